@@ -1,19 +1,26 @@
 #include "CGIHandler.hpp"
 #include "../utils/StringUtils.hpp"  // Added for StringUtils::trim
 #include "../utils/DebugLogger.hpp"
+#include "../utils/FileUtils.hpp"
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <iostream>
 #include <sstream>
 #include <cstring>
 #include <cstdlib>
 #include <algorithm>  // Added for std::transform
 
+std::vector<pid_t> CGIHandler::_unreaped;
+pthread_mutex_t CGIHandler::_unreapedMutex = PTHREAD_MUTEX_INITIALIZER;
+
 CGIHandler::CGIHandler()
-    : _scriptPath(), _requestBody(), _responseBody(), _env(),
-      _cgiHeaders(), _pid(-1), _cgiExitStatus(0), _cgiExecutionError(false)
+    : _scriptPath(), _requestBody(), _inputOffset(0), _responseBody(), _headersParsed(false), _env(),
+      _cgiHeaders(), _pid(-1), _exitFd(-1), _cgiExitStatus(0), _cgiExecutionError(false)
 {
     _inputPipe[0] = -1;
     _inputPipe[1] = -1;
@@ -28,9 +35,33 @@ CGIHandler::~CGIHandler()
 
 bool CGIHandler::executeCGI(const Request& request, const std::string& scriptPath, 
                            const LocationConfig& location, Response& response)
+{
+    if (!start(request, scriptPath, location)) {
+        return false;
+    }
+    
+    if (!run()) {
+        LOG_ERROR("Failed to read from CGI");
+        _cleanup();
+        _cgiExecutionError = true;
+        return false;
+    }
+    
+    // Nothing else to do meanwhile, so wait for the exit status
+    _reap(true);
+    
+    return finish(response);
+}
+
+bool CGIHandler::start(const Request& request, const std::string& scriptPath, 
+                       const LocationConfig& location)
 {
     _scriptPath = scriptPath;
     _requestBody = request.getBody();
+    _inputOffset = 0;
+    _responseBody.clear();
+    _headersParsed = false;
+    _cgiHeaders.clear();
     
     // Reset error tracking fields
     _cgiExecutionError = false;
@@ -48,26 +79,17 @@ bool CGIHandler::executeCGI(const Request& request, const std::string& scriptPat
     
     // Check if we have a valid interpreter
     if (interpreterPath.empty()) {
-        std::stringstream ss;
-        ss << "No interpreter found for extension: " << extension;
-        std::cerr << ss.str() << std::endl;
-        DebugLogger::logError(ss.str());
+        LOG_WARN("No interpreter found for extension: " << extension);
         _cgiExecutionError = true;
         return false;
     }
     
     // Log the interpreter that will be used
-    std::stringstream interpreterLog;
-    interpreterLog << "Using interpreter: " << interpreterPath << " for extension: " << extension;
-    DebugLogger::log(interpreterLog.str());
+    LOG_DEBUG("Using interpreter: " << interpreterPath << " for extension: " << extension);
     
     // Extract PATH_INFO (part of the URL path after the script)
     std::string requestPath = request.getPath();
-    std::string scriptDir = scriptPath.substr(0, scriptPath.find_last_of('/'));
     std::string scriptName = scriptPath.substr(scriptPath.find_last_of('/') + 1);
-    
-    // Find the location path that matched this request
-    std::string locationPath = location.getPath();
     std::string pathInfo = "";
     
     // Calculate PATH_INFO (everything after the script in the URL path)
@@ -82,84 +104,211 @@ bool CGIHandler::executeCGI(const Request& request, const std::string& scriptPat
     // Setup environment variables
     _setupEnvironment(request, scriptPath, pathInfo, location);
     
-    // Create pipes for communication
-    if (pipe(_inputPipe) < 0 || pipe(_outputPipe) < 0) {
-        std::cerr << "Failed to create pipes for CGI: " << strerror(errno) << std::endl;
-        DebugLogger::logError("Failed to create pipes for CGI: " + std::string(strerror(errno)));
+    // Create pipes for communication. Every end is close-on-exec from the
+    // start so other scripts forked meanwhile, possibly by another event
+    // loop thread, never inherit it: a sibling holding our stdin open would
+    // keep the script from seeing EOF (dup2() clears the flag on the
+    // child's stdin/stdout copies)
+    if (!FileUtils::createPipe(_inputPipe, false) || !FileUtils::createPipe(_outputPipe, false)) {
+        LOG_ERROR("Failed to create pipes for CGI: " << strerror(errno));
         _cleanup();
         _cgiExecutionError = true;
         return false;
     }
     
-    // Set pipes to non-blocking mode
+    // The server's ends must never block the event loop
     int flags;
     
-    // Set input read pipe to non-blocking
-    flags = fcntl(_inputPipe[0], F_GETFL, 0);
-    fcntl(_inputPipe[0], F_SETFL, flags | O_NONBLOCK);
+    // Set input write end to non-blocking
+    flags = fcntl(_inputPipe[1], F_GETFL, 0);
+    fcntl(_inputPipe[1], F_SETFL, flags | O_NONBLOCK);
     
-    // Set output write pipe to non-blocking
-    flags = fcntl(_outputPipe[1], F_GETFL, 0);
-    fcntl(_outputPipe[1], F_SETFL, flags | O_NONBLOCK);
+    // Set output read end to non-blocking
+    flags = fcntl(_outputPipe[0], F_GETFL, 0);
+    fcntl(_outputPipe[0], F_SETFL, flags | O_NONBLOCK);
     
     // Execute CGI script with the appropriate interpreter
     if (!_executeCGI(interpreterPath)) {
-        std::cerr << "CGI execution failed" << std::endl;
-        DebugLogger::logError("CGI execution failed");
+        LOG_ERROR("CGI execution failed");
         _cleanup();
         _cgiExecutionError = true;
         return false;
     }
     
-    // Write request body to CGI
-    if (!_requestBody.empty() && !_writeToCGI()) {
-        DebugLogger::logError("Failed to write request body to CGI");
-        _cleanup();
-        _cgiExecutionError = true;
-        return false;
+#ifdef SYS_pidfd_open
+    // Lets an event loop learn about the exit without polling waitpid()
+    _exitFd = syscall(SYS_pidfd_open, _pid, 0);
+#endif
+    
+    // No request body: the script sees EOF on stdin right away
+    if (_requestBody.empty()) {
+        closeInput();
     }
     
-    // Close write end of input pipe after writing
-    if (_inputPipe[1] != -1) {
-        close(_inputPipe[1]);
-        _inputPipe[1] = -1;
+    return true;
+}
+
+int CGIHandler::getInputFd() const
+{
+    return _inputPipe[1];
+}
+
+int CGIHandler::getOutputFd() const
+{
+    return _outputPipe[0];
+}
+
+int CGIHandler::getExitFd() const
+{
+    return _exitFd;
+}
+
+CGIHandler::IOStatus CGIHandler::writeInput(size_t maxBytes)
+{
+    if (_inputPipe[1] < 0 || _inputOffset >= _requestBody.size()) {
+        return CGI_IO_DONE;
     }
     
-    // Read CGI output
-    if (!_readFromCGI()) {
-        DebugLogger::logError("Failed to read from CGI");
-        _cleanup();
-        _cgiExecutionError = true;
-        return false;
+    size_t written = 0;
+    while (_inputOffset < _requestBody.size() && written < maxBytes) {
+        size_t length = _requestBody.size() - _inputOffset;
+        if (length > maxBytes - written) {
+            length = maxBytes - written;
+        }
+        
+        ssize_t bytesWritten = write(_inputPipe[1], _requestBody.data() + _inputOffset, length);
+        
+        if (bytesWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Pipe full, try again on the next write event
+                return CGI_IO_AGAIN;
+            }
+            if (errno == EPIPE) {
+                // The script exited or closed stdin without reading everything
+                LOG_DEBUG("CGI stopped reading its input");
+                return CGI_IO_DONE;
+            }
+            
+            LOG_ERROR("Failed to write to CGI: " << strerror(errno));
+            return CGI_IO_ERROR;
+        }
+        
+        _inputOffset += bytesWritten;
+        written += bytesWritten;
     }
     
-    // Check exit status from the CGI process
-    if (_cgiExitStatus != 0) {
-        std::stringstream ss;
-        ss << "CGI process exited with non-zero status: " << _cgiExitStatus;
-        DebugLogger::logError(ss.str());
+    return _inputOffset >= _requestBody.size() ? CGI_IO_DONE : CGI_IO_AGAIN;
+}
+
+CGIHandler::IOStatus CGIHandler::readOutput(size_t maxBytes)
+{
+    if (_outputPipe[0] < 0) {
+        return CGI_IO_DONE;
+    }
+    
+    char buffer[16384];
+    size_t total = 0;
+    
+    while (total < maxBytes) {
+        ssize_t bytesRead = read(_outputPipe[0], buffer, sizeof(buffer));
         
-        // If we don't have any content but have an error, set a more specific error
-        if (_responseBody.empty()) {
+        if (bytesRead > 0) {
+            _responseBody.append(buffer, bytesRead);
+            total += bytesRead;
+        } else if (bytesRead == 0) {
+            // End of output
+            return CGI_IO_DONE;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // No data available yet
+            return CGI_IO_AGAIN;
+        } else {
+            // Error reading from pipe
+            LOG_ERROR("Failed to read from CGI: " << strerror(errno));
             _cgiExecutionError = true;
-            _cleanup();
-            return false;
+            return CGI_IO_ERROR;
         }
     }
     
-    // Parse CGI output to separate headers and body
-    _parseCGIOutput();
+    // Budget spent, the pipe stays readable
+    return CGI_IO_AGAIN;
+}
+
+void CGIHandler::closeInput()
+{
+    if (_inputPipe[1] != -1) {
+        close(_inputPipe[1]);
+        _inputPipe[1] = -1;
+    }
+}
+
+void CGIHandler::closeOutput()
+{
+    if (_outputPipe[0] != -1) {
+        close(_outputPipe[0]);
+        _outputPipe[0] = -1;
+    }
+}
+
+bool CGIHandler::checkExit()
+{
+    if (_pid <= 0) {
+        return true;
+    }
     
-    // If execution error and no content, don't create a response
-    if (_cgiExecutionError && _responseBody.empty()) {
-        DebugLogger::logError("CGI execution error with no content");
-        _cleanup();
+    int status;
+    pid_t waitResult = waitpid(_pid, &status, WNOHANG);
+    if (waitResult == 0) {
         return false;
     }
+    if (waitResult > 0) {
+        _recordExitStatus(status);
+    }
+    _pid = -1;
+    return true;
+}
+
+bool CGIHandler::parseHeaders(bool eof)
+{
+    if (_headersParsed) {
+        return true;
+    }
+    
+    // Find the dividing line between headers and body (CRLF or bare LF lines)
+    size_t headerEnd = _responseBody.find("\r\n\r\n");
+    size_t separatorLength = 4;
+    size_t lfEnd = _responseBody.find("\n\n");
+    if (lfEnd != std::string::npos && (headerEnd == std::string::npos || lfEnd < headerEnd)) {
+        headerEnd = lfEnd;
+        separatorLength = 2;
+    }
     
-    // Set response based on CGI output
+    if (headerEnd == std::string::npos) {
+        if (!eof && _responseBody.size() < MAX_HEADER_SIZE) {
+            return false;  // Header block not complete yet
+        }
+        // No headers, assume entire output is body
+        LOG_DEBUG("No headers found in CGI output, assuming entire output is body");
+        _headersParsed = true;
+        return true;
+    }
+    
+    // Extract headers section, then remove it from the response body
+    _parseHeaderLines(_responseBody.substr(0, headerEnd));
+    _responseBody.erase(0, headerEnd + separatorLength);
+    _headersParsed = true;
+    return true;
+}
+
+void CGIHandler::applyHeaders(Response& response) const
+{
     // Set status code if provided by CGI, default to 200 OK
     std::map<std::string, std::string>::const_iterator statusIt = _cgiHeaders.find("status");
+    response.setStatusCode(HTTP_STATUS_OK);
     if (statusIt != _cgiHeaders.end()) {
         std::istringstream iss(statusIt->second);
         int statusCode;
@@ -167,8 +316,6 @@ bool CGIHandler::executeCGI(const Request& request, const std::string& scriptPat
         if (iss && statusCode >= 100 && statusCode < 600) {
             response.setStatusCode(statusCode);
         }
-    } else {
-        response.setStatusCode(HTTP_STATUS_OK);
     }
     
     // Set Content-Type if provided by CGI
@@ -179,9 +326,6 @@ bool CGIHandler::executeCGI(const Request& request, const std::string& scriptPat
         response.setContentType("text/html");
     }
     
-    // Set response body
-    response.setBody(_responseBody);
-    
     // Set additional headers from CGI
     for (std::map<std::string, std::string>::const_iterator it = _cgiHeaders.begin(); 
          it != _cgiHeaders.end(); ++it) {
@@ -191,12 +335,128 @@ bool CGIHandler::executeCGI(const Request& request, const std::string& scriptPat
             response.setHeader(it->first, it->second);
         }
     }
+}
+
+bool CGIHandler::getContentLength(size_t& length) const
+{
+    std::map<std::string, std::string>::const_iterator it = _cgiHeaders.find("content-length");
+    if (it == _cgiHeaders.end() || it->second.empty() ||
+        it->second.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    std::istringstream iss(it->second);
+    iss >> length;
+    return !iss.fail();
+}
+
+void CGIHandler::takeOutput(std::string& out)
+{
+    out.clear();
+    out.swap(_responseBody);
+}
+
+void CGIHandler::detach()
+{
+    closeInput();
+    closeOutput();
+    _reap(false);
+    _cleanup();
+}
+
+bool CGIHandler::run()
+{
+    // Wait on whichever pipe ends are still open instead of spinning
+    while (_outputPipe[0] >= 0) {
+        struct pollfd fds[2];
+        nfds_t count = 0;
+        
+        fds[count].fd = _outputPipe[0];
+        fds[count].events = POLLIN;
+        fds[count].revents = 0;
+        ++count;
+        
+        if (_inputPipe[1] >= 0) {
+            fds[count].fd = _inputPipe[1];
+            fds[count].events = POLLOUT;
+            fds[count].revents = 0;
+            ++count;
+        }
+        
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("poll() failed while running CGI: " << strerror(errno));
+            _cgiExecutionError = true;
+            return false;
+        }
+        
+        if (count > 1 && fds[1].revents != 0) {
+            IOStatus status = writeInput(static_cast<size_t>(-1));
+            if (status == CGI_IO_ERROR) {
+                _cgiExecutionError = true;
+                return false;
+            }
+            if (status == CGI_IO_DONE) {
+                closeInput();
+            }
+        }
+        
+        if (fds[0].revents != 0) {
+            IOStatus status = readOutput(static_cast<size_t>(-1));
+            if (status == CGI_IO_ERROR) {
+                return false;
+            }
+            if (status == CGI_IO_DONE) {
+                closeOutput();
+            }
+        }
+    }
+    
+    closeInput();
+    return true;
+}
+
+bool CGIHandler::finish(Response& response)
+{
+    // Both pipes are done with
+    closeInput();
+    closeOutput();
+    
+    // The output ended, so the script has normally exited already
+    _reap(false);
+    
+    // Check exit status from the CGI process
+    if (_cgiExitStatus != 0) {
+        LOG_WARN("CGI process exited with non-zero status: " << _cgiExitStatus);
+        
+        // If we don't have any content but have an error, set a more specific error
+        if (_responseBody.empty()) {
+            _cgiExecutionError = true;
+            _cleanup();
+            return false;
+        }
+    }
+    
+    // Parse CGI output to separate headers and body
+    parseHeaders(true);
+    
+    // If execution error and no content, don't create a response
+    if (_cgiExecutionError && _responseBody.empty()) {
+        LOG_WARN("CGI execution error with no content");
+        _cleanup();
+        return false;
+    }
+    
+    // Set response body first: setBody() resets Content-Type
+    response.setBody(_responseBody);
+    applyHeaders(response);
     
     // Log success or failure
     if (_cgiExecutionError) {
-        DebugLogger::logError("CGI execution had errors but produced output");
+        LOG_WARN("CGI execution had errors but produced output");
     } else {
-        DebugLogger::log("CGI execution successful for: " + scriptPath);
+        LOG_DEBUG("CGI execution successful for: " << _scriptPath);
     }
     
     _cleanup();
@@ -240,11 +500,8 @@ void CGIHandler::_setupEnvironment(const Request& request, const std::string& sc
     
     // Copy HTTP headers to environment variables
     const Headers& headers = request.getHeaders();
-    const std::map<std::string, std::string>& allHeaders = headers.getAll();
-    
-    for (std::map<std::string, std::string>::const_iterator it = allHeaders.begin(); 
-         it != allHeaders.end(); ++it) {
-        std::string name = it->first;
+    for (size_t i = 0; i < headers.size(); ++i) {
+        std::string name = headers.at(i).name;
         
         // Convert header name to CGI format (HTTP_HEADER_NAME)
         std::transform(name.begin(), name.end(), name.begin(), ::toupper);
@@ -256,7 +513,7 @@ void CGIHandler::_setupEnvironment(const Request& request, const std::string& sc
             }
         }
         
-        _env["HTTP_" + name] = it->second;
+        _env["HTTP_" + name] = headers.at(i).value;
     }
     
     // CGI path information
@@ -269,95 +526,80 @@ void CGIHandler::_setupEnvironment(const Request& request, const std::string& sc
     }
 }
 
+/**
+ * Report an error from a forked child and exit. Only async-signal-safe
+ * calls are allowed there: another thread may have held the malloc or
+ * iostream locks when fork() copied the process.
+ */
+static void childFail(const char* message)
+{
+    ssize_t ignored = write(STDERR_FILENO, message, strlen(message));
+    (void)ignored;
+    _exit(EXIT_FAILURE);
+}
+
 bool CGIHandler::_executeCGI(const std::string& interpreterPath)
 {
+    // Check the script and interpreter before forking
+    if (access(_scriptPath.c_str(), F_OK) != 0) {
+        LOG_ERROR("CGI script does not exist: " << _scriptPath);
+        return false;
+    }
+    if (access(interpreterPath.c_str(), F_OK) != 0) {
+        LOG_ERROR("CGI interpreter does not exist: " << interpreterPath);
+        return false;
+    }
+    if (access(interpreterPath.c_str(), X_OK) != 0) {
+        LOG_ERROR("CGI interpreter is not executable: " << interpreterPath);
+        return false;
+    }
+    
+    // Everything the child needs is built here, it must not allocate
+    size_t lastSlash = _scriptPath.find_last_of('/');
+    std::string scriptDir = (lastSlash == std::string::npos) ? "." :
+                            (lastSlash == 0) ? "/" : _scriptPath.substr(0, lastSlash);
+    
+    std::vector<std::string> envStrings;
+    envStrings.reserve(_env.size());
+    for (std::map<std::string, std::string>::const_iterator it = _env.begin(); 
+         it != _env.end(); ++it) {
+        envStrings.push_back(it->first + "=" + it->second);
+    }
+    std::vector<char*> envp;
+    envp.reserve(envStrings.size() + 1);
+    for (size_t i = 0; i < envStrings.size(); ++i) {
+        envp.push_back(&envStrings[i][0]);
+    }
+    envp.push_back(NULL);
+    
+    char* const argv[] = { 
+        const_cast<char*>(interpreterPath.c_str()),   // Interpreter path
+        const_cast<char*>(_scriptPath.c_str()),       // Script path
+        NULL 
+    };
+    
     _pid = fork();
     
     if (_pid < 0) {
-        std::cerr << "Failed to fork for CGI: " << strerror(errno) << std::endl;
-        DebugLogger::logError("Failed to fork for CGI: " + std::string(strerror(errno)));
+        LOG_ERROR("Failed to fork for CGI: " << strerror(errno));
         return false;
     }
     
     if (_pid == 0) {
-        // Child process
-        
-        // Redirect stdin to input pipe
+        // Child process: the pipe ends are close-on-exec, only the copies
+        // made by dup2() survive execve()
         if (dup2(_inputPipe[0], STDIN_FILENO) < 0) {
-            std::cerr << "Failed to redirect stdin: " << strerror(errno) << std::endl;
-            exit(EXIT_FAILURE);
+            childFail("webserv: CGI: failed to redirect stdin\n");
         }
-        
-        // Redirect stdout to output pipe
         if (dup2(_outputPipe[1], STDOUT_FILENO) < 0) {
-            std::cerr << "Failed to redirect stdout: " << strerror(errno) << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        
-        // Close unused pipe ends
-        close(_inputPipe[0]);
-        close(_inputPipe[1]);
-        close(_outputPipe[0]);
-        close(_outputPipe[1]);
-        
-        // Check if script exists and is accessible
-        if (access(_scriptPath.c_str(), F_OK) != 0) {
-            std::cerr << "CGI script does not exist: " << _scriptPath << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        
-        // Check if interpreter exists and is executable
-        if (access(interpreterPath.c_str(), F_OK) != 0) {
-            std::cerr << "CGI interpreter does not exist: " << interpreterPath << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        
-        if (access(interpreterPath.c_str(), X_OK) != 0) {
-            std::cerr << "CGI interpreter is not executable: " << interpreterPath << std::endl;
-            exit(EXIT_FAILURE);
+            childFail("webserv: CGI: failed to redirect stdout\n");
         }
-        
-        // Change directory to the script's directory
-        std::string scriptDir = _scriptPath.substr(0, _scriptPath.find_last_of('/'));
         if (chdir(scriptDir.c_str()) < 0) {
-            std::cerr << "Failed to change directory: " << strerror(errno) << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        
-        // Prepare environment variables
-        char** envp = new char*[_env.size() + 1];
-        size_t i = 0;
-        
-        for (std::map<std::string, std::string>::const_iterator it = _env.begin(); 
-             it != _env.end(); ++it) {
-            std::string env = it->first + "=" + it->second;
-            envp[i] = new char[env.length() + 1];
-            std::strcpy(envp[i], env.c_str());
-            ++i;
+            childFail("webserv: CGI: failed to change directory\n");
         }
         
-        envp[i] = NULL;
-        
-        // Prepare command and arguments
-        char* const argv[] = { 
-            const_cast<char*>(interpreterPath.c_str()),   // Interpreter path
-            const_cast<char*>(_scriptPath.c_str()),       // Script path
-            NULL 
-        };
-        
-        // Execute CGI script
-        execve(interpreterPath.c_str(), argv, envp);
-        
-        // If execve returns, there was an error
-        std::cerr << "Failed to execute CGI script: " << strerror(errno) << std::endl;
-        
-        // Clean up memory
-        for (size_t j = 0; j < i; ++j) {
-            delete[] envp[j];
-        }
-        delete[] envp;
-        
-        exit(EXIT_FAILURE);
+        execve(interpreterPath.c_str(), argv, &envp[0]);
+        childFail("webserv: CGI: failed to execute the interpreter\n");
     }
     
     // Parent process
@@ -372,179 +614,79 @@ bool CGIHandler::_executeCGI(const std::string& interpreterPath)
     return true;
 }
 
-bool CGIHandler::_writeToCGI()
+void CGIHandler::_reap(bool block)
 {
-    if (_inputPipe[1] < 0 || _requestBody.empty()) {
-        return true;
+    if (_pid <= 0) {
+        return;
     }
     
-    ssize_t bytesWritten = write(_inputPipe[1], _requestBody.c_str(), _requestBody.size());
+    int status;
+    pid_t waitResult = waitpid(_pid, &status, block ? 0 : WNOHANG);
     
-    if (bytesWritten < 0) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            // Try again later
-            return true;
-        }
-        
-        std::cerr << "Failed to write to CGI: " << strerror(errno) << std::endl;
-        DebugLogger::logError("Failed to write to CGI: " + std::string(strerror(errno)));
-        return false;
+    if (waitResult > 0) {
+        _recordExitStatus(status);
+    } else if (waitResult == 0) {
+        // Closed its stdout but still running: don't wait, collect it later
+        LOG_DEBUG("CGI process still running after end of output, reaping later");
+        _deferReap(_pid);
+    } else {
+        LOG_ERROR("Error waiting for CGI process: " << strerror(errno));
+        _cgiExecutionError = true;
     }
-    
-    // In a real implementation, we might need to handle partial writes and try again
-    // For simplicity, we're assuming the write completes in one go
-    
-    return true;
+    _pid = -1;
 }
 
-bool CGIHandler::_readFromCGI()
+void CGIHandler::_recordExitStatus(int status)
 {
-    if (_outputPipe[0] < 0) {
-        DebugLogger::logError("Output pipe not valid");
-        return false;
-    }
-    
-    char buffer[4096];
-    ssize_t bytesRead;
-    bool done = false;
-    bool processExited = false;
-    
-    // Read output until the process completes
-    while (!done) {
-        bytesRead = read(_outputPipe[0], buffer, sizeof(buffer) - 1);
-        
-        if (bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-            _responseBody += buffer;
-        } else if (bytesRead == 0) {
-            // End of output
-            done = true;
-        } else {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // No data available yet, check if the process has finished
-                if (!processExited) {
-                    int status;
-                    int waitResult = waitpid(_pid, &status, WNOHANG);
-                    
-                    if (waitResult > 0) {
-                        // Process has exited, store the exit status
-                        processExited = true;
-                        
-                        if (WIFEXITED(status)) {
-                            // Process exited normally, store exit code
-                            _cgiExitStatus = WEXITSTATUS(status);
-                            if (_cgiExitStatus != 0) {
-                                // Non-zero exit code means there was an error
-                                std::cerr << "CGI process exited with non-zero status: " << _cgiExitStatus << std::endl;
-                                std::stringstream ss;
-                                ss << "CGI process exited with status: " << _cgiExitStatus;
-                                DebugLogger::logError(ss.str());
-                                _cgiExecutionError = true;
-                            }
-                        } else if (WIFSIGNALED(status)) {
-                            // Process was terminated by a signal
-                            _cgiExitStatus = 128 + WTERMSIG(status);
-                            std::cerr << "CGI process terminated by signal: " << WTERMSIG(status) << std::endl;
-                            std::stringstream ssig;
-                            ssig << "CGI process terminated by signal: " << WTERMSIG(status);
-                            DebugLogger::logError(ssig.str());
-                            _cgiExecutionError = true;
-                        } else {
-                            // Other types of termination
-                            _cgiExitStatus = 1; // Generic error
-                            std::cerr << "CGI process terminated abnormally" << std::endl;
-                            DebugLogger::logError("CGI process terminated abnormally");
-                            _cgiExecutionError = true;
-                        }
-                        
-                        // If there's no more data to read, we're done
-                        if (_responseBody.empty()) {
-                            done = true;
-                        }
-                    } else if (waitResult < 0) {
-                        // Error checking process status
-                        std::cerr << "Error checking CGI process status: " << strerror(errno) << std::endl;
-                        DebugLogger::logError("Error checking CGI process status: " + std::string(strerror(errno)));
-                        _cgiExecutionError = true;
-                        return false;
-                    }
-                    
-                    // If we've waited long enough with no data and the process hasn't exited,
-                    // consider killing it after a timeout (not implemented here)
-                }
-                
-                // Wait a bit for more data
-                usleep(1000); // 1ms
-            } else {
-                // Error reading from pipe
-                std::cerr << "Failed to read from CGI: " << strerror(errno) << std::endl;
-                DebugLogger::logError("Failed to read from CGI: " + std::string(strerror(errno)));
-                _cgiExecutionError = true;
-                return false;
-            }
+    if (WIFEXITED(status)) {
+        // Process exited normally, store exit code
+        _cgiExitStatus = WEXITSTATUS(status);
+        if (_cgiExitStatus != 0) {
+            // Non-zero exit code means there was an error
+            LOG_WARN("CGI process exited with status: " << _cgiExitStatus);
+            _cgiExecutionError = true;
         }
+    } else if (WIFSIGNALED(status)) {
+        // Process was terminated by a signal
+        _cgiExitStatus = 128 + WTERMSIG(status);
+        LOG_WARN("CGI process terminated by signal: " << WTERMSIG(status));
+        _cgiExecutionError = true;
+    } else {
+        // Other types of termination
+        _cgiExitStatus = 1; // Generic error
+        LOG_ERROR("CGI process terminated abnormally");
+        _cgiExecutionError = true;
     }
-    
-    // If we haven't already waited for the process, do it now
-    if (!processExited) {
+}
+
+void CGIHandler::_deferReap(pid_t pid)
+{
+    pthread_mutex_lock(&_unreapedMutex);
+    _unreaped.push_back(pid);
+    pthread_mutex_unlock(&_unreapedMutex);
+}
+
+void CGIHandler::reapChildren()
+{
+    pthread_mutex_lock(&_unreapedMutex);
+    for (size_t i = 0; i < _unreaped.size(); ) {
         int status;
-        pid_t waitResult = waitpid(_pid, &status, 0);
-        
-        if (waitResult > 0) {
-            if (WIFEXITED(status)) {
-                _cgiExitStatus = WEXITSTATUS(status);
-                if (_cgiExitStatus != 0) {
-                    std::cerr << "CGI process exited with non-zero status: " << _cgiExitStatus << std::endl;
-                    std::stringstream ss;
-                    ss << "CGI process exited with status: " << _cgiExitStatus;
-                    DebugLogger::logError(ss.str());
-                    _cgiExecutionError = true;
-                }
-            } else if (WIFSIGNALED(status)) {
-                _cgiExitStatus = 128 + WTERMSIG(status);
-                std::cerr << "CGI process terminated by signal: " << WTERMSIG(status) << std::endl;
-                std::stringstream ssig;
-                ssig << "CGI process terminated by signal: " << WTERMSIG(status);
-                DebugLogger::logError(ssig.str());
-                _cgiExecutionError = true;
-            } else {
-                _cgiExitStatus = 1;
-                std::cerr << "CGI process terminated abnormally" << std::endl;
-                DebugLogger::logError("CGI process terminated abnormally");
-                _cgiExecutionError = true;
-            }
-        } else if (waitResult < 0) {
-            std::cerr << "Error waiting for CGI process: " << strerror(errno) << std::endl;
-            DebugLogger::logError("Error waiting for CGI process: " + std::string(strerror(errno)));
-            _cgiExecutionError = true;
-            return false;
+        if (waitpid(_unreaped[i], &status, WNOHANG) != 0) {
+            // Reaped (or already gone)
+            _unreaped[i] = _unreaped.back();
+            _unreaped.pop_back();
+        } else {
+            ++i;
         }
     }
-    
-    // At this point, we should have all the output and the exit status
-    return true;
+    pthread_mutex_unlock(&_unreapedMutex);
 }
 
-void CGIHandler::_parseCGIOutput()
+void CGIHandler::_parseHeaderLines(const std::string& headers)
 {
     // Clear previous headers
     _cgiHeaders.clear();
     
-    // Find the dividing line between headers and body
-    size_t headerEnd = _responseBody.find("\r\n\r\n");
-    
-    if (headerEnd == std::string::npos) {
-        // No headers, assume entire output is body
-        DebugLogger::log("No headers found in CGI output, assuming entire output is body");
-        return;
-    }
-    
-    // Extract headers section
-    std::string headers = _responseBody.substr(0, headerEnd);
-    
-    // Remove headers from response body
-    _responseBody = _responseBody.substr(headerEnd + 4);
-    
     // Parse headers
     std::istringstream iss(headers);
     std::string line;
@@ -601,6 +743,10 @@ void CGIHandler::_cleanup()
         close(_outputPipe[1]);
         _outputPipe[1] = -1;
     }
+    if (_exitFd != -1) {
+        close(_exitFd);
+        _exitFd = -1;
+    }
     
     // Check if child process is still running
     if (_pid > 0) {
@@ -609,22 +755,13 @@ void CGIHandler::_cleanup()
         pid_t result = waitpid(_pid, &status, WNOHANG);
         
         if (result == 0) {
-            // Process is still running, kill it
-            DebugLogger::logError("CGI process still running, sending SIGTERM");
-            kill(_pid, SIGTERM);
-            
-            // Wait a bit for it to terminate
-            usleep(1000); // 1ms
+            // Nobody wants its output anymore
+            LOG_WARN("CGI process still running, sending SIGKILL");
+            kill(_pid, SIGKILL);
             
-            // Check if it's still running
-            result = waitpid(_pid, &status, WNOHANG);
-            if (result == 0) {
-                // Still running, force kill
-                DebugLogger::logError("CGI process still running after SIGTERM, sending SIGKILL");
-                kill(_pid, SIGKILL);
-                
-                // Wait for it to terminate
-                waitpid(_pid, &status, 0);
+            // Usually gone at once; otherwise reaped on a later pass
+            if (waitpid(_pid, &status, WNOHANG) == 0) {
+                _deferReap(_pid);
             }
         }
         
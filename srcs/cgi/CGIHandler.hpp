@@ -3,16 +3,42 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <pthread.h>
 #include "../http/Request.hpp"
 #include "../http/Response.hpp"
 #include "../config/parser/LocationConfig.hpp"
 
+/**
+ * @brief Runs one CGI script without blocking the caller
+ *
+ * start() forks the script with non-blocking pipes. The owner monitors
+ * getInputFd() for writing and getOutputFd() for reading, calls
+ * writeInput()/readOutput() as they become ready and closes each pipe once
+ * it reports CGI_IO_DONE. finish() then turns the collected output into a
+ * Response. executeCGI() does all of this in one blocking call.
+ *
+ * To stream instead, the owner calls parseHeaders() as output arrives,
+ * applyHeaders() once it succeeds, then relays takeOutput() slices and
+ * ends with detach().
+ */
 class CGIHandler {
+public:
+    /**
+     * @brief Outcome of a non-blocking pipe operation
+     */
+    enum IOStatus {
+        CGI_IO_AGAIN,   // Pipe would block, wait for the next readiness event
+        CGI_IO_DONE,    // Request body fully written / end of script output
+        CGI_IO_ERROR    // Pipe error
+    };
+
 private:
     // Input/output for CGI
     std::string _scriptPath;
     std::string _requestBody;
-    std::string _responseBody;
+    size_t _inputOffset;        // Bytes of the request body already written
+    std::string _responseBody; // Script output not yet consumed (header block removed once parsed)
+    bool _headersParsed;       // CGI header block parsed into _cgiHeaders
     
     // Environment variables
     std::map<std::string, std::string> _env;
@@ -24,11 +50,19 @@ private:
     pid_t _pid;
     int _inputPipe[2];  // Server to CGI
     int _outputPipe[2]; // CGI to Server
+    int _exitFd;        // pidfd, readable once the script exits (-1 if unsupported)
     
     // Error tracking
     int _cgiExitStatus;        // Exit status of the CGI process
     bool _cgiExecutionError;   // Flag indicating execution error
     
+    // Children that outlived their handler, reaped by reapChildren()
+    static std::vector<pid_t> _unreaped;
+    static pthread_mutex_t _unreapedMutex;  // Event loop threads share the list
+    
+    // Hand a child that is still running over to reapChildren()
+    static void _deferReap(pid_t pid);
+    
     // Set up environment variables from request
     void _setupEnvironment(const Request& request, const std::string& scriptPath, 
                           const std::string& pathInfo, const LocationConfig& location);
@@ -36,14 +70,14 @@ private:
     // Execute the CGI script
     bool _executeCGI(const std::string& cgiPath);
     
-    // Read output from CGI
-    bool _readFromCGI();
+    // Collect the exit status, or hand a running child to reapChildren()
+    void _reap(bool block);
     
-    // Write input to CGI
-    bool _writeToCGI();
+    // Record the exit status reported by waitpid()
+    void _recordExitStatus(int status);
     
-    // Parse CGI output to separate headers and body
-    void _parseCGIOutput();
+    // Parse the lines of the CGI header block into _cgiHeaders
+    void _parseHeaderLines(const std::string& headers);
     
     // Clean up process and pipes
     void _cleanup();
@@ -52,10 +86,60 @@ public:
     CGIHandler();
     ~CGIHandler();
     
-    // Process a request through CGI
+    // Process a request through CGI, blocking until the script exits
     bool executeCGI(const Request& request, const std::string& scriptPath, 
                    const LocationConfig& location, Response& response);
     
+    // Fork the script with non-blocking pipes, return false if it could not start
+    bool start(const Request& request, const std::string& scriptPath, 
+               const LocationConfig& location);
+    
+    // Descriptors to monitor, -1 once closed or unavailable
+    int getInputFd() const;
+    int getOutputFd() const;
+    int getExitFd() const;
+    
+    // Write more of the request body, at most maxBytes
+    IOStatus writeInput(size_t maxBytes);
+    
+    // Read available script output, at most maxBytes
+    IOStatus readOutput(size_t maxBytes);
+    
+    // Close a pipe end once it reported CGI_IO_DONE (or is no longer needed)
+    void closeInput();
+    void closeOutput();
+    
+    // Reap the script if it has exited, return false while it is still running
+    bool checkExit();
+    
+    // Drive both pipes with poll() until the output ends (no event loop available)
+    bool run();
+    
+    // Reap the script and fill the response from its output
+    bool finish(Response& response);
+    
+    // Split the header block off the output collected so far; at eof, or
+    // once MAX_HEADER_SIZE bytes came without one, the output is all body
+    bool parseHeaders(bool eof);
+    
+    // Set status, Content-Type and the other CGI headers (parseHeaders() must have succeeded)
+    void applyHeaders(Response& response) const;
+    
+    // Content-Length announced by the script, false if none or invalid
+    bool getContentLength(size_t& length) const;
+    
+    // Move the body bytes collected so far into out
+    void takeOutput(std::string& out);
+    
+    // Close the pipes and let the script finish on its own (no kill)
+    void detach();
+    
+    // Largest CGI header block accepted before the output is treated as body
+    static const size_t MAX_HEADER_SIZE = 8192;
+    
+    // Collect children that exited after their handler was gone
+    static void reapChildren();
+    
     // Get the CGI output
     const std::string& getResponseBody() const;
     
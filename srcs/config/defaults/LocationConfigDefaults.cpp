@@ -4,6 +4,8 @@ void    LocationConfigDefaults::setDefaults(LocationConfig& config)
 {
     _setDefaultAllowedMethods(config);
     _setDefaultIndex(config);
+    _setDefaultFileCacheMaxEntry(config);
+    _setDefaultGzip(config);
 }
 
 void    LocationConfigDefaults::_setDefaultAllowedMethods(LocationConfig& config)
@@ -23,3 +25,34 @@ void    LocationConfigDefaults::_setDefaultIndex(LocationConfig& config)
         config.setIndex("index.html");
     }
 }
+
+void    LocationConfigDefaults::_setDefaultFileCacheMaxEntry(LocationConfig& config)
+{
+    // If not set, cache files up to 1MB (only used when the server enables file_cache_size)
+    if (config.getFileCacheMaxEntry() == DEFAULT_CACHE_ENTRY_SIZE) {
+        config.setFileCacheMaxEntry(1024 * 1024); // 1MB
+    }
+}
+
+
+void    LocationConfigDefaults::_setDefaultGzip(LocationConfig& config)
+{
+    // Text formats only: images, video and archives are compressed already
+    if (config.getGzipTypes().empty()) {
+        std::vector<std::string> types;
+        types.push_back("text/html");
+        types.push_back("text/css");
+        types.push_back("text/plain");
+        types.push_back("text/xml");
+        types.push_back("application/javascript");
+        types.push_back("application/json");
+        types.push_back("application/xml");
+        types.push_back("image/svg+xml");
+        config.setGzipTypes(types);
+    }
+    
+    // Below 1K the gzip header and CPU time outweigh the bytes saved
+    if (config.getGzipMinLength() == DEFAULT_GZIP_MIN_LENGTH) {
+        config.setGzipMinLength(1024);
+    }
+}
\ No newline at end of file
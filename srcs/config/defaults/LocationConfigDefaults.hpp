@@ -31,4 +31,18 @@ private:
      * @param config LocationConfig object to set defaults for
      */
     static void _setDefaultIndex(LocationConfig& config);
+
+    /**
+     * @brief Sets the default largest cacheable file if not defined
+     * 
+     * @param config LocationConfig object to set defaults for
+     */
+    static void _setDefaultFileCacheMaxEntry(LocationConfig& config);
+
+    /**
+     * @brief Sets the default gzip_types and gzip_min_length if not defined
+     * 
+     * @param config LocationConfig object to set defaults for
+     */
+    static void _setDefaultGzip(LocationConfig& config);
 };
\ No newline at end of file
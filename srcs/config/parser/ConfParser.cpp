@@ -2,7 +2,7 @@
 #include "ConfParser.hpp"
 #include <sstream>
 
-ConfParser::ConfParser(const std::string& filename) : _filename(filename), _configFile(), _servers()
+ConfParser::ConfParser(const std::string& filename) : _filename(filename), _configFile(), _servers(), _globalConfig()
 {
 	_openFile();
 	_parseConfigFile();
@@ -28,6 +28,7 @@ ConfParser&	ConfParser::operator=( const ConfParser& other )
 /*** Getter ***/
 const std::string&					ConfParser::getFilename( void ) const { return _filename; }
 const std::vector<ServerConfig*>&	ConfParser::getServers( void ) const { return _servers; }
+const GlobalConfig&					ConfParser::getGlobalConfig( void ) const { return _globalConfig; }
 
 /*** Setter ***/
 void	ConfParser::setFilename( const std::string& filename ) { _filename = filename; }
@@ -79,6 +80,8 @@ void	ConfParser::_parseConfigFile( void )
 			server->parseServerBlock(_configFile);
 			_addServer(server);
 		}
+		else if (_globalConfig.parseDirective(key, line))
+			continue;
 		else
 			throw ConfigException("Unexpected directive outside of server block: " + key);
 	}
@@ -160,6 +163,7 @@ std::ostream&	operator<<( std::ostream& os, const ConfParser& parser )
 {
 	os << "ConfParser {" << std::endl;
 	os << "    Filename: " << parser.getFilename() << std::endl;
+	os << "    " << parser.getGlobalConfig();
 	os << "        Servers: " << std::endl;
 
 	for (std::vector<ServerConfig*>::const_iterator it = parser.getServers().begin(); it != parser.getServers().end(); ++it)
@@ -11,6 +11,7 @@
 #include "../defaults/LocationConfigDefaults.hpp"
 
 #include "ServerConfig.hpp"
+#include "GlobalConfig.hpp"
 
 class ServerConfig;
 
@@ -33,6 +34,7 @@ public:
 
 	const std::string&					getFilename(void) const;
 	const std::vector<ServerConfig*>&	getServers(void) const;
+	const GlobalConfig&					getGlobalConfig(void) const;
 
 	void	setFilename(const std::string& filename);
 	void	setServers(const std::vector<ServerConfig*>& servers);
@@ -41,6 +43,7 @@ private:
 	std::string					_filename;
 	std::ifstream				_configFile;
     std::vector<ServerConfig*>	_servers;
+	GlobalConfig				_globalConfig;
 
 	void	_openFile(void);
 	void	_addServer(ServerConfig* server);
@@ -0,0 +1,366 @@
+#include "GlobalConfig.hpp"
+#include <cstdlib>
+#include <unistd.h>
+
+const char* const	GlobalConfig::DEFAULT_ACCESS_LOG_FORMAT =
+	"$remote_addr - [$time_local] \"$request\" $status $body_bytes_sent "
+	"$request_time $upstream_response_time \"$http_user_agent\"";
+
+GlobalConfig::GlobalConfig()
+#ifdef __linux__
+	: _eventBackend(BACKEND_EPOLL),
+#else
+	: _eventBackend(BACKEND_POLL),
+#endif
+	  _edgeTriggered(false),
+	  _readBufferSize(DEFAULT_READ_BUFFER_SIZE),
+	  _ioBudget(DEFAULT_IO_BUDGET),
+	  _workerProcesses(1),
+	  _workerCpuAffinity(false),
+	  _workerThreads(1),
+	  _acceptBatch(DEFAULT_ACCEPT_BATCH),
+	  _clientHeaderTimeout(DEFAULT_TIMEOUT),
+	  _clientBodyTimeout(DEFAULT_TIMEOUT),
+	  _sendTimeout(DEFAULT_TIMEOUT),
+	  _keepaliveTimeout(DEFAULT_TIMEOUT),
+	  _accessLog(),
+	  _accessLogFormat(DEFAULT_ACCESS_LOG_FORMAT),
+	  _accessLogBufferSize(DEFAULT_ACCESS_LOG_BUFFER),
+	  _accessLogFlush(DEFAULT_ACCESS_LOG_FLUSH)
+{
+}
+
+GlobalConfig::~GlobalConfig() {}
+
+/*** Private ***/
+GlobalConfig::GlobalConfig( const GlobalConfig& other ) { (void)other; }
+
+GlobalConfig&	GlobalConfig::operator=( const GlobalConfig& other )
+{
+	(void)other;
+	return *this;
+}
+
+/*** Getter ***/
+const GlobalConfig::EventBackend&	GlobalConfig::getEventBackend( void ) const { return _eventBackend; }
+bool								GlobalConfig::isEdgeTriggered( void ) const { return _edgeTriggered; }
+size_t								GlobalConfig::getReadBufferSize( void ) const { return _readBufferSize; }
+size_t								GlobalConfig::getIoBudget( void ) const { return _ioBudget; }
+size_t								GlobalConfig::getWorkerProcesses( void ) const { return _workerProcesses; }
+bool								GlobalConfig::hasWorkerCpuAffinity( void ) const { return _workerCpuAffinity; }
+size_t								GlobalConfig::getWorkerThreads( void ) const { return _workerThreads; }
+size_t								GlobalConfig::getClientHeaderTimeout( void ) const { return _clientHeaderTimeout; }
+size_t								GlobalConfig::getClientBodyTimeout( void ) const { return _clientBodyTimeout; }
+size_t								GlobalConfig::getSendTimeout( void ) const { return _sendTimeout; }
+size_t								GlobalConfig::getKeepaliveTimeout( void ) const { return _keepaliveTimeout; }
+size_t								GlobalConfig::getAcceptBatch( void ) const { return _acceptBatch; }
+const std::string&					GlobalConfig::getAccessLog( void ) const { return _accessLog; }
+const std::string&					GlobalConfig::getAccessLogFormat( void ) const { return _accessLogFormat; }
+size_t								GlobalConfig::getAccessLogBufferSize( void ) const { return _accessLogBufferSize; }
+size_t								GlobalConfig::getAccessLogFlush( void ) const { return _accessLogFlush; }
+
+/*** Setter ***/
+void	GlobalConfig::setEventBackend( const EventBackend& eventBackend ) { _eventBackend = eventBackend; }
+void	GlobalConfig::setEdgeTriggered( bool edgeTriggered ) { _edgeTriggered = edgeTriggered; }
+void	GlobalConfig::setReadBufferSize( size_t readBufferSize ) { _readBufferSize = readBufferSize; }
+void	GlobalConfig::setIoBudget( size_t ioBudget ) { _ioBudget = ioBudget; }
+void	GlobalConfig::setWorkerProcesses( size_t workerProcesses ) { _workerProcesses = workerProcesses; }
+void	GlobalConfig::setWorkerCpuAffinity( bool workerCpuAffinity ) { _workerCpuAffinity = workerCpuAffinity; }
+void	GlobalConfig::setWorkerThreads( size_t workerThreads ) { _workerThreads = workerThreads; }
+void	GlobalConfig::setClientHeaderTimeout( size_t clientHeaderTimeout ) { _clientHeaderTimeout = clientHeaderTimeout; }
+void	GlobalConfig::setClientBodyTimeout( size_t clientBodyTimeout ) { _clientBodyTimeout = clientBodyTimeout; }
+void	GlobalConfig::setSendTimeout( size_t sendTimeout ) { _sendTimeout = sendTimeout; }
+void	GlobalConfig::setKeepaliveTimeout( size_t keepaliveTimeout ) { _keepaliveTimeout = keepaliveTimeout; }
+void	GlobalConfig::setAcceptBatch( size_t acceptBatch ) { _acceptBatch = acceptBatch; }
+void	GlobalConfig::setAccessLog( const std::string& accessLog ) { _accessLog = accessLog; }
+void	GlobalConfig::setAccessLogFormat( const std::string& accessLogFormat ) { _accessLogFormat = accessLogFormat; }
+void	GlobalConfig::setAccessLogBufferSize( size_t accessLogBufferSize ) { _accessLogBufferSize = accessLogBufferSize; }
+void	GlobalConfig::setAccessLogFlush( size_t accessLogFlush ) { _accessLogFlush = accessLogFlush; }
+
+/*** private helper methods ***/
+
+/**
+ * @brief Converts an event_backend value ("poll" or "epoll") to its enum
+ */
+GlobalConfig::EventBackend	GlobalConfig::_parseEventBackend( const std::string& value )
+{
+	if (value == "poll")
+		return BACKEND_POLL;
+	if (value == "epoll")
+	{
+#ifdef __linux__
+		return BACKEND_EPOLL;
+#else
+		throw ConfigException("event_backend: epoll is only available on Linux.");
+#endif
+	}
+	throw ConfigException("event_backend: expected 'poll' or 'epoll', got '" + value + "'.");
+}
+
+/**
+ * @brief Converts an "on"/"off" flag
+ */
+bool	GlobalConfig::_parseOnOff( const std::string& key, const std::string& value )
+{
+	if (value == "on")
+		return true;
+	if (value == "off")
+		return false;
+	throw ConfigException(key + ": expected 'on' or 'off', got '" + value + "'.");
+}
+
+/**
+ * @brief Converts a strictly positive size with an optional K/M suffix to bytes
+ */
+size_t	GlobalConfig::_parseSize( const std::string& key, const std::string& value )
+{
+	if (value.empty())
+		throw ConfigException(key + ": Invalid size (empty value).");
+
+	size_t		multiplier = 1;
+	std::string	numPart = value;
+
+	char lastChar = value[value.size() - 1];
+	if (lastChar == 'K' || lastChar == 'k')
+	{
+		multiplier = 1024;
+		numPart = value.substr(0, value.size() - 1);
+	}
+	else if (lastChar == 'M' || lastChar == 'm')
+	{
+		multiplier = 1024 * 1024;
+		numPart = value.substr(0, value.size() - 1);
+	}
+
+	char*	endPtr;
+	long	result = strtol(numPart.c_str(), &endPtr, 10);
+
+	if (numPart.empty() || *endPtr != '\0' || result <= 0)
+		throw ConfigException(key + ": Invalid size '" + value + "'.");
+
+	return static_cast<size_t>(result) * multiplier;
+}
+
+/**
+ * @brief Converts a worker_processes/worker_threads value: a positive count or "auto" for one per online CPU
+ */
+size_t	GlobalConfig::_parseWorkerCount( const std::string& key, const std::string& value )
+{
+	if (value == "auto")
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		if (cpus < 1)
+			return 1;
+		return static_cast<size_t>(cpus) < MAX_WORKER_PROCESSES ? static_cast<size_t>(cpus) : MAX_WORKER_PROCESSES;
+	}
+
+	char*	endPtr;
+	long	result = strtol(value.c_str(), &endPtr, 10);
+
+	if (value.empty() || *endPtr != '\0' || result <= 0
+		|| static_cast<size_t>(result) > MAX_WORKER_PROCESSES)
+	{
+		std::ostringstream oss;
+		oss << key << ": expected 'auto' or a number between 1 and "
+			<< MAX_WORKER_PROCESSES << ", got '" << value << "'.";
+		throw ConfigException(oss.str());
+	}
+	return static_cast<size_t>(result);
+}
+
+/**
+ * @brief Converts a count between 1 and max
+ */
+size_t	GlobalConfig::_parseCount( const std::string& key, const std::string& value, size_t max )
+{
+	char*	endPtr;
+	long	result = strtol(value.c_str(), &endPtr, 10);
+
+	if (value.empty() || *endPtr != '\0' || result <= 0 || static_cast<size_t>(result) > max)
+	{
+		std::ostringstream oss;
+		oss << key << ": expected a number between 1 and " << max << ", got '" << value << "'.";
+		throw ConfigException(oss.str());
+	}
+	return static_cast<size_t>(result);
+}
+
+/**
+ * @brief Converts a strictly positive duration to milliseconds: seconds by
+ * default, or with an "ms", "s", "m" or "h" suffix ("500ms", "75s", "2m")
+ */
+size_t	GlobalConfig::_parseTime( const std::string& key, const std::string& value )
+{
+	size_t		multiplier = 1000;
+	std::string	numPart = value;
+
+	if (value.size() > 2 && value.compare(value.size() - 2, 2, "ms") == 0)
+	{
+		multiplier = 1;
+		numPart = value.substr(0, value.size() - 2);
+	}
+	else if (!value.empty())
+	{
+		char lastChar = value[value.size() - 1];
+		if (lastChar == 's' || lastChar == 'm' || lastChar == 'h')
+		{
+			multiplier = lastChar == 's' ? 1000 : (lastChar == 'm' ? 60 * 1000 : 60 * 60 * 1000);
+			numPart = value.substr(0, value.size() - 1);
+		}
+	}
+
+	char*	endPtr;
+	long	result = strtol(numPart.c_str(), &endPtr, 10);
+
+	if (numPart.empty() || *endPtr != '\0' || result <= 0
+		|| static_cast<size_t>(result) > MAX_TIMEOUT / multiplier)
+		throw ConfigException(key + ": Invalid time '" + value + "' (expected e.g. 60s, 500ms, 2m, at most 24h).");
+
+	return static_cast<size_t>(result) * multiplier;
+}
+
+/**
+ * @brief Parses "access_log off" or "access_log <path> [buffer=<size>] [flush=<time>]"
+ */
+void	GlobalConfig::_parseAccessLog( const std::string& key, const std::string& value )
+{
+	std::istringstream	iss(value);
+	std::string			path;
+	std::string			param;
+
+	if (!(iss >> path))
+		throw ConfigException(key + ": expected a file path or 'off'.");
+	if (path == "off")
+	{
+		if (iss >> param)
+			throw ConfigException(key + ": unexpected parameter '" + param + "' after 'off'.");
+		setAccessLog("");
+		return;
+	}
+
+	while (iss >> param)
+	{
+		if (param.compare(0, 7, "buffer=") == 0)
+			setAccessLogBufferSize(_parseSize(key, param.substr(7)));
+		else if (param.compare(0, 6, "flush=") == 0)
+			setAccessLogFlush(_parseTime(key, param.substr(6)));
+		else
+			throw ConfigException(key + ": unknown parameter '" + param + "'.");
+	}
+	setAccessLog(path);
+}
+
+/*** public parser method ***/
+
+bool	GlobalConfig::parseDirective( const std::string& key, const std::string& line )
+{
+	if (key == "event_backend")
+	{
+		setEventBackend(_parseEventBackend(StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "edge_triggered")
+	{
+		setEdgeTriggered(_parseOnOff(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "read_buffer_size")
+	{
+		setReadBufferSize(_parseSize(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "io_budget")
+	{
+		setIoBudget(_parseSize(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "worker_processes")
+	{
+		setWorkerProcesses(_parseWorkerCount(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "worker_threads")
+	{
+		setWorkerThreads(_parseWorkerCount(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "worker_cpu_affinity")
+	{
+		setWorkerCpuAffinity(_parseOnOff(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "accept_batch")
+	{
+		setAcceptBatch(_parseCount(key, StringUtils::extractDirectiveValue(line, key), MAX_ACCEPT_BATCH));
+		return true;
+	}
+	if (key == "client_header_timeout")
+	{
+		setClientHeaderTimeout(_parseTime(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "client_body_timeout")
+	{
+		setClientBodyTimeout(_parseTime(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "send_timeout")
+	{
+		setSendTimeout(_parseTime(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "keepalive_timeout")
+	{
+		setKeepaliveTimeout(_parseTime(key, StringUtils::extractDirectiveValue(line, key)));
+		return true;
+	}
+	if (key == "access_log")
+	{
+		_parseAccessLog(key, StringUtils::extractDirectiveValue(line, key));
+		return true;
+	}
+	if (key == "access_log_format")
+	{
+		// Checked against the known $variables when the log is opened
+		std::string format = StringUtils::extractDirectiveValue(line, key);
+		if (format.size() >= 2 && (format[0] == '\'' || format[0] == '"')
+			&& format[format.size() - 1] == format[0])
+			format = format.substr(1, format.size() - 2);
+		if (format.empty())
+			throw ConfigException(key + ": empty format.");
+		setAccessLogFormat(format);
+		return true;
+	}
+	return false;
+}
+
+std::string	GlobalConfig::backendToString( EventBackend backend )
+{
+	return backend == BACKEND_EPOLL ? "epoll" : "poll";
+}
+
+/**
+ * @brief << operator overload
+ */
+std::ostream&	operator<<( std::ostream& os, const GlobalConfig& global )
+{
+	os << "GlobalConfig {" << std::endl;
+	os << "    Event Backend: " << GlobalConfig::backendToString(global.getEventBackend()) << std::endl;
+	os << "    Edge Triggered: " << (global.isEdgeTriggered() ? "on" : "off") << std::endl;
+	os << "    Read Buffer Size: " << global.getReadBufferSize() << std::endl;
+	os << "    I/O Budget: " << global.getIoBudget() << std::endl;
+	os << "    Worker Processes: " << global.getWorkerProcesses() << std::endl;
+	os << "    Worker CPU Affinity: " << (global.hasWorkerCpuAffinity() ? "on" : "off") << std::endl;
+	os << "    Worker Threads: " << global.getWorkerThreads() << std::endl;
+	os << "    Accept Batch: " << global.getAcceptBatch() << std::endl;
+	os << "    Client Header Timeout: " << global.getClientHeaderTimeout() << "ms" << std::endl;
+	os << "    Client Body Timeout: " << global.getClientBodyTimeout() << "ms" << std::endl;
+	os << "    Send Timeout: " << global.getSendTimeout() << "ms" << std::endl;
+	os << "    Keep-Alive Timeout: " << global.getKeepaliveTimeout() << "ms" << std::endl;
+	os << "    Access Log: " << (global.getAccessLog().empty() ? "off" : global.getAccessLog()) << std::endl;
+	os << "    Access Log Format: " << global.getAccessLogFormat() << std::endl;
+	os << "    Access Log Buffer: " << global.getAccessLogBufferSize() << std::endl;
+	os << "    Access Log Flush: " << global.getAccessLogFlush() << "ms" << std::endl;
+	os << "}" << std::endl;
+	return os;
+}
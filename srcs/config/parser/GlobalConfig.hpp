@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include "../../exceptions/exceptions.hpp"
+#include "../../utils/StringUtils.hpp"
+
+/**
+ * @brief class to store process-wide settings declared outside of any server block
+ *
+ * These directives tune the event loop itself rather than a virtual host,
+ * so they live in the main context of the .conf file, like nginx does.
+ */
+class GlobalConfig
+{
+public:
+	/**
+	 * @brief Event notification backend used by the server loop
+	 */
+	enum EventBackend
+	{
+		BACKEND_POLL,
+		BACKEND_EPOLL
+	};
+
+	GlobalConfig();
+	~GlobalConfig();
+
+	// Defaults for the per-wakeup I/O tuning directives
+	static const size_t	DEFAULT_READ_BUFFER_SIZE = 16 * 1024;
+	static const size_t	DEFAULT_IO_BUDGET = 256 * 1024;
+
+	// Upper bound for worker_processes and worker_threads
+	static const size_t	MAX_WORKER_PROCESSES = 256;
+
+	// Default and upper bound for the connection timeouts, in milliseconds
+	static const size_t	DEFAULT_TIMEOUT = 60 * 1000;
+	static const size_t	MAX_TIMEOUT = 24 * 60 * 60 * 1000;
+
+	// Default and upper bound for accept_batch
+	static const size_t	DEFAULT_ACCEPT_BATCH = 64;
+	static const size_t	MAX_ACCEPT_BATCH = 4096;
+
+	// Defaults for the access_log buffer=/flush= parameters
+	static const size_t	DEFAULT_ACCESS_LOG_BUFFER = 1024 * 1024;
+	static const size_t	DEFAULT_ACCESS_LOG_FLUSH = 1000;
+
+	// Format used when access_log_format is not given
+	static const char* const	DEFAULT_ACCESS_LOG_FORMAT;
+
+	/*** Getter ***/
+	const EventBackend&	getEventBackend( void ) const;
+	bool				isEdgeTriggered( void ) const;
+	size_t				getReadBufferSize( void ) const;
+	size_t				getIoBudget( void ) const;
+	size_t				getWorkerProcesses( void ) const;
+	bool				hasWorkerCpuAffinity( void ) const;
+	size_t				getWorkerThreads( void ) const;
+	size_t				getClientHeaderTimeout( void ) const;
+	size_t				getClientBodyTimeout( void ) const;
+	size_t				getSendTimeout( void ) const;
+	size_t				getKeepaliveTimeout( void ) const;
+	size_t				getAcceptBatch( void ) const;
+	const std::string&	getAccessLog( void ) const;
+	const std::string&	getAccessLogFormat( void ) const;
+	size_t				getAccessLogBufferSize( void ) const;
+	size_t				getAccessLogFlush( void ) const;
+
+	/*** Setter ***/
+	void	setEventBackend( const EventBackend& eventBackend );
+	void	setEdgeTriggered( bool edgeTriggered );
+	void	setReadBufferSize( size_t readBufferSize );
+	void	setIoBudget( size_t ioBudget );
+	void	setWorkerProcesses( size_t workerProcesses );
+	void	setWorkerCpuAffinity( bool workerCpuAffinity );
+	void	setWorkerThreads( size_t workerThreads );
+	void	setClientHeaderTimeout( size_t clientHeaderTimeout );
+	void	setClientBodyTimeout( size_t clientBodyTimeout );
+	void	setSendTimeout( size_t sendTimeout );
+	void	setKeepaliveTimeout( size_t keepaliveTimeout );
+	void	setAcceptBatch( size_t acceptBatch );
+	void	setAccessLog( const std::string& accessLog );
+	void	setAccessLogFormat( const std::string& accessLogFormat );
+	void	setAccessLogBufferSize( size_t accessLogBufferSize );
+	void	setAccessLogFlush( size_t accessLogFlush );
+
+	/**
+	 * @brief Try to parse a main-context directive
+	 *
+	 * @param key directive name
+	 * @param line full trimmed config line
+	 * @return true if the directive was recognized, false otherwise
+	 * @throw ConfigException if the directive is known but its value is invalid
+	 */
+	bool	parseDirective( const std::string& key, const std::string& line );
+
+	static std::string	backendToString( EventBackend backend );
+
+private:
+	EventBackend	_eventBackend;
+	bool			_edgeTriggered;		// Register client sockets with EPOLLET
+	size_t			_readBufferSize;	// Bytes requested per recv() call
+	size_t			_ioBudget;			// Max bytes read or written per connection per wakeup
+	size_t			_workerProcesses;	// 1 runs the event loop in the main process
+	bool			_workerCpuAffinity;	// Pin each worker process to one CPU
+	size_t			_workerThreads;		// Event loop threads per process
+	size_t			_acceptBatch;		// Max clients accepted per listening socket wakeup
+
+	// Longest wait between two reads or writes, in milliseconds
+	size_t			_clientHeaderTimeout;	// Request line and headers
+	size_t			_clientBodyTimeout;		// Request body
+	size_t			_sendTimeout;			// Response, or a CGI script producing it
+	size_t			_keepaliveTimeout;		// Idle kept-alive connection
+
+	// Access log, written in batches by a background thread
+	std::string		_accessLog;				// File path, empty when off
+	std::string		_accessLogFormat;		// Line format with $variables
+	size_t			_accessLogBufferSize;	// Records waiting for the writer, in bytes
+	size_t			_accessLogFlush;		// Longest a record waits, in milliseconds
+
+	EventBackend	_parseEventBackend( const std::string& value );
+	bool			_parseOnOff( const std::string& key, const std::string& value );
+	size_t			_parseSize( const std::string& key, const std::string& value );
+	size_t			_parseWorkerCount( const std::string& key, const std::string& value );
+	size_t			_parseTime( const std::string& key, const std::string& value );
+	size_t			_parseCount( const std::string& key, const std::string& value, size_t max );
+	void			_parseAccessLog( const std::string& key, const std::string& value );
+
+	GlobalConfig( const GlobalConfig& other );
+	GlobalConfig& operator=( const GlobalConfig& other );
+};
+
+std::ostream&	operator<<( std::ostream& os, const GlobalConfig& global );
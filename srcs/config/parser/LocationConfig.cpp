@@ -2,7 +2,9 @@
 
 LocationConfig::LocationConfig()
     : _path(), _root(), _allowedMethods(), _clientMaxBodySize(DEFAULT_CLIENT_SIZE), 
-      _index(), _autoIndex(false), _cgiPath(), _cgiExtentions(), _cgiHandlers(), _uploadDir(), _redirection()
+      _index(), _autoIndex(false), _cgiPath(), _cgiExtentions(), _cgiHandlers(), _uploadDir(), _redirection(),
+      _fileCacheMaxEntry(DEFAULT_CACHE_ENTRY_SIZE), _gzip(false), _gzipStatic(false), _gzipTypes(),
+      _gzipMinLength(DEFAULT_GZIP_MIN_LENGTH), _gzipCompLevel(1)
 {
 }
 
@@ -29,6 +31,12 @@ const std::vector<std::string>&		LocationConfig::getCgiExtentions( void ) const
 const std::map<std::string, std::string>& LocationConfig::getCgiHandlers( void ) const { return _cgiHandlers; }
 const std::string&					LocationConfig::getUploadDir( void ) const { return _uploadDir; }
 const std::string&					LocationConfig::getRedirection( void ) const { return _redirection; }
+const size_t&						LocationConfig::getFileCacheMaxEntry( void ) const { return _fileCacheMaxEntry; }
+const bool&							LocationConfig::getGzip( void ) const { return _gzip; }
+const bool&							LocationConfig::getGzipStatic( void ) const { return _gzipStatic; }
+const std::vector<std::string>&		LocationConfig::getGzipTypes( void ) const { return _gzipTypes; }
+const size_t&						LocationConfig::getGzipMinLength( void ) const { return _gzipMinLength; }
+const int&							LocationConfig::getGzipCompLevel( void ) const { return _gzipCompLevel; }
 
 /*** Setter ***/
 void	LocationConfig::setPath( const std::string& path ) { _path = path; }
@@ -42,6 +50,12 @@ void	LocationConfig::setCgiExtentions( std::vector<std::string>& cgiExtentions )
 void	LocationConfig::setCgiHandlers( std::map<std::string, std::string>& cgiHandlers ) { _cgiHandlers = cgiHandlers; }
 void	LocationConfig::setUploadDir( const std::string& uploadDir ) { _uploadDir = uploadDir; }
 void	LocationConfig::setRedirection( const std::string& redirection ) { _redirection = redirection; }
+void	LocationConfig::setFileCacheMaxEntry( const size_t& fileCacheMaxEntry ) { _fileCacheMaxEntry = fileCacheMaxEntry; }
+void	LocationConfig::setGzip( const bool& gzip ) { _gzip = gzip; }
+void	LocationConfig::setGzipStatic( const bool& gzipStatic ) { _gzipStatic = gzipStatic; }
+void	LocationConfig::setGzipTypes( std::vector<std::string>& gzipTypes ) { _gzipTypes = gzipTypes; }
+void	LocationConfig::setGzipMinLength( const size_t& gzipMinLength ) { _gzipMinLength = gzipMinLength; }
+void	LocationConfig::setGzipCompLevel( const int& gzipCompLevel ) { _gzipCompLevel = gzipCompLevel; }
 
 /*** private helper methods ***/
 
@@ -141,6 +155,44 @@ std::string LocationConfig::getInterpreterForExtension(const std::string& extens
     return "";
 }
 
+/**
+ * @brief Check if a Content-Type is listed in gzip_types
+ * 
+ * Parameters such as "; charset=utf-8" are ignored.
+ * 
+ * @param contentType Content-Type header value
+ * @return true if bodies of this type are compressed on the fly
+ */
+bool LocationConfig::isGzipType(const std::string& contentType) const
+{
+    size_t length = contentType.find(';');
+    if (length == std::string::npos) {
+        length = contentType.size();
+    }
+    while (length > 0 && (contentType[length - 1] == ' ' || contentType[length - 1] == '\t')) {
+        --length;
+    }
+    
+    for (std::vector<std::string>::const_iterator it = _gzipTypes.begin(); it != _gzipTypes.end(); ++it) {
+        if (*it == "*" || (it->size() == length && StringUtils::equalsIgnoreCase(*it, contentType.substr(0, length)))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Converts an "on"/"off" flag
+ */
+bool	LocationConfig::_parseOnOff( const std::string& key, const std::string& value )
+{
+	if (value == "on")
+		return true;
+	if (value == "off")
+		return false;
+	throw ConfigException(key + ": expected 'on' or 'off', got '" + value + "'.");
+}
+
 /**
  * @brief Converts a size string (e.g., "1M") to an integer in bytes.
  * 
@@ -150,12 +202,13 @@ std::string LocationConfig::getInterpreterForExtension(const std::string& extens
  *  - "1M"    →  1,048,576 bytes
  * 
  * @param sizeStr The input size string.
+ * @param directive Directive name used in error messages.
  * @return size_t The size in bytes.
  */
-size_t LocationConfig::_parseSize(const std::string& sizeStr)
+size_t LocationConfig::_parseSize(const std::string& sizeStr, const std::string& directive)
 {
 	if (sizeStr.empty())
-		throw ConfigException("client_max_body_size: Invalid size (empty value).");
+		throw ConfigException(directive + ": Invalid size (empty value).");
 	
 	std::string trimmedStr = StringUtils::trim(sizeStr, " \t;");
 	size_t multiplier = 1;
@@ -178,7 +231,7 @@ size_t LocationConfig::_parseSize(const std::string& sizeStr)
 
 	// Validate conversion
 	if (*endPtr != '\0' || result < 0)
-		throw ConfigException("client_max_body_size: Invalid number format '" + trimmedStr + "'.");
+		throw ConfigException(directive + ": Invalid number format '" + trimmedStr + "'.");
 
 	return static_cast<size_t>(result) * multiplier;
 }
@@ -247,6 +300,39 @@ void LocationConfig::parseLocationBlock(std::ifstream& file)
 		{
 			setRedirection(StringUtils::extractDirectiveValue(line, key));
 		}
+		else if (key == "file_cache_max_entry")
+		{
+			std::string value = StringUtils::extractDirectiveValue(line, key);
+			setFileCacheMaxEntry(_parseSize(value, key));
+		}
+		else if (key == "gzip")
+		{
+			setGzip(_parseOnOff(key, StringUtils::extractDirectiveValue(line, key)));
+		}
+		else if (key == "gzip_static")
+		{
+			setGzipStatic(_parseOnOff(key, StringUtils::extractDirectiveValue(line, key)));
+		}
+		else if (key == "gzip_types")
+		{
+			std::string value = StringUtils::extractDirectiveValue(line, key);
+			std::vector<std::string> types = StringUtils::split(value, ' ');
+			setGzipTypes(types);
+		}
+		else if (key == "gzip_min_length")
+		{
+			std::string value = StringUtils::extractDirectiveValue(line, key);
+			setGzipMinLength(_parseSize(value, key));
+		}
+		else if (key == "gzip_comp_level")
+		{
+			std::string value = StringUtils::extractDirectiveValue(line, key);
+			char* endPtr;
+			long level = strtol(value.c_str(), &endPtr, 10);
+			if (value.empty() || *endPtr != '\0')
+				throw ConfigException(key + ": Invalid number format '" + value + "'.");
+			setGzipCompLevel(static_cast<int>(level));
+		}
 		else if (key == "}")
 		{
 			return;
@@ -292,6 +378,16 @@ std::ostream&	operator<<( std::ostream& os, const LocationConfig& location )
 
 	os << "                    Upload Directory: " << location.getUploadDir() << std::endl;
 	os << "                    Redirection: " << location.getRedirection() << std::endl;
+	os << "                    File Cache Max Entry: " << location.getFileCacheMaxEntry() << " bytes" << std::endl;
+	os << "                    Gzip: " << (location.getGzip() ? "on" : "off")
+	   << ", Static: " << (location.getGzipStatic() ? "on" : "off")
+	   << ", Level: " << location.getGzipCompLevel()
+	   << ", Min Length: " << location.getGzipMinLength() << " bytes" << std::endl;
+
+	os << "                    Gzip Types: ";
+	for (std::vector<std::string>::const_iterator it = location.getGzipTypes().begin(); it != location.getGzipTypes().end(); ++it)
+		os << *it << " ";
+	os << std::endl;
 
 	os << "                }" << std::endl;
 	return os;
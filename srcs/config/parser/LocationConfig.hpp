@@ -11,6 +11,8 @@
 #include "../../utils/StringUtils.hpp"
 
 #define DEFAULT_CLIENT_SIZE static_cast<size_t>(-1) // Use server's value
+#define DEFAULT_CACHE_ENTRY_SIZE static_cast<size_t>(-1) // Not set (default applied later)
+#define DEFAULT_GZIP_MIN_LENGTH static_cast<size_t>(-1) // Not set (default applied later)
 
 /**
  * @brief class to store location-specific info
@@ -32,6 +34,12 @@ public:
 	const std::map<std::string, std::string>& getCgiHandlers( void ) const;
 	const std::string&					getUploadDir( void ) const;
 	const std::string&					getRedirection( void ) const;
+	const size_t&						getFileCacheMaxEntry( void ) const;
+	const bool&							getGzip( void ) const;
+	const bool&							getGzipStatic( void ) const;
+	const std::vector<std::string>&		getGzipTypes( void ) const;
+	const size_t&						getGzipMinLength( void ) const;
+	const int&							getGzipCompLevel( void ) const;
 
 	void	setPath( const std::string& path );
 	void	setRoot( const std::string& root );
@@ -44,12 +52,21 @@ public:
 	void	setCgiHandlers( std::map<std::string, std::string>& cgiHandlers );
 	void	setUploadDir( const std::string& uploadDir );
 	void	setRedirection( const std::string& redirection );
+	void	setFileCacheMaxEntry( const size_t& fileCacheMaxEntry );
+	void	setGzip( const bool& gzip );
+	void	setGzipStatic( const bool& gzipStatic );
+	void	setGzipTypes( std::vector<std::string>& gzipTypes );
+	void	setGzipMinLength( const size_t& gzipMinLength );
+	void	setGzipCompLevel( const int& gzipCompLevel );
 
 	void	parseLocationBlock( std::ifstream& file );
 
 	// Get the interpreter for a specific extension
 	std::string getInterpreterForExtension(const std::string& extension) const;
 
+	// Check if responses of a Content-Type are compressed on the fly (gzip_types)
+	bool isGzipType(const std::string& contentType) const;
+
 private:
 
 	std::string					_path;
@@ -63,9 +80,16 @@ private:
 	std::map<std::string, std::string> _cgiHandlers; // Map of extension to interpreter path
 	std::string					_uploadDir;
 	std::string					_redirection;
+	size_t						_fileCacheMaxEntry;  // Largest file kept in the server's file cache, 0 disables caching here
+	bool						_gzip;               // Compress responses on the fly for clients accepting gzip
+	bool						_gzipStatic;         // Serve file.gz in place of file when it exists
+	std::vector<std::string>	_gzipTypes;          // MIME types compressed on the fly, "*" for any
+	size_t						_gzipMinLength;      // Smallest body compressed on the fly
+	int							_gzipCompLevel;      // zlib compression level, 1-9
 
 	void	_addAllowedMethod( const std::string& allowedMethod );
-	size_t	_parseSize(const std::string& sizeStr);
+	size_t	_parseSize(const std::string& sizeStr, const std::string& directive = "client_max_body_size");
+	bool	_parseOnOff( const std::string& key, const std::string& value );
 	void	_addCgiExtention( const std::string& cgiExtention );
 	void	_addCgiHandler( const std::string& extension, const std::string& interpreter );
 	void	_parseCgiHandlerDirective( const std::string& directive );
@@ -1,7 +1,8 @@
 #include "ServerConfig.hpp"
 
 ServerConfig::ServerConfig()
-	: _host(), _port(0), _serverNames(), _clientMaxBodySize(NONE_CLIENT_SIZE), _errorPages(), _locations() {}
+	: _host(), _port(0), _serverNames(), _clientMaxBodySize(NONE_CLIENT_SIZE), _errorPages(), _locations(), _fileCacheSize(0),
+	  _backlog(DEFAULT_BACKLOG) {}
 
 ServerConfig::~ServerConfig()
 {
@@ -25,6 +26,8 @@ const std::vector<std::string>&		ServerConfig::getServerNames( void ) const { re
 const size_t&						ServerConfig::getClientMaxBodySize( void ) const { return _clientMaxBodySize; }
 const std::map<int, std::string>&	ServerConfig::getErrorPages( void ) const { return _errorPages; }
 const std::vector<LocationConfig*>&	ServerConfig::getLocations( void ) const { return _locations; }
+const size_t&						ServerConfig::getFileCacheSize( void ) const { return _fileCacheSize; }
+const int&							ServerConfig::getBacklog( void ) const { return _backlog; }
 
 /*** Setter ***/
 void	ServerConfig::setHost( const std::string& host ) { _host = host; }
@@ -33,6 +36,8 @@ void	ServerConfig::setServerNames( const std::vector<std::string>& serverNames )
 void	ServerConfig::setClientMaxBodySize( const size_t& clientMaxBodySize ) { _clientMaxBodySize = clientMaxBodySize; }
 void	ServerConfig::setErrorPages( const std::map<int, std::string> errorPages ) { _errorPages = errorPages; }
 void	ServerConfig::setLocations( const std::vector<LocationConfig*>& locations ) { _locations = locations; }
+void	ServerConfig::setFileCacheSize( const size_t& fileCacheSize ) { _fileCacheSize = fileCacheSize; }
+void	ServerConfig::setBacklog( const int& backlog ) { _backlog = backlog; }
 
 /*** private helper methods ***/
 
@@ -67,6 +72,37 @@ void	ServerConfig::_addLocation( LocationConfig* location )
 	_locations.push_back(location);
 }
 
+/**
+ * @brief Parses "listen IP:PORT [backlog=N]"
+ * 
+ * @param value the directive value, without the directive name
+ */
+void	ServerConfig::_parseListen( const std::string& value )
+{
+	std::istringstream	iss(value);
+	std::string			address;
+	std::string			param;
+
+	iss >> address;
+	size_t colon = address.find(':');
+	if (colon == std::string::npos)
+		throw ConfigException("Invalid 'listen' format, expected 'IP:PORT'.");
+	setHost(address.substr(0, colon));
+	setPort(atoi(address.substr(colon + 1).c_str()));
+
+	while (iss >> param)
+	{
+		if (param.compare(0, 8, "backlog=") != 0)
+			throw ConfigException("listen: unknown parameter '" + param + "'.");
+
+		char*	endPtr;
+		long	backlog = strtol(param.c_str() + 8, &endPtr, 10);
+		if (param.size() == 8 || *endPtr != '\0' || backlog <= 0 || backlog > 65535)
+			throw ConfigException("listen: invalid backlog '" + param.substr(8) + "', expected 1 to 65535.");
+		setBacklog(static_cast<int>(backlog));
+	}
+}
+
 /**
  * @brief Converts a size string (e.g., "1M") to an integer in bytes.
  * 
@@ -76,12 +112,13 @@ void	ServerConfig::_addLocation( LocationConfig* location )
  *  - "1M"    →  1,048,576 bytes
  * 
  * @param sizeStr The input size string.
+ * @param directive Directive name used in error messages.
  * @return size_t The size in bytes.
  */
-size_t	ServerConfig::_parseSize( const std::string& sizeStr )
+size_t	ServerConfig::_parseSize( const std::string& sizeStr, const std::string& directive )
 {
 	if (sizeStr.empty())
-		throw ConfigException("client_max_body_size: Invalid size (empty value).");
+		throw ConfigException(directive + ": Invalid size (empty value).");
 	
 	std::string trimmedStr = StringUtils::trim(sizeStr, " \t;");
 	size_t		multiplier = 1;
@@ -104,7 +141,7 @@ size_t	ServerConfig::_parseSize( const std::string& sizeStr )
 
 	// Validate conversion
 	if (*endPtr != '\0' || result < 0)
-		throw ConfigException("client_max_body_size: Invalid number format '" + trimmedStr + "'.");
+		throw ConfigException(directive + ": Invalid number format '" + trimmedStr + "'.");
 
 	return static_cast<size_t>(result) * multiplier;
 }
@@ -130,16 +167,7 @@ void ServerConfig::parseServerBlock(std::ifstream& file)
 
 		if (key == "listen")
 		{
-			std::string listenValue = StringUtils::extractDirectiveValue(line, key);
-			
-			size_t colon = listenValue.find(':');
-			if (colon != std::string::npos)
-			{
-				setHost(listenValue.substr(0, colon));
-				setPort(atoi(listenValue.substr(colon + 1).c_str()));
-			}
-			else
-				throw ConfigException("Invalid 'listen' format, expected 'IP:PORT'.");
+			_parseListen(StringUtils::extractDirectiveValue(line, key));
 		}
 		else if (key == "server_name")
 		{
@@ -152,6 +180,11 @@ void ServerConfig::parseServerBlock(std::ifstream& file)
 			std::string value = StringUtils::extractDirectiveValue(line, key);
 			setClientMaxBodySize(_parseSize(value));
 		}
+		else if (key == "file_cache_size")
+		{
+			std::string value = StringUtils::extractDirectiveValue(line, key);
+			setFileCacheSize(_parseSize(value, key));
+		}
 		else if (key == "error_page")
 		{
 			std::string value = StringUtils::extractDirectiveValue(line, key);
@@ -193,6 +226,7 @@ std::ostream&	operator<<( std::ostream& os, const ServerConfig& server )
 	os << "    ServerConfig {" << std::endl;
 	os << "            Host: " << server.getHost() << std::endl;
 	os << "            Port: " << server.getPort() << std::endl;
+	os << "            Backlog: " << server.getBacklog() << std::endl;
 	
 	os << "            Server Names: ";
 	for (std::vector<std::string>::const_iterator it = server.getServerNames().begin(); it != server.getServerNames().end(); ++it)
@@ -200,6 +234,7 @@ std::ostream&	operator<<( std::ostream& os, const ServerConfig& server )
 	os << std::endl;
 
 	os << "            Client Max Body Size: " << server.getClientMaxBodySize() << std::endl;
+	os << "            File Cache Size: " << server.getFileCacheSize() << std::endl;
 	
 	os << "            Error Pages: ";
 	for (std::map<int, std::string>::const_iterator it = server.getErrorPages().begin(); it != server.getErrorPages().end(); ++it)
@@ -24,6 +24,9 @@ public:
 	ServerConfig();
 	~ServerConfig();
 
+	// Pending connection queue of a listening socket, as nginx sets it on Linux
+	static const int	DEFAULT_BACKLOG = 511;
+
 	/*** Getter ***/
 	const std::string&					getHost( void ) const;
 	const int&							getPort( void ) const;
@@ -31,6 +34,8 @@ public:
 	const size_t&						getClientMaxBodySize( void ) const;
 	const std::map<int, std::string>&	getErrorPages( void ) const;
 	const std::vector<LocationConfig*>&	getLocations( void ) const; 
+	const size_t&						getFileCacheSize( void ) const;
+	const int&							getBacklog( void ) const;
 
 	/*** Setter ***/
 	void	setHost( const std::string& host );
@@ -39,6 +44,8 @@ public:
 	void	setClientMaxBodySize( const size_t& clientMaxBodySize );
 	void	setErrorPages( const std::map<int, std::string> errorPages );
 	void	setLocations( const std::vector<LocationConfig*>& locations );
+	void	setFileCacheSize( const size_t& fileCacheSize );
+	void	setBacklog( const int& backlog );
 
 	void	parseServerBlock( std::ifstream& file );
 
@@ -51,12 +58,15 @@ private:
 	size_t							_clientMaxBodySize;
 	std::map<int, std::string>		_errorPages;
 	std::vector<LocationConfig*>	_locations;
+	size_t							_fileCacheSize;	// Static file cache budget in bytes, 0 disables it
+	int								_backlog;		// listen() backlog of the host:port (backlog= parameter)
 
 	void	_addServerName( const std::string& serverName );
 	void	_addErrorPage( const int& error, const std::string& errorPage );
 	void	_addLocation( LocationConfig* location );
+	void	_parseListen( const std::string& value );
 
-	size_t	_parseSize( const std::string& sizeStr );
+	size_t	_parseSize( const std::string& sizeStr, const std::string& directive = "client_max_body_size" );
 
 	ServerConfig( const ServerConfig& other );
 	ServerConfig& operator=( const ServerConfig& other );
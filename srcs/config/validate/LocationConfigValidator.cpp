@@ -16,6 +16,7 @@ void LocationConfigValidator::_validate(void) const
     _validateCgi();
     _validateUploadDir();
     _validateRedirection();
+    _validateGzip();
 }
 
 void LocationConfigValidator::_validatePath(void) const
@@ -155,4 +156,16 @@ void LocationConfigValidator::_validateRedirection(void) const
             throw ValidationException("Invalid redirect format (should be 'STATUS URL') for location: " + _locationConfig.getPath());
         }
     }
+}
+
+void LocationConfigValidator::_validateGzip(void) const
+{
+    // zlib levels: 1 is fastest, 9 compresses best
+    int level = _locationConfig.getGzipCompLevel();
+    if (level < 1 || level > 9) {
+        std::stringstream ss;
+        ss << level;
+        throw ValidationException("gzip_comp_level must be between 1 and 9 for location: " +
+                                  _locationConfig.getPath() + " (got " + ss.str() + ")");
+    }
 }
\ No newline at end of file
@@ -29,4 +29,5 @@ private:
 	void _validateCgi(void) const;
 	void _validateUploadDir(void) const;
 	void _validateRedirection(void) const;
+	void _validateGzip(void) const;
 };
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "ByteRanges.hpp"
+#include "../utils/StringUtils.hpp"
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * @brief Parse a run of digits, saturating instead of overflowing
+ *
+ * @return true if at least one digit was read
+ */
+static bool parseNumber(const std::string& text, size_t& pos, size_t end, size_t& value)
+{
+    size_t start = pos;
+    value = 0;
+    while (pos < end && text[pos] >= '0' && text[pos] <= '9') {
+        size_t digit = static_cast<size_t>(text[pos] - '0');
+        if (value > (static_cast<size_t>(-1) - digit) / 10) {
+            value = static_cast<size_t>(-1);
+        } else {
+            value = value * 10 + digit;
+        }
+        ++pos;
+    }
+    return pos > start;
+}
+
+// A header that is ignored leaves no ranges behind
+static ByteRanges::Result ignoreHeader(std::vector<ByteRanges::Range>& ranges)
+{
+    ranges.clear();
+    return ByteRanges::RANGES_NONE;
+}
+
+ByteRanges::Result ByteRanges::parse(const std::string& header, size_t size, std::vector<Range>& ranges)
+{
+    ranges.clear();
+
+    size_t pos = 0;
+    while (pos < header.size() && isSpace(header[pos])) {
+        ++pos;
+    }
+    if (header.size() - pos < 6 || !StringUtils::equalsIgnoreCase(header.substr(pos, 6), "bytes=")) {
+        return ignoreHeader(ranges);
+    }
+    pos += 6;
+
+    size_t specs = 0;
+    size_t total = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos) {
+            end = header.size();
+        }
+        while (pos < end && isSpace(header[pos])) {
+            ++pos;
+        }
+        size_t last = end;
+        while (last > pos && isSpace(header[last - 1])) {
+            --last;
+        }
+
+        // Empty list elements are allowed ("bytes=0-1,,5-6")
+        if (pos == last) {
+            pos = end + 1;
+            continue;
+        }
+        if (++specs > MAX_RANGES) {
+            return ignoreHeader(ranges);
+        }
+
+        Range range;
+        size_t first;
+        size_t final;
+        if (header[pos] == '-') {
+            // Suffix range: the last n bytes
+            ++pos;
+            if (!parseNumber(header, pos, last, final) || pos != last) {
+                return ignoreHeader(ranges);
+            }
+            if (final == 0 || size == 0) {
+                pos = end + 1;
+                continue;
+            }
+            range.first = final < size ? size - final : 0;
+            range.length = size - range.first;
+        } else {
+            if (!parseNumber(header, pos, last, first) || pos == last || header[pos] != '-') {
+                return ignoreHeader(ranges);
+            }
+            ++pos;
+            final = static_cast<size_t>(-1);
+            if (pos < last && (!parseNumber(header, pos, last, final) || final < first)) {
+                return ignoreHeader(ranges);
+            }
+            if (pos != last) {
+                return ignoreHeader(ranges);
+            }
+            if (first >= size) {
+                pos = end + 1;
+                continue;
+            }
+            range.first = first;
+            range.length = (final < size ? final + 1 : size) - first;
+        }
+
+        // Overlapping ranges adding up to more than the file are not worth serving
+        total += range.length;
+        if (total > size) {
+            return ignoreHeader(ranges);
+        }
+        ranges.push_back(range);
+        pos = end + 1;
+    }
+
+    if (specs == 0) {
+        return ignoreHeader(ranges);
+    }
+    return ranges.empty() ? RANGES_UNSATISFIABLE : RANGES_OK;
+}
+
+void ByteRanges::appendContentRange(std::string& out, const Range& range, size_t size)
+{
+    out += "bytes ";
+    StringUtils::appendUnsigned(out, range.first);
+    out += '-';
+    StringUtils::appendUnsigned(out, range.first + range.length - 1);
+    out += '/';
+    StringUtils::appendUnsigned(out, size);
+}
+
+void ByteRanges::appendUnsatisfiedRange(std::string& out, size_t size)
+{
+    out += "bytes */";
+    StringUtils::appendUnsigned(out, size);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/**
+ * @brief Class to parse Range headers against a representation size
+ *
+ * Handles the "bytes" unit of RFC 9110 section 14: "first-last",
+ * "first-" and suffix "-length" specs, separated by commas. A header
+ * that does not parse, asks for too many ranges or for more bytes than
+ * the file holds (overlapping ranges) is ignored and the whole file is
+ * sent, as the RFC allows.
+ */
+class ByteRanges {
+public:
+    /**
+     * @brief One satisfiable range, clamped to the file
+     */
+    struct Range {
+        size_t first;           // First byte
+        size_t length;          // Number of bytes, at least 1
+    };
+
+    /**
+     * @brief Outcome of parsing a Range header
+     */
+    enum Result {
+        RANGES_NONE,            // No usable header: send the whole file (200)
+        RANGES_OK,              // At least one range can be sent (206)
+        RANGES_UNSATISFIABLE    // Valid header, no range overlaps the file (416)
+    };
+
+    // Most ranges served in one response
+    static const size_t MAX_RANGES = 32;
+
+    /**
+     * @brief Parse a Range header value
+     *
+     * @param header Range header value
+     * @param size Size of the file
+     * @param ranges Receives the satisfiable ranges, in request order, empty unless RANGES_OK
+     * @return Result What to answer
+     */
+    static Result parse(const std::string& header, size_t size, std::vector<Range>& ranges);
+
+    /**
+     * @brief Append a Content-Range value, "bytes first-last/size"
+     *
+     * @param out String to append to
+     * @param range Range sent
+     * @param size Size of the file
+     */
+    static void appendContentRange(std::string& out, const Range& range, size_t size);
+
+    /**
+     * @brief Append the Content-Range value of a 416, the size alone
+     *
+     * @param out String to append to
+     * @param size Size of the file
+     */
+    static void appendUnsatisfiedRange(std::string& out, size_t size);
+
+private:
+    // Private constructor to prevent instantiation
+    ByteRanges();
+    // Private destructor
+    ~ByteRanges();
+    // Private copy constructor and assignment operator to prevent copying
+    ByteRanges(const ByteRanges& other);
+    ByteRanges& operator=(const ByteRanges& other);
+};
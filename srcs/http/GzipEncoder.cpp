@@ -0,0 +1,128 @@
+#include "GzipEncoder.hpp"
+#include "../utils/StringUtils.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+// Window bits of a gzip (not zlib) stream with the largest window
+static const int GZIP_WINDOW_BITS = 15 + 16;
+
+// Output space added per deflate() call
+static const size_t OUTPUT_STEP = 16 * 1024;
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * @brief Read the q parameter of one Accept-Encoding element
+ *
+ * @return double The quality value, 1 when absent ("gzip;q=0" refuses gzip)
+ */
+static double qualityOf(const std::string& value, size_t params, size_t end)
+{
+    size_t q = value.find("q=", params);
+    if (q == std::string::npos || q >= end) {
+        q = value.find("Q=", params);
+    }
+    if (q == std::string::npos || q >= end) {
+        return 1.0;
+    }
+    return strtod(value.c_str() + q + 2, NULL);
+}
+
+GzipEncoder::GzipEncoder(int level)
+{
+    memset(&_stream, 0, sizeof(_stream));
+    if (level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION) {
+        level = DEFAULT_LEVEL;
+    }
+    if (deflateInit2(&_stream, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::bad_alloc();
+    }
+}
+
+GzipEncoder::~GzipEncoder()
+{
+    deflateEnd(&_stream);
+}
+
+void GzipEncoder::_deflate(const char* data, size_t length, int flush, std::string& out)
+{
+    _stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    _stream.avail_in = static_cast<uInt>(length);
+
+    // Grow the output in steps until zlib has consumed everything it was asked to
+    do {
+        size_t used = out.size();
+        out.resize(used + OUTPUT_STEP);
+        _stream.next_out = reinterpret_cast<Bytef*>(&out[used]);
+        _stream.avail_out = static_cast<uInt>(OUTPUT_STEP);
+        deflate(&_stream, flush);
+        out.resize(used + OUTPUT_STEP - _stream.avail_out);
+    } while (_stream.avail_out == 0);
+}
+
+void GzipEncoder::write(const char* data, size_t length, std::string& out)
+{
+    if (length > 0) {
+        _deflate(data, length, Z_NO_FLUSH, out);
+    }
+}
+
+void GzipEncoder::flush(std::string& out)
+{
+    _deflate(NULL, 0, Z_SYNC_FLUSH, out);
+}
+
+void GzipEncoder::finish(std::string& out)
+{
+    _deflate(NULL, 0, Z_FINISH, out);
+}
+
+void GzipEncoder::compress(const std::string& in, int level, std::string& out)
+{
+    out.clear();
+    out.reserve(in.size() / 2 + 64);
+    GzipEncoder encoder(level);
+    encoder._deflate(in.data(), in.size(), Z_FINISH, out);
+}
+
+bool GzipEncoder::isAccepted(const std::string& acceptEncoding)
+{
+    // An explicit gzip element takes precedence over "*" (RFC 9110 section 12.5.3)
+    double gzipQuality = -1;
+    double anyQuality = -1;
+    size_t pos = 0;
+    while (pos < acceptEncoding.size()) {
+        size_t end = acceptEncoding.find(',', pos);
+        if (end == std::string::npos) {
+            end = acceptEncoding.size();
+        }
+        size_t semicolon = acceptEncoding.find(';', pos);
+        if (semicolon > end) {
+            semicolon = end;
+        }
+
+        while (pos < semicolon && isSpace(acceptEncoding[pos])) {
+            ++pos;
+        }
+        size_t last = semicolon;
+        while (last > pos && isSpace(acceptEncoding[last - 1])) {
+            --last;
+        }
+        std::string coding = acceptEncoding.substr(pos, last - pos);
+        if (StringUtils::equalsIgnoreCase(coding, "gzip") ||
+            StringUtils::equalsIgnoreCase(coding, "x-gzip")) {
+            double quality = qualityOf(acceptEncoding, semicolon, end);
+            if (quality > gzipQuality) {
+                gzipQuality = quality;
+            }
+        } else if (coding == "*") {
+            anyQuality = qualityOf(acceptEncoding, semicolon, end);
+        }
+        pos = end + 1;
+    }
+    return (gzipQuality >= 0 ? gzipQuality : anyQuality) > 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <zlib.h>
+
+/**
+ * @brief Class to gzip a response body, in one piece or as it is produced
+ *
+ * Wraps a zlib deflate stream writing the gzip format. Compressed bytes
+ * are appended to a caller's buffer, so a streamed body (large file, CGI
+ * output) never needs more than one slice in memory.
+ */
+class GzipEncoder {
+public:
+    // Compression level used when none is configured
+    static const int DEFAULT_LEVEL = 1;
+
+    /**
+     * @brief Start a gzip stream
+     *
+     * @param level zlib compression level, 1 (fastest) to 9 (smallest)
+     * @throw std::bad_alloc if zlib cannot allocate its state
+     */
+    explicit GzipEncoder(int level);
+    ~GzipEncoder();
+
+    /**
+     * @brief Compress a slice of the body
+     *
+     * zlib may keep part of it buffered until more input, flush() or finish().
+     *
+     * @param data Uncompressed bytes
+     * @param length Number of bytes
+     * @param out Receives the compressed bytes produced, appended
+     */
+    void write(const char* data, size_t length, std::string& out);
+
+    /**
+     * @brief Output everything written so far, for a client reading as it arrives
+     *
+     * @param out Receives the compressed bytes, appended
+     */
+    void flush(std::string& out);
+
+    /**
+     * @brief End the stream with the gzip trailer
+     *
+     * @param out Receives the last compressed bytes, appended
+     */
+    void finish(std::string& out);
+
+    /**
+     * @brief Compress a whole body at once
+     *
+     * @param in Uncompressed body
+     * @param level zlib compression level
+     * @param out Receives the gzip data, replaced
+     */
+    static void compress(const std::string& in, int level, std::string& out);
+
+    /**
+     * @brief Check if an Accept-Encoding value allows gzip
+     *
+     * "gzip" or "x-gzip" with a non-zero quality value, or "*" with one
+     * when gzip is not listed.
+     *
+     * @param acceptEncoding Accept-Encoding header value
+     * @return true if a gzip response is acceptable
+     */
+    static bool isAccepted(const std::string& acceptEncoding);
+
+private:
+    z_stream _stream;
+
+    void _deflate(const char* data, size_t length, int flush, std::string& out);
+
+    // Prevent copying
+    GzipEncoder(const GzipEncoder& other);
+    GzipEncoder& operator=(const GzipEncoder& other);
+};
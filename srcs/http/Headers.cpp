@@ -3,159 +3,396 @@
 #include <algorithm>
 #include <cstring>
 #include <cctype>
+#include <cstdlib>
+#include <pthread.h>
 
-Headers::Headers() {}
+// Canonical names of the well-known headers, in Headers::Id order
+static const char* const KNOWN_NAMES[Headers::KNOWN_COUNT] = {
+    "Accept-Encoding",
+    "Accept-Ranges",
+    "Cache-Control",
+    "Connection",
+    "Content-Disposition",
+    "Content-Encoding",
+    "Content-Length",
+    "Content-Range",
+    "Content-Type",
+    "Cookie",
+    "Date",
+    "ETag",
+    "Expect",
+    "Host",
+    "If-Modified-Since",
+    "If-None-Match",
+    "If-Range",
+    "Keep-Alive",
+    "Last-Modified",
+    "Location",
+    "Range",
+    "Server",
+    "Set-Cookie",
+    "Status",
+    "Transfer-Encoding",
+    "User-Agent",
+    "Vary"
+};
 
-Headers::~Headers() {}
+static const std::string EMPTY_VALUE;
 
-std::string Headers::_normalize(const std::string& name) const
+static inline char asciiLower(char c)
 {
-    std::string result = name;
-    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
-    return result;
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
 }
 
-void Headers::set(const std::string& name, const std::string& value)
+static bool equalsIgnoreCase(const char* a, const char* b, size_t length)
 {
-    _headers[_normalize(name)] = value;
+    for (size_t i = 0; i < length; ++i) {
+        if (asciiLower(a[i]) != asciiLower(b[i])) {
+            return false;
+        }
+    }
+    return true;
 }
 
-bool Headers::contains(const std::string& name) const
+static bool containsIgnoreCase(const std::string& haystack, const char* needle)
+{
+    size_t length = strlen(needle);
+    for (size_t i = 0; i + length <= haystack.size(); ++i) {
+        if (equalsIgnoreCase(haystack.data() + i, needle, length)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Canonical names as strings and their hashes
+ */
+struct KnownHeaders {
+    std::string names[Headers::KNOWN_COUNT];
+    unsigned int hashes[Headers::KNOWN_COUNT];
+
+    KnownHeaders() {
+        for (int i = 0; i < Headers::KNOWN_COUNT; ++i) {
+            names[i] = KNOWN_NAMES[i];
+            hashes[i] = Headers::hashName(names[i].data(), names[i].size());
+        }
+    }
+};
+
+static pthread_once_t knownHeadersOnce = PTHREAD_ONCE_INIT;
+static const KnownHeaders* knownHeadersTable = NULL;
+
+static void buildKnownHeaders()
+{
+    knownHeadersTable = new KnownHeaders();
+}
+
+static const KnownHeaders& knownHeaders()
 {
-    return _headers.find(_normalize(name)) != _headers.end();
+    // Built once, by whichever event loop thread gets here first
+    pthread_once(&knownHeadersOnce, buildKnownHeaders);
+    return *knownHeadersTable;
 }
 
-std::string Headers::get(const std::string& name) const
+Headers::Headers() : _fields(), _count(0)
 {
-    std::map<std::string, std::string>::const_iterator it = _headers.find(_normalize(name));
-    if (it != _headers.end()) {
-        return it->second;
+    memset(_index, 0, sizeof(_index));
+}
+
+Headers::~Headers() {}
+
+unsigned int Headers::hashName(const char* name, size_t length)
+{
+    // FNV-1a over the lowercase name
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(asciiLower(name[i]));
+        hash *= 16777619u;
     }
-    return "";
+    return hash;
 }
 
-void Headers::remove(const std::string& name)
+Headers::Id Headers::_lookupId(const char* name, size_t length, unsigned int hash)
 {
-    _headers.erase(_normalize(name));
+    const KnownHeaders& known = knownHeaders();
+    for (int i = 0; i < KNOWN_COUNT; ++i) {
+        if (known.hashes[i] == hash && known.names[i].size() == length &&
+            equalsIgnoreCase(known.names[i].data(), name, length)) {
+            return static_cast<Id>(i);
+        }
+    }
+    return OTHER;
 }
 
-const std::map<std::string, std::string>& Headers::getAll() const
+const std::string& Headers::nameOf(Id id)
 {
-    return _headers;
+    return knownHeaders().names[id];
 }
 
-std::string Headers::toString() const
+size_t Headers::_find(const char* name, size_t length) const
 {
-    std::string result;
-    
-    for (std::map<std::string, std::string>::const_iterator it = _headers.begin(); it != _headers.end(); ++it) {
-        // Capitalize first letter of each header word for standard formatting
-        std::string name = it->first;
+    unsigned int hash = hashName(name, length);
+    Id id = _lookupId(name, length, hash);
+    if (id != OTHER) {
+        return _index[id] ? _index[id] - 1 : _count;
+    }
+
+    for (size_t i = 0; i < _count; ++i) {
+        const Field& field = _fields[i];
+        if (field.hash == hash && field.name.size() == length &&
+            equalsIgnoreCase(field.name.data(), name, length)) {
+            return i;
+        }
+    }
+    return _count;
+}
+
+void Headers::_set(Id id, const char* name, size_t nameLength, unsigned int hash,
+                   const char* value, size_t valueLength)
+{
+    // Replace an existing field
+    size_t position = (id != OTHER) ? (_index[id] ? _index[id] - 1 : _count) : _find(name, nameLength);
+    if (position < _count) {
+        _fields[position].value.assign(value, valueLength);
+        return;
+    }
+
+    // Append, reusing a spare entry (and its string buffers) when there is one
+    if (_count == _fields.size()) {
+        if (_fields.capacity() == 0) {
+            _fields.reserve(16);
+        }
+        _fields.push_back(Field());
+    }
+    Field& field = _fields[_count];
+    if (id != OTHER) {
+        field.name = nameOf(id);
+    } else {
+        // Capitalize each word once here instead of on every serialization
+        field.name.assign(name, nameLength);
         bool capitalize = true;
-        
-        for (size_t i = 0; i < name.length(); ++i) {
+        for (size_t i = 0; i < field.name.length(); ++i) {
             if (capitalize) {
-                name[i] = toupper(name[i]);
+                field.name[i] = toupper(field.name[i]);
                 capitalize = false;
-            } else if (name[i] == '-') {
+            } else if (field.name[i] == '-') {
                 capitalize = true;
             }
         }
-        
-        result += name + ": " + it->second + "\r\n";
     }
-    
+    field.value.assign(value, valueLength);
+    field.hash = hash;
+    field.id = id;
+    ++_count;
+    if (id != OTHER) {
+        _index[id] = _count;
+    }
+}
+
+void Headers::_removeAt(size_t position)
+{
+    if (_fields[position].id != OTHER) {
+        _index[_fields[position].id] = 0;
+    }
+
+    // Shift later fields down, swapping so the removed entry becomes a spare
+    for (size_t i = position; i + 1 < _count; ++i) {
+        Field& current = _fields[i];
+        Field& next = _fields[i + 1];
+        current.name.swap(next.name);
+        current.value.swap(next.value);
+        std::swap(current.hash, next.hash);
+        std::swap(current.id, next.id);
+        if (current.id != OTHER) {
+            _index[current.id] = i + 1;
+        }
+    }
+    --_count;
+}
+
+void Headers::set(const std::string& name, const std::string& value)
+{
+    set(name.data(), name.size(), value.data(), value.size());
+}
+
+void Headers::set(const char* name, size_t nameLength, const char* value, size_t valueLength)
+{
+    unsigned int hash = hashName(name, nameLength);
+    _set(_lookupId(name, nameLength, hash), name, nameLength, hash, value, valueLength);
+}
+
+void Headers::set(Id id, const std::string& value)
+{
+    set(id, value.data(), value.size());
+}
+
+void Headers::set(Id id, const char* value, size_t valueLength)
+{
+    const KnownHeaders& known = knownHeaders();
+    _set(id, known.names[id].data(), known.names[id].size(), known.hashes[id], value, valueLength);
+}
+
+bool Headers::contains(const std::string& name) const
+{
+    return _find(name.data(), name.size()) < _count;
+}
+
+bool Headers::contains(Id id) const
+{
+    return _index[id] != 0;
+}
+
+const std::string& Headers::get(const std::string& name) const
+{
+    size_t position = _find(name.data(), name.size());
+    if (position < _count) {
+        return _fields[position].value;
+    }
+    return EMPTY_VALUE;
+}
+
+const std::string& Headers::get(Id id) const
+{
+    if (_index[id]) {
+        return _fields[_index[id] - 1].value;
+    }
+    return EMPTY_VALUE;
+}
+
+void Headers::remove(const std::string& name)
+{
+    size_t position = _find(name.data(), name.size());
+    if (position < _count) {
+        _removeAt(position);
+    }
+}
+
+void Headers::remove(Id id)
+{
+    if (_index[id]) {
+        _removeAt(_index[id] - 1);
+    }
+}
+
+size_t Headers::size() const
+{
+    return _count;
+}
+
+const Headers::Field& Headers::at(size_t position) const
+{
+    return _fields[position];
+}
+
+std::string Headers::toString() const
+{
+    std::string result;
+    appendTo(result);
     return result;
 }
 
+void Headers::appendTo(std::string& out) const
+{
+    size_t length = 0;
+    for (size_t i = 0; i < _count; ++i) {
+        length += _fields[i].name.size() + _fields[i].value.size() + 4;
+    }
+    out.reserve(out.size() + length);
+
+    for (size_t i = 0; i < _count; ++i) {
+        out += _fields[i].name;
+        out += ": ";
+        out += _fields[i].value;
+        out += "\r\n";
+    }
+}
+
 bool Headers::parse(const std::string& str)
 {
-    std::istringstream stream(str);
-    std::string line;
-    
-    while (std::getline(stream, line)) {
+    size_t start = 0;
+
+    while (start < str.size()) {
+        size_t end = str.find('\n', start);
+        if (end == std::string::npos) {
+            end = str.size();
+        }
+        size_t lineEnd = end;
+
         // Remove trailing CR if present (for CRLF)
-        if (!line.empty() && line[line.length() - 1] == '\r') {
-            line.erase(line.length() - 1);
+        if (lineEnd > start && str[lineEnd - 1] == '\r') {
+            --lineEnd;
         }
-        
+
         // Skip empty lines
-        if (line.empty()) {
-            continue;
-        }
-        
-        // Find the colon separator
-        size_t colonPos = line.find(':');
-        if (colonPos == std::string::npos) {
-            return false; // Invalid header format
+        if (lineEnd > start) {
+            // Find the colon separator
+            size_t colonPos = str.find(':', start);
+            if (colonPos == std::string::npos || colonPos >= lineEnd) {
+                return false; // Invalid header format
+            }
+
+            std::string name = StringUtils::trim(str.substr(start, colonPos - start), " \t");
+            std::string value = StringUtils::trim(str.substr(colonPos + 1, lineEnd - colonPos - 1), " \t");
+            set(name, value);
         }
-        
-        std::string name = line.substr(0, colonPos);
-        std::string value = line.substr(colonPos + 1);
-        
-        // Trim whitespace
-        name = StringUtils::trim(name, " \t");
-        value = StringUtils::trim(value, " \t");
-        
-        set(name, value);
-    }
-    
+        start = end + 1;
+    }
+
     return true;
 }
 
 void Headers::clear()
 {
-    _headers.clear();
+    // Keep the fields as spares so their buffers are reused
+    _count = 0;
+    memset(_index, 0, sizeof(_index));
 }
 
 size_t Headers::getContentLength() const
 {
-    std::string value = get("content-length");
+    const std::string& value = get(CONTENT_LENGTH);
     if (value.empty()) {
         return 0;
     }
-    
+
     // Convert to integer
     char* endptr;
     long result = strtol(value.c_str(), &endptr, 10);
-    
+
     // Check if conversion was successful
     if (*endptr != '\0' || result < 0) {
         return 0;
     }
-    
+
     return static_cast<size_t>(result);
 }
 
-std::string Headers::getContentType() const
+const std::string& Headers::getContentType() const
 {
-    return get("content-type");
+    return get(CONTENT_TYPE);
 }
 
 bool Headers::hasChunkedEncoding() const
 {
-    std::string transferEncoding = get("transfer-encoding");
-    return transferEncoding.find("chunked") != std::string::npos;
+    return containsIgnoreCase(get(TRANSFER_ENCODING), "chunked");
 }
 
 bool Headers::keepAlive(bool defaultValue) const
 {
-    std::string connection = get("connection");
-    
+    const std::string& connection = get(CONNECTION);
+
     if (connection.empty()) {
         return defaultValue;
     }
-    
-    // Convert to lowercase for case-insensitive comparison
-    std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
-    
-    if (connection.find("close") != std::string::npos) {
+
+    if (containsIgnoreCase(connection, "close")) {
         return false;
     }
-    
-    if (connection.find("keep-alive") != std::string::npos) {
+
+    if (containsIgnoreCase(connection, "keep-alive")) {
         return true;
     }
-    
+
     return defaultValue;
-}
\ No newline at end of file
+}
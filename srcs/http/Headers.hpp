@@ -1,124 +1,277 @@
 #pragma once
 
-#include <map>
 #include <string>
-#include <sstream>
+#include <vector>
+#include <cstddef>
 #include "../utils/StringUtils.hpp"
 
 /**
  * @brief Class to represent and manipulate HTTP headers
- * 
- * This class provides methods for working with HTTP headers,
- * with case-insensitive header names and utility methods for
- * common header operations.
+ *
+ * Fields are kept in a flat array in insertion order. Each field stores
+ * a case-insensitive hash of its name and, for well-known headers, an Id
+ * so lookups compare integers instead of building lowercase copies.
+ * Well-known headers are also indexed directly by Id. Names are stored in
+ * canonical form (e.g. "Content-Length") once, when the field is set, so
+ * toString() copies them as they are.
+ *
+ * clear() keeps the field storage, so a reused object (the Request of a
+ * keep-alive connection) parses later requests without reallocating.
  */
 class Headers {
+public:
+    /**
+     * @brief Well-known header fields
+     */
+    enum Id {
+        ACCEPT_ENCODING,
+        ACCEPT_RANGES,
+        CACHE_CONTROL,
+        CONNECTION,
+        CONTENT_DISPOSITION,
+        CONTENT_ENCODING,
+        CONTENT_LENGTH,
+        CONTENT_RANGE,
+        CONTENT_TYPE,
+        COOKIE,
+        DATE,
+        ETAG,
+        EXPECT,
+        HOST,
+        IF_MODIFIED_SINCE,
+        IF_NONE_MATCH,
+        IF_RANGE,
+        KEEP_ALIVE,
+        LAST_MODIFIED,
+        LOCATION,
+        RANGE,
+        SERVER,
+        SET_COOKIE,
+        STATUS,
+        TRANSFER_ENCODING,
+        USER_AGENT,
+        VARY,
+        KNOWN_COUNT,            // Number of well-known headers
+        OTHER = KNOWN_COUNT     // Any other field
+    };
+
+    /**
+     * @brief One header field
+     */
+    struct Field {
+        std::string name;       // Canonical name
+        std::string value;      // Field value
+        unsigned int hash;      // Case-insensitive hash of the name
+        Id id;                  // Well-known header, OTHER if none
+    };
+
 private:
-    std::map<std::string, std::string> _headers;  // Normalized header name to value
+    std::vector<Field> _fields;             // Field storage, entries past _count are spare
+    size_t _count;                          // Number of fields in use
+    unsigned int _index[KNOWN_COUNT];       // Position + 1 of each well-known field, 0 if absent
+
+    /**
+     * @brief Find the well-known header with this name
+     *
+     * @return Id The header Id, OTHER if the name is not well known
+     */
+    static Id _lookupId(const char* name, size_t length, unsigned int hash);
+
+    /**
+     * @brief Find a field by name
+     *
+     * @return size_t The field position, _count if absent
+     */
+    size_t _find(const char* name, size_t length) const;
+
+    /**
+     * @brief Set a field, replacing an existing one with the same name
+     */
+    void _set(Id id, const char* name, size_t nameLength, unsigned int hash,
+              const char* value, size_t valueLength);
 
     /**
-     * @brief Normalize a header name (convert to lowercase)
-     * 
-     * @param name Header name to normalize
-     * @return std::string Normalized header name
+     * @brief Remove the field at a position, keeping the others in order
      */
-    std::string _normalize(const std::string& name) const;
+    void _removeAt(size_t position);
 
 public:
     /**
      * @brief Construct a new Headers object
      */
     Headers();
-    
+
     /**
      * @brief Destroy the Headers object
      */
     ~Headers();
 
+    /**
+     * @brief Hash a header name, ignoring case
+     *
+     * @param name Header name
+     * @param length Name length
+     * @return unsigned int FNV-1a hash of the lowercase name
+     */
+    static unsigned int hashName(const char* name, size_t length);
+
+    /**
+     * @brief Get the canonical name of a well-known header
+     *
+     * @param id Header Id
+     * @return const std::string& Canonical name
+     */
+    static const std::string& nameOf(Id id);
+
     /**
      * @brief Set a header value
-     * 
+     *
      * @param name Header name
      * @param value Header value
      */
     void set(const std::string& name, const std::string& value);
-    
+
+    /**
+     * @brief Set a header value from a parsed line
+     *
+     * @param name Header name
+     * @param nameLength Name length
+     * @param value Header value
+     * @param valueLength Value length
+     */
+    void set(const char* name, size_t nameLength, const char* value, size_t valueLength);
+
+    /**
+     * @brief Set a well-known header value
+     *
+     * @param id Header Id
+     * @param value Header value
+     */
+    void set(Id id, const std::string& value);
+
+    /**
+     * @brief Set a well-known header value from a character range
+     *
+     * @param id Header Id
+     * @param value Header value
+     * @param valueLength Value length
+     */
+    void set(Id id, const char* value, size_t valueLength);
+
     /**
      * @brief Check if a header exists
-     * 
+     *
      * @param name Header name
      * @return true if header exists
      */
     bool contains(const std::string& name) const;
-    
+
+    /**
+     * @brief Check if a well-known header exists
+     *
+     * @param id Header Id
+     * @return true if header exists
+     */
+    bool contains(Id id) const;
+
     /**
      * @brief Get a header value
-     * 
+     *
      * @param name Header name
-     * @return std::string Header value, empty string if not found
+     * @return const std::string& Header value, empty string if not found
+     */
+    const std::string& get(const std::string& name) const;
+
+    /**
+     * @brief Get a well-known header value
+     *
+     * @param id Header Id
+     * @return const std::string& Header value, empty string if not found
      */
-    std::string get(const std::string& name) const;
-    
+    const std::string& get(Id id) const;
+
     /**
      * @brief Remove a header
-     * 
+     *
      * @param name Header name
      */
     void remove(const std::string& name);
-    
+
     /**
-     * @brief Get all headers as a map
-     * 
-     * @return const std::map<std::string, std::string>& Headers map
+     * @brief Remove a well-known header
+     *
+     * @param id Header Id
      */
-    const std::map<std::string, std::string>& getAll() const;
-    
+    void remove(Id id);
+
+    /**
+     * @brief Get the number of header fields
+     *
+     * @return size_t Field count
+     */
+    size_t size() const;
+
+    /**
+     * @brief Get a header field by position, in insertion order
+     *
+     * @param position Index below size()
+     * @return const Field& The field
+     */
+    const Field& at(size_t position) const;
+
     /**
      * @brief Convert headers to a string
-     * 
+     *
      * @return std::string Headers as a string in HTTP format
      */
     std::string toString() const;
-    
+
+    /**
+     * @brief Append the headers in HTTP format to a string
+     *
+     * @param out String to append to
+     */
+    void appendTo(std::string& out) const;
+
     /**
      * @brief Parse headers from a string
-     * 
+     *
      * @param str String containing headers
      * @return bool True if parsing was successful
      */
     bool parse(const std::string& str);
-    
+
     /**
      * @brief Clear all headers
      */
     void clear();
-    
+
     /**
      * @brief Get the Content-Length value
-     * 
+     *
      * @return size_t Content length, 0 if not set or invalid
      */
     size_t getContentLength() const;
-    
+
     /**
      * @brief Get the Content-Type value
-     * 
-     * @return std::string Content type, empty string if not set
+     *
+     * @return const std::string& Content type, empty string if not set
      */
-    std::string getContentType() const;
-    
+    const std::string& getContentType() const;
+
     /**
      * @brief Check if Transfer-Encoding is chunked
-     * 
+     *
      * @return true if chunked encoding is used
      */
     bool hasChunkedEncoding() const;
-    
+
     /**
      * @brief Check if connection should be kept alive
-     * 
+     *
      * @param defaultValue Default value if header not present
      * @return true if connection should be kept alive
      */
     bool keepAlive(bool defaultValue = true) const;
-};
\ No newline at end of file
+};
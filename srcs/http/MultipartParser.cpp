@@ -1,16 +1,53 @@
 #include "../utils/StringUtils.hpp"
 #include "MultipartParser.hpp"
+#include "../utils/DebugLogger.hpp"
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <vector>
+
+MultipartParser::MultipartParser(const std::string& contentType)
+    : _boundary(_extractBoundary(contentType)), _body(), _fields(), _files(),
+      _delimiter(), _window(), _state(PREAMBLE), _partKind(PART_SKIP), _fieldName(),
+      _uploadDir(), _fileFd(-1)
+{
+    _init();
+}
 
 MultipartParser::MultipartParser(const std::string& contentType, const std::string& body)
-    : _boundary(_extractBoundary(contentType)), _body(body), _fields(), _files()
+    : _boundary(_extractBoundary(contentType)), _body(body), _fields(), _files(),
+      _delimiter(), _window(), _state(PREAMBLE), _partKind(PART_SKIP), _fieldName(),
+      _uploadDir(), _fileFd(-1)
 {
+    _init();
 }
 
 MultipartParser::~MultipartParser()
 {
+    _endPart();
+    _removeTempFiles();
+}
+
+void MultipartParser::_init()
+{
+    if (_boundary.empty()) {
+        _state = FAILED;
+        return;
+    }
+    _delimiter = "\r\n--" + _boundary;
+    // The first delimiter may open the body without a preceding CRLF
+    _window = "\r\n";
+}
+
+void MultipartParser::setUploadDir(const std::string& uploadDir)
+{
+    _uploadDir = uploadDir;
 }
 
 std::string MultipartParser::_extractBoundary(const std::string& contentType)
@@ -20,118 +57,184 @@ std::string MultipartParser::_extractBoundary(const std::string& contentType)
     if (boundaryPos == std::string::npos) {
         return "";
     }
-    
+
     // Extract boundary value
     std::string boundary = contentType.substr(boundaryPos + 9); // 9 = length of "boundary="
-    
+
     // Remove quotes if present
     if (!boundary.empty() && boundary[0] == '"') {
         boundary = boundary.substr(1, boundary.length() - 2);
     }
-    
+
     // Remove any trailing parameters
     size_t semicolonPos = boundary.find(';');
     if (semicolonPos != std::string::npos) {
         boundary = boundary.substr(0, semicolonPos);
     }
-    
+
     // Trim whitespace
     boundary = StringUtils::trim(boundary, " \t");
-    
+
     return boundary;
 }
 
-bool MultipartParser::parse()
+bool MultipartParser::feed(const char* data, size_t length)
 {
-    if (_boundary.empty()) {
+    if (_state == FAILED) {
         return false;
     }
-    
-    // Split body into parts using the boundary
-    std::string delimiter = "--" + _boundary;
-    std::string endDelimiter = delimiter + "--";
-    
-    size_t pos = _body.find(delimiter);
-    if (pos == std::string::npos) {
-        return false;
+    if (_state == EPILOGUE) {
+        return true;
     }
-    
-    // Skip the first boundary
-    pos += delimiter.length();
-    
-    while (pos < _body.length()) {
-        // Check if this is the end boundary
-        if (pos + 2 <= _body.length() && _body.substr(pos, 2) == "--") {
-            break;
-        }
-        
-        // Skip the CRLF after the boundary
-        if (pos + 2 <= _body.length() && _body.substr(pos, 2) == "\r\n") {
-            pos += 2;
-        }
-        
-        // Find the next boundary
-        size_t nextPos = _body.find(delimiter, pos);
-        if (nextPos == std::string::npos) {
-            // If no more boundaries, look for the end delimiter
-            nextPos = _body.find(endDelimiter, pos);
-            if (nextPos == std::string::npos) {
-                // If no end delimiter, use the end of the body
-                nextPos = _body.length();
+    _window.append(data, length);
+
+    for (;;) {
+        switch (_state) {
+            case PREAMBLE: {
+                size_t pos = _window.find(_delimiter);
+                if (pos == std::string::npos) {
+                    // Keep only what could be the start of a split delimiter
+                    if (_window.size() >= _delimiter.size()) {
+                        _window.erase(0, _window.size() - _delimiter.size() + 1);
+                    }
+                    return true;
+                }
+                _window.erase(0, pos + _delimiter.size());
+                _state = DELIMITER_END;
+                break;
+            }
+
+            case DELIMITER_END: {
+                if (_window.size() < 2) {
+                    return true;
+                }
+                if (_window.compare(0, 2, "--") == 0) {
+                    _state = EPILOGUE;
+                    _window.clear();
+                    return true;
+                }
+                // CRLF, optionally preceded by transport padding
+                size_t eol = _window.find("\r\n");
+                if (eol == std::string::npos) {
+                    if (_window.size() > MAX_PART_HEADER_SIZE) {
+                        return _fail("delimiter line too long");
+                    }
+                    return true;
+                }
+                if (_window.find_first_not_of(" \t") < eol) {
+                    return _fail("garbage after delimiter");
+                }
+                _window.erase(0, eol + 2);
+                _state = PART_HEADERS;
+                break;
+            }
+
+            case PART_HEADERS: {
+                std::string headers;
+                if (_window.compare(0, 2, "\r\n") == 0) {
+                    // Part without headers
+                    _window.erase(0, 2);
+                } else {
+                    size_t end = _window.find("\r\n\r\n");
+                    if (end == std::string::npos) {
+                        if (_window.size() > MAX_PART_HEADER_SIZE) {
+                            return _fail("part headers too large");
+                        }
+                        return true;
+                    }
+                    headers = _window.substr(0, end);
+                    _window.erase(0, end + 4);
+                }
+                if (!_startPart(headers)) {
+                    return false;
+                }
+                _state = PART_BODY;
+                break;
+            }
+
+            case PART_BODY: {
+                size_t pos = _window.find(_delimiter);
+                if (pos == std::string::npos) {
+                    // Everything except a possible delimiter prefix is content
+                    if (_window.size() >= _delimiter.size()) {
+                        size_t safe = _window.size() - _delimiter.size() + 1;
+                        if (!_writePartData(_window.data(), safe)) {
+                            return false;
+                        }
+                        _window.erase(0, safe);
+                    }
+                    return true;
+                }
+                if (!_writePartData(_window.data(), pos)) {
+                    return false;
+                }
+                _endPart();
+                _window.erase(0, pos + _delimiter.size());
+                _state = DELIMITER_END;
+                break;
             }
+
+            case EPILOGUE:
+                _window.clear();
+                return true;
+
+            case FAILED:
+                return false;
         }
-        
-        // Extract the part content
-        std::string part = _body.substr(pos, nextPos - pos);
-        
-        // Remove trailing CRLF before the next boundary
-        if (part.length() >= 2 && part.substr(part.length() - 2) == "\r\n") {
-            part = part.substr(0, part.length() - 2);
+    }
+}
+
+bool MultipartParser::finish()
+{
+    return _state == EPILOGUE;
+}
+
+bool MultipartParser::parse()
+{
+    if (_state == FAILED || !feed(_body.data(), _body.size())) {
+        return false;
+    }
+    if (_state == PREAMBLE) {
+        return false;
+    }
+    // Tolerate a missing closing delimiter: the last part runs to the end of the body
+    if (_state == PART_BODY) {
+        if (!_writePartData(_window.data(), _window.size())) {
+            return false;
         }
-        
-        // Parse the part
-        _parsePart(part);
-        
-        // Move to the next part
-        pos = nextPos + delimiter.length();
+        _endPart();
+        _window.clear();
+        _state = EPILOGUE;
     }
-    
     return true;
 }
 
-void MultipartParser::_parsePart(const std::string& part)
+bool MultipartParser::_startPart(const std::string& headers)
 {
-    // Find the dividing line between headers and body
-    size_t headerEnd = part.find("\r\n\r\n");
-    if (headerEnd == std::string::npos) {
-        return;
-    }
-    
-    // Extract headers and body
-    std::string headers = part.substr(0, headerEnd);
-    std::string body = part.substr(headerEnd + 4); // +4 for \r\n\r\n
-    
+    _partKind = PART_SKIP;
+
     // Parse headers
     std::map<std::string, std::string> partHeaders = _parsePartHeaders(headers);
-    
+
     // Check if this part has a Content-Disposition header
     std::map<std::string, std::string>::const_iterator contentDispositionIt = partHeaders.find("content-disposition");
     if (contentDispositionIt == partHeaders.end()) {
-        return;
+        return true;
     }
-    
+
     // Parse Content-Disposition header
     std::map<std::string, std::string> disposition = _parseContentDisposition(contentDispositionIt->second);
-    
+
     // Check if this is a file upload or a form field
     std::map<std::string, std::string>::const_iterator filenameIt = disposition.find("filename");
-    
+
     if (filenameIt != disposition.end() && !filenameIt->second.empty()) {
         // This is a file upload
         UploadedFile file;
         file.name = disposition["name"];
         file.filename = filenameIt->second;
-        
+        file.size = 0;
+
         // Get content type if available
         std::map<std::string, std::string>::const_iterator contentTypeIt = partHeaders.find("content-type");
         if (contentTypeIt != partHeaders.end()) {
@@ -139,14 +242,103 @@ void MultipartParser::_parsePart(const std::string& part)
         } else {
             file.contentType = "application/octet-stream";
         }
-        
-        file.content = body;
-        
+
+        if (!_uploadDir.empty()) {
+            // Spool to a hidden temporary file next to the final destination
+            std::string pattern = _uploadDir;
+            if (pattern[pattern.length() - 1] != '/') {
+                pattern += "/";
+            }
+            pattern += ".upload-XXXXXX";
+            std::vector<char> path(pattern.begin(), pattern.end());
+            path.push_back('\0');
+
+            _fileFd = mkstemp(&path[0]);
+            if (_fileFd < 0) {
+                return _fail(std::string("cannot create temporary file: ") + strerror(errno));
+            }
+            fcntl(_fileFd, F_SETFD, FD_CLOEXEC);
+            file.tempPath = &path[0];
+        }
+
         _files.push_back(file);
+        _partKind = PART_FILE;
     } else {
         // This is a form field
-        _fields[disposition["name"]] = body;
+        _fieldName = disposition["name"];
+        _fields[_fieldName] = "";
+        _partKind = PART_FIELD;
+    }
+    return true;
+}
+
+bool MultipartParser::_writePartData(const char* data, size_t length)
+{
+    if (length == 0) {
+        return true;
     }
+    switch (_partKind) {
+        case PART_SKIP:
+            break;
+
+        case PART_FIELD:
+            _fields[_fieldName].append(data, length);
+            break;
+
+        case PART_FILE: {
+            UploadedFile& file = _files.back();
+            if (_fileFd < 0) {
+                file.content.append(data, length);
+                file.size += length;
+                break;
+            }
+            size_t written = 0;
+            while (written < length) {
+                ssize_t n = write(_fileFd, data + written, length - written);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return _fail(std::string("cannot write temporary file: ") + strerror(errno));
+                }
+                written += n;
+            }
+            file.size += length;
+            break;
+        }
+    }
+    return true;
+}
+
+void MultipartParser::_endPart()
+{
+    if (_fileFd >= 0) {
+        close(_fileFd);
+        _fileFd = -1;
+    }
+    _partKind = PART_SKIP;
+}
+
+void MultipartParser::_removeTempFiles()
+{
+    // Files that were never saved are not left behind in the upload directory
+    for (size_t i = 0; i < _files.size(); ++i) {
+        if (!_files[i].tempPath.empty()) {
+            unlink(_files[i].tempPath.c_str());
+            _files[i].tempPath.clear();
+        }
+    }
+}
+
+bool MultipartParser::_fail(const std::string& reason)
+{
+    LOG_WARN("Multipart parse error: " << reason);
+    _endPart();
+    // The rest of the body may still take a while to arrive
+    _removeTempFiles();
+    _window.clear();
+    _state = FAILED;
+    return false;
 }
 
 std::map<std::string, std::string> MultipartParser::_parsePartHeaders(const std::string& headers)
@@ -282,17 +474,31 @@ std::string MultipartParser::getField(const std::string& name) const
     return "";
 }
 
-bool MultipartParser::saveFile(size_t index, const std::string& path) const
+bool MultipartParser::saveFile(size_t index, const std::string& path)
 {
-    if (index >= _files.size()) {
+    if (index >= _files.size() || _state == FAILED) {
         return false;
     }
-    
+
+    UploadedFile& upload = _files[index];
+    if (!upload.tempPath.empty()) {
+        // Spooled to the upload directory already, just give it its name
+        if (rename(upload.tempPath.c_str(), path.c_str()) != 0) {
+            return false;
+        }
+        upload.tempPath.clear();
+        return true;
+    }
+    if (!_uploadDir.empty()) {
+        // Spooled and saved before: the content is no longer here
+        return false;
+    }
+
     std::ofstream file(path.c_str(), std::ios::binary);
     if (!file.is_open()) {
         return false;
     }
-    
-    file.write(_files[index].content.c_str(), _files[index].content.size());
+
+    file.write(upload.content.c_str(), upload.content.size());
     return !file.bad();
-}
\ No newline at end of file
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <cstddef>
 
 /**
  * @brief Structure to represent a file in a multipart upload
@@ -11,99 +12,210 @@ struct UploadedFile {
     std::string name;          // File field name
     std::string filename;      // Original filename
     std::string contentType;   // File content type
-    std::string content;       // File content
+    std::string content;       // File content (in-memory mode only)
+    std::string tempPath;      // Temporary file holding the content (upload dir mode), empty once saved
+    size_t size;               // Content size in bytes
 };
 
 /**
  * @brief Class to parse multipart/form-data uploads
+ *
+ * The parser is an incremental state machine: feed() accepts the body in
+ * arbitrary slices as it arrives from the socket. Only a window slightly
+ * longer than the boundary is kept between calls. With an upload directory
+ * set, file parts are written straight to temporary files there and
+ * saveFile() renames them into place; otherwise they are kept in memory.
  */
 class MultipartParser {
 private:
+    /**
+     * @brief Parser position in the multipart body
+     */
+    enum State {
+        PREAMBLE,       // Before the first delimiter
+        DELIMITER_END,  // After a delimiter: "--" ends the body, CRLF starts a part
+        PART_HEADERS,   // Reading the headers of a part
+        PART_BODY,      // Reading part content up to the next delimiter
+        EPILOGUE,       // After the closing delimiter, everything is ignored
+        FAILED          // Malformed input or write error
+    };
+
+    /**
+     * @brief What the content of the current part goes to
+     */
+    enum PartKind {
+        PART_SKIP,      // No usable Content-Disposition
+        PART_FIELD,     // Form field value
+        PART_FILE       // Uploaded file
+    };
+
     std::string _boundary;                  // Boundary string
-    std::string _body;                      // Request body
+    std::string _body;                      // Request body (buffered constructor only)
     std::map<std::string, std::string> _fields;  // Form fields
     std::vector<UploadedFile> _files;       // Uploaded files
 
+    // Incremental parsing state
+    std::string _delimiter;                 // CRLF "--" boundary
+    std::string _window;                    // Unconsumed input
+    State _state;
+    PartKind _partKind;
+    std::string _fieldName;                 // Field of the current PART_FIELD
+    std::string _uploadDir;                 // Where file parts are spooled, empty for memory
+    int _fileFd;                            // Temporary file of the current PART_FILE, -1 if none
+
+    // Part header blocks larger than this are rejected
+    static const size_t MAX_PART_HEADER_SIZE = 8192;
+
     /**
      * @brief Extract the boundary from Content-Type header
-     * 
+     *
      * @param contentType Content-Type header value
      * @return std::string Boundary string
      */
     std::string _extractBoundary(const std::string& contentType);
-    
+
+    /**
+     * @brief Set up the delimiter and initial state
+     */
+    void _init();
+
+    /**
+     * @brief Start a part from its header block
+     *
+     * @param headers Headers section
+     * @return bool False if the part's temporary file could not be created
+     */
+    bool _startPart(const std::string& headers);
+
+    /**
+     * @brief Append content to the current part
+     *
+     * @return bool False on a write error
+     */
+    bool _writePartData(const char* data, size_t length);
+
+    /**
+     * @brief Finish the current part
+     */
+    void _endPart();
+
+    /**
+     * @brief Unlink the temporary files not saved yet
+     */
+    void _removeTempFiles();
+
     /**
-     * @brief Parse a single part of the multipart data
-     * 
-     * @param part Part content
+     * @brief Enter the FAILED state, removing unsaved temporary files
+     *
+     * @return bool Always false
      */
-    void _parsePart(const std::string& part);
-    
+    bool _fail(const std::string& reason);
+
     /**
      * @brief Parse headers from a part
-     * 
+     *
      * @param headers Headers section
      * @return std::map<std::string, std::string> Parsed headers
      */
     std::map<std::string, std::string> _parsePartHeaders(const std::string& headers);
-    
+
     /**
      * @brief Parse the Content-Disposition header
-     * 
+     *
      * @param contentDisposition Content-Disposition header value
      * @return std::map<std::string, std::string> Parsed attributes
      */
     std::map<std::string, std::string> _parseContentDisposition(const std::string& contentDisposition);
 
+    // Prevent copying (owns temporary files)
+    MultipartParser(const MultipartParser& other);
+    MultipartParser& operator=(const MultipartParser& other);
+
 public:
     /**
-     * @brief Construct a new MultipartParser object
-     * 
+     * @brief Construct a parser that receives the body through feed()
+     *
+     * @param contentType Content-Type header value
+     */
+    explicit MultipartParser(const std::string& contentType);
+
+    /**
+     * @brief Construct a new MultipartParser object for a complete body
+     *
      * @param contentType Content-Type header value
      * @param body Request body
      */
     MultipartParser(const std::string& contentType, const std::string& body);
-    
+
     /**
-     * @brief Destroy the MultipartParser object
+     * @brief Destroy the MultipartParser object, removing unsaved temporary files
      */
     ~MultipartParser();
-    
+
+    /**
+     * @brief Spool file parts to temporary files in a directory
+     *
+     * Must be called before the first feed(). The directory should be the
+     * final destination so saveFile() is a rename.
+     *
+     * @param uploadDir Existing, writable directory
+     */
+    void setUploadDir(const std::string& uploadDir);
+
+    /**
+     * @brief Parse the next slice of the body
+     *
+     * @param data Body bytes
+     * @param length Number of bytes
+     * @return bool False once the input is malformed or a file write failed
+     */
+    bool feed(const char* data, size_t length);
+
+    /**
+     * @brief Check that the whole body was received and parsed
+     *
+     * @return bool True if the closing delimiter was seen without errors
+     */
+    bool finish();
+
     /**
      * @brief Parse the multipart data
-     * 
+     *
      * @return bool True if parsing was successful
      */
     bool parse();
-    
+
     /**
      * @brief Get the form fields
-     * 
+     *
      * @return const std::map<std::string, std::string>& Form fields
      */
     const std::map<std::string, std::string>& getFields() const;
-    
+
     /**
      * @brief Get the uploaded files
-     * 
+     *
      * @return const std::vector<UploadedFile>& Uploaded files
      */
     const std::vector<UploadedFile>& getFiles() const;
-    
+
     /**
      * @brief Get a specific field value
-     * 
+     *
      * @param name Field name
      * @return std::string Field value, empty if not found
      */
     std::string getField(const std::string& name) const;
-    
+
     /**
      * @brief Save an uploaded file to disk
-     * 
+     *
+     * A spooled file is renamed into place, so it can be saved once.
+     * Nothing is saved once parsing failed.
+     *
      * @param index File index
      * @param path Path to save to
      * @return bool True if file was saved successfully
      */
-    bool saveFile(size_t index, const std::string& path) const;
-};
\ No newline at end of file
+    bool saveFile(size_t index, const std::string& path);
+};
@@ -1,13 +1,84 @@
 #include "Request.hpp"
+#include "StatusCodes.hpp"
+#include "../utils/StringUtils.hpp"
 #include <sstream>
 #include <iostream>
 #include <cstdlib>
 #include <cctype>
+#include <strings.h>
+
+/**
+ * @brief Parse a chunk-size line: hex digits, then nothing or ";" extensions
+ *
+ * @return true if the line is valid and the size did not overflow
+ */
+static bool parseChunkSize(const char* line, size_t length, size_t& size)
+{
+    size_t pos = 0;
+    size = 0;
+    while (pos < length && isxdigit(static_cast<unsigned char>(line[pos]))) {
+        if (size > (static_cast<size_t>(-1) >> 4)) {
+            return false;
+        }
+        char c = line[pos++];
+        size = (size << 4) | static_cast<size_t>(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+    }
+    if (pos == 0) {
+        return false;
+    }
+    while (pos < length && (line[pos] == ' ' || line[pos] == '\t')) {
+        ++pos;
+    }
+    if (pos == length) {
+        return true;
+    }
+    if (line[pos] != ';') {
+        return false;
+    }
+    // Extensions are ignored, but may not hide a line break
+    for (; pos < length; ++pos) {
+        if (line[pos] == '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Find the colon of a header or trailer field line
+ *
+ * Obsolete line folding and whitespace in the name or before the colon
+ * are rejected (RFC 9112 section 5).
+ *
+ * @return size_t Offset of the colon, 0 if the line is not a valid field
+ */
+static size_t findFieldColon(const char* line, size_t length)
+{
+    if (line[0] == ' ' || line[0] == '\t') {
+        LOG_INFO("Folded field line");
+        return 0;
+    }
+    size_t colon = 0;
+    while (colon < length && line[colon] != ':') {
+        if (line[colon] == ' ' || line[colon] == '\t') {
+            LOG_INFO("Invalid field name: " << std::string(line, length));
+            return 0;
+        }
+        ++colon;
+    }
+    if (colon == length) {
+        LOG_INFO("Invalid field line: " << std::string(line, length));
+        return 0;
+    }
+    return colon;
+}
 
 Request::Request()
     : _method(UNKNOWN), _uri(), _path(), _queryString(), _queryParams(), 
       _version(), _headers(), _body(), _complete(false), 
-      _headersParsed(false), _bodyBytesRead(0)
+      _headersParsed(false), _bodyBytesRead(0), _chunkRemaining(0),
+      _chunkCrlfPending(false), _chunkTrailer(false), _requestLineParsed(false), _lineStart(0), _scanOffset(0),
+      _headerCount(0), _parseError(0)
 {
 }
 
@@ -35,99 +106,102 @@ bool Request::parse(std::string& buffer)
 bool Request::parseHeaders(std::string& buffer)
 {
     if (_headersParsed) {
-        DebugLogger::log("Headers already parsed");
+        LOG_DEBUG("Headers already parsed");
         return true;
     }
-    
-    // Look for end of headers (double CRLF)
-    size_t headerEnd = buffer.find("\r\n\r\n");
-    if (headerEnd == std::string::npos) {
-        // Not enough data yet
-        std::stringstream ss;
-        ss << buffer.size();
-        DebugLogger::log("End of headers not found yet, buffer size: " + ss.str());
+    if (_parseError != 0) {
         return false;
     }
     
-    // Extract headers section
-    std::string headers = buffer.substr(0, headerEnd + 4);
-    buffer.erase(0, headerEnd + 4);
-    
-    std::stringstream ss;
-    ss << headerEnd;
-    DebugLogger::log("Found end of headers at position " + ss.str());
-    DebugLogger::log("Headers raw data:");
-    DebugLogger::log(headers);
-    
-    // Parse headers section
-    std::istringstream stream(headers);
-    std::string line;
-    
-    
-    
-    // Parse request line
-    if (!std::getline(stream, line)) {
-        DebugLogger::logError("Failed to read request line from headers");
-        return false;
-    }
-    
-    // Remove trailing CR if present
-    if (!line.empty() && line[line.length() - 1] == '\r') {
-        line.erase(line.length() - 1);
-    }
-    
-    DebugLogger::log("Request line: " + line);
-    
-    if (!_parseRequestLine(line)) {
-        DebugLogger::logError("Failed to parse request line: " + line);
-        return false;
-    }
-    
-    // Parse headers
-    std::string headerBlock;
-    while (std::getline(stream, line)) {
-        // Skip the empty line after headers
-        if (line == "\r" || line.empty()) {
-            DebugLogger::log("Found empty line, end of headers");
-            break;
+    // Parse complete lines in place, resuming after the last one parsed
+    for (;;) {
+        size_t lineEnd = buffer.find('\n', _scanOffset);
+        if (lineEnd == std::string::npos) {
+            // Not enough data yet, only the new bytes will be searched next time
+            _scanOffset = buffer.size();
+            if (!_requestLineParsed && _scanOffset - _lineStart > MAX_REQUEST_LINE) {
+                LOG_INFO("Request line too long");
+                return _fail(HTTP_STATUS_URI_TOO_LONG);
+            }
+            if (_scanOffset > MAX_HEADER_SIZE) {
+                LOG_INFO("Header section too large");
+                return _fail(HTTP_STATUS_REQUEST_HEADER_FIELDS_TOO_LARGE);
+            }
+            LOG_DEBUG("End of headers not found yet");
+            return false;
+        }
+        
+        const char* line = buffer.data() + _lineStart;
+        size_t length = lineEnd - _lineStart;
+        if (length > 0 && line[length - 1] == '\r') {
+            --length;
+        }
+        _lineStart = lineEnd + 1;
+        _scanOffset = _lineStart;
+        
+        if (!_requestLineParsed) {
+            // Empty lines before the request line are ignored (RFC 9112 section 2.2)
+            if (length == 0) {
+                continue;
+            }
+            if (length > MAX_REQUEST_LINE) {
+                LOG_INFO("Request line too long");
+                return _fail(HTTP_STATUS_URI_TOO_LONG);
+            }
+            if (!_parseRequestLine(line, length)) {
+                return false;
+            }
+            _requestLineParsed = true;
+            continue;
         }
         
-        // Remove trailing CR if present
-        if (!line.empty() && line[line.length() - 1] == '\r') {
-            line.erase(line.length() - 1);
+        if (_lineStart > MAX_HEADER_SIZE) {
+            LOG_INFO("Header section too large");
+            return _fail(HTTP_STATUS_REQUEST_HEADER_FIELDS_TOO_LARGE);
         }
         
-        DebugLogger::log("Header line: " + line);
-        headerBlock += line + "\n";
+        // An empty line ends the header section
+        if (length == 0) {
+            break;
+        }
+        
+        if (++_headerCount > MAX_HEADER_COUNT) {
+            LOG_INFO("Too many header fields");
+            return _fail(HTTP_STATUS_REQUEST_HEADER_FIELDS_TOO_LARGE);
+        }
+        if (!_parseHeaderLine(line, length)) {
+            return _fail(HTTP_STATUS_BAD_REQUEST);
+        }
     }
     
-    if (!_headers.parse(headerBlock)) {
-        DebugLogger::logError("Failed to parse headers block");
+    if (!_checkBodyFraming()) {
         return false;
     }
     
+    // Remove the header section, the rest of the buffer is body or the next request
+    buffer.erase(0, _lineStart);
+    _lineStart = 0;
+    _scanOffset = 0;
+    
     // If we got here, headers parsed successfully
     _headersParsed = true;
     
     
     // Dump parsed headers
-    DebugLogger::log("Parsed headers:");
-    const std::map<std::string, std::string>& headerMap = _headers.getAll();
-    for (std::map<std::string, std::string>::const_iterator it = headerMap.begin(); 
-         it != headerMap.end(); ++it) {
-        DebugLogger::log(it->first + ": " + it->second);
+    LOG_DEBUG("Parsed headers:");
+    for (size_t i = 0; i < _headers.size(); ++i) {
+        LOG_DEBUG(_headers.at(i).name << ": " << _headers.at(i).value);
     }
     
-    // If no body expected, request is complete
-    if (_method == GET || (_headers.getContentLength() == 0 && !_headers.hasChunkedEncoding())) {
-        DebugLogger::log("No body expected, request is complete");
+    // If no body expected, request is complete. A body is read whatever
+    // the method, or its bytes would be parsed as the next request.
+    if (_headers.getContentLength() == 0 && !_headers.hasChunkedEncoding()) {
+        LOG_DEBUG("No body expected, request is complete");
         _complete = true;
     } else if (_headers.hasChunkedEncoding()) {
-        DebugLogger::log("Request uses chunked encoding");
+        LOG_DEBUG("Request uses chunked encoding");
     } else {
-        std::stringstream lenStr;
-        lenStr << _headers.getContentLength();
-        DebugLogger::log("Body expected, Content-Length: " + lenStr.str());
+        LOG_DEBUG("Body expected, Content-Length: " << _headers.getContentLength());
     }
 
     return true;
@@ -135,34 +209,31 @@ bool Request::parseHeaders(std::string& buffer)
 
 bool Request::parseBody(std::string& buffer)
 {
-    std::stringstream entryLog;
-    entryLog << "parseBody entry - Headers parsed: " << (_headersParsed ? "yes" : "no")
-            << ", Complete: " << (_complete ? "yes" : "no");
-    DebugLogger::log(entryLog.str());
+    LOG_DEBUG("parseBody entry - Headers parsed: " << (_headersParsed ? "yes" : "no") << ", Complete: " << (_complete ? "yes" : "no"));
     
     if (!_headersParsed) {
-        DebugLogger::logError("Cannot parse body before headers");
+        LOG_INFO("Cannot parse body before headers");
         return false;
     }
     
     if (_complete) {
-        DebugLogger::log("Request already complete");
+        LOG_DEBUG("Request already complete");
         return true;
     }
     
     // Log multipart form details
     if (_headers.getContentType().find("multipart/form-data") != std::string::npos) {
-        DebugLogger::log("Multipart request detected");
+        LOG_DEBUG("Multipart request detected");
         size_t boundaryPos = _headers.getContentType().find("boundary=");
         if (boundaryPos != std::string::npos) {
             std::string boundary = _headers.getContentType().substr(boundaryPos);
-            DebugLogger::log("Boundary info: " + boundary);
+            LOG_DEBUG("Boundary info: " << boundary);
         }
     }
     
     // Handle chunked encoding
     if (_headers.hasChunkedEncoding()) {
-        DebugLogger::log("Processing chunked body");
+        LOG_DEBUG("Processing chunked body");
         return _parseChunkedBody(buffer);
     }
     
@@ -173,23 +244,18 @@ bool Request::parseBody(std::string& buffer)
         size_t remainingBytes = contentLength - _bodyBytesRead;
         size_t bytesToRead = buffer.size() < remainingBytes ? buffer.size() : remainingBytes;
         
-        std::stringstream ss;
-        ss << contentLength << ", Read so far: " << _bodyBytesRead 
-           << ", Remaining: " << remainingBytes
-           << ", Available: " << buffer.size()
-           << ", Will read: " << bytesToRead;
-        DebugLogger::log("Content-Length: " + ss.str());
+        LOG_DEBUG("Content-Length: " << contentLength << ", Read so far: " << _bodyBytesRead << ", Remaining: " << remainingBytes << ", Available: " << buffer.size() << ", Will read: " << bytesToRead);
         
         // Log buffer beginning and end for multipart debugging
-        if (_headers.getContentType().find("multipart/form-data") != std::string::npos) {
+        if (LOG_DEBUG_ENABLED() && _headers.getContentType().find("multipart/form-data") != std::string::npos) {
             if (!buffer.empty()) {
                 size_t startSize = buffer.size() > 50 ? 50 : buffer.size();
                 size_t endSize = buffer.size() > 50 ? 50 : 0;
                 if (buffer.size() > 100) {
-                    DebugLogger::log("Buffer start: " + buffer.substr(0, startSize));
-                    DebugLogger::log("Buffer end: " + buffer.substr(buffer.size() - endSize));
+                    LOG_DEBUG("Buffer start: " << buffer.substr(0, startSize));
+                    LOG_DEBUG("Buffer end: " << buffer.substr(buffer.size() - endSize));
                 } else {
-                    DebugLogger::log("Buffer: " + buffer);
+                    LOG_DEBUG("Buffer: " << buffer);
                 }
             }
         }
@@ -199,223 +265,264 @@ bool Request::parseBody(std::string& buffer)
         _bodyBytesRead += bytesToRead;
         
         // Remove read data from buffer
-        size_t oldBufferSize = buffer.size();
         buffer.erase(0, bytesToRead);
         
-        std::stringstream bufLog;
-        bufLog << "Buffer size before/after: " << oldBufferSize << "/" << buffer.size();
-        DebugLogger::log(bufLog.str());
+        LOG_DEBUG("Buffer size before/after: " << (buffer.size() + bytesToRead) << "/" << buffer.size());
         
         // Check if body is complete
         if (_bodyBytesRead >= contentLength) {
             // Check ending of multipart data
             if (_headers.getContentType().find("multipart/form-data") != std::string::npos && _body.size() > 50) {
-                DebugLogger::log("Multipart end part: " + _body.substr(_body.size() - 50));
+                LOG_DEBUG("Multipart end part: " << _body.substr(_body.size() - 50));
             }
             
-            std::stringstream sizeStr;
-            sizeStr << _body.size();
-            DebugLogger::log("Body complete, total size: " + sizeStr.str());
+            LOG_DEBUG("Body complete, total size: " << _body.size());
             _complete = true;
-            DebugLogger::log("Setting request as COMPLETE");
+            LOG_DEBUG("Setting request as COMPLETE");
         } else {
-            std::stringstream remainStr;
-            remainStr << (contentLength - _bodyBytesRead);
-            DebugLogger::log("Body not complete, need " + remainStr.str() + " more bytes");
+            LOG_DEBUG("Body not complete, need " << (contentLength - _bodyBytesRead) << " more bytes");
         }
     } else {
         // No body expected
-        DebugLogger::log("No body expected (Content-Length is 0)");
+        LOG_DEBUG("No body expected (Content-Length is 0)");
         _complete = true;
     }
     
-    std::stringstream exitLog;
-    exitLog << "parseBody exit - Complete: " << (_complete ? "yes" : "no")
-           << ", Body size: " << _body.size()
-           << ", BodyBytesRead: " << _bodyBytesRead;
-    DebugLogger::log(exitLog.str());
+    LOG_DEBUG("parseBody exit - Complete: " << (_complete ? "yes" : "no") << ", Body size: " << _body.size() << ", BodyBytesRead: " << _bodyBytesRead);
     
     return _complete;
 }
 
 bool Request::_parseChunkedBody(std::string& buffer)
 {
-    std::stringstream ss;
-    ss << buffer.size();
-    DebugLogger::log("Parsing chunked body, buffer size: " + ss.str());
+    LOG_DEBUG("Parsing chunked body, buffer size: " << buffer.size());
     
-    // Dump the first 100 bytes of the buffer for debugging
-    size_t dumpSize = buffer.size() < 100 ? buffer.size() : 100;
-    DebugLogger::hexDump("Chunk buffer", buffer.substr(0, dumpSize));
+    // Dump the first bytes of the buffer for debugging
+    if (LOG_DEBUG_ENABLED()) {
+        DebugLogger::hexDump("Chunk buffer", buffer.data(), buffer.size());
+    }
     
-    // Chunked encoding format:
-    // [chunk size in hex]\r\n
+    // Chunked encoding format (RFC 9112 section 7.1):
+    // [chunk size in hex][;extensions]\r\n
     // [chunk data]\r\n
     // ...
-    // 0\r\n
+    // 0[;extensions]\r\n
+    // [trailer field]\r\n ...
     // \r\n
+    // Whatever follows the final CRLF is the next request.
     
-    while (!buffer.empty()) {
-        // Check if we're at the end of the chunked data
-        if (buffer.find("0\r\n\r\n") == 0 || buffer.find("0\r\n") == 0) {
-            DebugLogger::log("Found end chunk marker");
-            
-            // Check for the terminating sequence
-            if (buffer.find("0\r\n\r\n") == 0) {
-                buffer.erase(0, 5); // Remove "0\r\n\r\n"
-            } else if (buffer.find("0\r\n") == 0) {
-                buffer.erase(0, 3); // Remove "0\r\n"
-                
-                // Check if there's another \r\n after this
-                if (buffer.find("\r\n") == 0) {
-                    buffer.erase(0, 2); // Remove additional "\r\n"
-                }
+    while (!_complete) {
+        if (_chunkRemaining > 0) {
+            if (buffer.empty()) {
+                return false;
             }
-            
-            _complete = true;
-            
-            std::stringstream sizeStr;
-            sizeStr << _body.size();
-            DebugLogger::log("Chunked body complete, total size: " + sizeStr.str());
-            return true;
-        }
-        
-        // Find chunk size line
-        size_t crlfPos = buffer.find("\r\n");
-        if (crlfPos == std::string::npos) {
-            // Not enough data to read chunk size
-            DebugLogger::log("Chunk size line not complete yet");
-            return false;
+            // Append the part of the current chunk that is available
+            size_t bytesToRead = buffer.size() < _chunkRemaining ? buffer.size() : _chunkRemaining;
+            _body.append(buffer, 0, bytesToRead);
+            _bodyBytesRead += bytesToRead;
+            _chunkRemaining -= bytesToRead;
+            buffer.erase(0, bytesToRead);
+            _chunkCrlfPending = (_chunkRemaining == 0);
+            continue;
         }
         
-        // Parse chunk size
-        std::string hexSize = buffer.substr(0, crlfPos);
-        DebugLogger::log("Chunk size (hex): " + hexSize);
-        
-        // Skip any chunk extensions
-        size_t semicolonPos = hexSize.find(';');
-        if (semicolonPos != std::string::npos) {
-            hexSize = hexSize.substr(0, semicolonPos);
-            DebugLogger::log("Trimmed chunk size (hex): " + hexSize);
+        if (_chunkCrlfPending) {
+            // Check if the chunk is properly terminated with CRLF
+            if (buffer.size() < 2) {
+                return false;
+            }
+            if (buffer.compare(0, 2, "\r\n") != 0) {
+                LOG_INFO("Chunk not terminated with CRLF");
+                if (LOG_DEBUG_ENABLED()) {
+                    DebugLogger::hexDump("Chunk termination", buffer.data(), buffer.size(), 4);
+                }
+                return _fail(HTTP_STATUS_BAD_REQUEST);
+            }
+            buffer.erase(0, 2);
+            _chunkCrlfPending = false;
+            continue;
         }
         
-        // Convert hex to decimal
-        unsigned long chunkSize = 0;
-        std::istringstream iss(hexSize);
-        iss >> std::hex >> chunkSize;
-        
-        if (!iss) {
-            // Invalid hex format
-            DebugLogger::logError("Invalid chunk size format: " + hexSize);
+        // A chunk size line or a trailer line, searched for LF from where
+        // the previous call stopped
+        size_t lineEnd = buffer.find('\n', _scanOffset);
+        if (lineEnd == std::string::npos) {
+            _scanOffset = buffer.size();
+            if (_scanOffset > MAX_CHUNK_LINE) {
+                LOG_INFO("Chunk line too long");
+                return _fail(HTTP_STATUS_BAD_REQUEST);
+            }
+            LOG_DEBUG("Chunk line not complete yet");
             return false;
         }
+        if (lineEnd == 0 || buffer[lineEnd - 1] != '\r' || lineEnd - 1 > MAX_CHUNK_LINE) {
+            LOG_INFO("Chunk line not terminated with CRLF or too long");
+            return _fail(HTTP_STATUS_BAD_REQUEST);
+        }
+        const char* line = buffer.data();
+        size_t length = lineEnd - 1;
         
-        std::stringstream chunkSizeStr;
-        chunkSizeStr << chunkSize;
-        DebugLogger::log("Chunk size (decimal): " + chunkSizeStr.str());
-        
-        // Remove size line and CRLF from buffer
-        buffer.erase(0, crlfPos + 2);
-        
-        if (chunkSize == 0) {
-            // Last chunk
-            if (buffer.find("\r\n") == 0) {
-                buffer.erase(0, 2); // Remove final CRLF
+        if (_chunkTrailer) {
+            if (length == 0) {
                 _complete = true;
-                
-                std::stringstream bodySizeStr;
-                bodySizeStr << _body.size();
-                DebugLogger::log("Chunked body complete (zero-size chunk), total size: " + 
-                             bodySizeStr.str());
-                return true;
+                LOG_DEBUG("Chunked body complete, total size: " << _body.size());
+            } else if (++_headerCount > MAX_HEADER_COUNT) {
+                LOG_INFO("Too many trailer fields");
+                return _fail(HTTP_STATUS_REQUEST_HEADER_FIELDS_TOO_LARGE);
+            } else if (findFieldColon(line, length) == 0) {
+                return _fail(HTTP_STATUS_BAD_REQUEST);
+            }
+            // Trailer fields are checked but never merged into the headers
+        } else {
+            size_t chunkSize;
+            if (!parseChunkSize(line, length, chunkSize)) {
+                LOG_INFO("Invalid chunk size line: " << std::string(line, length));
+                return _fail(HTTP_STATUS_BAD_REQUEST);
+            }
+            LOG_DEBUG("Chunk size: " << chunkSize);
+            if (chunkSize == 0) {
+                _chunkTrailer = true;
             } else {
-                // Not enough data to finish
-                DebugLogger::log("Waiting for final CRLF after zero-size chunk");
-                return false;
+                // The chunk data may arrive over several reads, pass it on as it comes
+                _chunkRemaining = chunkSize;
             }
         }
-        
-        // Check if we have the full chunk data plus CRLF
-        if (buffer.size() < chunkSize + 2) {
-            // Not enough data
-            std::stringstream ss;
-            ss << buffer.size() << " bytes, need " << (chunkSize + 2) << " bytes";
-            DebugLogger::log("Not enough data for complete chunk, have " + ss.str());
-            return false;
-        }
-        
-        // Append chunk data to body
-        _body.append(buffer, 0, chunkSize);
-        _bodyBytesRead += chunkSize;
-        
-        // Check if the chunk is properly terminated with CRLF
-        if (buffer.substr(chunkSize, 2) != "\r\n") {
-            DebugLogger::logError("Chunk not terminated with CRLF");
-            DebugLogger::hexDump("Chunk termination", buffer.substr(chunkSize, 4));
-            return false;
-        }
-        
-        // Remove chunk data and CRLF from buffer
-        buffer.erase(0, chunkSize + 2);
-        
-        std::stringstream processedStr;
-        processedStr << chunkSize << " bytes, remaining buffer size: " << buffer.size();
-        DebugLogger::log("Processed chunk of " + processedStr.str());
+        buffer.erase(0, lineEnd + 1);
+        _scanOffset = 0;
     }
     
-    DebugLogger::log("Need more data for chunked body");
-    return false; // Need more data
+    return true;
 }
 
-bool Request::_parseRequestLine(const std::string& line)
+bool Request::_parseRequestLine(const char* line, size_t length)
 {
-    std::istringstream iss(line);
-    std::string methodStr, uri, version;
-    
-    iss >> methodStr >> uri >> version;
+    // method SP request-target SP HTTP-version, tokenized in place
+    const char* end = line + length;
+    const char* tokens[3];
+    size_t lengths[3];
+    const char* pos = line;
+    
+    for (int i = 0; i < 3; ++i) {
+        while (pos < end && *pos == ' ') {
+            ++pos;
+        }
+        tokens[i] = pos;
+        while (pos < end && *pos != ' ') {
+            ++pos;
+        }
+        lengths[i] = pos - tokens[i];
+    }
+    while (pos < end && *pos == ' ') {
+        ++pos;
+    }
     
-    // Check if all three parts were read
-    if (methodStr.empty() || uri.empty() || version.empty()) {
-        DebugLogger::logError("Invalid request line format, missing components");
-        return false;
+    // Check if all three parts were read and nothing follows
+    if (lengths[0] == 0 || lengths[1] == 0 || lengths[2] == 0 || pos != end) {
+        LOG_INFO("Invalid request line format: " << std::string(line, length));
+        return _fail(HTTP_STATUS_BAD_REQUEST);
     }
     
-    DebugLogger::log("Method: " + methodStr + ", URI: " + uri + ", Version: " + version);
+    std::string methodStr(tokens[0], lengths[0]);
+    _uri.assign(tokens[1], lengths[1]);
+    _version.assign(tokens[2], lengths[2]);
+    
+    LOG_DEBUG("Method: " << methodStr << ", URI: " << _uri << ", Version: " << _version);
     
     // Parse method
     _method = parseMethod(methodStr);
     if (_method == UNKNOWN) {
-        DebugLogger::logError("Unknown HTTP method: " + methodStr);
-        return false;
+        LOG_INFO("Unknown HTTP method: " << methodStr);
+        return _fail(HTTP_STATUS_METHOD_NOT_ALLOWED);
     }
     
-    // Store URI
-    _uri = uri;
+    // Check HTTP version
+    if (_version != "HTTP/1.0" && _version != "HTTP/1.1") {
+        LOG_INFO("Unsupported HTTP version: " << _version);
+        return _fail(_version.compare(0, 5, "HTTP/") == 0 ? HTTP_STATUS_HTTP_VERSION_NOT_SUPPORTED
+                                                           : HTTP_STATUS_BAD_REQUEST);
+    }
     
     // Parse URI to get path and query string
-    size_t queryPos = uri.find('?');
+    size_t queryPos = _uri.find('?');
     if (queryPos != std::string::npos) {
-        _path = uri.substr(0, queryPos);
-        _queryString = uri.substr(queryPos + 1);
-        DebugLogger::log("Path: " + _path + ", Query string: " + _queryString);
+        _path.assign(_uri, 0, queryPos);
+        _queryString.assign(_uri, queryPos + 1, std::string::npos);
+        LOG_DEBUG("Path: " << _path << ", Query string: " << _queryString);
         _parseQueryParams();
     } else {
-        _path = uri;
-        _queryString = "";
-        DebugLogger::log("Path: " + _path + " (no query string)");
+        _path = _uri;
+        _queryString.clear();
+        LOG_DEBUG("Path: " << _path << " (no query string)");
     }
     
-    // Check HTTP version
-    if (version != "HTTP/1.0" && version != "HTTP/1.1") {
-        DebugLogger::logError("Unsupported HTTP version: " + version);
+    return true;
+}
+
+bool Request::_parseHeaderLine(const char* line, size_t length)
+{
+    size_t colon = findFieldColon(line, length);
+    if (colon == 0) {
         return false;
     }
     
-    _version = version;
+    // Trim optional whitespace around the value
+    size_t valueStart = colon + 1;
+    size_t valueEnd = length;
+    while (valueStart < valueEnd && (line[valueStart] == ' ' || line[valueStart] == '\t')) {
+        ++valueStart;
+    }
+    while (valueEnd > valueStart && (line[valueEnd - 1] == ' ' || line[valueEnd - 1] == '\t')) {
+        --valueEnd;
+    }
+    
+    // A repeated Content-Length may only repeat the same value (RFC 9112 section 6.3)
+    const std::string& contentLengthName = Headers::nameOf(Headers::CONTENT_LENGTH);
+    if (colon == contentLengthName.size() && strncasecmp(line, contentLengthName.c_str(), colon) == 0 &&
+        _headers.contains(Headers::CONTENT_LENGTH)) {
+        std::string contentLength = _headers.get(Headers::CONTENT_LENGTH);
+        _headers.set(line, colon, line + valueStart, valueEnd - valueStart);
+        if (_headers.get(Headers::CONTENT_LENGTH) != contentLength) {
+            LOG_INFO("Conflicting Content-Length fields");
+            return false;
+        }
+        return true;
+    }
+    
+    _headers.set(line, colon, line + valueStart, valueEnd - valueStart);
+    return true;
+}
+
+bool Request::_checkBodyFraming()
+{
+    const std::string& transferEncoding = _headers.get(Headers::TRANSFER_ENCODING);
+    const std::string& contentLength = _headers.get(Headers::CONTENT_LENGTH);
+    
+    if (_headers.contains(Headers::TRANSFER_ENCODING)) {
+        if (_headers.contains(Headers::CONTENT_LENGTH)) {
+            LOG_INFO("Both Content-Length and Transfer-Encoding");
+            return _fail(HTTP_STATUS_BAD_REQUEST);
+        }
+        if (!StringUtils::equalsIgnoreCase(transferEncoding, "chunked")) {
+            LOG_INFO("Unsupported Transfer-Encoding: " << transferEncoding);
+            return _fail(HTTP_STATUS_NOT_IMPLEMENTED);
+        }
+        return true;
+    }
     
+    if (_headers.contains(Headers::CONTENT_LENGTH) &&
+        (contentLength.empty() || contentLength.size() > 18 || contentLength.find_first_not_of("0123456789") != std::string::npos)) {
+        LOG_INFO("Invalid Content-Length: " << contentLength);
+        return _fail(HTTP_STATUS_BAD_REQUEST);
+    }
     return true;
 }
 
+bool Request::_fail(int statusCode)
+{
+    _parseError = statusCode;
+    return false;
+}
+
 void Request::_parseQueryParams()
 {
     _queryParams.clear();
@@ -461,6 +568,14 @@ void Request::reset()
     _complete = false;
     _headersParsed = false;
     _bodyBytesRead = 0;
+    _chunkRemaining = 0;
+    _chunkCrlfPending = false;
+    _chunkTrailer = false;
+    _requestLineParsed = false;
+    _lineStart = 0;
+    _scanOffset = 0;
+    _headerCount = 0;
+    _parseError = 0;
 }
 
 Request::Method Request::getMethod() const
@@ -522,6 +637,22 @@ const std::string& Request::getBody() const
     return _body;
 }
 
+size_t Request::getBodyLength() const
+{
+    return _bodyBytesRead;
+}
+
+void Request::takeBody(std::string& out)
+{
+    out.clear();
+    out.swap(_body);
+}
+
+int Request::getParseError() const
+{
+    return _parseError;
+}
+
 bool Request::isComplete() const
 {
     return _complete;
@@ -529,7 +660,7 @@ bool Request::isComplete() const
 
 std::string Request::getHost() const
 {
-    return _headers.get("host");
+    return _headers.get(Headers::HOST);
 }
 
 std::string Request::toString() const
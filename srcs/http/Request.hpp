@@ -38,14 +38,61 @@ private:
     // Parsing state
     bool _headersParsed;                          // Whether headers have been parsed
     size_t _bodyBytesRead;                        // Number of body bytes read so far
+    size_t _chunkRemaining;                       // Data bytes left in the current chunk
+    bool _chunkCrlfPending;                       // CRLF after the chunk data not seen yet
+    bool _chunkTrailer;                           // Last chunk seen, reading trailer fields
+    
+    // Header parsing resumes where the previous call stopped
+    bool _requestLineParsed;                      // Whether the request line has been parsed
+    size_t _lineStart;                            // Buffer offset of the line being parsed
+    size_t _scanOffset;                           // Buffer offset already searched for LF
+    size_t _headerCount;                          // Header fields parsed so far
+    int _parseError;                              // Status code of a malformed request, 0 if none
+    
+    // Header section limits (exceeding them answers 414 or 431)
+    static const size_t MAX_REQUEST_LINE = 8192;
+    static const size_t MAX_HEADER_SIZE = 32768;
+    static const size_t MAX_HEADER_COUNT = 100;
+    
+    // Longest chunk size or trailer line (exceeding it answers 400)
+    static const size_t MAX_CHUNK_LINE = 4096;
     
     /**
      * @brief Parse the HTTP request line
      * 
-     * @param line Request line to parse
+     * @param line Start of the line in the input buffer
+     * @param length Line length without the line terminator
      * @return bool True if parsing was successful
      */
-    bool _parseRequestLine(const std::string& line);
+    bool _parseRequestLine(const char* line, size_t length);
+    
+    /**
+     * @brief Parse one header field line
+     * 
+     * @param line Start of the line in the input buffer
+     * @param length Line length without the line terminator
+     * @return bool True if parsing was successful
+     */
+    bool _parseHeaderLine(const char* line, size_t length);
+    
+    /**
+     * @brief Check that the body length is unambiguous
+     * 
+     * Content-Length must be a plain number and Transfer-Encoding exactly
+     * "chunked", never both: a body framed one way here and another way
+     * by a proxy in front would be read as a second request.
+     * 
+     * @return bool True if the framing is valid
+     */
+    bool _checkBodyFraming();
+    
+    /**
+     * @brief Record a malformed request
+     * 
+     * @param statusCode Status code to answer with
+     * @return bool Always false
+     */
+    bool _fail(int statusCode);
     
     /**
      * @brief Parse query parameters from the query string
@@ -55,6 +102,9 @@ private:
     /**
      * @brief Parse a chunked request body
      * 
+     * Reads through the last chunk and its trailer section, so the
+     * input left in the buffer is exactly the next request.
+     * 
      * @param buffer Buffer containing the body data
      * @return bool True if the body is complete
      */
@@ -82,11 +132,23 @@ public:
     /**
      * @brief Parse the HTTP headers from a buffer
      * 
+     * Call again with the same buffer after more data was appended; lines
+     * already parsed are not scanned again. The header section is removed
+     * from the buffer once complete.
+     * 
      * @param buffer Buffer containing the header data
-     * @return bool True if headers are completely parsed
+     * @return bool True if headers are completely parsed, false if more data is
+     *         needed or the request is malformed (see getParseError())
      */
     bool parseHeaders(std::string& buffer);
     
+    /**
+     * @brief Get the status code for a malformed request
+     * 
+     * @return int 400, 405, 414, 431 or 505, 0 while the request is valid
+     */
+    int getParseError() const;
+    
     /**
      * @brief Parse the HTTP body from a buffer
      * 
@@ -178,6 +240,25 @@ public:
      */
     const std::string& getBody() const;
     
+    /**
+     * @brief Get the number of body bytes received so far
+     * 
+     * Includes bytes already moved out with takeBody().
+     * 
+     * @return size_t Decoded body length
+     */
+    size_t getBodyLength() const;
+    
+    /**
+     * @brief Move the body received so far out of the request
+     * 
+     * Lets a consumer process a large body as it arrives instead of
+     * keeping all of it in memory.
+     * 
+     * @param out Receives the pending body bytes
+     */
+    void takeBody(std::string& out);
+    
     /**
      * @brief Check if the request is complete
      * 
@@ -1,32 +1,43 @@
 #include "Response.hpp"
-#include <sstream>
 
 Response::Response()
-    : _statusCode(HTTP_STATUS_OK), _statusMessage(getReasonPhrase(HTTP_STATUS_OK)),
+    : _statusCode(HTTP_STATUS_OK),
       _version("HTTP/1.1"), _headers(), _body(), _sent(false)
 {
     // Set default headers
-    _headers.set("Server", "WebServer/1.0");
-    _headers.set("Connection", "keep-alive");
+    _headers.set(Headers::SERVER, "WebServer/1.0");
+    _headers.set(Headers::CONNECTION, "keep-alive");
 }
 
 Response::Response(int statusCode)
-    : _statusCode(statusCode), _statusMessage(getReasonPhrase(statusCode)),
+    : _statusCode(statusCode),
       _version("HTTP/1.1"), _headers(), _body(), _sent(false)
 {
     // Set default headers
-    _headers.set("Server", "WebServer/1.0");
-    _headers.set("Connection", "keep-alive");
+    _headers.set(Headers::SERVER, "WebServer/1.0");
+    _headers.set(Headers::CONNECTION, "keep-alive");
 }
 
 Response::~Response()
 {
 }
 
+void Response::reset()
+{
+    _statusCode = HTTP_STATUS_OK;
+    _version = "HTTP/1.1";
+    _headers.clear();
+    _body.clear();
+    _sent = false;
+
+    // Same default headers as a new response
+    _headers.set(Headers::SERVER, "WebServer/1.0");
+    _headers.set(Headers::CONNECTION, "keep-alive");
+}
+
 void Response::setStatusCode(int statusCode)
 {
     _statusCode = statusCode;
-    _statusMessage = getReasonPhrase(statusCode);
 }
 
 void Response::setVersion(const std::string& version)
@@ -46,6 +57,11 @@ void Response::setHeader(const std::string& name, const std::string& value)
     _headers.set(name, value);
 }
 
+void Response::setHeader(Headers::Id id, const std::string& value)
+{
+    _headers.set(id, value);
+}
+
 Headers& Response::getHeaders()
 {
     return _headers;
@@ -53,67 +69,69 @@ Headers& Response::getHeaders()
 
 std::string Response::build()
 {
-    std::stringstream statusStr;
-    statusStr << _statusCode;
-    DebugLogger::log("Building response with status code: " + statusStr.str());
-    
-    std::stringstream ss;
-    
-    // Status line
-    ss << _version << " " << _statusCode << " " << _statusMessage << "\r\n";
-    
+    std::string result;
+    serializeHeaders(result);
+    result += _body;
+    return result;
+}
+
+std::string Response::buildHeaders()
+{
+    std::string result;
+    serializeHeaders(result);
+    return result;
+}
+
+void Response::serializeHeaders(std::string& out)
+{
     // Make sure Content-Length is set if we have a body
-    if (!_body.empty() && !_headers.contains("content-length")) {
+    if (!_body.empty() && !_headers.contains(Headers::CONTENT_LENGTH)) {
         setContentLength(_body.size());
-        
-        std::stringstream lenStr;
-        lenStr << _body.size();
-        DebugLogger::log("Added Content-Length: " + lenStr.str());
     }
     
-    // Headers
-    ss << _headers.toString();
-    DebugLogger::log("Added response headers");
-    
-    // Empty line
-    ss << "\r\n";
+    out.clear();
     
-    // Body
-    if (!_body.empty()) {
-        ss << _body;
-        
-        std::stringstream sizeStr;
-        sizeStr << _body.size();
-        DebugLogger::log("Added response body, size: " + sizeStr.str());
+    // Status line
+    if (_version == "HTTP/1.1") {
+        out += getStatusLine(_statusCode);
+    } else {
+        out += _version;
+        out += ' ';
+        StringUtils::appendUnsigned(out, _statusCode);
+        out += ' ';
+        out += getReasonPhrase(_statusCode);
+        out += "\r\n";
     }
     
-    std::string result = ss.str();
-    
-    std::stringstream resultSizeStr;
-    resultSizeStr << result.size();
-    DebugLogger::log("Complete response size: " + resultSizeStr.str());
+    // Headers
+    _headers.appendTo(out);
+    if (!_headers.contains(Headers::DATE)) {
+        out += "Date: ";
+        out.append(TimeUtils::currentHttpDate(), TimeUtils::HTTP_DATE_LENGTH);
+        out += "\r\n";
+    }
     
-    return result;
+    // Empty line
+    out += "\r\n";
 }
 
 void Response::redirect(const std::string& location, int code)
 {
     setStatusCode(code);
-    setHeader("Location", location);
+    setHeader(Headers::LOCATION, location);
     setBody("<html><head><title>Redirect</title></head><body><h1>Redirect</h1><p>Redirecting to <a href=\"" + 
             location + "\">" + location + "</a></p></body></html>");
 }
 
 void Response::setContentType(const std::string& contentType)
 {
-    setHeader("Content-Type", contentType);
+    setHeader(Headers::CONTENT_TYPE, contentType);
 }
 
 void Response::setContentLength(size_t length)
 {
-    std::stringstream ss;
-    ss << length;
-    setHeader("Content-Length", ss.str());
+    char digits[20];
+    _headers.set(Headers::CONTENT_LENGTH, digits, StringUtils::formatUnsigned(digits, length));
 }
 
 int Response::getStatusCode() const
@@ -123,7 +141,7 @@ int Response::getStatusCode() const
 
 const std::string& Response::getStatusMessage() const
 {
-    return _statusMessage;
+    return getReasonPhrase(_statusCode);
 }
 
 const std::string& Response::getVersion() const
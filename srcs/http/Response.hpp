@@ -3,6 +3,8 @@
 #include <string>
 #include "Headers.hpp"
 #include "StatusCodes.hpp"
+#include "../utils/StringUtils.hpp"
+#include "../utils/TimeUtils.hpp"
 #include "../utils/DebugLogger.hpp"
 
 /**
@@ -14,7 +16,6 @@
 class Response {
 private:
     int _statusCode;              // HTTP status code
-    std::string _statusMessage;   // HTTP status message
     std::string _version;         // HTTP version
     Headers _headers;             // HTTP headers
     std::string _body;            // Response body
@@ -38,6 +39,14 @@ public:
      */
     ~Response();
 
+    /**
+     * @brief Return to the state of a new Response, keeping allocated storage
+     * 
+     * Lets a pooled connection reuse its response object instead of
+     * assigning a freshly constructed one for every request.
+     */
+    void reset();
+
     /**
      * @brief Set the HTTP status code
      * 
@@ -68,6 +77,14 @@ public:
      */
     void setHeader(const std::string& name, const std::string& value);
     
+    /**
+     * @brief Set a well-known response header
+     * 
+     * @param id Header Id
+     * @param value Header value
+     */
+    void setHeader(Headers::Id id, const std::string& value);
+    
     /**
      * @brief Get all headers
      * 
@@ -82,6 +99,26 @@ public:
      */
     std::string build();
     
+    /**
+     * @brief Build the status line and header block, without the body
+     * 
+     * Lets the caller queue the body as separate segments. Content-Length
+     * is added from the in-memory body when not set explicitly.
+     * 
+     * @return std::string Status line, headers and the terminating empty line
+     */
+    std::string buildHeaders();
+    
+    /**
+     * @brief Write the status line and header block into a reusable buffer
+     * 
+     * Same output as buildHeaders(). The status line comes preformatted
+     * from a table and a Date header is added unless one is set.
+     * 
+     * @param out Buffer to overwrite, its capacity is reused
+     */
+    void serializeHeaders(std::string& out);
+    
     /**
      * @brief Create a redirect response
      * 
@@ -1,56 +1,120 @@
 #include "StatusCodes.hpp"
+#include <pthread.h>
 
 // Static map of status codes to reason phrases
-const std::map<int, std::string>& getStatusCodesMap()
+static std::map<int, std::string> buildStatusCodesMap()
 {
-    static std::map<int, std::string> statusCodes;
+    std::map<int, std::string> statusCodes;
     
-    // Initialize on first call
-    if (statusCodes.empty()) {
-        // 2xx Success
-        statusCodes[HTTP_STATUS_OK] = "OK";
-        statusCodes[HTTP_STATUS_CREATED] = "Created";
-        statusCodes[HTTP_STATUS_ACCEPTED] = "Accepted";
-        statusCodes[HTTP_STATUS_NO_CONTENT] = "No Content";
-        
-        // 3xx Redirection
-        statusCodes[HTTP_STATUS_MOVED_PERMANENTLY] = "Moved Permanently";
-        statusCodes[HTTP_STATUS_FOUND] = "Found";
-        statusCodes[HTTP_STATUS_SEE_OTHER] = "See Other";
-        statusCodes[HTTP_STATUS_NOT_MODIFIED] = "Not Modified";
-        statusCodes[HTTP_STATUS_TEMPORARY_REDIRECT] = "Temporary Redirect";
-        statusCodes[HTTP_STATUS_PERMANENT_REDIRECT] = "Permanent Redirect";
-        
-        // 4xx Client Error
-        statusCodes[HTTP_STATUS_BAD_REQUEST] = "Bad Request";
-        statusCodes[HTTP_STATUS_UNAUTHORIZED] = "Unauthorized";
-        statusCodes[HTTP_STATUS_FORBIDDEN] = "Forbidden";
-        statusCodes[HTTP_STATUS_NOT_FOUND] = "Not Found";
-        statusCodes[HTTP_STATUS_METHOD_NOT_ALLOWED] = "Method Not Allowed";
-        statusCodes[HTTP_STATUS_REQUEST_TIMEOUT] = "Request Timeout";
-        statusCodes[HTTP_STATUS_LENGTH_REQUIRED] = "Length Required";
-        statusCodes[HTTP_STATUS_PAYLOAD_TOO_LARGE] = "Payload Too Large";
-        
-        // 5xx Server Error
-        statusCodes[HTTP_STATUS_INTERNAL_SERVER_ERROR] = "Internal Server Error";
-        statusCodes[HTTP_STATUS_NOT_IMPLEMENTED] = "Not Implemented";
-        statusCodes[HTTP_STATUS_BAD_GATEWAY] = "Bad Gateway";
-        statusCodes[HTTP_STATUS_SERVICE_UNAVAILABLE] = "Service Unavailable";
-        statusCodes[HTTP_STATUS_GATEWAY_TIMEOUT] = "Gateway Timeout";
-        statusCodes[HTTP_STATUS_HTTP_VERSION_NOT_SUPPORTED] = "HTTP Version Not Supported";
-    }
+    // 2xx Success
+    statusCodes[HTTP_STATUS_OK] = "OK";
+    statusCodes[HTTP_STATUS_CREATED] = "Created";
+    statusCodes[HTTP_STATUS_ACCEPTED] = "Accepted";
+    statusCodes[HTTP_STATUS_NO_CONTENT] = "No Content";
+    statusCodes[HTTP_STATUS_PARTIAL_CONTENT] = "Partial Content";
+    
+    // 3xx Redirection
+    statusCodes[HTTP_STATUS_MOVED_PERMANENTLY] = "Moved Permanently";
+    statusCodes[HTTP_STATUS_FOUND] = "Found";
+    statusCodes[HTTP_STATUS_SEE_OTHER] = "See Other";
+    statusCodes[HTTP_STATUS_NOT_MODIFIED] = "Not Modified";
+    statusCodes[HTTP_STATUS_TEMPORARY_REDIRECT] = "Temporary Redirect";
+    statusCodes[HTTP_STATUS_PERMANENT_REDIRECT] = "Permanent Redirect";
+    
+    // 4xx Client Error
+    statusCodes[HTTP_STATUS_BAD_REQUEST] = "Bad Request";
+    statusCodes[HTTP_STATUS_UNAUTHORIZED] = "Unauthorized";
+    statusCodes[HTTP_STATUS_FORBIDDEN] = "Forbidden";
+    statusCodes[HTTP_STATUS_NOT_FOUND] = "Not Found";
+    statusCodes[HTTP_STATUS_METHOD_NOT_ALLOWED] = "Method Not Allowed";
+    statusCodes[HTTP_STATUS_REQUEST_TIMEOUT] = "Request Timeout";
+    statusCodes[HTTP_STATUS_LENGTH_REQUIRED] = "Length Required";
+    statusCodes[HTTP_STATUS_PAYLOAD_TOO_LARGE] = "Payload Too Large";
+    statusCodes[HTTP_STATUS_URI_TOO_LONG] = "URI Too Long";
+    statusCodes[HTTP_STATUS_RANGE_NOT_SATISFIABLE] = "Range Not Satisfiable";
+    statusCodes[HTTP_STATUS_REQUEST_HEADER_FIELDS_TOO_LARGE] = "Request Header Fields Too Large";
+    
+    // 5xx Server Error
+    statusCodes[HTTP_STATUS_INTERNAL_SERVER_ERROR] = "Internal Server Error";
+    statusCodes[HTTP_STATUS_NOT_IMPLEMENTED] = "Not Implemented";
+    statusCodes[HTTP_STATUS_BAD_GATEWAY] = "Bad Gateway";
+    statusCodes[HTTP_STATUS_SERVICE_UNAVAILABLE] = "Service Unavailable";
+    statusCodes[HTTP_STATUS_GATEWAY_TIMEOUT] = "Gateway Timeout";
+    statusCodes[HTTP_STATUS_HTTP_VERSION_NOT_SUPPORTED] = "HTTP Version Not Supported";
     
     return statusCodes;
 }
 
-std::string getReasonPhrase(int statusCode)
+static pthread_once_t statusCodesOnce = PTHREAD_ONCE_INIT;
+static const std::map<int, std::string>* statusCodesMap = NULL;
+
+static void buildStatusCodes()
 {
-    const std::map<int, std::string>& statusCodes = getStatusCodesMap();
-    
-    std::map<int, std::string>::const_iterator it = statusCodes.find(statusCode);
-    if (it != statusCodes.end()) {
-        return it->second;
+    statusCodesMap = new std::map<int, std::string>(buildStatusCodesMap());
+}
+
+const std::map<int, std::string>& getStatusCodesMap()
+{
+    // Built once, by whichever event loop thread gets here first
+    pthread_once(&statusCodesOnce, buildStatusCodes);
+    return *statusCodesMap;
+}
+
+/**
+ * @brief Reason phrases and HTTP/1.1 status lines for every code, built once
+ */
+struct StatusTable {
+    static const int FIRST = 100;
+    static const int LAST = 599;
+
+    std::string reasons[LAST - FIRST + 1];
+    std::string lines[LAST - FIRST + 1];
+
+    StatusTable() {
+        const std::map<int, std::string>& statusCodes = getStatusCodesMap();
+        for (int code = FIRST; code <= LAST; ++code) {
+            std::map<int, std::string>::const_iterator it = statusCodes.find(code);
+            std::string& reason = reasons[code - FIRST];
+            reason = (it != statusCodes.end()) ? it->second : "Unknown Status";
+
+            std::string& line = lines[code - FIRST];
+            line = "HTTP/1.1 ";
+            line += static_cast<char>('0' + code / 100);
+            line += static_cast<char>('0' + code / 10 % 10);
+            line += static_cast<char>('0' + code % 10);
+            line += " " + reason + "\r\n";
+        }
     }
-    
-    return "Unknown Status";
-}
\ No newline at end of file
+};
+
+static pthread_once_t statusTableOnce = PTHREAD_ONCE_INIT;
+static const StatusTable* statusTableData = NULL;
+
+static void buildStatusTable()
+{
+    statusTableData = new StatusTable();
+}
+
+static const StatusTable& statusTable()
+{
+    pthread_once(&statusTableOnce, buildStatusTable);
+    return *statusTableData;
+}
+
+static const std::string UNKNOWN_STATUS("Unknown Status");
+
+const std::string& getReasonPhrase(int statusCode)
+{
+    if (statusCode < StatusTable::FIRST || statusCode > StatusTable::LAST) {
+        return UNKNOWN_STATUS;
+    }
+    return statusTable().reasons[statusCode - StatusTable::FIRST];
+}
+
+const std::string& getStatusLine(int statusCode)
+{
+    if (statusCode < StatusTable::FIRST || statusCode > StatusTable::LAST) {
+        statusCode = HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    }
+    return statusTable().lines[statusCode - StatusTable::FIRST];
+}
@@ -8,6 +8,7 @@
 #define HTTP_STATUS_CREATED               201
 #define HTTP_STATUS_ACCEPTED              202
 #define HTTP_STATUS_NO_CONTENT            204
+#define HTTP_STATUS_PARTIAL_CONTENT       206
 
 #define HTTP_STATUS_MOVED_PERMANENTLY     301
 #define HTTP_STATUS_FOUND                 302
@@ -24,6 +25,9 @@
 #define HTTP_STATUS_REQUEST_TIMEOUT       408
 #define HTTP_STATUS_LENGTH_REQUIRED       411
 #define HTTP_STATUS_PAYLOAD_TOO_LARGE     413
+#define HTTP_STATUS_URI_TOO_LONG          414
+#define HTTP_STATUS_RANGE_NOT_SATISFIABLE 416
+#define HTTP_STATUS_REQUEST_HEADER_FIELDS_TOO_LARGE 431
 
 #define HTTP_STATUS_INTERNAL_SERVER_ERROR 500
 #define HTTP_STATUS_NOT_IMPLEMENTED       501
@@ -36,9 +40,17 @@
  * @brief Get the reason phrase for an HTTP status code
  * 
  * @param statusCode HTTP status code
- * @return std::string Reason phrase, or "Unknown Status" if not found
+ * @return const std::string& Reason phrase, or "Unknown Status" if not found
  */
-std::string getReasonPhrase(int statusCode);
+const std::string& getReasonPhrase(int statusCode);
+
+/**
+ * @brief Get the preformatted HTTP/1.1 status line for a status code
+ * 
+ * @param statusCode HTTP status code (100-599)
+ * @return const std::string& Status line including the CRLF, e.g. "HTTP/1.1 404 Not Found\r\n"
+ */
+const std::string& getStatusLine(int statusCode);
 
 /**
  * @brief Get a static map of status codes to reason phrases
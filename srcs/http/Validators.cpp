@@ -0,0 +1,104 @@
+#include "Validators.hpp"
+#include "../utils/TimeUtils.hpp"
+
+static void appendHex(std::string& out, unsigned long long value)
+{
+    static const char DIGITS[] = "0123456789abcdef";
+    char buffer[16];
+    size_t length = 0;
+    do {
+        buffer[length++] = DIGITS[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    while (length > 0) {
+        out += buffer[--length];
+    }
+}
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * @brief Look for an entity tag in an If-None-Match list
+ *
+ * Uses the weak comparison: a "W/" prefix is ignored on either side.
+ */
+static bool listContains(const std::string& list, const std::string& etag)
+{
+    size_t pos = 0;
+    while (pos < list.size()) {
+        while (pos < list.size() && (isSpace(list[pos]) || list[pos] == ',')) {
+            ++pos;
+        }
+        if (pos >= list.size()) {
+            break;
+        }
+        if (list[pos] == '*') {
+            return true;
+        }
+        if (list.compare(pos, 2, "W/") == 0) {
+            pos += 2;
+        }
+        if (pos >= list.size() || list[pos] != '"') {
+            return false;
+        }
+        size_t end = list.find('"', pos + 1);
+        if (end == std::string::npos) {
+            return false;
+        }
+        if (list.compare(pos, end + 1 - pos, etag) == 0) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+void Validators::appendETag(std::string& out, const struct stat& info)
+{
+    out += '"';
+    appendHex(out, static_cast<unsigned long long>(info.st_ino));
+    out += '-';
+    appendHex(out, static_cast<unsigned long long>(info.st_size));
+    out += '-';
+    appendHex(out, static_cast<unsigned long long>(info.st_mtime));
+#ifdef __linux__
+    // A same-size rewrite within the same second must still change the tag
+    out += '.';
+    appendHex(out, static_cast<unsigned long long>(info.st_mtim.tv_nsec));
+#endif
+    out += '"';
+}
+
+void Validators::appendLastModified(std::string& out, const struct stat& info)
+{
+    char date[TimeUtils::HTTP_DATE_LENGTH + 1];
+    out.append(date, TimeUtils::formatHttpDate(date, info.st_mtime));
+}
+
+bool Validators::isNotModified(const Headers& request, const std::string& etag, time_t mtime)
+{
+    const std::string& noneMatch = request.get(Headers::IF_NONE_MATCH);
+    if (!noneMatch.empty()) {
+        return listContains(noneMatch, etag);
+    }
+
+    const std::string& modifiedSince = request.get(Headers::IF_MODIFIED_SINCE);
+    time_t since;
+    if (modifiedSince.empty() || !TimeUtils::parseHttpDate(modifiedSince, since)) {
+        return false;
+    }
+    return mtime <= since;
+}
+
+bool Validators::matchesIfRange(const std::string& value, const std::string& etag,
+                                const std::string& lastModified)
+{
+    // Weak tags never match here, and ours are all strong
+    if (!value.empty() && value[0] == '"') {
+        return value == etag;
+    }
+    return value == lastModified;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <ctime>
+#include <sys/stat.h>
+#include "Headers.hpp"
+
+/**
+ * @brief Class to build and check the validators of static files
+ *
+ * A file's strong entity tag is made of its inode, size and modification
+ * time (to the nanosecond where the platform has it), so it changes
+ * whenever the bytes may have, without hashing them.
+ * Preconditions follow RFC 9110 section 13.2.2: If-None-Match takes
+ * precedence and If-Modified-Since is only looked at without it.
+ */
+class Validators {
+public:
+    /**
+     * @brief Append the entity tag of a file, quotes included
+     *
+     * @param out String to append to
+     * @param info File metadata
+     */
+    static void appendETag(std::string& out, const struct stat& info);
+
+    /**
+     * @brief Append the Last-Modified value of a file
+     *
+     * @param out String to append to
+     * @param info File metadata
+     */
+    static void appendLastModified(std::string& out, const struct stat& info);
+
+    /**
+     * @brief Check if a GET can be answered with 304 Not Modified
+     *
+     * @param request Request headers
+     * @param etag Entity tag of the file
+     * @param mtime Modification time of the file
+     * @return true if the client's copy is still current
+     */
+    static bool isNotModified(const Headers& request, const std::string& etag, time_t mtime);
+
+    /**
+     * @brief Check an If-Range value against the file
+     *
+     * An entity tag must match strongly, a date must be the exact
+     * Last-Modified value.
+     *
+     * @param value If-Range header value
+     * @param etag Entity tag of the file
+     * @param lastModified Last-Modified value of the file
+     * @return true if the requested ranges may be served
+     */
+    static bool matchesIfRange(const std::string& value, const std::string& etag,
+                               const std::string& lastModified);
+
+private:
+    // Private constructor to prevent instantiation
+    Validators();
+    // Private destructor
+    ~Validators();
+    // Private copy constructor and assignment operator to prevent copying
+    Validators(const Validators& other);
+    Validators& operator=(const Validators& other);
+};
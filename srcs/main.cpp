@@ -2,6 +2,7 @@
 #include "tests/ConfigTests.hpp"
 #include "tests/WebServerTests.hpp"
 #include "server/Server.hpp"
+#include "server/MasterProcess.hpp"
 #include "utils/DebugLogger.hpp"
 #include <iostream>
 #include <string>
@@ -27,6 +28,7 @@ void printUsage(const char* programName) {
     std::cout << "  --help, -h              Show this help message" << std::endl;
     std::cout << "  --config, -c <file>     Specify configuration file (default: config/webserv.conf)" << std::endl;
     std::cout << "  --debug, -d             Enable debug logging" << std::endl;
+    std::cout << "  --log-level, -l <level> Log level: error, warn (default), info, debug" << std::endl;
 }
 
 int main(int argc, char **argv) {
@@ -51,6 +53,15 @@ int main(int argc, char **argv) {
             debugMode = true;
             DebugLogger::enable();
             std::cout << "Debug logging enabled" << std::endl;
+        } else if (arg == "--log-level" || arg == "-l") {
+            int level = i + 1 < argc ? DebugLogger::parseLevel(argv[i + 1]) : -1;
+            if (level < 0) {
+                std::cerr << "Error: --log-level expects error, warn, info or debug" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            ++i;
+            DebugLogger::setLevel(level);
         } else if (arg == "--config" || arg == "-c") {
             if (i + 1 < argc) {
                 confFile = argv[++i];
@@ -90,8 +101,14 @@ int main(int argc, char **argv) {
         std::cout << "Configuration loaded successfully." << std::endl;
         std::cout << "Starting server with " << parser.getServers().size() << " virtual host(s)." << std::endl;
         
+        // Several workers: this process only supervises them
+        if (parser.getGlobalConfig().getWorkerProcesses() > 1) {
+            MasterProcess master(parser.getServers(), parser.getGlobalConfig());
+            return master.run();
+        }
+        
         // Initialize server with the parsed configuration
-        Server server(parser.getServers());
+        Server server(parser.getServers(), parser.getGlobalConfig());
         g_server = &server;
         
         // Set up signal handler for clean shutdown
@@ -0,0 +1,344 @@
+#include "AccessLog.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/uio.h>
+#include "../utils/StringUtils.hpp"
+#include "../utils/TimeUtils.hpp"
+#include "../utils/DebugLogger.hpp"
+
+AccessLog::AccessLog(const std::string& path, const std::string& format, size_t bufferSize, size_t flushMs)
+    : _path(path), _parts(), _fd(-1), _ring(), _head(0), _tail(0), _flushThreshold(0),
+      _flushMs(flushMs > 0 ? flushMs : 1), _dropped(0), _droppedTotal(0), _stopping(false), _thread()
+{
+    _compile(format);
+
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (_fd < 0) {
+        throw std::runtime_error("Cannot open access log " + path + ": " + strerror(errno));
+    }
+
+    _ring.resize(bufferSize > 0 ? bufferSize : 1);
+    _flushThreshold = _ring.size() / 4 > 0 ? _ring.size() / 4 : 1;
+
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_wakeup, NULL);
+
+    // Signals stay with the event loop threads, like for EventLoop::start()
+    sigset_t blocked;
+    sigset_t previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    int error = pthread_create(&_thread, NULL, &AccessLog::_threadMain, this);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (error != 0) {
+        pthread_cond_destroy(&_wakeup);
+        pthread_mutex_destroy(&_mutex);
+        ::close(_fd);
+        throw std::runtime_error(std::string("Cannot start the access log writer: ") + strerror(error));
+    }
+}
+
+AccessLog::~AccessLog()
+{
+    pthread_mutex_lock(&_mutex);
+    _stopping = true;
+    pthread_cond_signal(&_wakeup);
+    pthread_mutex_unlock(&_mutex);
+
+    // The writer drains the ring before it returns
+    pthread_join(_thread, NULL);
+
+    pthread_cond_destroy(&_wakeup);
+    pthread_mutex_destroy(&_mutex);
+    ::close(_fd);
+}
+
+void AccessLog::_compile(const std::string& format)
+{
+    struct VariableName {
+        const char* name;
+        Variable variable;
+    };
+    static const VariableName names[] = {
+        { "remote_addr", VAR_REMOTE_ADDR },
+        { "time_local", VAR_TIME_LOCAL },
+        { "request", VAR_REQUEST },
+        { "request_method", VAR_REQUEST_METHOD },
+        { "request_uri", VAR_REQUEST_URI },
+        { "server_protocol", VAR_SERVER_PROTOCOL },
+        { "status", VAR_STATUS },
+        { "bytes_sent", VAR_BYTES_SENT },
+        { "body_bytes_sent", VAR_BODY_BYTES_SENT },
+        { "request_time", VAR_REQUEST_TIME },
+        { "upstream_response_time", VAR_UPSTREAM_RESPONSE_TIME },
+        { "http_host", VAR_HTTP_HOST },
+        { "http_user_agent", VAR_HTTP_USER_AGENT }
+    };
+
+    Part literal;
+    literal.variable = VAR_LITERAL;
+
+    size_t i = 0;
+    while (i < format.size()) {
+        size_t end = i + 1;
+        while (end < format.size() && (islower(static_cast<unsigned char>(format[end])) || format[end] == '_')) {
+            ++end;
+        }
+        if (format[i] != '$' || end == i + 1) {
+            literal.literal += format[i++];
+            continue;
+        }
+
+        std::string name = format.substr(i + 1, end - i - 1);
+        size_t n = 0;
+        while (n < sizeof(names) / sizeof(names[0]) && name != names[n].name) {
+            ++n;
+        }
+        if (n == sizeof(names) / sizeof(names[0])) {
+            throw std::runtime_error("access_log_format: unknown variable $" + name);
+        }
+
+        if (!literal.literal.empty()) {
+            _parts.push_back(literal);
+            literal.literal.clear();
+        }
+        Part part;
+        part.variable = names[n].variable;
+        _parts.push_back(part);
+        i = end;
+    }
+    if (!literal.literal.empty()) {
+        _parts.push_back(literal);
+    }
+}
+
+/**
+ * Append client-controlled text with quotes, backslashes and control
+ * characters escaped as \xHH, so a request cannot forge log lines
+ */
+static void appendEscaped(std::string& out, const std::string& value)
+{
+    static const char digits[] = "0123456789ABCDEF";
+
+    if (value.empty()) {
+        out += '-';
+        return;
+    }
+    for (size_t i = 0; i < value.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        if (c < 0x20 || c >= 0x7f || c == '"' || c == '\\') {
+            out += "\\x";
+            out += digits[c >> 4];
+            out += digits[c & 0x0f];
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+}
+
+void AccessLog::_appendMilliseconds(std::string& out, uint64_t ms)
+{
+    // Seconds with millisecond resolution, like nginx: "0.042"
+    StringUtils::appendUnsigned(out, static_cast<unsigned long>(ms / 1000));
+    out += '.';
+    unsigned long fraction = static_cast<unsigned long>(ms % 1000);
+    out += static_cast<char>('0' + fraction / 100);
+    out += static_cast<char>('0' + fraction / 10 % 10);
+    out += static_cast<char>('0' + fraction % 10);
+}
+
+void AccessLog::_format(const Entry& entry, std::string& line) const
+{
+    const Request& request = *entry.request;
+
+    line.clear();
+    for (std::vector<Part>::const_iterator it = _parts.begin(); it != _parts.end(); ++it) {
+        switch (it->variable) {
+            case VAR_LITERAL:
+                line += it->literal;
+                break;
+            case VAR_REMOTE_ADDR:
+                line += *entry.clientIp;
+                break;
+            case VAR_TIME_LOCAL:
+                line += TimeUtils::currentLogTime();
+                break;
+            case VAR_REQUEST:
+                if (request.getUri().empty()) {
+                    line += '-';
+                    break;
+                }
+                line += request.getMethodStr();
+                line += ' ';
+                appendEscaped(line, request.getUri());
+                line += ' ';
+                appendEscaped(line, request.getVersion());
+                break;
+            case VAR_REQUEST_METHOD:
+                line += request.getUri().empty() ? std::string("-") : request.getMethodStr();
+                break;
+            case VAR_REQUEST_URI:
+                appendEscaped(line, request.getUri());
+                break;
+            case VAR_SERVER_PROTOCOL:
+                appendEscaped(line, request.getVersion());
+                break;
+            case VAR_STATUS:
+                StringUtils::appendUnsigned(line, static_cast<unsigned long>(entry.status));
+                break;
+            case VAR_BYTES_SENT:
+                StringUtils::appendUnsigned(line, static_cast<unsigned long>(entry.bytesSent));
+                break;
+            case VAR_BODY_BYTES_SENT:
+                StringUtils::appendUnsigned(line, static_cast<unsigned long>(
+                    entry.bytesSent > entry.headerBytes ? entry.bytesSent - entry.headerBytes : 0));
+                break;
+            case VAR_REQUEST_TIME:
+                _appendMilliseconds(line, entry.requestTimeMs);
+                break;
+            case VAR_UPSTREAM_RESPONSE_TIME:
+                if (entry.upstreamTimeMs < 0) {
+                    line += '-';
+                } else {
+                    _appendMilliseconds(line, static_cast<uint64_t>(entry.upstreamTimeMs));
+                }
+                break;
+            case VAR_HTTP_HOST:
+                appendEscaped(line, request.getHeaders().get(Headers::HOST));
+                break;
+            case VAR_HTTP_USER_AGENT:
+                appendEscaped(line, request.getHeaders().get(Headers::USER_AGENT));
+                break;
+        }
+    }
+    line += '\n';
+}
+
+void AccessLog::log(const Entry& entry, std::string& scratch)
+{
+    _format(entry, scratch);
+
+    size_t length = scratch.size();
+    size_t capacity = _ring.size();
+
+    pthread_mutex_lock(&_mutex);
+    size_t used = static_cast<size_t>(_head - _tail);
+    if (length > capacity - used) {
+        // The writer is behind: losing a record beats blocking the loop
+        ++_dropped;
+        ++_droppedTotal;
+        pthread_mutex_unlock(&_mutex);
+        return;
+    }
+
+    size_t offset = static_cast<size_t>(_head % capacity);
+    size_t first = length < capacity - offset ? length : capacity - offset;
+    memcpy(&_ring[offset], scratch.data(), first);
+    if (first < length) {
+        memcpy(&_ring[0], scratch.data() + first, length - first);
+    }
+    _head += length;
+
+    if (used < _flushThreshold && used + length >= _flushThreshold) {
+        pthread_cond_signal(&_wakeup);
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+unsigned long AccessLog::getDroppedCount() const
+{
+    pthread_mutex_lock(&_mutex);
+    unsigned long dropped = _droppedTotal;
+    pthread_mutex_unlock(&_mutex);
+    return dropped;
+}
+
+void AccessLog::_writeBatch(uint64_t from, uint64_t to)
+{
+    // Bytes in [from, to) belong to the writer until _tail moves past them
+    size_t capacity = _ring.size();
+
+    while (from < to) {
+        size_t offset = static_cast<size_t>(from % capacity);
+        size_t length = static_cast<size_t>(to - from);
+
+        struct iovec iov[2];
+        int count = 1;
+        iov[0].iov_base = &_ring[offset];
+        iov[0].iov_len = length < capacity - offset ? length : capacity - offset;
+        if (iov[0].iov_len < length) {
+            iov[1].iov_base = &_ring[0];
+            iov[1].iov_len = length - iov[0].iov_len;
+            count = 2;
+        }
+
+        ssize_t written = writev(_fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("Access log write to " << _path << " failed: " << strerror(errno)
+                      << ", " << length << " bytes lost");
+            return;
+        }
+        from += written;
+    }
+}
+
+void AccessLog::_run()
+{
+    pthread_mutex_lock(&_mutex);
+    for (;;) {
+        if (!_stopping && _head - _tail < _flushThreshold) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += _flushMs / 1000;
+            deadline.tv_nsec += static_cast<long>(_flushMs % 1000) * 1000000;
+            if (deadline.tv_nsec >= 1000000000) {
+                deadline.tv_sec += 1;
+                deadline.tv_nsec -= 1000000000;
+            }
+            while (!_stopping && _head - _tail < _flushThreshold) {
+                if (pthread_cond_timedwait(&_wakeup, &_mutex, &deadline) == ETIMEDOUT) {
+                    break;
+                }
+            }
+        }
+
+        uint64_t from = _tail;
+        uint64_t to = _head;
+        unsigned long dropped = _dropped;
+        bool stopping = _stopping;
+        _dropped = 0;
+        pthread_mutex_unlock(&_mutex);
+
+        if (dropped > 0) {
+            LOG_WARN("Access log buffer full, " << dropped << " records dropped");
+        }
+        if (from != to) {
+            _writeBatch(from, to);
+        }
+
+        pthread_mutex_lock(&_mutex);
+        _tail = to;
+        if (stopping && _head == _tail) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+void* AccessLog::_threadMain(void* log)
+{
+    static_cast<AccessLog*>(log)->_run();
+    return NULL;
+}
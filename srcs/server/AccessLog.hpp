@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include <pthread.h>
+#include "../http/Request.hpp"
+
+/**
+ * @brief Access log written in batches by a background thread
+ *
+ * Event loop threads format one line per request and copy it into a
+ * preallocated ring buffer under a short lock; they never touch the file.
+ * A writer thread drains the ring with a single writev() whenever it is
+ * a quarter full or the flush interval has passed, so the file sees a
+ * few large appends per second instead of one write per request. When
+ * the disk cannot keep up and the ring is full, records are dropped and
+ * counted rather than stalling a loop.
+ *
+ * The line format is compiled once into literal and variable parts.
+ * Variables, as in nginx: $remote_addr, $time_local, $request,
+ * $request_method, $request_uri, $server_protocol, $status, $bytes_sent,
+ * $body_bytes_sent, $request_time, $upstream_response_time, $http_host,
+ * $http_user_agent.
+ *
+ * One log is shared by all event loop threads of a process; each worker
+ * process opens its own, appending to the same file.
+ */
+class AccessLog {
+public:
+    /**
+     * @brief What is known about a finished request
+     */
+    struct Entry {
+        const std::string* clientIp;    // Peer address
+        const Request* request;         // Parsed request line and headers
+        int status;                     // Response status code
+        uint64_t bytesSent;             // Bytes written to the client, headers included
+        uint64_t headerBytes;           // Size of the response header block
+        uint64_t requestTimeMs;         // From the first request byte to the last response byte
+        int64_t upstreamTimeMs;         // Time spent on the CGI script, -1 if none ran
+    };
+
+    /**
+     * @brief Open the log file and start the writer thread
+     *
+     * @param path File to append to, created if missing
+     * @param format Line format with $variables
+     * @param bufferSize Ring buffer capacity in bytes
+     * @param flushMs Longest time a record waits for the writer
+     * @throw std::runtime_error If the format is invalid, the file cannot
+     *        be opened or the thread cannot be started
+     */
+    AccessLog(const std::string& path, const std::string& format, size_t bufferSize, size_t flushMs);
+
+    /**
+     * @brief Stop the writer thread after it flushed everything, close the file
+     */
+    ~AccessLog();
+
+    /**
+     * @brief Format a record and queue it for the writer (any thread)
+     *
+     * @param entry Request to log
+     * @param scratch Caller-owned buffer the line is formatted into, so a
+     *        reused connection formats without allocating
+     */
+    void log(const Entry& entry, std::string& scratch);
+
+    /**
+     * @brief Number of records dropped because the ring was full
+     *
+     * @return unsigned long Records lost since the log was opened
+     */
+    unsigned long getDroppedCount() const;
+
+private:
+    /**
+     * @brief One part of the compiled format
+     */
+    enum Variable {
+        VAR_LITERAL,
+        VAR_REMOTE_ADDR,
+        VAR_TIME_LOCAL,
+        VAR_REQUEST,
+        VAR_REQUEST_METHOD,
+        VAR_REQUEST_URI,
+        VAR_SERVER_PROTOCOL,
+        VAR_STATUS,
+        VAR_BYTES_SENT,
+        VAR_BODY_BYTES_SENT,
+        VAR_REQUEST_TIME,
+        VAR_UPSTREAM_RESPONSE_TIME,
+        VAR_HTTP_HOST,
+        VAR_HTTP_USER_AGENT
+    };
+
+    struct Part {
+        Variable variable;
+        std::string literal;    // Text of a VAR_LITERAL part
+    };
+
+    std::string _path;
+    std::vector<Part> _parts;   // Compiled format
+    int _fd;
+
+    // Ring buffer; positions count bytes ever queued and never wrap,
+    // the offset in _ring is the position modulo its size
+    std::vector<char> _ring;
+    uint64_t _head;             // Next byte queued by log()
+    uint64_t _tail;             // Next byte written by the writer
+    size_t _flushThreshold;     // Fill level that wakes the writer early
+    size_t _flushMs;
+    unsigned long _dropped;     // Records lost to a full ring since the last batch
+    unsigned long _droppedTotal;  // Records lost since the log was opened
+
+    mutable pthread_mutex_t _mutex;  // Guards the ring positions, drop counts and _stopping
+    pthread_cond_t _wakeup;     // Signaled on the threshold and on shutdown
+    bool _stopping;
+    pthread_t _thread;
+
+    void _compile(const std::string& format);
+    void _format(const Entry& entry, std::string& line) const;
+    void _writeBatch(uint64_t from, uint64_t to);
+    void _run();
+
+    static void* _threadMain(void* log);
+    static void _appendMilliseconds(std::string& out, uint64_t ms);
+
+    // Prevent copying
+    AccessLog(const AccessLog& other);
+    AccessLog& operator=(const AccessLog& other);
+};
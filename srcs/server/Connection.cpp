@@ -5,24 +5,142 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <cstdlib>
 #include <string.h>
+#include <sys/stat.h>
 #include "../http/StatusCodes.hpp"
 #include "../cgi/CGIHandler.hpp"
 #include "../utils/StringUtils.hpp"
+#include "../utils/TimeUtils.hpp"
 
-Connection::Connection(int clientFd, struct sockaddr_in clientAddr, ServerConfig* config)
-    : _clientFd(clientFd), _clientAddr(clientAddr), _serverConfig(config),
-      _inputBuffer(), _outputBuffer(), _state(READING_HEADERS),
+// Marks the entity tag of a body compressed on the fly: it differs from the file's
+static void appendGzipTag(std::string& etag)
+{
+    etag.insert(etag.size() - 1, "-gz");
+}
+
+// Cache key of a directory listing: file keys are absolute paths, so this never collides
+static std::string listingKey(const std::string& requestPath)
+{
+    return "autoindex:" + requestPath;
+}
+
+// Read a decimal query parameter, keeping the default when it is absent
+static bool parseListingNumber(const std::string& value, size_t& result)
+{
+    if (value.empty()) {
+        return true;
+    }
+    if (value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    result = std::strtoul(value.c_str(), NULL, 10);
+    return true;
+}
+
+// Read ?format=, ?offset= and ?limit= of a directory listing request
+static bool parseListingQuery(const Request& request, DirectoryListing::Format& format,
+                              size_t& offset, size_t& limit)
+{
+    std::string formatName = request.getQueryParam("format");
+    if (formatName == "json") {
+        format = DirectoryListing::FORMAT_JSON;
+    } else if (formatName.empty() || formatName == "html") {
+        format = DirectoryListing::FORMAT_HTML;
+    } else {
+        return false;
+    }
+    offset = 0;
+    limit = DirectoryListing::NO_LIMIT;
+    return parseListingNumber(request.getQueryParam("offset"), offset) &&
+           parseListingNumber(request.getQueryParam("limit"), limit);
+}
+
+Connection::Connection()
+    : _clientFd(-1), _clientAddr(), _serverConfig(NULL), _fileCache(NULL), _accessLog(NULL),
+      _multiplexer(NULL), _cgi(NULL), _cgiStreaming(false), _cgiChunked(false), _cgiPaused(false),
+      _cgiRemaining(std::string::npos), _cgiChunk(), _gzip(NULL), _gzipFd(-1), _gzipBuffer(),
+      _listing(NULL), _listingBuffer(),
+      _upload(NULL), _uploadChunk(),
+      _inputBuffer(), _output(), _headerBuffer(), _body(), _ranges(), _readBuffer(GlobalConfig::DEFAULT_READ_BUFFER_SIZE),
+      _ioBudget(GlobalConfig::DEFAULT_IO_BUDGET), _edgeTriggered(false), _ioPending(false),
+      _timer(), _activity(false), _idle(false), _logPending(false), _requestStart(0),
+      _cgiStart(0), _upstreamMs(-1), _bytesSent(0), _headerBytes(0), _pipelinedBytes(0), _logLine(), _state(CLOSED),
+      _request(), _response()
+{
+    _timer.data = this;
+}
+
+Connection::Connection(int clientFd, const struct sockaddr_in& clientAddr, ServerConfig* config)
+    : _clientFd(-1), _clientAddr(), _serverConfig(NULL), _fileCache(NULL), _accessLog(NULL),
+      _multiplexer(NULL), _cgi(NULL), _cgiStreaming(false), _cgiChunked(false), _cgiPaused(false),
+      _cgiRemaining(std::string::npos), _cgiChunk(), _gzip(NULL), _gzipFd(-1), _gzipBuffer(),
+      _listing(NULL), _listingBuffer(),
+      _upload(NULL), _uploadChunk(),
+      _inputBuffer(), _output(), _headerBuffer(), _body(), _ranges(), _readBuffer(GlobalConfig::DEFAULT_READ_BUFFER_SIZE),
+      _ioBudget(GlobalConfig::DEFAULT_IO_BUDGET), _edgeTriggered(false), _ioPending(false),
+      _timer(), _activity(false), _idle(false), _logPending(false), _requestStart(0),
+      _cgiStart(0), _upstreamMs(-1), _bytesSent(0), _headerBytes(0), _pipelinedBytes(0), _logLine(), _state(CLOSED),
       _request(), _response()
 {
+    _timer.data = this;
+    open(clientFd, clientAddr, config);
+}
+
+void Connection::open(int clientFd, const struct sockaddr_in& clientAddr, ServerConfig* config)
+{
+    // Everything close() leaves behind is reset here; buffers keep their
+    // capacity unless a previous client grew them past the retention limit
+    _clientFd = clientFd;
+    _clientAddr = clientAddr;
+    _serverConfig = config;
+    _fileCache = NULL;
+    _accessLog = NULL;
+    _multiplexer = NULL;
+    _cgiStreaming = false;
+    _cgiChunked = false;
+    _cgiPaused = false;
+    _cgiRemaining = std::string::npos;
+    _trimBuffer(_cgiChunk);
+    _trimBuffer(_gzipBuffer);
+    _trimBuffer(_uploadChunk);
+    _trimBuffer(_inputBuffer);
+    _trimBuffer(_headerBuffer);
+    _ioPending = false;
+    _activity = false;
+    _idle = false;
+    _logPending = false;
+    _requestStart = 0;
+    _upstreamMs = -1;
+    _bytesSent = 0;
+    _headerBytes = 0;
+    _pipelinedBytes = 0;
+    _state = READING_HEADERS;
+    _request.reset();
+    _response.reset();
+    
+    // The request's body buffer is swapped out so an oversized one is trimmed too
+    _request.takeBody(_uploadChunk);
+    _trimBuffer(_uploadChunk);
+    
     // Convert binary address to string for logging
     char ipBuffer[INET_ADDRSTRLEN];
     inet_ntop(AF_INET, &_clientAddr.sin_addr, ipBuffer, INET_ADDRSTRLEN);
     _clientIp = ipBuffer;
     
-    _updateLastActivity();
+    _markActivity();
     
-    std::cout << "New connection from " << _clientIp << " (fd: " << _clientFd << ")" << std::endl;
+    LOG_INFO("New connection from " << _clientIp << " (fd: " << _clientFd << ")");
+}
+
+void Connection::_trimBuffer(std::string& buffer)
+{
+    if (buffer.capacity() > RETAINED_BUFFER_SIZE) {
+        std::string().swap(buffer);
+    } else {
+        buffer.clear();
+    }
 }
 
 Connection::~Connection()
@@ -30,62 +148,104 @@ Connection::~Connection()
     close();
 }
 
-void Connection::_updateLastActivity()
+void Connection::_markActivity()
+{
+    _activity = true;
+}
+
+void Connection::configureIO(size_t readBufferSize, size_t ioBudget, bool edgeTriggered)
+{
+    _readBuffer.resize(readBufferSize > 0 ? readBufferSize : GlobalConfig::DEFAULT_READ_BUFFER_SIZE);
+    _ioBudget = ioBudget > 0 ? ioBudget : GlobalConfig::DEFAULT_IO_BUDGET;
+    _edgeTriggered = edgeTriggered;
+}
+
+void Connection::setFileCache(FileCache* fileCache)
+{
+    _fileCache = (fileCache && fileCache->isEnabled()) ? fileCache : NULL;
+}
+
+void Connection::setAccessLog(AccessLog* accessLog)
 {
-    _lastActivity = time(NULL);
+    _accessLog = accessLog;
+}
+
+void Connection::setMultiplexer(IOMultiplexer* multiplexer)
+{
+    _multiplexer = multiplexer;
 }
 
 /*** READ & PROCESS REQUESTS DATA ***/
 bool Connection::readData()
 {
+    _ioPending = false;
     if (!_isValidStateForReading())
         return _state != CLOSED;
-        
-    ssize_t bytesRead = _readFromSocket();
     
-    if (bytesRead > 0) {
+    size_t budget = _ioBudget;
+    
+    // Drain the socket; processing may move us out of a reading state
+    // (request complete or error), in which case the rest stays queued
+    do {
+        ssize_t bytesRead = _readFromSocket();
+        
+        if (bytesRead == 0) {
+            return _handleConnectionClosed();
+        } else if (bytesRead < 0) {
+            return _handleSocketError();
+        }
+        
         _processReadData(bytesRead);
-        return true;
-    } else if (bytesRead == 0) {
-        return _handleConnectionClosed();
-    } else {
-        return _handleSocketError();
-    }
+        
+        if (static_cast<size_t>(bytesRead) >= budget) {
+            // Yield to other clients, come back on the next loop iteration
+            _ioPending = (_state == READING_HEADERS || _state == READING_BODY);
+            break;
+        }
+        budget -= bytesRead;
+        
+        // A short read means the socket is empty; level-triggered
+        // notification will tell us when more arrives
+        if (!_edgeTriggered && static_cast<size_t>(bytesRead) < _readBuffer.size()) {
+            break;
+        }
+    } while (_state == READING_HEADERS || _state == READING_BODY);
+    
+    return _state != CLOSED;
 }
 
 bool Connection::_isValidStateForReading() const
 {
     if (_state == CLOSED) {
-        DebugLogger::log("Connection is closed, not reading");
+        LOG_DEBUG("Connection is closed, not reading");
         return false;
     }
     
     // Only read in appropriate states
     if (_state != READING_HEADERS && _state != READING_BODY) {
-        std::stringstream ss;
-        ss << _state;
-        DebugLogger::log("Connection state doesn't allow reading: " + ss.str());
+        LOG_DEBUG("Connection state doesn't allow reading: " << _state);
         return false;
     }
     
     // Log pre-read state and buffer size
-    std::stringstream preReadLog;
-    preReadLog << "[DEBUG-UPLOAD] Pre-read state: " << _state 
-              << ", Input buffer size: " << _inputBuffer.size();
-    DebugLogger::log(preReadLog.str());
+    LOG_DEBUG("[DEBUG-UPLOAD] Pre-read state: " << _state << ", Input buffer size: " << _inputBuffer.size());
     
     return true;
 }
 
 ssize_t Connection::_readFromSocket()
 {
-    char buffer[4096];
-    ssize_t bytesRead = recv(_clientFd, buffer, sizeof(buffer), 0);
+    char* buffer = &_readBuffer[0];
+    ssize_t bytesRead = recv(_clientFd, buffer, _readBuffer.size(), 0);
     
     if (bytesRead > 0) {
         // Append read data to input buffer
         _inputBuffer.append(buffer, bytesRead);
-        _updateLastActivity();
+        _idle = false;
+        if (_requestStart == 0) {
+            _requestStart = TimeUtils::monotonicMs();
+        }
+        _markActivity();
         
         // Log data received
         _logReadOperation(bytesRead, buffer);
@@ -96,17 +256,24 @@ ssize_t Connection::_readFromSocket()
 
 void Connection::_logReadOperation(ssize_t bytesRead, const char* buffer)
 {
-    std::stringstream dataLog;
-    dataLog << "Read " << bytesRead << " bytes, total buffer: " << _inputBuffer.size();
-    DebugLogger::log(dataLog.str());
-    
-    std::cout << "Read " << bytesRead << " bytes from " << _clientIp << std::endl;
-    DebugLogger::hexDump("Raw request data", std::string(buffer, bytesRead));
+    LOG_DEBUG("Read " << bytesRead << " bytes from " << _clientIp << ", total buffer: " << _inputBuffer.size());
+    if (LOG_DEBUG_ENABLED()) {
+        DebugLogger::hexDump("Raw request data", buffer, bytesRead);
+    }
 }
 
 bool Connection::_handleConnectionClosed()
 {
-    std::cout << "Connection closed by client: " << _clientIp << std::endl;
+    // The client may only have shut down its side after pipelining:
+    // the queued responses still go out before closing
+    if (!_output.empty()) {
+        LOG_DEBUG("End of input from " << _clientIp << ", sending queued responses");
+        _response.setHeader(Headers::CONNECTION, "close");
+        _transitionToSendingResponse();
+        return true;
+    }
+    
+    LOG_INFO("Connection closed by client: " << _clientIp);
     _state = CLOSED;
     return false;
 }
@@ -115,14 +282,11 @@ bool Connection::_handleSocketError()
 {
     if (errno == EAGAIN || errno == EWOULDBLOCK) {
         // No data available, try again later
-        std::stringstream eagainLog;
-        eagainLog << "EAGAIN/EWOULDBLOCK - No data available, state: " << _state;
-        DebugLogger::log(eagainLog.str());
+        LOG_DEBUG("EAGAIN/EWOULDBLOCK - No data available, state: " << _state);
         return true;
     } else {
         // Error
-        std::cerr << "Error reading from socket " << _clientFd << ": " << strerror(errno) << std::endl;
-        DebugLogger::logError("Socket read error: " + std::string(strerror(errno)));
+        LOG_WARN("Socket read error: " << strerror(errno));
         _state = CLOSED;
         return false;
     }
@@ -141,9 +305,9 @@ void Connection::_processReadData(ssize_t bytesRead)
 
 void Connection::_processHeaderData()
 {
-    DebugLogger::log("Parsing headers...");
+    LOG_DEBUG("Parsing headers...");
     if (_request.parseHeaders(_inputBuffer)) {
-        DebugLogger::log("Headers parsed successfully");
+        LOG_DEBUG("Headers parsed successfully");
         
         // Log important headers
         _logHeaderInfo();
@@ -153,14 +317,14 @@ void Connection::_processHeaderData()
         if (contentLength > 0) {
             size_t maxBodySize = _getEffectiveMaxBodySize(_request.getPath());
             if (maxBodySize > 0 && contentLength > maxBodySize) {
-                DebugLogger::logError("Content-Length exceeds client_max_body_size limit");
+                LOG_INFO("Content-Length exceeds client_max_body_size limit");
                 _handleError(HTTP_STATUS_PAYLOAD_TOO_LARGE);
                 return;
             }
         }
         
         // Check for Expect: 100-continue header
-        if (_request.getHeaders().get("expect") == "100-continue") {
+        if (_request.getHeaders().get(Headers::EXPECT) == "100-continue") {
             _handle100Continue();
         }
         
@@ -170,48 +334,54 @@ void Connection::_processHeaderData()
         } else {
             _handleBodyAfterHeaders();
         }
+    } else if (_request.getParseError() == 0) {
+        LOG_DEBUG("Headers not complete yet, continuing to read");
+    } else if (_request.getParseError() == HTTP_STATUS_METHOD_NOT_ALLOWED) {
+        _handleUnknownMethod();
     } else {
-        // Headers parsing failed
-        if (_request.getMethod() == Request::UNKNOWN) {
-            _handleUnknownMethod();
-        } else {
-            DebugLogger::log("Headers not complete yet, continuing to read");
-        }
+        // Headers parsing failed, the rest of the stream cannot be trusted
+        _response.reset();
+        _response.setHeader(Headers::CONNECTION, "close");
+        _handleError(_request.getParseError());
     }
 }
 
 void Connection::_logHeaderInfo()
 {
-    std::stringstream headerLog;
-    headerLog << "Content-Length: " << _request.getHeaders().getContentLength()
-             << ", Content-Type: " << _request.getHeaders().getContentType();
-    DebugLogger::log(headerLog.str());
+    LOG_DEBUG("Content-Length: " << _request.getHeaders().getContentLength() << ", Content-Type: " << _request.getHeaders().getContentType());
     
-    DebugLogger::logRequest(_clientIp, _request.getMethodStr(), 
-                         _request.getPath(), _request.getHeaders().toString());
+    if (LOG_DEBUG_ENABLED()) {
+        DebugLogger::logRequest(_clientIp, _request.getMethodStr(),
+                                _request.getPath(), _request.getHeaders().toString());
+    }
 }
 
 void Connection::_handle100Continue()
 {
-    DebugLogger::log("Detected Expect: 100-continue header, sending 100 Continue response");
+    LOG_DEBUG("Detected Expect: 100-continue header, sending 100 Continue response");
     
-    // Send 100 Continue response
+    // Send 100 Continue response, behind any pipelined response still queued
     std::string continueResponse = "HTTP/1.1 100 Continue\r\n\r\n";
+    if (!_output.empty()) {
+        _output.append(continueResponse);
+        _pipelinedBytes = _output.size();
+        return;
+    }
     send(_clientFd, continueResponse.c_str(), continueResponse.length(), 0);
 }
 
 void Connection::_handleBodyAfterHeaders()
 {
+    _beginUpload();
+    
     // Body expected, check if body data is already in buffer
     if (_inputBuffer.size() > 0) {
         _attemptImmediateBodyParse();
     } else {
         // No body data in buffer yet, switch to READING_BODY state
-        DebugLogger::log("Body expected, moving to READING_BODY state");
+        LOG_DEBUG("Body expected, moving to READING_BODY state");
         
-        std::stringstream ss;
-        ss << _request.getHeaders().getContentLength();
-        DebugLogger::log("Content-Length: " + ss.str());
+        LOG_DEBUG("Content-Length: " << _request.getHeaders().getContentLength());
         
         _transitionToReadingBody();
     }
@@ -219,50 +389,56 @@ void Connection::_handleBodyAfterHeaders()
 
 void Connection::_attemptImmediateBodyParse()
 {
-    DebugLogger::log("Body data already in buffer, attempting to parse immediately");
-    std::stringstream bufLog;
-    bufLog << "Buffer size after header parsing: " << _inputBuffer.size();
-    DebugLogger::log(bufLog.str());
+    LOG_DEBUG("Body data already in buffer, attempting to parse immediately");
+    LOG_DEBUG("Buffer size after header parsing: " << _inputBuffer.size());
 
     // Check the content length against the limit
     size_t contentLength = _request.getHeaders().getContentLength();
     size_t maxBodySize = _getEffectiveMaxBodySize(_request.getPath());
     
     if (maxBodySize > 0 && contentLength > maxBodySize) {
-        DebugLogger::logError("Content-Length exceeds client_max_body_size limit");
+        LOG_INFO("Content-Length exceeds client_max_body_size limit");
         _handleError(HTTP_STATUS_PAYLOAD_TOO_LARGE);
         return;
     }
     
     // Try parsing body right away
     bool parseResult = _request.parseBody(_inputBuffer);
+    if (!parseResult && _request.getParseError() != 0) {
+        _handleError(_request.getParseError());
+        return;
+    }
+    
+    // A chunked body has no announced length, check what was decoded
+    if (maxBodySize > 0 && _request.getBodyLength() > maxBodySize) {
+        LOG_INFO("Request body exceeds client_max_body_size limit");
+        _handleError(HTTP_STATUS_PAYLOAD_TOO_LARGE);
+        return;
+    }
+    _feedUpload();
     
-    std::stringstream resultLog;
-    resultLog << "Immediate body parse result: " << (parseResult ? "true" : "false")
-             << ", isComplete: " << (_request.isComplete() ? "true" : "false");
-    DebugLogger::log(resultLog.str());
+    LOG_DEBUG("Immediate body parse result: " << (parseResult ? "true" : "false") << ", isComplete: " << (_request.isComplete() ? "true" : "false"));
     
     if (parseResult) {
         // Body complete, move to processing
         _transitionToProcessing();
     } else {
         // Body parsing started but not complete, continue in READING_BODY state
-        DebugLogger::log("Body partially parsed, moving to READING_BODY state");
+        LOG_DEBUG("Body partially parsed, moving to READING_BODY state");
         _transitionToReadingBody();
     }
 }
 
 void Connection::_processBodyData()
 {
-    DebugLogger::log("Parsing body...");
+    LOG_DEBUG("Parsing body...");
 
     // Check current body size before processing more
-    const std::string& currentBody = _request.getBody();
     size_t maxBodySize = _getEffectiveMaxBodySize(_request.getPath());
     
     // Only perform check if a limit is set (non-zero)
-    if (maxBodySize > 0 && currentBody.size() > maxBodySize) {
-        DebugLogger::logError("Request body exceeds client_max_body_size limit");
+    if (maxBodySize > 0 && _request.getBodyLength() > maxBodySize) {
+        LOG_INFO("Request body exceeds client_max_body_size limit");
         _handleError(HTTP_STATUS_PAYLOAD_TOO_LARGE);
         return;
     }
@@ -270,15 +446,21 @@ void Connection::_processBodyData()
     _logBodyParseStart();
     
     bool parseResult = _request.parseBody(_inputBuffer);
+    if (!parseResult && _request.getParseError() != 0) {
+        _handleError(_request.getParseError());
+        return;
+    }
     
     _logBodyParseResult(parseResult);
     
     // Check again after parsing in case we just exceeded the limit
-    if (parseResult && maxBodySize > 0 && _request.getBody().size() > maxBodySize) {
-        DebugLogger::logError("Request body exceeds client_max_body_size limit after parsing");
+    if (maxBodySize > 0 && _request.getBodyLength() > maxBodySize) {
+        LOG_INFO("Request body exceeds client_max_body_size limit after parsing");
         _handleError(HTTP_STATUS_PAYLOAD_TOO_LARGE);
         return;
     }
+    
+    _feedUpload();
 
     if (parseResult) {
         _transitionToProcessing();
@@ -287,41 +469,87 @@ void Connection::_processBodyData()
     }
 }
 
+void Connection::_beginUpload()
+{
+    // Only multipart POSTs to an upload location are parsed on the fly,
+    // anything else keeps its body in the request
+    if (_request.getMethod() != Request::POST ||
+        _request.getHeaders().getContentType().find("multipart/form-data") == std::string::npos) {
+        return;
+    }
+    
+    LocationConfig* location = _findLocation(_request.getPath());
+    if (!location || location->getUploadDir().empty() || !location->getRedirection().empty()) {
+        return;
+    }
+    
+    const std::vector<std::string>& allowedMethods = location->getAllowedMethods();
+    if (std::find(allowedMethods.begin(), allowedMethods.end(), "POST") == allowedMethods.end()) {
+        return;
+    }
+    
+    // Without a usable directory the body is buffered and the upload fails later
+    if (!_prepareUploadDirectory(location->getUploadDir())) {
+        return;
+    }
+    
+    _upload = new MultipartParser(_request.getHeaders().getContentType());
+    _upload->setUploadDir(location->getUploadDir());
+    LOG_DEBUG("Streaming multipart upload to " << location->getUploadDir());
+}
+
+void Connection::_feedUpload()
+{
+    if (!_upload) {
+        return;
+    }
+    
+    // Move the decoded body out of the request, only the parser window stays in memory
+    _request.takeBody(_uploadChunk);
+    if (!_uploadChunk.empty()) {
+        // A malformed body keeps being read and is rejected once complete
+        _upload->feed(_uploadChunk.data(), _uploadChunk.size());
+    }
+    _uploadChunk.clear();
+}
+
+void Connection::_releaseUpload()
+{
+    // Unsaved temporary files are removed by the parser
+    delete _upload;
+    _upload = NULL;
+    _uploadChunk.clear();
+}
+
 void Connection::_logBodyParseStart()
 {
-    std::stringstream beforeLog;
-    beforeLog << "Before parseBody call - Buffer size: " << _inputBuffer.size()
-             << ", Content-Length: " << _request.getHeaders().getContentLength();
-    DebugLogger::log(beforeLog.str());
+    LOG_DEBUG("Before parseBody call - Buffer size: " << _inputBuffer.size() << ", Content-Length: " << _request.getHeaders().getContentLength());
 }
 
 void Connection::_logBodyParseResult(bool parseResult)
 {
-    std::stringstream afterLog;
-    afterLog << "parseBody result: " << (parseResult ? "true" : "false")
-            << ", isComplete: " << (_request.isComplete() ? "true" : "false")
-            << ", Remaining buffer: " << _inputBuffer.size();
-    DebugLogger::log(afterLog.str());
+    LOG_DEBUG("parseBody result: " << (parseResult ? "true" : "false") << ", isComplete: " << (_request.isComplete() ? "true" : "false") << ", Remaining buffer: " << _inputBuffer.size());
 }
 
 void Connection::_logBodyParseIncomplete()
 {
-    DebugLogger::log("Body not complete yet, continuing to read");
+    LOG_DEBUG("Body not complete yet, continuing to read");
     
     // Print first part of body content for debugging
-    if (_request.getBody().size() > 0) {
+    if (LOG_DEBUG_ENABLED() && _request.getBody().size() > 0) {
         const std::string& body = _request.getBody();
         std::string preview = body.substr(0, body.size() > 100 ? 100 : body.size());
-        DebugLogger::log("Body preview: " + preview + (body.size() > 100 ? "..." : ""));
+        LOG_DEBUG("Body preview: " << preview << (body.size() > 100 ? "..." : ""));
     }
 }
 
 void Connection::_handleUnknownMethod()
 {
-    DebugLogger::logError("Unknown HTTP method: " + _request.getMethodStr());
+    LOG_INFO("Unknown HTTP method: " << _request.getMethodStr());
     
-    // Create a new response
-    _response = Response();
+    // Start a fresh response, the rest of the request is never read
+    _response.reset();
+    _response.setHeader(Headers::CONNECTION, "close");
     
     // Handle the 405 error
     _handleError(HTTP_STATUS_METHOD_NOT_ALLOWED);
@@ -329,12 +557,11 @@ void Connection::_handleUnknownMethod()
 
 void Connection::_transitionToProcessing()
 {
-    DebugLogger::log("Request is complete, moving to PROCESSING state");
+    LOG_DEBUG("Request is complete, moving to PROCESSING state");
     _state = PROCESSING;
+    _logPending = true;
     
-    std::stringstream bodySizeStr;
-    bodySizeStr << _request.getBody().size();
-    DebugLogger::log("Body size: " + bodySizeStr.str());
+    LOG_DEBUG("Body size: " << _request.getBody().size());
     
     process();
 }
@@ -353,58 +580,103 @@ void Connection::_transitionToSendingResponse()
 /*** WRITE & PROCESS RESPONSE ***/
 bool Connection::writeData()
 {
+    _ioPending = false;
     if (!_isValidStateForWriting())
         return _state != CLOSED;
+    
+    size_t budget = _ioBudget;
+    
+    // Keep sending until the kernel buffer is full or the response is out
+    do {
+        _queuePipelinedResponses();
+        
+        ssize_t bytesWritten = _writeToSocket(budget);
+        
+        if (bytesWritten == 0) {
+            return _handleWriteSocketClosure();
+        } else if (bytesWritten < 0) {
+            return _handleWriteSocketError();
+        }
         
-    ssize_t bytesWritten = _writeToSocket();
+        _handleSuccessfulWrite(bytesWritten);
+        
+        if (static_cast<size_t>(bytesWritten) >= budget) {
+            _ioPending = (_state != CLOSED && !_output.empty());
+            break;
+        }
+        budget -= bytesWritten;
+    } while (_state != CLOSED && !_output.empty());
     
-    if (bytesWritten > 0) {
-        return _handleSuccessfulWrite(bytesWritten);
-    } else if (bytesWritten == 0) {
-        return _handleWriteSocketClosure();
-    } else {
-        return _handleWriteSocketError();
-    }
+    return _state != CLOSED;
 }
 
 bool Connection::_isValidStateForWriting() const
 {
     if (_state == CLOSED) {
-        DebugLogger::log("Connection is closed, not writing");
+        LOG_DEBUG("Connection is closed, not writing");
         return false;
     }
     
-    // Make sure we only write when we should
-    if (_state != SENDING_RESPONSE || _outputBuffer.empty()) {
-        std::stringstream ss;
-        ss << _state;
-        ss << ", buffer size: " << _outputBuffer.size();
-        DebugLogger::log("Not in writing state or buffer empty, state: " + ss.str());
+    // Responses of pipelined requests may still be queued in any state
+    if (_output.empty()) {
+        LOG_DEBUG("Not in writing state or buffer empty, state: " << _state << ", buffer size: " << _output.size());
         return false;
     }
     
-    std::stringstream ss;
-    ss << _outputBuffer.size();
-    DebugLogger::log("Writing response data, buffer size: " + ss.str());
+    LOG_DEBUG("Writing response data, buffer size: " << _output.size());
     return true;
 }
 
-ssize_t Connection::_writeToSocket()
+ssize_t Connection::_writeToSocket(size_t maxBytes)
 {
-    return send(_clientFd, _outputBuffer.c_str(), _outputBuffer.size(), 0);
+    return _output.flush(_clientFd, maxBytes);
 }
 
 bool Connection::_handleSuccessfulWrite(ssize_t bytesWritten)
 {
-    _updateLastActivity();
+    _markActivity();
+    
+    // Responses queued ahead of the current one were logged already
+    size_t earlier = std::min(static_cast<size_t>(bytesWritten), _pipelinedBytes);
+    _pipelinedBytes -= earlier;
+    _bytesSent += bytesWritten - earlier;
     
     _logWriteOperation(bytesWritten);
     
-    // Remove sent data from buffer
-    _outputBuffer.erase(0, bytesWritten);
+    // A file compressed on the fly is read as the client drains the queue
+    if (_gzipFd >= 0) {
+        if (_output.size() < GZIP_LOW_WATER) {
+            _pumpGzipFile();
+        }
+        if (_gzipFd >= 0) {
+            return true;
+        }
+    }
+    
+    // So is a large directory listing
+    if (_listing) {
+        if (_output.size() < LISTING_LOW_WATER) {
+            _pumpListing();
+        }
+        if (_listing) {
+            return true;
+        }
+    }
+    
+    // A streaming CGI response ends with the script's output, not with the queue
+    if (_cgi) {
+        if (_cgiPaused && _output.size() < CGI_LOW_WATER) {
+            if (!_watchCgiFd(_cgi->getOutputFd(), IOMultiplexer::EVENT_READ)) {
+                _failCgi();
+                return _state != CLOSED;
+            }
+            _cgiPaused = false;
+        }
+        return true;
+    }
     
     // If all data sent, move to next state
-    if (_outputBuffer.empty()) {
+    if (_state == SENDING_RESPONSE && _output.empty()) {
         _handleWriteComplete();
     }
     
@@ -413,22 +685,19 @@ bool Connection::_handleSuccessfulWrite(ssize_t bytesWritten)
 
 void Connection::_logWriteOperation(ssize_t bytesWritten)
 {
-    std::cout << "Wrote " << bytesWritten << " bytes to " << _clientIp << std::endl;
-    
-    std::stringstream ss;
-    ss << bytesWritten << " bytes to client, remaining: " << _outputBuffer.size();
-    DebugLogger::log("Wrote " + ss.str());
+    LOG_DEBUG("Wrote " << bytesWritten << " bytes to " << _clientIp << ", remaining: " << _output.size());
 }
 
 void Connection::_handleWriteComplete()
 {
     // Mark the response as sent
     _response.markAsSent();
-    DebugLogger::log("Response fully sent");
+    LOG_DEBUG("Response fully sent");
+    _logAccess();
     
-    // Check connection header
-    bool keepAlive = _request.getHeaders().keepAlive(true);
-    DebugLogger::log("Keep-alive: " + std::string(keepAlive ? "yes" : "no"));
+    // Check connection header (a response may force a close, e.g. a body ended by EOF)
+    bool keepAlive = _request.getHeaders().keepAlive(true) && _response.getHeaders().keepAlive(true);
+    LOG_DEBUG("Keep-alive: " << (keepAlive ? "yes" : "no"));
     
     if (keepAlive) {
         _prepareForNextRequest();
@@ -439,22 +708,67 @@ void Connection::_handleWriteComplete()
 
 void Connection::_prepareForNextRequest()
 {
-    DebugLogger::log("Keeping connection alive, resetting for next request");
+    LOG_DEBUG("Keeping connection alive, resetting for next request");
     _request.reset();
+    _releaseUpload();
     _state = READING_HEADERS;
-    _inputBuffer.clear();
+    _idle = true;
+    
+    // Bytes past the previous request are the start of the next one
+    if (!_inputBuffer.empty()) {
+        _parseBufferedRequest();
+    }
+}
+
+void Connection::_parseBufferedRequest()
+{
+    LOG_DEBUG("Parsing pipelined request, " << _inputBuffer.size() << " bytes buffered");
+    _idle = false;
+    _requestStart = TimeUtils::monotonicMs();
+    _markActivity();
+    _processHeaderData();
+}
+
+/**
+ * @brief Answer pipelined requests that are already buffered
+ * 
+ * Once the current response is entirely queued, the next buffered request
+ * is processed right away and its response queued behind it, so the
+ * answers to a pipelined batch leave in one writev() instead of one per
+ * wakeup. A response handed over this way is logged at that point, with
+ * its full size. Stops at a response that closes the connection, a
+ * request that needs more data, a CGI script or a file still being
+ * compressed, and bounds the queue.
+ */
+void Connection::_queuePipelinedResponses()
+{
+    size_t queued = 0;
+    
+    while (_state == SENDING_RESPONSE && !_cgi && _gzipFd < 0 && !_listing && !_inputBuffer.empty() &&
+           queued < MAX_PIPELINED_RESPONSES && _output.size() < PIPELINE_HIGH_WATER) {
+        if (!_request.getHeaders().keepAlive(true) || !_response.getHeaders().keepAlive(true)) {
+            return;
+        }
+        
+        _bytesSent += _output.size() - _pipelinedBytes;
+        _pipelinedBytes = _output.size();
+        _logAccess();
+        ++queued;
+        
+        LOG_DEBUG("Response queued, answering the next pipelined request");
+        _prepareForNextRequest();
+    }
 }
 
 void Connection::_closeAfterResponse()
 {
-    DebugLogger::log("Not keep-alive, closing connection");
+    LOG_DEBUG("Not keep-alive, closing connection");
     _state = CLOSED;
 }
 
 bool Connection::_handleWriteSocketClosure()
 {
-    std::cout << "Connection closed during write: " << _clientIp << std::endl;
-    DebugLogger::logError("Connection closed by client during write");
+    LOG_INFO("Connection closed by client during write: " << _clientIp);
     _state = CLOSED;
     return false;
 }
@@ -463,12 +777,11 @@ bool Connection::_handleWriteSocketError()
 {
     if (errno == EAGAIN || errno == EWOULDBLOCK) {
         // Socket buffer full, try again later
-        DebugLogger::log("Write would block (EAGAIN/EWOULDBLOCK), trying again later");
+        LOG_DEBUG("Write would block (EAGAIN/EWOULDBLOCK), trying again later");
         return true;
     } else {
         // Error
-        std::cerr << "Error writing to socket " << _clientFd << ": " << strerror(errno) << std::endl;
-        DebugLogger::logError("Socket write error: " + std::string(strerror(errno)));
+        LOG_WARN("Socket write error: " << strerror(errno));
         _state = CLOSED;
         return false;
     }
@@ -489,15 +802,18 @@ void Connection::process()
         _handleProcessingException(e);
     }
     
+    // A CGI request completes from handleCgiEvent() (or already did, inline)
+    if (_state != PROCESSING) {
+        return;
+    }
+    
     _buildAndPrepareResponse();
 }
 
 bool Connection::_isValidStateForProcessing() const
 {
     if (_state != PROCESSING) {
-        std::stringstream ss;
-        ss << _state;
-        DebugLogger::log("process() called but state is not PROCESSING, current state: " + ss.str());
+        LOG_DEBUG("process() called but state is not PROCESSING, current state: " << _state);
         return false;
     }
     return true;
@@ -505,28 +821,27 @@ bool Connection::_isValidStateForProcessing() const
 
 void Connection::_logProcessingStart()
 {
-    std::cout << "Processing " << _request.getMethodStr() << " request for " 
-              << _request.getPath() << " from " << _clientIp << std::endl;
+    LOG_INFO("Processing " << _request.getMethodStr() << " request for "
+             << _request.getPath() << " from " << _clientIp);
 }
 
 void Connection::_prepareNewResponse()
 {
-    // Create a new response for this request
-    _response = Response();
+    // Start a fresh response for this request, reusing the object's storage
+    _response.reset();
 }
 
 void Connection::_handleProcessingException(const std::exception& e)
 {
     // Handle any exceptions during processing
-    std::cerr << "Error processing request: " << e.what() << std::endl;
-    DebugLogger::logError("Exception during request processing: " + std::string(e.what()));
+    LOG_ERROR("Exception during request processing: " << e.what());
     _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
 }
 
 void Connection::_buildAndPrepareResponse()
 {
-    // Build the response and store in output buffer
-    _outputBuffer = _response.build();
+    // Queue the response segments
+    _queueResponse();
     
     // Log the response
     _logResponseDetails();
@@ -535,18 +850,51 @@ void Connection::_buildAndPrepareResponse()
     _transitionToSendingResponse();
 }
 
+void Connection::_queueResponse()
+{
+    // In-memory bodies (directory listings, short CGI output) are compressed here
+    if (_body.empty() && _gzipFd < 0 && _response.getStatusCode() == HTTP_STATUS_OK &&
+        !_response.getBody().empty() && !_response.getHeaders().contains(Headers::CONTENT_ENCODING)) {
+        int level = _gzipLevelFor(_findLocation(_request.getPath()), _response.getHeaders().getContentType(),
+                                  _response.getBody().size());
+        if (level > 0) {
+            std::string contentType = _response.getHeaders().getContentType();
+            _setGzippedBody(_response.getBody(), contentType, level);
+        }
+    }
+    
+    // Header block first, then the body either as prepared segments
+    // (file ranges) or straight from the response object
+    _response.serializeHeaders(_headerBuffer);
+    _output.append(_headerBuffer);
+    _headerBytes = _headerBuffer.size();
+    _logPending = true;
+    if (!_body.empty()) {
+        _output.splice(_body);
+    } else {
+        _output.append(_response.getBody());
+    }
+    
+    // A file compressed on the fly follows as it is read, a large listing as it is rendered
+    if (_gzipFd >= 0) {
+        _pumpGzipFile();
+    } else if (_listing) {
+        _pumpListing();
+    }
+}
+
 void Connection::_logResponseDetails()
 {
-    DebugLogger::logResponse(_response.getStatusCode(), _response.getHeaders().toString());
+    if (LOG_DEBUG_ENABLED()) {
+        DebugLogger::logResponse(_response.getStatusCode(), _response.getHeaders().toString());
+    }
     
-    std::stringstream ss;
-    ss << _response.getBody().size();
-    DebugLogger::log("Response body length: " + ss.str());
+    LOG_DEBUG("Response body length: " << _response.getBody().size());
 }
 
 void Connection::_processRequest()
 {
-    DebugLogger::log("Processing request: " + _request.getMethodStr() + " " + _request.getPath());
+    LOG_DEBUG("Processing request: " << _request.getMethodStr() << " " << _request.getPath());
     
     LocationConfig* location = _findAndValidateLocation();
     if (!location) {
@@ -568,13 +916,12 @@ LocationConfig* Connection::_findAndValidateLocation()
 {
     LocationConfig* location = _findLocation(_request.getPath());
     if (!location) {
-        DebugLogger::logError("No location block found for path: " + _request.getPath());
+        LOG_INFO("No location block found for path: " << _request.getPath());
         _handleError(HTTP_STATUS_NOT_FOUND);
         return NULL;
     }
     
-    DebugLogger::log("Found location block: " + location->getPath() + 
-                   " with root: " + location->getRoot());
+    LOG_DEBUG("Found location block: " << location->getPath() << " with root: " << location->getRoot());
     return location;
 }
 
@@ -592,24 +939,24 @@ bool Connection::_validateRequestMethod(const LocationConfig& location)
         }
     }
     
-    DebugLogger::logError("Method " + methodStr + " not allowed for this location");
+    LOG_INFO("Method " << methodStr << " not allowed for this location");
     _handleError(HTTP_STATUS_METHOD_NOT_ALLOWED);
     return false;
 }
 
 void Connection::_logAllowedMethods(const std::vector<std::string>& allowedMethods)
 {
-    DebugLogger::log("Allowed methods for this location:");
+    LOG_DEBUG("Allowed methods for this location:");
     for (std::vector<std::string>::const_iterator it = allowedMethods.begin();
          it != allowedMethods.end(); ++it) {
-        DebugLogger::log(" - " + *it);
+        LOG_DEBUG(" - " << *it);
     }
 }
 
 bool Connection::_checkForRedirection(const LocationConfig& location)
 {
     if (!location.getRedirection().empty()) {
-        DebugLogger::log("This location has a redirection: " + location.getRedirection());
+        LOG_DEBUG("This location has a redirection: " << location.getRedirection());
         _handleRedirection(location);
         return true;
     }
@@ -621,38 +968,38 @@ void Connection::_routeRequestByMethod()
     Request::Method method = _request.getMethod();
     std::string methodStr = _request.getMethodStr();
     
-    std::cout << "Request method is: " << method << std::endl;
+    LOG_DEBUG("Request method is: " << method);
     
     switch (method) {
         case Request::GET:
-            DebugLogger::log("Handling GET request");
+            LOG_DEBUG("Handling GET request");
             _handleStaticFile();
             break;
             
         case Request::POST:
-            DebugLogger::log("Handling POST request");
+            LOG_DEBUG("Handling POST request");
             _handlePostRequest();
             break;
             
         case Request::DELETE:
-            DebugLogger::log("Handling DELETE request");
+            LOG_DEBUG("Handling DELETE request");
             _handleDeleteRequest();
             break;
             
         default:
-            DebugLogger::logError("Unexpected error caused by unknown method: " + methodStr);
+            LOG_ERROR("Unexpected error caused by unknown method: " << methodStr);
             _handleError(HTTP_STATUS_NOT_IMPLEMENTED);
             break;
     }
 }
 
-bool Connection::_needsTrailingSlashRedirect(const std::string& fsPath, const std::string& requestPath)
+bool Connection::_needsTrailingSlashRedirect(const struct stat& info, const std::string& requestPath)
 {
     // If path doesn't end with slash
     if (requestPath.empty() || requestPath[requestPath.length() - 1] != '/') {
         // Check if it's a directory
         
-        return FileUtils::isDirectory(fsPath);
+        return S_ISDIR(info.st_mode);
     }
     return false;
 }
@@ -664,7 +1011,7 @@ void Connection::_redirectToPathWithSlash(const std::string& requestPath)
         redirectUrl += '/';
     }
     
-    DebugLogger::log("Redirecting to add trailing slash: " + redirectUrl);
+    LOG_DEBUG("Redirecting to add trailing slash: " << redirectUrl);
     _response.redirect(redirectUrl, HTTP_STATUS_MOVED_PERMANENTLY);
 }
 
@@ -672,26 +1019,27 @@ bool Connection::_tryServeIndexFile(const std::string& dirPath, const LocationCo
 {
     std::string indexFile = location.getIndex();
     if (indexFile.empty()) {
-        DebugLogger::log("No index file configured for this location");
+        LOG_DEBUG("No index file configured for this location");
         return false;
     }
     
     std::string indexPath = FileUtils::ensureTrailingSlash(dirPath) + indexFile;
-    DebugLogger::log("Trying index file: " + indexPath);
+    LOG_DEBUG("Trying index file: " << indexPath);
     
-    if (FileUtils::isFile(indexPath)) {
-        DebugLogger::log("Index file exists, serving: " + indexPath);
-        _serveFile(indexPath);
+    struct stat info;
+    if (stat(indexPath.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+        LOG_DEBUG("Index file exists, serving: " << indexPath);
+        _serveFile(indexPath, info);
         return true;
     }
     
-    DebugLogger::logError("Index file not found: " + indexPath);
+    LOG_INFO("Index file not found: " << indexPath);
     return false;
 }
 
 void Connection::_handleStaticFile()
 {
-    DebugLogger::log("Handling static file for path: " + _request.getPath());
+    LOG_DEBUG("Handling static file for path: " << _request.getPath());
     
     // Get the request path
     std::string requestPath = _request.getPath();
@@ -699,32 +1047,56 @@ void Connection::_handleStaticFile()
     // Find the appropriate location for this path
     LocationConfig* location = _findLocation(requestPath);
     if (!location) {
-        DebugLogger::logError("No location block found for path: " + requestPath);
+        LOG_INFO("No location block found for path: " << requestPath);
         _handleError(HTTP_STATUS_NOT_FOUND);
         return;
     }
     
     // Resolve the path to a file system path
     std::string fsPath = FileUtils::resolvePath(requestPath, *location);
-    DebugLogger::log("Resolved filesystem path: " + fsPath);
+    LOG_DEBUG("Resolved filesystem path: " << fsPath);
+    
+    // Cached files and listings skip every filesystem check below
+    if (_fileCache) {
+        FileCache::Lock lock(*_fileCache);
+        // Unless a .gz sidecar may stand in for the file
+        const FileCache::Entry* entry = location->getGzipStatic() ? NULL : _fileCache->get(fsPath);
+        if (entry) {
+            _serveCachedFile(*entry, entry->contentType,
+                             _gzipLevelFor(location, entry->contentType, entry->content.size()));
+            return;
+        }
+        if (!requestPath.empty() && requestPath[requestPath.length() - 1] == '/' &&
+            _request.getQueryString().empty() &&
+            (entry = _fileCache->get(listingKey(requestPath))) != NULL) {
+            LOG_DEBUG("Serving directory listing from cache: " << fsPath);
+            _response.setStatusCode(HTTP_STATUS_OK);
+            _response.setBody(entry->content, entry->contentType);
+            return;
+        }
+    }
+    
+    // A single stat() answers every check below and validates the file
+    struct stat info;
+    bool exists = (stat(fsPath.c_str(), &info) == 0);
     
     // Step 1: Check if this needs a trailing slash redirect (directory without slash)
-    if (_needsTrailingSlashRedirect(fsPath, requestPath)) {
+    if (exists && _needsTrailingSlashRedirect(info, requestPath)) {
         _redirectToPathWithSlash(requestPath);
         return;
     }
     
     // Step 2: Check if the path exists
-    if (FileUtils::isDirectory(fsPath)) {
+    if (exists && S_ISDIR(info.st_mode)) {
         // Path is a directory with proper trailing slash
-        DebugLogger::log("Path is a directory: " + fsPath);
-        _handleDirectory(fsPath, requestPath, *location);
+        LOG_DEBUG("Path is a directory: " << fsPath);
+        _handleDirectory(fsPath, requestPath, info, *location);
         return;
     } 
-    else if (FileUtils::isFile(fsPath)) {
+    else if (exists && S_ISREG(info.st_mode)) {
         // Path is a regular file
-        DebugLogger::log("Serving regular file: " + fsPath);
-        _serveFile(fsPath);
+        LOG_DEBUG("Serving regular file: " << fsPath);
+        _serveFile(fsPath, info);
         return;
     }
     
@@ -736,7 +1108,7 @@ void Connection::_handleStaticFile()
     }
     
     // If we get here, file not found
-    DebugLogger::logError("File not found: " + fsPath);
+    LOG_INFO("File not found: " << fsPath);
     _handleError(HTTP_STATUS_NOT_FOUND);
 }
 
@@ -763,7 +1135,7 @@ void Connection::_handleDefault()
 }
 
 LocationConfig* Connection::_findLocation(const std::string& requestPath) {
-    DebugLogger::log("Finding location for path: " + requestPath);
+    LOG_DEBUG("Finding location for path: " << requestPath);
     
     const std::vector<LocationConfig*>& locations = _serverConfig->getLocations();
     
@@ -771,7 +1143,7 @@ LocationConfig* Connection::_findLocation(const std::string& requestPath) {
     for (std::vector<LocationConfig*>::const_iterator it = locations.begin(); 
          it != locations.end(); ++it) {
         if ((*it)->getPath() == requestPath) {
-            DebugLogger::log("Found exact match location: " + (*it)->getPath());
+            LOG_DEBUG("Found exact match location: " << (*it)->getPath());
             return *it;
         }
     }
@@ -784,14 +1156,14 @@ LocationConfig* Connection::_findLocation(const std::string& requestPath) {
          it != locations.end(); ++it) {
         const std::string& locationPath = (*it)->getPath();
         
-        DebugLogger::log("Checking if location '" + locationPath + "' matches request '" + requestPath + "'");
+        LOG_DEBUG("Checking if location '" << locationPath << "' matches request '" << requestPath << "'");
         
         // Special case for root location - lowest priority
         if (locationPath == "/") {
             if (bestMatch == NULL) { // Only use root if we have no other match
                 bestMatch = *it;
                 bestMatchLength = 1;
-                DebugLogger::log("Root location '/' is fallback match");
+                LOG_DEBUG("Root location '/' is fallback match");
             }
             continue; // Skip the rest of the loop for root location
         }
@@ -807,14 +1179,14 @@ LocationConfig* Connection::_findLocation(const std::string& requestPath) {
             if (requestPath == locationNoSlash) {
                 isMatch = true;
                 matchLength = locationPath.length(); // Use full length for prioritization
-                DebugLogger::log("Match: Request matches location without trailing slash");
+                LOG_DEBUG("Match: Request matches location without trailing slash");
             }
             // Case 1B: Request starts with location (including slash)
             // e.g., location "/uploads/" and request "/uploads/file.txt"
             else if (requestPath.find(locationPath) == 0) {
                 isMatch = true;
                 matchLength = locationPath.length();
-                DebugLogger::log("Match: Request starts with location (including slash)");
+                LOG_DEBUG("Match: Request starts with location (including slash)");
             }
         }
         // CASE 2: Location without trailing slash
@@ -824,7 +1196,7 @@ LocationConfig* Connection::_findLocation(const std::string& requestPath) {
             if (requestPath == locationPath) {
                 isMatch = true;
                 matchLength = locationPath.length();
-                DebugLogger::log("Match: Request exactly matches location");
+                LOG_DEBUG("Match: Request exactly matches location");
             }
             // Case 2B: Request starts with location followed by a slash
             // e.g., location "/upload" and request "/upload/file.txt"
@@ -833,7 +1205,7 @@ LocationConfig* Connection::_findLocation(const std::string& requestPath) {
                      requestPath[locationPath.length()] == '/') {
                 isMatch = true;
                 matchLength = locationPath.length();
-                DebugLogger::log("Match: Request starts with location followed by slash");
+                LOG_DEBUG("Match: Request starts with location followed by slash");
             }
         }
         
@@ -841,16 +1213,14 @@ LocationConfig* Connection::_findLocation(const std::string& requestPath) {
             bestMatch = *it;
             bestMatchLength = matchLength;
             
-            std::stringstream ss;
-            ss << matchLength;
-            DebugLogger::log("New best match: '" + locationPath + "' (length: " + ss.str() + ")");
+            LOG_DEBUG("New best match: '" << locationPath << "' (length: " << matchLength << ")");
         }
     }
     
     if (bestMatch) {
-        DebugLogger::log("Final best match location: " + bestMatch->getPath());
+        LOG_DEBUG("Final best match location: " << bestMatch->getPath());
     } else {
-        DebugLogger::logError("No matching location found for " + requestPath);
+        LOG_INFO("No matching location found for " << requestPath);
     }
     
     return bestMatch;
@@ -892,9 +1262,9 @@ void Connection::_handleRedirection(const LocationConfig& location)
 }
 
 void Connection::_handleDirectory(const std::string& fsPath, const std::string& requestPath, 
-    const LocationConfig& location)
+    const struct stat& info, const LocationConfig& location)
 {
-    DebugLogger::log("Handling directory: " + fsPath + " for request path: " + requestPath);
+    LOG_DEBUG("Handling directory: " << fsPath << " for request path: " << requestPath);
 
     // Step 1: Ensure request path ends with slash
     if (requestPath[requestPath.length() - 1] != '/') {
@@ -909,47 +1279,69 @@ void Connection::_handleDirectory(const std::string& fsPath, const std::string&
 
     // Step 3: If no index file or autoindex is off, return 403 Forbidden
     if (!location.getAutoIndex()) {
-        DebugLogger::logError("No index file and autoindex is off, returning 403 Forbidden");
+        LOG_INFO("No index file and autoindex is off, returning 403 Forbidden");
         _handleError(HTTP_STATUS_FORBIDDEN);
         return;
     }
 
-    // Step 4: Generate directory listing
-    DebugLogger::log("Generating directory listing for: " + fsPath);
-    std::string listing = FileUtils::generateDirectoryListing(fsPath, requestPath);
-    if (listing.empty()) {
-        DebugLogger::logError("Failed to generate directory listing");
+    // Step 4: Generate directory listing, paginated by ?offset= and ?limit=
+    DirectoryListing::Format format;
+    size_t offset;
+    size_t limit;
+    if (!parseListingQuery(_request, format, offset, limit)) {
+        LOG_INFO("Invalid directory listing query: " << _request.getQueryString());
+        _handleError(HTTP_STATUS_BAD_REQUEST);
+        return;
+    }
+    
+    LOG_DEBUG("Generating directory listing for: " << fsPath);
+    DirectoryListing* directory = new DirectoryListing(requestPath, format, offset, limit);
+    if (!directory->open(fsPath)) {
+        delete directory;
+        LOG_ERROR("Failed to generate directory listing");
+        _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
+        return;
+    }
+    
+    // Too large to hold: rendered as the client reads it
+    if (!directory->isBuffered()) {
+        _streamListing(directory, DirectoryListing::contentType(format), location);
+        return;
+    }
+    
+    std::string listing;
+    while (directory->read(listing, std::string::npos)) {
+    }
+    bool failed = directory->hasFailed();
+    delete directory;
+    if (failed) {
+        LOG_ERROR("Failed to generate directory listing");
         _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
         return;
     }
 
     // Send directory listing
-    DebugLogger::log("Serving directory listing");
+    LOG_DEBUG("Serving directory listing");
     _response.setStatusCode(HTTP_STATUS_OK);
-    _response.setBody(listing, "text/html");
+    _response.setBody(listing, DirectoryListing::contentType(format));
+
+    // Repeat requests are answered from the cache until the directory changes
+    if (_fileCache && _request.getQueryString().empty()) {
+        FileCache::Lock lock(*_fileCache);
+        _fileCache->store(listingKey(requestPath), fsPath, listing, "text/html", info,
+                          location.getFileCacheMaxEntry());
+    }
 }
 
-void Connection::_serveFile(const std::string& fsPath)
+void Connection::_serveFile(const std::string& fsPath, const struct stat& info)
 {
-    DebugLogger::log("Serving file: " + fsPath);
-    
-    // Get the file contents
-    std::string contents = FileUtils::getFileContents(fsPath);
-    if (contents.empty()) {
-        DebugLogger::logError("Failed to read file contents: " + fsPath);
-        _handleError(HTTP_STATUS_NOT_FOUND);
-        return;
-    }
-    
-    std::stringstream ss;
-    ss << contents.size();
-    DebugLogger::log("Read file contents, size: " + ss.str());
+    LOG_DEBUG("Serving file: " << fsPath);
     
     // Get the file extension and MIME type
     std::string extension = FileUtils::getFileExtension(fsPath);
     std::string mimeType = FileUtils::getMimeType(extension);
     
-    DebugLogger::log("File extension: " + extension + ", MIME type: " + mimeType);
+    LOG_DEBUG("File extension: " << extension << ", MIME type: " << mimeType);
     
     // Check if this is a CGI file
     LocationConfig* location = _findLocation(_request.getPath());
@@ -964,88 +1356,928 @@ void Connection::_serveFile(const std::string& fsPath)
             }
             
             if (extension == cgiExt) {
-                DebugLogger::log("File is a CGI script, extension: " + extension);
+                LOG_DEBUG("File is a CGI script, extension: " << extension);
                 _handleCgi(fsPath, *location);
                 return;
             }
         }
     }
     
-    // Set the response
-    DebugLogger::log("Setting response with file contents");
-    _response.setStatusCode(HTTP_STATUS_OK);
-    _response.setBody(contents, mimeType);
-}
-
-void Connection::_handleCgi(const std::string& fsPath, const LocationConfig& location)
-{
-    // Get file extension
-    std::string extension = "";
-    size_t dotPos = fsPath.find_last_of('.');
-    if (dotPos != std::string::npos) {
-        extension = fsPath.substr(dotPos);
+    // A precompressed sidecar (gzip_static) stands in for the file when the client accepts it
+    if (location && location->getGzipStatic()) {
+        _response.setHeader(Headers::VARY, "Accept-Encoding");
+        std::string gzipPath = fsPath + ".gz";
+        struct stat gzipInfo;
+        if (GzipEncoder::isAccepted(_request.getHeaders().get(Headers::ACCEPT_ENCODING)) &&
+            stat(gzipPath.c_str(), &gzipInfo) == 0 && S_ISREG(gzipInfo.st_mode)) {
+            LOG_DEBUG("Serving precompressed file: " << gzipPath);
+            _response.setHeader(Headers::CONTENT_ENCODING, "gzip");
+            _serveFileContent(gzipPath, gzipInfo, mimeType, location, 0);
+            return;
+        }
     }
     
-    // Check if we have an interpreter for this extension
-    std::string interpreter = location.getInterpreterForExtension(extension);
-    if (interpreter.empty()) {
-        // No interpreter found - fall back to legacy behavior
-        if (location.getCgiPath().empty()) {
-            DebugLogger::logError("No CGI interpreter found for extension: " + extension);
-            _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    _serveFileContent(fsPath, info, mimeType, location,
+                      _gzipLevelFor(location, mimeType, static_cast<size_t>(info.st_size)));
+}
+
+/**
+ * @brief Answer with the bytes of a regular file
+ * 
+ * @param fsPath File to send
+ * @param info Its metadata
+ * @param mimeType Content-Type of the response
+ * @param location Location serving it, NULL to bypass the file cache
+ * @param gzipLevel Compression level when compressing on the fly, 0 to send the file as it is
+ */
+void Connection::_serveFileContent(const std::string& fsPath, const struct stat& info,
+                                   const std::string& mimeType, const LocationConfig* location, int gzipLevel)
+{
+    // Small hot files are served from memory
+    bool cacheable = _fileCache && location;
+    if (cacheable) {
+        FileCache::Lock lock(*_fileCache);
+        const FileCache::Entry* entry = _fileCache->get(fsPath);
+        if (entry) {
+            _serveCachedFile(*entry, mimeType, gzipLevel);
             return;
-        } else {
-            interpreter = location.getCgiPath();
-            DebugLogger::log("Using legacy CGI path: " + interpreter);
         }
-    } else {
-        DebugLogger::log("Using interpreter from cgi_handler: " + interpreter + " for " + extension);
     }
     
-    // Create CGI handler
-    CGIHandler cgiHandler;
+    // Revalidations are answered from the stat() alone, the file stays closed
+    std::string etag;
+    std::string lastModified;
+    Validators::appendETag(etag, info);
+    if (gzipLevel > 0) {
+        appendGzipTag(etag);
+    }
+    Validators::appendLastModified(lastModified, info);
+    if (_setValidators(etag, lastModified, info.st_mtime)) {
+        return;
+    }
     
-    // Execute CGI script
-    if (cgiHandler.executeCGI(_request, fsPath, location, _response)) {
-        // CGI execution completed (may have errors but produced a response)
-        if (cgiHandler.hasExecutionError()) {
-            // CGI executed but with errors - check if we got a response body
-            if (_response.getBody().empty()) {
-                // No content produced, return 500 error
-                DebugLogger::logError("CGI execution error with no content produced: " + fsPath);
-                _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
-            } else {
-                // We got content despite errors, use the response as is
-                std::stringstream ss;
-                ss << "CGI execution completed with errors (exit code: " 
-                   << cgiHandler.getExitStatus() 
-                   << ") but produced content: " << fsPath;
-                DebugLogger::logError(ss.str());
-                
-                // The response has already been set by executeCGI
-                // Just log that we're using it despite errors
-                DebugLogger::log("Using CGI output despite execution errors");
-            }
-        } else {
-            // Successful execution
-            DebugLogger::log("CGI execution successful for: " + fsPath);
+    // A cache miss that needs the bytes loads the file for the next requests
+    if (cacheable) {
+        FileCache::Lock lock(*_fileCache);
+        const FileCache::Entry* entry = _fileCache->load(fsPath, location->getFileCacheMaxEntry());
+        if (entry) {
+            _serveCachedFile(*entry, mimeType, gzipLevel);
+            return;
         }
-    } else {
-        // CGI execution failed completely
-        DebugLogger::logError("CGI execution failed for: " + fsPath);
-        _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
     }
-}
-
-void Connection::_handlePostRequest()
-{
-    // Get the request path
-    std::string requestPath = _request.getPath();
     
-    // Find the appropriate location for this path
-    LocationConfig* location = _findLocation(requestPath);
-    if (!location) {
-        _handleError(HTTP_STATUS_NOT_FOUND);
+    // Large files are compressed as the client reads them
+    if (gzipLevel > 0 && static_cast<size_t>(info.st_size) >= SENDFILE_MIN_SIZE) {
+        if (!_streamGzipFile(fsPath, mimeType, gzipLevel)) {
+            LOG_ERROR("Failed to open file: " << fsPath);
+            _handleError(HTTP_STATUS_NOT_FOUND);
+        }
+        return;
+    }
+    
+    // Large files go out with sendfile(), only the headers are built here
+    if (gzipLevel == 0 && _serveFileWithSendfile(fsPath, mimeType, info)) {
+        return;
+    }
+    
+    // Get the file contents
+    std::string contents = FileUtils::getFileContents(fsPath);
+    if (contents.empty()) {
+        LOG_ERROR("Failed to read file contents: " << fsPath);
+        _handleError(HTTP_STATUS_NOT_FOUND);
+        return;
+    }
+    
+    LOG_DEBUG("Read file contents, size: " << contents.size());
+    
+    if (gzipLevel > 0) {
+        _setGzippedBody(contents, mimeType, gzipLevel);
+        return;
+    }
+    
+    // Set the response
+    LOG_DEBUG("Setting response with file contents");
+    _response.setStatusCode(HTTP_STATUS_OK);
+    _response.setBody(contents, mimeType);
+}
+
+bool Connection::_serveFileWithSendfile(const std::string& fsPath, const std::string& mimeType,
+                                        const struct stat& info)
+{
+#ifdef __linux__
+    int fd = ::open(fsPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    
+    // Replaced or rewritten since it was validated: don't vouch for these bytes
+    if (st.st_ino != info.st_ino || st.st_size != info.st_size || st.st_mtime != info.st_mtime) {
+        _response.getHeaders().remove(Headers::ETAG);
+        _response.getHeaders().remove(Headers::LAST_MODIFIED);
+    }
+    
+    // Ranges are sent from the file whatever its size
+    _response.setHeader(Headers::ACCEPT_RANGES, "bytes");
+    ByteRanges::Result ranges = _parseRanges(st);
+    if (ranges == ByteRanges::RANGES_UNSATISFIABLE) {
+        ::close(fd);
+        _rejectRanges(size);
+        return true;
+    }
+    if (ranges == ByteRanges::RANGES_OK) {
+        _queueRanges(NULL, fd, size, mimeType);
+        return true;
+    }
+    
+    // Small files are cheaper to send together with the headers
+    if (size < SENDFILE_MIN_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    
+    _body.clear();
+    _body.appendFile(fd, 0, size, true);
+    
+    LOG_DEBUG("Sending file with sendfile(), size: " << size);
+    
+    _response.setStatusCode(HTTP_STATUS_OK);
+    _response.setContentType(mimeType);
+    _response.setContentLength(size);
+    return true;
+#else
+    (void)fsPath;
+    (void)mimeType;
+    (void)info;
+    return false;
+#endif
+}
+
+/**
+ * @brief Answer with a file held in the cache
+ * 
+ * @param entry Cached file
+ * @param contentType Content-Type of the response (a .gz sidecar keeps its original file's)
+ * @param gzipLevel Compression level when compressing on the fly, 0 to send the file as it is
+ */
+void Connection::_serveCachedFile(const FileCache::Entry& entry, const std::string& contentType, int gzipLevel)
+{
+    LOG_DEBUG("Serving file from cache: " << entry.path);
+    
+    if (gzipLevel > 0 && entry.gzipLevel == gzipLevel) {
+        if (!_setValidators(entry.gzipEtag, entry.lastModified, entry.info.st_mtime)) {
+            _setCompressedBody(entry.gzipContent, contentType);
+        }
+        return;
+    }
+    if (gzipLevel > 0) {
+        std::string etag = entry.etag;
+        appendGzipTag(etag);
+        if (!_setValidators(etag, entry.lastModified, entry.info.st_mtime)) {
+            _setGzippedBody(entry.content, contentType, gzipLevel);
+            // The response holds its own copy, the next hits send the stored bytes
+            _fileCache->storeGzip(entry, gzipLevel, _gzipBuffer, etag);
+        }
+        return;
+    }
+    
+    if (_setValidators(entry.etag, entry.lastModified, entry.info.st_mtime)) {
+        return;
+    }
+    
+    _response.setHeader(Headers::ACCEPT_RANGES, "bytes");
+    ByteRanges::Result ranges = _parseRanges(entry.info);
+    if (ranges == ByteRanges::RANGES_UNSATISFIABLE) {
+        _rejectRanges(entry.content.size());
+        return;
+    }
+    if (ranges == ByteRanges::RANGES_OK) {
+        _queueRanges(&entry.content, -1, entry.content.size(), contentType);
+        return;
+    }
+    
+    // Header values were formatted when the entry was loaded
+    _response.setStatusCode(HTTP_STATUS_OK);
+    _response.setHeader(Headers::CONTENT_TYPE, contentType);
+    _response.setHeader(Headers::CONTENT_LENGTH, entry.contentLength);
+    _body.clear();
+    _body.append(entry.content);
+}
+
+/**
+ * @brief Decide whether a response body is compressed on the fly
+ * 
+ * The location must enable gzip for this Content-Type and the body must
+ * reach gzip_min_length. Vary is added whenever the answer then depends
+ * on Accept-Encoding. Range requests are served from the file as it is.
+ * 
+ * @param location Location of the request, NULL if none
+ * @param contentType Content-Type of the body
+ * @param length Body size, npos if unknown (streamed CGI output)
+ * @return int Compression level, 0 to send the body as it is
+ */
+int Connection::_gzipLevelFor(const LocationConfig* location, const std::string& contentType, size_t length)
+{
+    if (!location || !location->getGzip() || length < location->getGzipMinLength() ||
+        !location->isGzipType(contentType)) {
+        return 0;
+    }
+    
+    _response.setHeader(Headers::VARY, "Accept-Encoding");
+    if (_request.getHeaders().contains(Headers::RANGE) ||
+        !GzipEncoder::isAccepted(_request.getHeaders().get(Headers::ACCEPT_ENCODING))) {
+        return 0;
+    }
+    return location->getGzipCompLevel();
+}
+
+void Connection::_setGzippedBody(const std::string& content, const std::string& contentType, int level)
+{
+    GzipEncoder::compress(content, level, _gzipBuffer);
+    LOG_DEBUG("Compressed body: " << content.size() << " -> " << _gzipBuffer.size() << " bytes");
+    _setCompressedBody(_gzipBuffer, contentType);
+}
+
+void Connection::_setCompressedBody(const std::string& gzipped, const std::string& contentType)
+{
+    _response.setStatusCode(HTTP_STATUS_OK);
+    _response.setHeader(Headers::CONTENT_ENCODING, "gzip");
+    _response.setBody(gzipped, contentType);
+}
+
+/**
+ * @brief Start sending a file compressed as it is read
+ * 
+ * The compressed size is only known at the end, so the body is chunked
+ * (HTTP/1.1) or ended by closing the connection (HTTP/1.0). Slices are
+ * read and compressed by _pumpGzipFile() as the queue drains.
+ * 
+ * @return false if the file cannot be opened
+ */
+bool Connection::_streamGzipFile(const std::string& fsPath, const std::string& mimeType, int level)
+{
+    int fd = ::open(fsPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    
+    _gzip = new GzipEncoder(level);
+    _gzipFd = fd;
+    
+    _response.setStatusCode(HTTP_STATUS_OK);
+    _response.setContentType(mimeType);
+    _response.setHeader(Headers::CONTENT_ENCODING, "gzip");
+    if (_request.getVersion() == "HTTP/1.1") {
+        _response.setHeader(Headers::TRANSFER_ENCODING, "chunked");
+    } else {
+        _response.setHeader(Headers::CONNECTION, "close");
+    }
+    
+    LOG_DEBUG("Compressing file as it is sent: " << fsPath);
+    return true;
+}
+
+/**
+ * @brief Read and compress more of the file being sent
+ * 
+ * Stops once enough is queued or the read budget is spent, but never
+ * leaves the queue empty before the end of the file: the connection is
+ * only written to while something is queued.
+ */
+void Connection::_pumpGzipFile()
+{
+    bool chunked = _response.getHeaders().hasChunkedEncoding();
+    size_t bytesRead = 0;
+    
+    while (_output.empty() || (_output.size() < GZIP_HIGH_WATER && bytesRead < _ioBudget)) {
+        ssize_t n = ::read(_gzipFd, &_readBuffer[0], _readBuffer.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            // Part of the body may be out already, it can only be cut short
+            LOG_ERROR("Failed to read " << _request.getPath() << ": " << strerror(errno));
+            _releaseGzip();
+            _response.setHeader(Headers::CONNECTION, "close");
+            if (_output.empty()) {
+                _state = CLOSED;
+            }
+            return;
+        }
+        
+        _gzipBuffer.clear();
+        if (n == 0) {
+            _gzip->finish(_gzipBuffer);
+            _queueChunk(_gzipBuffer, chunked);
+            if (chunked) {
+                _output.append("0\r\n\r\n");
+            }
+            _releaseGzip();
+            return;
+        }
+        bytesRead += n;
+        _gzip->write(&_readBuffer[0], n, _gzipBuffer);
+        _queueChunk(_gzipBuffer, chunked);
+    }
+}
+
+/**
+ * @brief Start sending a directory listing rendered as it is sent
+ * 
+ * Like a file compressed on the fly, the body is chunked (HTTP/1.1) or
+ * ended by closing the connection (HTTP/1.0), and _pumpListing() renders
+ * the next slices as the queue drains.
+ * 
+ * @param listing Opened listing, owned by the connection from now on
+ */
+void Connection::_streamListing(DirectoryListing* listing, const char* contentType, const LocationConfig& location)
+{
+    _listing = listing;
+    
+    _response.setStatusCode(HTTP_STATUS_OK);
+    _response.setContentType(contentType);
+    int level = _gzipLevelFor(&location, contentType, std::string::npos);
+    if (level > 0) {
+        _gzip = new GzipEncoder(level);
+        _response.setHeader(Headers::CONTENT_ENCODING, "gzip");
+    }
+    if (_request.getVersion() == "HTTP/1.1") {
+        _response.setHeader(Headers::TRANSFER_ENCODING, "chunked");
+    } else {
+        _response.setHeader(Headers::CONNECTION, "close");
+    }
+    
+    LOG_DEBUG("Streaming directory listing: " << _request.getPath());
+}
+
+/**
+ * @brief Render more of the directory listing being sent
+ * 
+ * Same limits as _pumpGzipFile(): enough queued or the budget spent, but
+ * never an empty queue before the end of the listing.
+ */
+void Connection::_pumpListing()
+{
+    bool chunked = _response.getHeaders().hasChunkedEncoding();
+    size_t rendered = 0;
+    
+    while (_output.empty() || (_output.size() < LISTING_HIGH_WATER && rendered < _ioBudget)) {
+        _listingBuffer.clear();
+        bool more = _listing->read(_listingBuffer, _readBuffer.size());
+        rendered += _listingBuffer.size();
+        
+        if (!more && _listing->hasFailed()) {
+            // Part of the body may be out already, it can only be cut short
+            LOG_ERROR("Failed to read directory " << _request.getPath());
+            _releaseListing();
+            _releaseGzip();
+            _response.setHeader(Headers::CONNECTION, "close");
+            if (_output.empty()) {
+                _state = CLOSED;
+            }
+            return;
+        }
+        
+        if (_gzip) {
+            _gzipBuffer.clear();
+            _gzip->write(_listingBuffer.data(), _listingBuffer.size(), _gzipBuffer);
+            if (!more) {
+                _gzip->finish(_gzipBuffer);
+            }
+            _queueChunk(_gzipBuffer, chunked);
+        } else {
+            _queueChunk(_listingBuffer, chunked);
+        }
+        
+        if (!more) {
+            if (chunked) {
+                _output.append("0\r\n\r\n");
+            }
+            _releaseListing();
+            _releaseGzip();
+            return;
+        }
+    }
+}
+
+void Connection::_releaseListing()
+{
+    delete _listing;
+    _listing = NULL;
+}
+
+void Connection::_releaseGzip()
+{
+    delete _gzip;
+    _gzip = NULL;
+    if (_gzipFd >= 0) {
+        ::close(_gzipFd);
+        _gzipFd = -1;
+    }
+}
+
+/**
+ * @brief Set the validators of the file about to be served
+ * 
+ * Adds ETag and Last-Modified, then checks the request's If-None-Match
+ * and If-Modified-Since. A client whose copy is still current gets a 304
+ * without a body.
+ * 
+ * @param etag Entity tag of the file
+ * @param lastModified Last-Modified value of the file
+ * @param mtime Modification time of the file
+ * @return true if a 304 was prepared and nothing else needs to be sent
+ */
+bool Connection::_setValidators(const std::string& etag, const std::string& lastModified, time_t mtime)
+{
+    _response.setHeader(Headers::ETAG, etag);
+    _response.setHeader(Headers::LAST_MODIFIED, lastModified);
+    if (_request.getMethod() != Request::GET ||
+        !Validators::isNotModified(_request.getHeaders(), etag, mtime)) {
+        return false;
+    }
+    
+    LOG_DEBUG("Not modified: " << etag);
+    _body.clear();
+    _response.setStatusCode(HTTP_STATUS_NOT_MODIFIED);
+    return true;
+}
+
+/**
+ * @brief Check which part of a file the request asks for
+ * 
+ * Ranges only apply to a GET whose If-Range, if any, still matches the
+ * file: a client resuming the download of a file changed since gets the
+ * new file in full.
+ * 
+ * @param info Metadata of the file about to be served
+ * @return ByteRanges::Result RANGES_OK with _ranges filled, RANGES_UNSATISFIABLE or RANGES_NONE
+ */
+ByteRanges::Result Connection::_parseRanges(const struct stat& info)
+{
+    const std::string& header = _request.getHeaders().get(Headers::RANGE);
+    if (header.empty() || _request.getMethod() != Request::GET || !_matchesIfRange()) {
+        return ByteRanges::RANGES_NONE;
+    }
+    
+    ByteRanges::Result result = ByteRanges::parse(header, static_cast<size_t>(info.st_size), _ranges);
+    LOG_DEBUG("Range " << header << ": " << (result == ByteRanges::RANGES_OK ? "satisfiable" :
+              result == ByteRanges::RANGES_UNSATISFIABLE ? "unsatisfiable" : "ignored"));
+    return result;
+}
+
+bool Connection::_matchesIfRange()
+{
+    const std::string& validator = _request.getHeaders().get(Headers::IF_RANGE);
+    if (validator.empty()) {
+        return true;
+    }
+    
+    // Compared with the validators already set on the response
+    const Headers& headers = _response.getHeaders();
+    return Validators::matchesIfRange(validator, headers.get(Headers::ETAG),
+                                      headers.get(Headers::LAST_MODIFIED));
+}
+
+/**
+ * @brief Answer with the requested ranges of a file (206)
+ * 
+ * A single range is sent as it is, with a Content-Range header. Several
+ * make a multipart/byteranges body: small part headers between slices of
+ * the file. Either way only the requested bytes are copied (cached file)
+ * or sent from the file with sendfile().
+ * 
+ * @param content Bytes of a cached file, NULL to send from fd
+ * @param fd Open file when content is NULL, owned by the body queue afterwards
+ * @param size File size
+ * @param contentType Content-Type of the file
+ */
+void Connection::_queueRanges(const std::string* content, int fd, size_t size, const std::string& contentType)
+{
+    _body.clear();
+    _response.setStatusCode(HTTP_STATUS_PARTIAL_CONTENT);
+    
+    std::string value;
+    if (_ranges.size() == 1) {
+        ByteRanges::appendContentRange(value, _ranges[0], size);
+        _response.setHeader(Headers::CONTENT_RANGE, value);
+        _response.setHeader(Headers::CONTENT_TYPE, contentType);
+        _response.setContentLength(_ranges[0].length);
+        _queueRange(content, fd, _ranges[0], true);
+        return;
+    }
+    
+    // Unique enough not to appear in the file
+    static __thread unsigned long responses = 0;
+    std::string boundary = "webserv-";
+    StringUtils::appendUnsigned(boundary, static_cast<unsigned long>(TimeUtils::monotonicMs()));
+    boundary += '-';
+    StringUtils::appendUnsigned(boundary, ++responses);
+    
+    size_t length = 0;
+    for (size_t i = 0; i < _ranges.size(); ++i) {
+        value = "\r\n--" + boundary + "\r\nContent-Type: " + contentType + "\r\nContent-Range: ";
+        ByteRanges::appendContentRange(value, _ranges[i], size);
+        value += "\r\n\r\n";
+        _body.append(value);
+        _queueRange(content, fd, _ranges[i], i + 1 == _ranges.size());
+        length += value.size() + _ranges[i].length;
+    }
+    value = "\r\n--" + boundary + "--\r\n";
+    _body.append(value);
+    length += value.size();
+    
+    _response.setHeader(Headers::CONTENT_TYPE, "multipart/byteranges; boundary=" + boundary);
+    _response.setContentLength(length);
+}
+
+void Connection::_queueRange(const std::string* content, int fd, const ByteRanges::Range& range, bool last)
+{
+    if (content) {
+        _body.append(content->substr(range.first, range.length));
+    } else {
+        // The last slice closes the file once it is sent
+        _body.appendFile(fd, static_cast<off_t>(range.first), range.length, last);
+    }
+}
+
+void Connection::_rejectRanges(size_t size)
+{
+    LOG_INFO("Range not satisfiable: " << _request.getHeaders().get(Headers::RANGE));
+    _handleError(HTTP_STATUS_RANGE_NOT_SATISFIABLE);
+    
+    std::string value;
+    ByteRanges::appendUnsatisfiedRange(value, size);
+    _response.setHeader(Headers::CONTENT_RANGE, value);
+}
+
+void Connection::_handleCgi(const std::string& fsPath, const LocationConfig& location)
+{
+    // Get file extension
+    std::string extension = "";
+    size_t dotPos = fsPath.find_last_of('.');
+    if (dotPos != std::string::npos) {
+        extension = fsPath.substr(dotPos);
+    }
+    
+    // Check if we have an interpreter for this extension
+    std::string interpreter = location.getInterpreterForExtension(extension);
+    if (interpreter.empty()) {
+        // No interpreter found - fall back to legacy behavior
+        if (location.getCgiPath().empty()) {
+            LOG_WARN("No CGI interpreter found for extension: " << extension);
+            _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
+            return;
+        } else {
+            interpreter = location.getCgiPath();
+            LOG_DEBUG("Using legacy CGI path: " << interpreter);
+        }
+    } else {
+        LOG_DEBUG("Using interpreter from cgi_handler: " << interpreter << " for " << extension);
+    }
+    
+    // Start the script; its pipes are then driven by the event loop
+    _cgiStart = TimeUtils::monotonicMs();
+    _cgi = new CGIHandler();
+    if (!_cgi->start(_request, fsPath, location)) {
+        LOG_ERROR("CGI execution failed for: " << fsPath);
+        _releaseCgi();
+        _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
+        return;
+    }
+    
+    _state = RUNNING_CGI;
+    
+    if (!_multiplexer) {
+        // No event loop to return to: run the script to completion
+        if (_cgi->run()) {
+            _completeCgi();
+        } else {
+            _abortCgi();
+        }
+        return;
+    }
+    
+    if (!_watchCgiFd(_cgi->getInputFd(), IOMultiplexer::EVENT_WRITE) ||
+        !_watchCgiFd(_cgi->getOutputFd(), IOMultiplexer::EVENT_READ)) {
+        _abortCgi();
+        return;
+    }
+    LOG_DEBUG("CGI started, waiting for output: " << fsPath);
+}
+
+bool Connection::handleCgiEvent(int fd, short events)
+{
+    (void)events;
+    if (!_cgi || fd < 0) {
+        return _state != CLOSED;
+    }
+    
+    _markActivity();
+    
+    if (fd == _cgi->getInputFd()) {
+        // Feed the request body as the pipe drains
+        CGIHandler::IOStatus status = _cgi->writeInput(_ioBudget);
+        if (status == CGIHandler::CGI_IO_ERROR) {
+            _abortCgi();
+        } else if (status == CGIHandler::CGI_IO_DONE) {
+            _multiplexer->removeFd(fd);
+            _cgi->closeInput();
+        }
+    } else if (fd == _cgi->getOutputFd()) {
+        CGIHandler::IOStatus status = _cgi->readOutput(_ioBudget);
+        if (status == CGIHandler::CGI_IO_ERROR) {
+            _failCgi();
+        } else {
+            _relayCgiOutput(status == CGIHandler::CGI_IO_DONE);
+        }
+    } else if (fd == _cgi->getExitFd()) {
+        if (_cgi->checkExit()) {
+            _completeCgi();
+        }
+    }
+    
+    return _state != CLOSED;
+}
+
+bool Connection::_watchCgiFd(int fd, short events)
+{
+    if (fd < 0 || !_multiplexer) {
+        return true;  // Nothing to watch
+    }
+    return _multiplexer->addFd(fd, events, this);
+}
+
+void Connection::_unwatchCgiFds()
+{
+    if (!_cgi || !_multiplexer) {
+        return;
+    }
+    // Must happen before the handler closes them
+    _multiplexer->removeFd(_cgi->getInputFd());
+    _multiplexer->removeFd(_cgi->getOutputFd());
+    _multiplexer->removeFd(_cgi->getExitFd());
+}
+
+/**
+ * @brief Forward script output to the client as it arrives
+ * 
+ * Output that ends before it could be streamed (small, fast scripts) is
+ * answered in one piece with a Content-Length. Otherwise the response
+ * headers go out as soon as the CGI header block is parsed and each
+ * slice of body follows, framed with chunked encoding when the script
+ * gave no Content-Length. Reading pauses while too much is queued.
+ * 
+ * @param eof The script closed its output
+ */
+void Connection::_relayCgiOutput(bool eof)
+{
+    int outputFd = _cgi->getOutputFd();
+    
+    if (!_cgiStreaming) {
+        if (eof) {
+            _multiplexer->removeFd(outputFd);
+            _cgi->closeOutput();
+            _onCgiOutputDone();
+            return;
+        }
+        if (!_cgi->parseHeaders(false)) {
+            return;  // Header block not complete yet
+        }
+        _startCgiStream();
+    }
+    
+    _cgi->takeOutput(_cgiChunk);
+    _queueCgiBody(_cgiChunk);
+    
+    if (eof) {
+        _endCgiStream();
+        return;
+    }
+    
+    // Backpressure: stop reading until the client drains the queue
+    if (_output.size() >= CGI_HIGH_WATER) {
+        _multiplexer->removeFd(outputFd);
+        _cgiPaused = true;
+    }
+}
+
+void Connection::_startCgiStream()
+{
+    _cgi->applyHeaders(_response);
+    
+    size_t contentLength;
+    bool hasLength = _cgi->getContentLength(contentLength);
+    
+    // Compressed output has no known length, it is framed like output without one
+    if (_response.getStatusCode() == HTTP_STATUS_OK && !_response.getHeaders().contains(Headers::CONTENT_ENCODING)) {
+        int level = _gzipLevelFor(_findLocation(_request.getPath()), _response.getHeaders().getContentType(),
+                                  hasLength ? contentLength : std::string::npos);
+        if (level > 0) {
+            _gzip = new GzipEncoder(level);
+            _response.setHeader(Headers::CONTENT_ENCODING, "gzip");
+            _response.getHeaders().remove(Headers::CONTENT_LENGTH);
+        }
+    }
+    
+    if (hasLength && !_gzip) {
+        _response.setContentLength(contentLength);
+        _cgiRemaining = contentLength;
+        _cgiChunked = false;
+    } else if (_request.getVersion() == "HTTP/1.1") {
+        _response.setHeader(Headers::TRANSFER_ENCODING, "chunked");
+        _cgiRemaining = hasLength ? contentLength : std::string::npos;
+        _cgiChunked = true;
+    } else {
+        // HTTP/1.0 has no chunked encoding: closing the connection ends the body
+        _response.setHeader(Headers::CONNECTION, "close");
+        _cgiRemaining = hasLength ? contentLength : std::string::npos;
+        _cgiChunked = false;
+    }
+    
+    _response.serializeHeaders(_headerBuffer);
+    _output.append(_headerBuffer);
+    _headerBytes = _headerBuffer.size();
+    _cgiStreaming = true;
+    
+    if (LOG_DEBUG_ENABLED()) {
+        DebugLogger::logResponse(_response.getStatusCode(), _response.getHeaders().toString());
+    }
+    LOG_DEBUG("Streaming CGI output" << (_cgiChunked ? " (chunked)" : ""));
+    
+    _transitionToSendingResponse();
+}
+
+void Connection::_queueCgiBody(std::string& data)
+{
+    // Never send more than the announced Content-Length
+    if (_cgiRemaining != std::string::npos) {
+        if (data.size() > _cgiRemaining) {
+            data.resize(_cgiRemaining);
+        }
+        _cgiRemaining -= data.size();
+    }
+    if (data.empty()) {
+        return;
+    }
+    
+    // Flushed slice by slice, so the client sees output as the script produces it
+    if (_gzip) {
+        _gzipBuffer.clear();
+        _gzip->write(data.data(), data.size(), _gzipBuffer);
+        _gzip->flush(_gzipBuffer);
+        _queueChunk(_gzipBuffer, _cgiChunked);
+        return;
+    }
+    
+    _queueChunk(data, _cgiChunked);
+}
+
+void Connection::_queueChunk(const std::string& data, bool chunked)
+{
+    if (data.empty()) {
+        return;
+    }
+    
+    if (chunked) {
+        std::stringstream chunkSize;
+        chunkSize << std::hex << data.size() << "\r\n";
+        _output.append(chunkSize.str());
+        _output.append(data);
+        _output.append("\r\n");
+    } else {
+        _output.append(data);
+    }
+}
+
+void Connection::_endCgiStream()
+{
+    if (_gzip) {
+        _gzipBuffer.clear();
+        _gzip->finish(_gzipBuffer);
+        _queueChunk(_gzipBuffer, _cgiChunked);
+    }
+    if (_cgiChunked) {
+        _output.append("0\r\n\r\n");
+    }
+    
+    // Shorter than its Content-Length: only closing tells the client
+    if (_cgiRemaining != std::string::npos && _cgiRemaining > 0) {
+        LOG_WARN("CGI output shorter than its Content-Length: " << _request.getPath());
+        _response.setHeader(Headers::CONNECTION, "close");
+    }
+    
+    // The output is complete, the exit status no longer matters
+    _unwatchCgiFds();
+    _cgi->detach();
+    _releaseCgi();
+    
+    if (_output.empty()) {
+        _handleWriteComplete();
+    }
+}
+
+void Connection::_onCgiOutputDone()
+{
+    // The exit status decides between the output and a 500 when the
+    // script printed nothing, so wait for the exit if it is not in yet
+    if (_cgi->checkExit() || _cgi->getExitFd() < 0) {
+        _completeCgi();
+        return;
+    }
+    if (!_watchCgiFd(_cgi->getExitFd(), IOMultiplexer::EVENT_READ)) {
+        _failCgi();
+    }
+}
+
+void Connection::_completeCgi()
+{
+    _unwatchCgiFds();
+    
+    bool produced = _cgi->finish(_response);
+    bool executionError = _cgi->hasExecutionError();
+    int exitStatus = _cgi->getExitStatus();
+    std::string requestPath = _request.getPath();
+    _releaseCgi();
+    
+    if (produced) {
+        // CGI execution completed (may have errors but produced a response)
+        if (executionError) {
+            // CGI executed but with errors - check if we got a response body
+            if (_response.getBody().empty()) {
+                // No content produced, return 500 error
+                LOG_WARN("CGI execution error with no content produced: " << requestPath);
+                _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
+                return;
+            }
+            // We got content despite errors, use the response as is
+            LOG_WARN("CGI execution completed with errors (exit code: " << exitStatus << ") but produced content: " << requestPath);
+            LOG_DEBUG("Using CGI output despite execution errors");
+        } else {
+            // Successful execution
+            LOG_DEBUG("CGI execution successful for: " << requestPath);
+        }
+        _buildAndPrepareResponse();
+    } else {
+        // CGI execution failed completely
+        LOG_ERROR("CGI execution failed for: " << requestPath);
+        _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    }
+}
+
+void Connection::_abortCgi()
+{
+    LOG_ERROR("CGI I/O failed for: " << _request.getPath());
+    _releaseCgi();
+    _handleError(HTTP_STATUS_INTERNAL_SERVER_ERROR);
+}
+
+void Connection::_failCgi()
+{
+    if (_cgiStreaming) {
+        // Part of the response is out already, it can only be cut short
+        LOG_ERROR("CGI I/O failed for: " << _request.getPath());
+        _releaseCgi();
+        _state = CLOSED;
+    } else {
+        _abortCgi();
+    }
+}
+
+void Connection::_releaseCgi()
+{
+    if (!_cgi) {
+        return;
+    }
+    _unwatchCgiFds();
+    _upstreamMs = static_cast<int64_t>(TimeUtils::monotonicMs() - _cgiStart);
+    // Kills the script if it is still running
+    delete _cgi;
+    _cgi = NULL;
+    
+    _cgiStreaming = false;
+    _cgiChunked = false;
+    _cgiPaused = false;
+    _cgiRemaining = std::string::npos;
+    _cgiChunk.clear();
+    _releaseGzip();
+}
+
+void Connection::_handlePostRequest()
+{
+    // Get the request path
+    std::string requestPath = _request.getPath();
+    
+    // Find the appropriate location for this path
+    LocationConfig* location = _findLocation(requestPath);
+    if (!location) {
+        _handleError(HTTP_STATUS_NOT_FOUND);
         return;
     }
     
@@ -1089,7 +2321,7 @@ bool Connection::_prepareUploadDirectory(const std::string& uploadDir)
     if (FileUtils::isDirectory(uploadDir)) {
         // Check if directory is writable
         if (!FileUtils::isWritable(uploadDir)) {
-            std::cerr << "Upload directory is not writable: " << uploadDir << std::endl;
+            LOG_ERROR("Upload directory is not writable: " << uploadDir);
             return false;
         }
         return true;
@@ -1097,7 +2329,7 @@ bool Connection::_prepareUploadDirectory(const std::string& uploadDir)
     
     // Try to create the directory
     if (!FileUtils::createDirectory(uploadDir)) {
-        std::cerr << "Failed to create upload directory: " << uploadDir << " - " << strerror(errno) << std::endl;
+        LOG_ERROR("Failed to create upload directory: " << uploadDir << " - " << strerror(errno));
         return false;
     }
     
@@ -1151,9 +2383,10 @@ bool Connection::_handleFileUpload(const LocationConfig& location)
         return false;
     }
     
-    // Parse the multipart form data
-    MultipartParser parser(contentType, _request.getBody());
-    if (!parser.parse()) {
+    // Use the parser fed while the body was read, or parse the buffered body
+    MultipartParser buffered(contentType, _request.getBody());
+    MultipartParser& parser = _upload ? *_upload : buffered;
+    if (_upload ? !parser.finish() : !parser.parse()) {
         _handleError(HTTP_STATUS_BAD_REQUEST);
         return false;
     }
@@ -1232,10 +2465,10 @@ bool Connection::_handleFileUpload(const LocationConfig& location)
             client_max_body_size = _serverConfig->getClientMaxBodySize();
 
         // Check file size if a limit is set (non-zero)
-        if (client_max_body_size != 0 && files[i].content.size() > client_max_body_size) {
+        if (client_max_body_size != 0 && files[i].size > client_max_body_size) {
             responseBody << "    <li>\r\n"
                         << "      <strong>Error:</strong> File too large: " << originalFilename << " (" 
-                        << FileUtils::formatFileSize(files[i].content.size()) << " exceeds limit of "
+                        << FileUtils::formatFileSize(files[i].size) << " exceeds limit of "
                         << FileUtils::formatFileSize(client_max_body_size) << ")<br>\r\n"
                         << "    </li>\r\n";
             continue;
@@ -1257,21 +2490,13 @@ bool Connection::_handleFileUpload(const LocationConfig& location)
         
         // ===== ACTUAL FILE STORAGE =====
         
-        // Save the file
-        bool saveSuccess = false;
-        try {
-            std::ofstream fileStream(savePath.c_str(), std::ios::binary);
-            if (fileStream.is_open()) {
-                fileStream.write(files[i].content.c_str(), files[i].content.size());
-                saveSuccess = !fileStream.bad();
-                fileStream.close();
-                
-                // Set appropriate permissions (e.g., 0644)
-                chmod(savePath.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
-            }
-        } catch (const std::exception& e) {
-            saveSuccess = false;
-            std::cerr << "Exception while saving file " << finalFilename << ": " << e.what() << std::endl;
+        // Save the file (a rename when it was spooled to the upload directory)
+        bool saveSuccess = parser.saveFile(i, savePath);
+        if (saveSuccess) {
+            // Set appropriate permissions (e.g., 0644)
+            chmod(savePath.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        } else {
+            LOG_ERROR("Failed to save file " << finalFilename << ": " << strerror(errno));
         }
         
         if (saveSuccess) {
@@ -1283,7 +2508,7 @@ bool Connection::_handleFileUpload(const LocationConfig& location)
                         << "      <strong>Original Filename:</strong> " << originalFilename << "<br>\r\n"
                         << "      <strong>Saved As:</strong> " << finalFilename << "<br>\r\n"
                         << "      <strong>Content Type:</strong> " << files[i].contentType << "<br>\r\n"
-                        << "      <strong>Size:</strong> " << FileUtils::formatFileSize(files[i].content.size()) << "<br>\r\n"
+                        << "      <strong>Size:</strong> " << FileUtils::formatFileSize(files[i].size) << "<br>\r\n"
                         << "    </li>\r\n";
         } else {
             // Failed to write file
@@ -1444,7 +2669,7 @@ void Connection::_handleDeleteRequest()
     // Find the appropriate location for this path
     LocationConfig* location = _findLocation(requestPath);
     if (!location) {
-        std::cout << "DELETE: Location not found for path: " << requestPath << std::endl;
+        LOG_INFO("DELETE: Location not found for path: " << requestPath);
         _handleError(HTTP_STATUS_NOT_FOUND);
         return;
     }
@@ -1461,7 +2686,7 @@ void Connection::_handleDeleteRequest()
     }
     
     if (!deleteAllowed) {
-        std::cout << "DELETE: Method not allowed for path: " << requestPath << std::endl;
+        LOG_INFO("DELETE: Method not allowed for path: " << requestPath);
         _handleError(HTTP_STATUS_METHOD_NOT_ALLOWED);
         return;
     }
@@ -1473,14 +2698,14 @@ void Connection::_handleDeleteRequest()
     
     // Check if the file exists
     if (!FileUtils::fileExists(fsPath)) {
-        std::cout << "DELETE: File not found: " << fsPath << std::endl;
+        LOG_INFO("DELETE: File not found: " << fsPath);
         _handleError(HTTP_STATUS_NOT_FOUND);
         return;
     }
     
     // Check if this is a directory
     if (FileUtils::isDirectory(fsPath)) {
-        std::cout << "DELETE: Cannot delete directory: " << fsPath << std::endl;
+        LOG_INFO("DELETE: Cannot delete directory: " << fsPath);
         _handleError(HTTP_STATUS_FORBIDDEN);
         return;
     }
@@ -1488,14 +2713,14 @@ void Connection::_handleDeleteRequest()
     // Check if the file is outside the location's root directory (security check)
     std::string rootDir = location->getRoot();
     if (!FileUtils::isPathWithinDirectory(fsPath, rootDir)) {
-        std::cout << "DELETE: Path outside root directory: " << fsPath << std::endl;
+        LOG_INFO("DELETE: Path outside root directory: " << fsPath);
         _handleError(HTTP_STATUS_FORBIDDEN);
         return;
     }
     
     // Check if we have permission to delete the file
     if (!FileUtils::isWritable(fsPath)) {
-        std::cout << "DELETE: Permission denied: " << fsPath << std::endl;
+        LOG_INFO("DELETE: Permission denied: " << fsPath);
         _handleError(HTTP_STATUS_FORBIDDEN);
         return;
     }
@@ -1505,7 +2730,7 @@ void Connection::_handleDeleteRequest()
     // Attempt to delete the file
     if (remove(fsPath.c_str()) != 0) {
         // Failed to delete the file
-        std::cout << "DELETE: Failed to delete file: " << fsPath << " - " << strerror(errno) << std::endl;
+        LOG_WARN("DELETE: Failed to delete file: " << fsPath << " - " << strerror(errno));
         
         // Different error responses based on the reason for failure
         if (errno == EACCES || errno == EPERM) {
@@ -1519,7 +2744,7 @@ void Connection::_handleDeleteRequest()
     }
     
     // File deleted successfully
-    std::cout << "DELETE: Successfully deleted file: " << fsPath << std::endl;
+    LOG_INFO("DELETE: Successfully deleted file: " << fsPath);
     
     // Create a simple success response
     std::string responseBody = "<html>\r\n"
@@ -1537,9 +2762,18 @@ void Connection::_handleDeleteRequest()
 
 void Connection::_handleError(int statusCode)
 {
-    std::stringstream ss;
-    ss << statusCode;
-    DebugLogger::log("Handling error, status code: " + ss.str());
+    LOG_DEBUG("Handling error, status code: " << statusCode);
+    
+    // Request bytes left unread would be parsed as the next request
+    if (!_request.isComplete()) {
+        _response.setHeader(Headers::CONNECTION, "close");
+    }
+    
+    // Drop a file body prepared before the error, and its encoding
+    _body.clear();
+    _releaseGzip();
+    _releaseListing();
+    _response.getHeaders().remove(Headers::CONTENT_ENCODING);
     
     // Get error page content
     std::string errorContent = _getErrorPage(statusCode);
@@ -1548,28 +2782,32 @@ void Connection::_handleError(int statusCode)
     _response.setStatusCode(statusCode);
     _response.setBody(errorContent, "text/html");
     
-    std::stringstream sizeStr;
-    sizeStr << errorContent.size();
-    DebugLogger::log("Error page set, content size: " + sizeStr.str());
+    LOG_DEBUG("Error page set, content size: " << errorContent.size());
     
-    // Build the response and store in output buffer
-    _outputBuffer = _response.build();
+    // Inside process() the final response is queued once processing returns
+    if (_state == PROCESSING) {
+        LOG_DEBUG("Error response prepared, queued when processing ends");
+        return;
+    }
+    
+    // Queue the response
+    _queueResponse();
     
     // Log the response
-    DebugLogger::logResponse(_response.getStatusCode(), _response.getHeaders().toString());
+    if (LOG_DEBUG_ENABLED()) {
+        DebugLogger::logResponse(_response.getStatusCode(), _response.getHeaders().toString());
+    }
     
     // Transition to sending response state
     _transitionToSendingResponse();
 
-    DebugLogger::log("Error response prepared and ready to send");
+    LOG_DEBUG("Error response prepared and ready to send");
     
 }
 
 std::string Connection::_getErrorPage(int statusCode)
 {
-    std::stringstream ss;
-    ss << statusCode;
-    DebugLogger::log("Getting error page for status code: " + ss.str());
+    LOG_DEBUG("Getting error page for status code: " << statusCode);
     
     // Check if there is a custom error page configured
     std::map<int, std::string> errorPages = _serverConfig->getErrorPages();
@@ -1578,7 +2816,7 @@ std::string Connection::_getErrorPage(int statusCode)
     if (it != errorPages.end()) {
         // Custom error page configured, try to read it
         std::string path = it->second;
-        DebugLogger::log("Custom error page found: " + path);
+        LOG_DEBUG("Custom error page found: " << path);
         
         // Check if the path starts with a slash, if so, it's relative to server root
         if (!path.empty() && path[0] == '/') {
@@ -1594,25 +2832,25 @@ std::string Connection::_getErrorPage(int statusCode)
                 
                 // Construct full path
                 path = root + relativePath;
-                DebugLogger::log("Resolved error page path: " + path);
+                LOG_DEBUG("Resolved error page path: " << path);
             }
         }
         
         // Try to read the file
         if (FileUtils::fileExists(path)) {
-            DebugLogger::log("Reading custom error page: " + path);
+            LOG_DEBUG("Reading custom error page: " << path);
             std::string content = FileUtils::getFileContents(path);
             if (!content.empty()) {
                 return content;
             }
-            DebugLogger::logError("Failed to read custom error page: " + path);
+            LOG_ERROR("Failed to read custom error page: " << path);
         } else {
-            DebugLogger::logError("Custom error page not found: " + path);
+            LOG_WARN("Custom error page not found: " << path);
         }
     }
     
     // Default error page
-    DebugLogger::log("Using default error page");
+    LOG_DEBUG("Using default error page");
     std::stringstream errorContent;
     errorContent << "<html>\r\n"
                  << "<head><title>Error " << statusCode << "</title></head>\r\n"
@@ -1627,15 +2865,66 @@ std::string Connection::_getErrorPage(int statusCode)
     return errorContent.str();
 }
 
-bool Connection::isTimeout() const
+Connection::TimeoutPhase Connection::getTimeoutPhase() const
 {
-    // Check if the connection has been idle for too long
-    time_t now = time(NULL);
-    return (now - _lastActivity) > CONNECTION_TIMEOUT;
+    switch (_state) {
+        case READING_HEADERS:
+            return _idle ? TIMEOUT_KEEPALIVE : TIMEOUT_HEADER;
+        case READING_BODY:
+            return TIMEOUT_BODY;
+        default:
+            return TIMEOUT_SEND;
+    }
+}
+
+bool Connection::takeActivity()
+{
+    bool activity = _activity;
+    _activity = false;
+    return activity;
+}
+
+TimerWheel::Timer& Connection::getTimer()
+{
+    return _timer;
+}
+
+void Connection::_logAccess()
+{
+    if (!_logPending) {
+        return;
+    }
+    _logPending = false;
+    
+    if (_accessLog) {
+        AccessLog::Entry entry;
+        entry.clientIp = &_clientIp;
+        entry.request = &_request;
+        // Closed before any response was queued: 499, as nginx records it
+        entry.status = _headerBytes > 0 ? _response.getStatusCode() : 499;
+        entry.bytesSent = _bytesSent;
+        entry.headerBytes = _headerBytes;
+        entry.requestTimeMs = _requestStart > 0 ? TimeUtils::monotonicMs() - _requestStart : 0;
+        entry.upstreamTimeMs = _upstreamMs;
+        _accessLog->log(entry, _logLine);
+    }
+    
+    _requestStart = 0;
+    _upstreamMs = -1;
+    _bytesSent = 0;
+    _headerBytes = 0;
 }
 
 void Connection::close()
 {
+    _releaseCgi();
+    _releaseGzip();
+    _releaseListing();
+    // A request cut short (client gone, timeout) is still recorded
+    _logAccess();
+    _releaseUpload();
+    _output.clear();
+    _body.clear();
     if (_clientFd >= 0) {
         ::close(_clientFd);
         _clientFd = -1;
@@ -1658,20 +2947,25 @@ Connection::ConnectionState Connection::getState() const
     return _state;
 }
 
+bool Connection::hasPendingIO() const
+{
+    return _ioPending && _state != CLOSED;
+}
+
 bool Connection::shouldRead() const
 {
     // We should monitor for read events when:
     // - Reading headers
     // - Reading body
-    return (_state == READING_HEADERS || _state == READING_BODY) && _state != CLOSED;
+    // - And the client reads the responses to its pipelined requests
+    return (_state == READING_HEADERS || _state == READING_BODY) && _output.size() < PIPELINE_HIGH_WATER;
 }
 
 bool Connection::shouldWrite() const
 {
     // We should monitor for write events when:
-    // - In SENDING_RESPONSE state
-    // - Have data in the output buffer
-    return _state == SENDING_RESPONSE && !_outputBuffer.empty() && _state != CLOSED;
+    // - Have data in the output buffer, whatever the next request is doing
+    return _state != CLOSED && !_output.empty();
 }
 
 const Request& Connection::getRequest() const
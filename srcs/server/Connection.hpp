@@ -1,16 +1,29 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <ctime>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "../config/parser/ServerConfig.hpp"
+#include "../config/parser/GlobalConfig.hpp"
 #include "../http/Request.hpp"
 #include "../http/Response.hpp"
 #include "../utils/FileUtils.hpp"
+#include "../utils/DirectoryListing.hpp"
 #include "../http/MultipartParser.hpp"
+#include "../http/ByteRanges.hpp"
+#include "../http/Validators.hpp"
+#include "../http/GzipEncoder.hpp"
 #include "../utils/DebugLogger.hpp"
+#include "OutputQueue.hpp"
+#include "FileCache.hpp"
+#include "AccessLog.hpp"
+#include "IOMultiplexer.hpp"
+#include "TimerWheel.hpp"
+
+class CGIHandler;
 
 /**
  * @brief Class to manage an individual client connection
@@ -30,47 +43,189 @@ public:
         READING_HEADERS,  // Reading HTTP headers
         READING_BODY,     // Reading HTTP body
         PROCESSING,       // Processing the request
+        RUNNING_CGI,      // Waiting for a CGI script, its pipes are in the multiplexer
         SENDING_RESPONSE, // Sending response
         CLOSED            // Connection closed
     };
     
+    /**
+     * @brief Which timeout applies, depending on what the connection waits for
+     */
+    enum TimeoutPhase {
+        TIMEOUT_HEADER,    // Request line and headers (client_header_timeout)
+        TIMEOUT_BODY,      // Request body (client_body_timeout)
+        TIMEOUT_SEND,      // Response, including a running CGI script (send_timeout)
+        TIMEOUT_KEEPALIVE, // Idle between two requests (keepalive_timeout)
+        TIMEOUT_PHASES
+    };
+    
 private:
     int _clientFd;                  // Client socket file descriptor
     struct sockaddr_in _clientAddr; // Client address information
     std::string _clientIp;          // Client IP address (for logging)
     ServerConfig* _serverConfig;    // Server configuration to use
+    FileCache* _fileCache;          // Static file cache of the server block, NULL if disabled
+    AccessLog* _accessLog;          // Process access log, NULL if off
+    IOMultiplexer* _multiplexer;    // Event loop that CGI pipes are registered with, NULL runs CGI inline
+    CGIHandler* _cgi;               // Script of the current request while RUNNING_CGI or streaming
+    
+    // CGI output relayed while the script runs (see _relayCgiOutput())
+    bool _cgiStreaming;             // Response headers queued, body follows as it arrives
+    bool _cgiChunked;               // Body framed with chunked transfer-encoding
+    bool _cgiPaused;                // Output pipe unwatched until the socket catches up
+    size_t _cgiRemaining;           // Body bytes still allowed by the script's Content-Length, npos if none
+    std::string _cgiChunk;          // Scratch buffer for one relayed slice
+    
+    // Body compressed on the fly (see _gzipLevelFor())
+    GzipEncoder* _gzip;             // Stream of the streamed file or CGI output, NULL if none
+    int _gzipFd;                    // File read and compressed as the queue drains, -1 if none
+    std::string _gzipBuffer;        // Compressed output scratch buffer
+    
+    DirectoryListing* _listing;     // Large directory listed as the queue drains, NULL if none
+    std::string _listingBuffer;     // Rendered listing scratch buffer
+    
+    MultipartParser* _upload;       // Multipart body parsed as it arrives, NULL unless uploading
+    std::string _uploadChunk;       // Body bytes taken from the request for the parser
     
     std::string _inputBuffer;       // Buffer for incoming data
-    std::string _outputBuffer;      // Buffer for outgoing data
+    OutputQueue _output;            // Queued response segments (headers, body slices, file ranges)
+    std::string _headerBuffer;      // Response header block, serialized in place for every response
+    OutputQueue _body;              // Body segments prepared by a handler, spliced after the headers
+    std::vector<ByteRanges::Range> _ranges;  // Ranges of the file being served, when answering with a 206
+    std::vector<char> _readBuffer;  // recv() scratch buffer, sized by configureIO()
+    
+    // Per-wakeup I/O limits (see configureIO())
+    size_t _ioBudget;               // Max bytes read or written per readData()/writeData() call
+    bool _edgeTriggered;            // Drain until EAGAIN instead of stopping on a short read
+    bool _ioPending;                // Last call stopped on the budget with I/O still possible
+    
+    // Deadline bookkeeping, driven by the event loop (see takeActivity())
+    TimerWheel::Timer _timer;       // Node in the loop's timer wheel
+    bool _activity;                 // I/O progress since the loop last armed _timer
+    bool _idle;                     // Kept alive with no byte of the next request yet
+    
+    // Access log record of the current request (see _logAccess())
+    bool _logPending;               // Request complete or answered, not logged yet
+    uint64_t _requestStart;         // First byte of the request, 0 before it arrives
+    uint64_t _cgiStart;             // Script start, for $upstream_response_time
+    int64_t _upstreamMs;            // Time the script took, -1 if none ran
+    uint64_t _bytesSent;            // Response bytes written so far
+    uint64_t _headerBytes;          // Size of the response header block, 0 until queued
+    size_t _pipelinedBytes;         // Queued bytes of responses already logged (pipelining)
+    std::string _logLine;           // Scratch buffer the record is formatted into
     
-    time_t _lastActivity;           // Time of last activity (for timeout)
     ConnectionState _state;         // Current connection state
     
     // HTTP request and response objects
     Request _request;
     Response _response;
     
-    // Connection timeout in seconds
-    static const time_t CONNECTION_TIMEOUT = 60;
+    // Buffers grown past this size are released when the connection is recycled
+    static const size_t RETAINED_BUFFER_SIZE = 64 * 1024;
+    
+    // Files at least this large are sent with sendfile() instead of being copied into the response
+    static const size_t SENDFILE_MIN_SIZE = 16 * 1024;
+    
+    // Queued CGI output that pauses reading from the script, and the level that resumes it
+    static const size_t CGI_HIGH_WATER = 256 * 1024;
+    static const size_t CGI_LOW_WATER = 64 * 1024;
+    
+    // Same levels for the compressed output of a file gzipped as it is sent
+    static const size_t GZIP_HIGH_WATER = 256 * 1024;
+    static const size_t GZIP_LOW_WATER = 64 * 1024;
+    
+    // And for a directory listing rendered as it is sent
+    static const size_t LISTING_HIGH_WATER = 256 * 1024;
+    static const size_t LISTING_LOW_WATER = 64 * 1024;
+    
+    // Queued output that stops reading and answering pipelined requests,
+    // and the most responses queued behind each other per write
+    static const size_t PIPELINE_HIGH_WATER = 256 * 1024;
+    static const size_t MAX_PIPELINED_RESPONSES = 32;
     
 public:
     /**
-     * @brief Construct a new Connection object
+     * @brief Construct an unused Connection, CLOSED until open()
+     * 
+     * Connections are pooled by ConnectionSlab and recycled with
+     * open()/close() rather than allocated per client.
+     */
+    Connection();
+    
+    /**
+     * @brief Construct a Connection serving a client right away
+     * 
+     * Same as the default constructor followed by open(), for code that
+     * drives a single connection outside of an event loop.
      * 
      * @param clientFd Client socket file descriptor
      * @param clientAddr Client address information
      * @param config Server configuration to use
      */
-    Connection(int clientFd, struct sockaddr_in clientAddr, ServerConfig* config);
+    Connection(int clientFd, const struct sockaddr_in& clientAddr, ServerConfig* config);
     
     /**
      * @brief Destroy the Connection object, close connection if open
      */
     ~Connection();
     
+    /**
+     * @brief Start serving a new client, resetting all per-client state in place
+     * 
+     * @param clientFd Client socket file descriptor
+     * @param clientAddr Client address information
+     * @param config Server configuration to use
+     */
+    void open(int clientFd, const struct sockaddr_in& clientAddr, ServerConfig* config);
+    
+    /**
+     * @brief Set the per-wakeup I/O limits
+     * 
+     * @param readBufferSize Bytes requested per recv() call
+     * @param ioBudget Max bytes transferred per readData()/writeData() call
+     * @param edgeTriggered Whether the socket is registered edge-triggered
+     */
+    void configureIO(size_t readBufferSize, size_t ioBudget, bool edgeTriggered);
+    
+    /**
+     * @brief Set the static file cache used for GET requests
+     * 
+     * @param fileCache Cache shared by the server block, NULL to disable
+     */
+    void setFileCache(FileCache* fileCache);
+    
+    /**
+     * @brief Set the access log requests are recorded in
+     * 
+     * @param accessLog Log shared by the process, NULL to disable
+     */
+    void setAccessLog(AccessLog* accessLog);
+    
+    /**
+     * @brief Set the multiplexer CGI pipes are registered with
+     * 
+     * The pipes carry this connection as their event data; the server
+     * hands their events to handleCgiEvent().
+     * 
+     * @param multiplexer Server multiplexer, NULL to run scripts synchronously
+     */
+    void setMultiplexer(IOMultiplexer* multiplexer);
+    
+    /**
+     * @brief Handle readiness of one of the CGI descriptors
+     * 
+     * @param fd Descriptor reported by the multiplexer
+     * @param events Reported events
+     * @return true if connection is still valid, false if closed
+     */
+    bool handleCgiEvent(int fd, short events);
+    
     /**
      * @brief Read available data from the socket
      * 
+     * Keeps reading until the socket would block, the request stops
+     * accepting data or the I/O budget is spent.
+     * 
      * @return true if connection is still valid, false if closed
      */
     bool readData();
@@ -78,21 +233,51 @@ public:
     /**
      * @brief Write pending data to the socket
      * 
+     * Keeps writing until the socket would block, the response is sent
+     * or the I/O budget is spent.
+     * 
      * @return true if connection is still valid, false if closed
      */
     bool writeData();
     
+    /**
+     * @brief Check if the last read/write stopped on the I/O budget
+     * 
+     * An edge-triggered socket in that situation will not be reported
+     * again by the multiplexer, so the server must call back on its own.
+     * 
+     * @return true if more I/O is possible without waiting
+     */
+    bool hasPendingIO() const;
+    
     /**
      * @brief Process the received request
      */
     void process();
     
     /**
-     * @brief Check if the connection has timed out
+     * @brief Get the timeout that applies in the current state
+     * 
+     * @return TimeoutPhase Phase selecting one of the configured timeouts
+     */
+    TimeoutPhase getTimeoutPhase() const;
+    
+    /**
+     * @brief Check for I/O progress since the last call, and reset the flag
+     * 
+     * Timeouts measure the time between two successive reads or writes, so
+     * the event loop re-arms the deadline whenever this returns true.
+     * 
+     * @return true if data moved (or the state changed) since the last call
+     */
+    bool takeActivity();
+    
+    /**
+     * @brief Get the timer node the event loop arms for this connection
      * 
-     * @return true if connection has timed out, false otherwise
+     * @return TimerWheel::Timer& Timer whose data is this connection
      */
-    bool isTimeout() const;
+    TimerWheel::Timer& getTimer();
     
     /**
      * @brief Close the connection
@@ -154,7 +339,9 @@ private:
     Connection& operator=(const Connection& other);
     
     // Helper methods for activity and state
-    void _updateLastActivity();
+    void _markActivity();
+    void _logAccess();
+    static void _trimBuffer(std::string& buffer);
     
     // Read operation helper methods
     bool _isValidStateForReading() const;
@@ -170,6 +357,9 @@ private:
     void _handle100Continue();
     void _handleBodyAfterHeaders();
     void _attemptImmediateBodyParse();
+    void _beginUpload();
+    void _feedUpload();
+    void _releaseUpload();
     
     // Body processing helper methods
     void _processBodyData();
@@ -201,7 +391,7 @@ private:
 
     // Request processing methods
     void _handleStaticFile();
-    bool _needsTrailingSlashRedirect(const std::string& fsPath, const std::string& requestPath);
+    bool _needsTrailingSlashRedirect(const struct stat& info, const std::string& requestPath);
     void _redirectToPathWithSlash(const std::string& requestPath);
     bool _tryServeIndexFile(const std::string& dirPath, const LocationConfig& location);
 
@@ -212,11 +402,14 @@ private:
 
     // Write operation helper methods
     bool _isValidStateForWriting() const;
-    ssize_t _writeToSocket();
+    ssize_t _writeToSocket(size_t maxBytes);
+    void _queueResponse();
     bool _handleSuccessfulWrite(ssize_t bytesWritten);
     void _logWriteOperation(ssize_t bytesWritten);
     void _handleWriteComplete();
     void _prepareForNextRequest();
+    void _parseBufferedRequest();
+    void _queuePipelinedResponses();
     void _closeAfterResponse();
     bool _handleWriteSocketClosure();
     bool _handleWriteSocketError();
@@ -224,9 +417,42 @@ private:
     // File handling methods
     LocationConfig* _findLocation(const std::string& requestPath);
     void _handleRedirection(const LocationConfig& location);
-    void _handleDirectory(const std::string& fsPath, const std::string& requestPath, const LocationConfig& location);
-    void _serveFile(const std::string& fsPath);
+    void _handleDirectory(const std::string& fsPath, const std::string& requestPath, const struct stat& info,
+                          const LocationConfig& location);
+    void _serveFile(const std::string& fsPath, const struct stat& info);
+    void _serveFileContent(const std::string& fsPath, const struct stat& info,
+                           const std::string& mimeType, const LocationConfig* location, int gzipLevel);
+    bool _serveFileWithSendfile(const std::string& fsPath, const std::string& mimeType,
+                                const struct stat& info);
+    void _serveCachedFile(const FileCache::Entry& entry, const std::string& contentType, int gzipLevel);
+    int _gzipLevelFor(const LocationConfig* location, const std::string& contentType, size_t length);
+    void _setGzippedBody(const std::string& content, const std::string& contentType, int level);
+    void _setCompressedBody(const std::string& gzipped, const std::string& contentType);
+    bool _streamGzipFile(const std::string& fsPath, const std::string& mimeType, int level);
+    void _pumpGzipFile();
+    void _releaseGzip();
+    void _streamListing(DirectoryListing* listing, const char* contentType, const LocationConfig& location);
+    void _pumpListing();
+    void _releaseListing();
+    bool _setValidators(const std::string& etag, const std::string& lastModified, time_t mtime);
+    ByteRanges::Result _parseRanges(const struct stat& info);
+    bool _matchesIfRange();
+    void _queueRanges(const std::string* content, int fd, size_t size, const std::string& contentType);
+    void _queueRange(const std::string* content, int fd, const ByteRanges::Range& range, bool last);
+    void _rejectRanges(size_t size);
     void _handleCgi(const std::string& fsPath, const LocationConfig& location);
+    bool _watchCgiFd(int fd, short events);
+    void _unwatchCgiFds();
+    void _onCgiOutputDone();
+    void _relayCgiOutput(bool eof);
+    void _startCgiStream();
+    void _queueCgiBody(std::string& data);
+    void _queueChunk(const std::string& data, bool chunked);
+    void _endCgiStream();
+    void _completeCgi();
+    void _abortCgi();
+    void _failCgi();
+    void _releaseCgi();
     
     // HTTP method handlers
     void _handlePostRequest();
@@ -0,0 +1,77 @@
+#include "ConnectionSlab.hpp"
+
+ConnectionSlab::ConnectionSlab()
+    : _byFd(), _free(), _chunks(), _count(0)
+{
+}
+
+ConnectionSlab::~ConnectionSlab()
+{
+    // Pooled connections close whatever is still open on destruction
+    for (size_t i = 0; i < _chunks.size(); ++i) {
+        delete[] _chunks[i];
+    }
+}
+
+void ConnectionSlab::_grow()
+{
+    Connection* chunk = new Connection[CHUNK_SIZE];
+    _chunks.push_back(chunk);
+
+    // Handed out in address order
+    for (size_t i = CHUNK_SIZE; i > 0; --i) {
+        _free.push_back(&chunk[i - 1]);
+    }
+}
+
+Connection* ConnectionSlab::acquire(int fd)
+{
+    if (fd < 0) {
+        return NULL;
+    }
+    if (static_cast<size_t>(fd) >= _byFd.size()) {
+        _byFd.resize(fd + 1, NULL);
+    }
+
+    // A descriptor still indexed was not released: reuse its slot
+    if (_byFd[fd] != NULL) {
+        return _byFd[fd];
+    }
+
+    if (_free.empty()) {
+        _grow();
+    }
+    Connection* connection = _free.back();
+    _free.pop_back();
+    _byFd[fd] = connection;
+    ++_count;
+    return connection;
+}
+
+void ConnectionSlab::release(int fd)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _byFd.size() || _byFd[fd] == NULL) {
+        return;
+    }
+    _free.push_back(_byFd[fd]);
+    _byFd[fd] = NULL;
+    --_count;
+}
+
+Connection* ConnectionSlab::get(int fd) const
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _byFd.size()) {
+        return NULL;
+    }
+    return _byFd[fd];
+}
+
+size_t ConnectionSlab::fdLimit() const
+{
+    return _byFd.size();
+}
+
+size_t ConnectionSlab::size() const
+{
+    return _count;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "Connection.hpp"
+
+/**
+ * @brief Pool of Connection objects indexed by client descriptor
+ *
+ * Connections are allocated in chunks and never freed while the slab
+ * lives: a closed connection goes back to a free list and is reset in
+ * place by Connection::open() for the next client, keeping its buffers.
+ * Lookups by descriptor are a vector index, like the multiplexer's own
+ * bookkeeping, so accepting and closing involve no tree and no heap
+ * allocation once the pool is warm.
+ *
+ * Owned and used by a single event loop thread.
+ */
+class ConnectionSlab {
+public:
+    ConnectionSlab();
+
+    /**
+     * @brief Destroy the slab and every pooled connection
+     */
+    ~ConnectionSlab();
+
+    /**
+     * @brief Take a pooled connection and index it by descriptor
+     *
+     * The caller opens it with Connection::open().
+     *
+     * @param fd Client socket descriptor
+     * @return Connection* Pooled connection, NULL if fd is negative
+     */
+    Connection* acquire(int fd);
+
+    /**
+     * @brief Return the connection of a descriptor to the pool
+     *
+     * The connection must already be closed.
+     *
+     * @param fd Client socket descriptor it was acquired for
+     */
+    void release(int fd);
+
+    /**
+     * @brief Get the connection of a descriptor
+     *
+     * @param fd Client socket descriptor
+     * @return Connection* Connection in use, NULL if none
+     */
+    Connection* get(int fd) const;
+
+    /**
+     * @brief One past the highest descriptor ever indexed, to walk every slot
+     */
+    size_t fdLimit() const;
+
+    /**
+     * @brief Number of connections in use
+     */
+    size_t size() const;
+
+private:
+    // Connections allocated at once when the free list runs out
+    static const size_t CHUNK_SIZE = 32;
+
+    std::vector<Connection*> _byFd;     // Connection in use, indexed by descriptor
+    std::vector<Connection*> _free;     // Closed connections ready for reuse
+    std::vector<Connection*> _chunks;   // Arrays allocated with new[], for the destructor
+    size_t _count;                      // Connections in use
+
+    void _grow();
+
+    // Prevent copying
+    ConnectionSlab(const ConnectionSlab& other);
+    ConnectionSlab& operator=(const ConnectionSlab& other);
+};
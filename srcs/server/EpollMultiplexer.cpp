@@ -0,0 +1,104 @@
+#ifdef __linux__
+
+#include "EpollMultiplexer.hpp"
+#include "../utils/DebugLogger.hpp"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+EpollMultiplexer::EpollMultiplexer() : IOMultiplexer(), _epollFd(-1), _events(64) {
+    _epollFd = epoll_create(1);
+    if (_epollFd < 0) {
+        throw std::runtime_error("epoll_create() failed: " + std::string(strerror(errno)));
+    }
+    fcntl(_epollFd, F_SETFD, FD_CLOEXEC);
+}
+
+EpollMultiplexer::~EpollMultiplexer() {
+    if (_epollFd >= 0) {
+        ::close(_epollFd);
+        _epollFd = -1;
+    }
+}
+
+const char* EpollMultiplexer::getName() const {
+    return "epoll";
+}
+
+bool EpollMultiplexer::supportsEdgeTriggered() const {
+    return true;
+}
+
+uint32_t EpollMultiplexer::_toEpoll(short events) {
+    uint32_t result = 0;
+    if (events & EVENT_READ) result |= EPOLLIN;
+    if (events & EVENT_WRITE) result |= EPOLLOUT;
+    if (events & EVENT_EDGE) result |= EPOLLET;
+    return result;
+}
+
+short EpollMultiplexer::_fromEpoll(uint32_t events) {
+    short result = 0;
+    if (events & EPOLLIN) result |= POLLIN;
+    if (events & EPOLLOUT) result |= POLLOUT;
+    if (events & EPOLLERR) result |= POLLERR;
+    if (events & EPOLLHUP) result |= POLLHUP;
+    return result;
+}
+
+bool EpollMultiplexer::_backendAdd(int fd, FdEntry& entry) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = _toEpoll(entry.events);
+    ev.data.fd = fd;
+
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        LOG_ERROR("epoll_ctl(ADD, " << fd << ") failed: " << strerror(errno));
+        return false;
+    }
+
+    // Make sure one epoll_wait() can drain every registered descriptor
+    if (_events.size() < _count + 1) {
+        _events.resize(_events.size() * 2);
+    }
+    return true;
+}
+
+void EpollMultiplexer::_backendModify(int fd, FdEntry& entry) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = _toEpoll(entry.events);
+    ev.data.fd = fd;
+
+    if (epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+        std::cerr << "epoll_ctl(MOD, " << fd << ") failed: " << strerror(errno) << std::endl;
+    }
+}
+
+void EpollMultiplexer::_backendRemove(int fd, FdEntry& entry) {
+    (void)entry;
+    // The event argument is ignored for DEL but must be non-NULL on old kernels
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+
+    // ENOENT/EBADF are expected when the owner already closed the descriptor
+    if (epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, &ev) < 0 && errno != ENOENT && errno != EBADF) {
+        std::cerr << "epoll_ctl(DEL, " << fd << ") failed: " << strerror(errno) << std::endl;
+    }
+}
+
+int EpollMultiplexer::_waitForEvents(int timeout) {
+    int result = epoll_wait(_epollFd, &_events[0], static_cast<int>(_events.size()), timeout);
+
+    for (int i = 0; i < result; ++i) {
+        _markReady(_events[i].data.fd, _fromEpoll(_events[i].events));
+    }
+
+    return result;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <vector>
+#include <sys/epoll.h>
+#include "IOMultiplexer.hpp"
+
+/**
+ * @brief Linux epoll() backend for IOMultiplexer
+ *
+ * The interest list lives in the kernel, so wait() only returns the
+ * descriptors that are actually ready and costs O(ready) instead of
+ * O(registered).
+ */
+class EpollMultiplexer : public IOMultiplexer {
+private:
+    int _epollFd;
+    std::vector<struct epoll_event> _events;   // Output buffer for epoll_wait()
+
+    static uint32_t _toEpoll(short events);
+    static short _fromEpoll(uint32_t events);
+
+public:
+    /**
+     * @brief Construct a new EpollMultiplexer object
+     *
+     * @throw std::runtime_error if epoll_create fails
+     */
+    EpollMultiplexer();
+    ~EpollMultiplexer();
+
+    const char* getName() const;
+    bool supportsEdgeTriggered() const;
+
+protected:
+    bool _backendAdd(int fd, FdEntry& entry);
+    void _backendModify(int fd, FdEntry& entry);
+    void _backendRemove(int fd, FdEntry& entry);
+    int _waitForEvents(int timeout);
+
+private:
+    // Prevent copying
+    EpollMultiplexer(const EpollMultiplexer& other);
+    EpollMultiplexer& operator=(const EpollMultiplexer& other);
+};
+
+#endif
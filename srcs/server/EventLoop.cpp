@@ -0,0 +1,515 @@
+#include "EventLoop.hpp"
+#include "Server.hpp"
+#include "../cgi/CGIHandler.hpp"
+#include "../utils/TimeUtils.hpp"
+#include "../utils/DebugLogger.hpp"
+#include <signal.h>
+
+/**
+ * Constructor: create the multiplexer and the handoff pipe
+ */
+EventLoop::EventLoop(Server& server, const GlobalConfig& globalConfig, size_t id)
+    : _server(server), _globalConfig(globalConfig), _id(id), _multiplexer(NULL), _fdKinds(),
+      _connections(), _accessLog(NULL), _pendingFds(), _retryFds(), _edgeFlag(0), _now(TimeUtils::monotonicMs()),
+      _timers(TIMER_TICK_MS, _now), _expired(), _nextReap(_now + REAP_INTERVAL_MS), _handoffs(),
+      _adopting(), _stopRequested(false), _stopping(false), _thread(), _threadStarted(false)
+{
+    _timeouts[Connection::TIMEOUT_HEADER] = _globalConfig.getClientHeaderTimeout();
+    _timeouts[Connection::TIMEOUT_BODY] = _globalConfig.getClientBodyTimeout();
+    _timeouts[Connection::TIMEOUT_SEND] = _globalConfig.getSendTimeout();
+    _timeouts[Connection::TIMEOUT_KEEPALIVE] = _globalConfig.getKeepaliveTimeout();
+
+    _wakeupPipe[0] = -1;
+    _wakeupPipe[1] = -1;
+    pthread_mutex_init(&_handoffMutex, NULL);
+
+    _multiplexer = IOMultiplexer::create(_globalConfig.getEventBackend());
+
+    // Edge-triggered mode needs a backend that supports it (epoll)
+    if (_globalConfig.isEdgeTriggered()) {
+        if (_multiplexer->supportsEdgeTriggered()) {
+            _edgeFlag = IOMultiplexer::EVENT_EDGE;
+        } else if (_id == 0) {
+            std::cerr << "edge_triggered ignored: not supported by the "
+                      << _multiplexer->getName() << " backend" << std::endl;
+        }
+    }
+
+    if (!FileUtils::createPipe(_wakeupPipe, true)) {
+        std::string error = strerror(errno);
+        delete _multiplexer;
+        pthread_mutex_destroy(&_handoffMutex);
+        throw std::runtime_error("Failed to create event loop wakeup pipe: " + error);
+    }
+    _setFdKind(_wakeupPipe[0], FD_WAKEUP);
+    if (!_multiplexer->addFd(_wakeupPipe[0], IOMultiplexer::EVENT_READ, this)) {
+        ::close(_wakeupPipe[0]);
+        ::close(_wakeupPipe[1]);
+        delete _multiplexer;
+        pthread_mutex_destroy(&_handoffMutex);
+        throw std::runtime_error("Failed to watch event loop wakeup pipe");
+    }
+}
+
+/**
+ * Destructor: close connections and descriptors nobody adopted
+ */
+EventLoop::~EventLoop()
+{
+    join();
+    closeConnections();
+    for (size_t i = 0; i < _handoffs.size(); ++i) {
+        ::close(_handoffs[i].fd);
+    }
+    _multiplexer->removeFd(_wakeupPipe[0]);
+    ::close(_wakeupPipe[0]);
+    ::close(_wakeupPipe[1]);
+    delete _multiplexer;
+    pthread_mutex_destroy(&_handoffMutex);
+}
+
+bool EventLoop::addListenSocket(Socket* socket)
+{
+    if (!_multiplexer->addFd(socket->getSocketFd(), IOMultiplexer::EVENT_READ, socket)) {
+        return false;
+    }
+    _setFdKind(socket->getSocketFd(), FD_LISTEN);
+    return true;
+}
+
+bool EventLoop::addFileCache(FileCache* fileCache)
+{
+    // inotify reports changes to cached files through this descriptor
+    if (!_multiplexer->addFd(fileCache->getNotifyFd(), IOMultiplexer::EVENT_READ, fileCache)) {
+        return false;
+    }
+    _setFdKind(fileCache->getNotifyFd(), FD_FILE_CACHE);
+    return true;
+}
+
+void EventLoop::removeFileCache(FileCache* fileCache)
+{
+    _multiplexer->removeFd(fileCache->getNotifyFd());
+    _setFdKind(fileCache->getNotifyFd(), FD_CLIENT);
+}
+
+/**
+ * Open a pooled Connection for an accepted client and start watching it
+ */
+void EventLoop::setAccessLog(AccessLog* accessLog)
+{
+    _accessLog = accessLog;
+}
+
+void EventLoop::addConnection(int fd, const struct sockaddr_in& address, ServerConfig* config, FileCache* fileCache)
+{
+    // A descriptor number may be reused before an old entry was dropped
+    _setFdKind(fd, FD_CLIENT);
+
+    Connection* connection = _connections.acquire(fd);
+    connection->open(fd, address, config);
+    connection->configureIO(_globalConfig.getReadBufferSize(), _globalConfig.getIoBudget(), _edgeFlag != 0);
+    connection->setMultiplexer(_multiplexer);
+    connection->setFileCache(fileCache);
+    connection->setAccessLog(_accessLog);
+
+    // Add to multiplexer - initially only interested in reading
+    if (!_multiplexer->addFd(fd, IOMultiplexer::EVENT_READ | _edgeFlag, connection)) {
+        connection->close();
+        _connections.release(fd);
+        return;
+    }
+
+    // The request line and headers are due from now on
+    _armTimeout(connection);
+}
+
+/**
+ * Queue an accepted client, waking the loop up if the queue was empty
+ */
+void EventLoop::handOff(int fd, const struct sockaddr_in& address, ServerConfig* config, FileCache* fileCache)
+{
+    Handoff handoff;
+    handoff.fd = fd;
+    handoff.address = address;
+    handoff.config = config;
+    handoff.fileCache = fileCache;
+
+    pthread_mutex_lock(&_handoffMutex);
+    bool wasEmpty = _handoffs.empty();
+    _handoffs.push_back(handoff);
+    pthread_mutex_unlock(&_handoffMutex);
+
+    // One byte per batch: the loop takes the whole queue when it wakes up
+    if (wasEmpty) {
+        _wakeUp();
+    }
+}
+
+void EventLoop::_wakeUp()
+{
+    char byte = 1;
+    // A full pipe already guarantees a wakeup
+    if (write(_wakeupPipe[1], &byte, 1) < 0 && errno != EAGAIN) {
+        std::cerr << "Failed to wake event loop " << _id << ": " << strerror(errno) << std::endl;
+    }
+}
+
+/**
+ * Drain the wakeup pipe and adopt every queued client
+ */
+void EventLoop::_adoptHandoffs()
+{
+    char buffer[64];
+    while (read(_wakeupPipe[0], buffer, sizeof(buffer)) > 0) {
+    }
+
+    pthread_mutex_lock(&_handoffMutex);
+    _adopting.swap(_handoffs);
+    _stopping = _stopRequested;
+    pthread_mutex_unlock(&_handoffMutex);
+
+    for (size_t i = 0; i < _adopting.size(); ++i) {
+        const Handoff& handoff = _adopting[i];
+        addConnection(handoff.fd, handoff.address, handoff.config, handoff.fileCache);
+    }
+    _adopting.clear();
+}
+
+/**
+ * Run the event loop
+ */
+void EventLoop::run()
+{
+    _now = TimeUtils::monotonicMs();
+
+    // Main event loop
+    while (!_shouldStop()) {
+        // Sleep until the nearest deadline; signals interrupt the wait.
+        // Connections that stopped on their I/O budget must not wait at all.
+        int activity = _multiplexer->wait(_pendingFds.empty() ? _waitTimeout() : 0);
+
+        // Every deadline armed during this wakeup counts from here
+        _now = TimeUtils::monotonicMs();
+
+        if (activity < 0) {
+            // Poll error (except when interrupted by a signal)
+            if (errno != EINTR) {
+                std::cerr << _multiplexer->getName() << "() failed: " << strerror(errno) << std::endl;
+                break;
+            }
+            continue;
+        }
+
+        if (activity == 0) {
+            // Timeout - resume budget-limited connections, expire deadlines
+            _handlePendingConnections();
+            _expireTimeouts();
+            continue;
+        }
+
+        // Dispatch straight from the ready records: fd, events and data are
+        // all there, no further multiplexer lookups are needed
+        const std::vector<IOMultiplexer::Event>& events = _multiplexer->getEvents();
+
+        for (size_t i = 0; i < events.size(); ++i) {
+            const IOMultiplexer::Event& event = events[i];
+
+            // Descriptor removed earlier in this iteration
+            if (event.data == NULL) {
+                continue;
+            }
+
+            FdKind kind = _getFdKind(event.fd);
+
+            if (kind == FD_LISTEN) {
+                if (event.events & IOMultiplexer::EVENT_ERROR) {
+                    LOG_ERROR("Error on listening socket: " << event.fd);
+                    // This is serious - we might want to remove this socket
+                } else if (event.events & IOMultiplexer::EVENT_READ) {
+                    // Accept new connection on listening socket
+                    _server.acceptConnection(static_cast<Socket*>(event.data), *this);
+                }
+                continue;
+            }
+
+            if (kind == FD_FILE_CACHE) {
+                // Cached files changed on disk
+                FileCache* cache = static_cast<FileCache*>(event.data);
+                FileCache::Lock lock(*cache);
+                cache->processEvents();
+                continue;
+            }
+
+            if (kind == FD_WAKEUP) {
+                // Clients accepted by another loop
+                _adoptHandoffs();
+                continue;
+            }
+
+            Connection* connection = static_cast<Connection*>(event.data);
+
+            // CGI pipes of a connection carry it as data too
+            if (event.fd != connection->getFd()) {
+                _handleCgiEvent(connection, event.fd, event.events);
+                continue;
+            }
+
+            // Check for errors
+            if (event.events & IOMultiplexer::EVENT_ERROR) {
+                // Client connection error
+                _removeConnection(event.fd, connection);
+                continue;
+            }
+
+            // Handle data from / to an existing connection
+            _handleConnection(connection, event.events);
+        }
+
+        _handlePendingConnections();
+
+        // Close connections whose deadline passed
+        _expireTimeouts();
+    }
+}
+
+/**
+ * Check if run() should return
+ *
+ * Shutdown signals are blocked in loop threads (see start()), so only the
+ * first loop, on the main thread, watches the server's signal flag; it
+ * stops the others through stop() once it returns.
+ */
+bool EventLoop::_shouldStop() const
+{
+    return _stopping || (_id == 0 && _server.isStopping());
+}
+
+void* EventLoop::_threadMain(void* loop)
+{
+    static_cast<EventLoop*>(loop)->run();
+    return NULL;
+}
+
+/**
+ * Start a thread running the loop, with the shutdown signals blocked so
+ * they are delivered to the main thread
+ */
+bool EventLoop::start()
+{
+    sigset_t blocked;
+    sigset_t previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+
+    // The new thread inherits the mask in effect here
+    int error = pthread_create(&_thread, NULL, &EventLoop::_threadMain, this);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (error != 0) {
+        std::cerr << "Failed to start event loop " << _id << ": " << strerror(error) << std::endl;
+        return false;
+    }
+    _threadStarted = true;
+    return true;
+}
+
+void EventLoop::stop()
+{
+    pthread_mutex_lock(&_handoffMutex);
+    _stopRequested = true;
+    pthread_mutex_unlock(&_handoffMutex);
+    _wakeUp();
+}
+
+void EventLoop::join()
+{
+    if (_threadStarted) {
+        pthread_join(_thread, NULL);
+        _threadStarted = false;
+    }
+}
+
+/**
+ * Record what kind of descriptor fd is
+ */
+void EventLoop::_setFdKind(int fd, FdKind kind)
+{
+    if (fd < 0) {
+        return;
+    }
+    if (static_cast<size_t>(fd) >= _fdKinds.size()) {
+        _fdKinds.resize(fd + 1, FD_CLIENT);
+    }
+    _fdKinds[fd] = static_cast<unsigned char>(kind);
+}
+
+/**
+ * Get the kind of a descriptor, FD_CLIENT unless registered otherwise
+ */
+EventLoop::FdKind EventLoop::_getFdKind(int fd) const
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= _fdKinds.size()) {
+        return FD_CLIENT;
+    }
+    return static_cast<FdKind>(_fdKinds[fd]);
+}
+
+/**
+ * Handle activity on a client connection
+ */
+void EventLoop::_handleConnection(Connection* connection, short events)
+{
+    int fd = connection->getFd();
+    bool connectionValid = true;
+
+    // Handle read events
+    if ((events & IOMultiplexer::EVENT_READ) && connection->shouldRead()) {
+        connectionValid = connection->readData();
+    }
+
+    // Handle write events
+    if (connectionValid && (events & IOMultiplexer::EVENT_WRITE) && connection->shouldWrite()) {
+        connectionValid = connection->writeData();
+    }
+
+    // If connection is closed, clean up
+    if (!connectionValid || connection->getState() == Connection::CLOSED) {
+        LOG_DEBUG("Cleaning up connection " << fd);
+        _removeConnection(fd, connection);
+        return;
+    }
+
+    // An edge-triggered socket that still has data won't be reported again
+    if (_edgeFlag && connection->hasPendingIO()) {
+        _pendingFds.push_back(fd);
+    }
+
+    // Update the events we're interested in based on connection state
+    short interest = _edgeFlag;
+    if (connection->shouldRead()) {
+        interest |= IOMultiplexer::EVENT_READ;
+    }
+    if (connection->shouldWrite()) {
+        interest |= IOMultiplexer::EVENT_WRITE;
+    }
+
+    _multiplexer->modifyFd(fd, interest);
+
+    _armTimeout(connection);
+}
+
+/**
+ * Handle activity on one of the CGI descriptors of a connection
+ */
+void EventLoop::_handleCgiEvent(Connection* connection, int fd, short events)
+{
+    connection->handleCgiEvent(fd, events);
+
+    // Once the script is done the response is queued: try to send it
+    // right away, then refresh the socket's monitored events
+    _handleConnection(connection, IOMultiplexer::EVENT_WRITE);
+}
+
+/**
+ * Resume connections that stopped on their I/O budget during the
+ * previous iteration (edge-triggered mode only)
+ */
+void EventLoop::_handlePendingConnections()
+{
+    if (_pendingFds.empty()) {
+        return;
+    }
+
+    // Connections that exhaust their budget again are queued for the next round
+    _retryFds.swap(_pendingFds);
+    for (size_t i = 0; i < _retryFds.size(); ++i) {
+        Connection* connection = _connections.get(_retryFds[i]);
+        if (connection != NULL) {
+            _handleConnection(connection, IOMultiplexer::EVENT_READ | IOMultiplexer::EVENT_WRITE);
+        }
+    }
+    _retryFds.clear();
+}
+
+/**
+ * Restart the connection's deadline after I/O progress
+ *
+ * Timeouts bound the wait between two reads or writes, not the whole
+ * exchange, so a slow but steady transfer never expires. The phase picks
+ * the timeout: headers, body, response or keep-alive idle.
+ */
+void EventLoop::_armTimeout(Connection* connection)
+{
+    if (connection->takeActivity()) {
+        _timers.arm(connection->getTimer(), _now + _timeouts[connection->getTimeoutPhase()]);
+    }
+}
+
+/**
+ * Close connections whose deadline passed, and run periodic housekeeping
+ */
+void EventLoop::_expireTimeouts()
+{
+    // Collect CGI children that outlived their connection
+    if (_now >= _nextReap) {
+        CGIHandler::reapChildren();
+        _nextReap = _now + REAP_INTERVAL_MS;
+    }
+
+    _timers.advance(_now, _expired);
+    for (size_t i = 0; i < _expired.size(); ++i) {
+        Connection* connection = static_cast<Connection*>(_expired[i]);
+        LOG_INFO("Connection timeout: " << connection->getClientIp());
+        _removeConnection(connection->getFd(), connection);
+    }
+    _expired.clear();
+}
+
+/**
+ * Milliseconds the multiplexer may sleep: until the nearest deadline or
+ * the next housekeeping run, whichever comes first
+ */
+int EventLoop::_waitTimeout() const
+{
+    int timeout = _nextReap > _now ? static_cast<int>(_nextReap - _now) : 0;
+    int nearest = _timers.nextTimeout(_now);
+    if (nearest >= 0 && nearest < timeout) {
+        timeout = nearest;
+    }
+    return timeout;
+}
+
+/**
+ * Stop watching a connection, close it and return it to the pool
+ */
+void EventLoop::_removeConnection(int fd, Connection* connection)
+{
+    _timers.cancel(connection->getTimer());
+    _multiplexer->removeFd(fd);
+    connection->close();
+    _connections.release(fd);
+}
+
+void EventLoop::closeConnections()
+{
+    for (size_t fd = 0; fd < _connections.fdLimit(); ++fd) {
+        Connection* connection = _connections.get(static_cast<int>(fd));
+        if (connection != NULL) {
+            _removeConnection(static_cast<int>(fd), connection);
+        }
+    }
+    _pendingFds.clear();
+}
+
+const char* EventLoop::getBackendName() const
+{
+    return _multiplexer->getName();
+}
+
+bool EventLoop::isEdgeTriggered() const
+{
+    return _edgeFlag != 0;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <vector>
+#include <pthread.h>
+#include <netinet/in.h>
+#include "IOMultiplexer.hpp"
+#include "TimerWheel.hpp"
+#include "Connection.hpp"
+#include "ConnectionSlab.hpp"
+#include "FileCache.hpp"
+#include "AccessLog.hpp"
+#include "Socket.hpp"
+#include "../config/parser/ServerConfig.hpp"
+#include "../config/parser/GlobalConfig.hpp"
+
+class Server;
+
+/**
+ * @brief One reactor: a multiplexer and the connections it drives
+ *
+ * Every connection belongs to exactly one loop and is only touched by the
+ * thread running that loop, so Connection objects need no locking. The
+ * Server owns the listening sockets and registers them with its first
+ * loop; accepted descriptors are spread over all loops with handOff().
+ * handOff() and stop() are the only methods other threads may call.
+ *
+ * Configuration objects are shared read-only between loops; the file
+ * caches are shared too, behind FileCache::Lock.
+ *
+ * Connection deadlines live in a timer wheel read against a clock cached
+ * once per wakeup, and the multiplexer sleeps until the nearest one
+ * instead of polling the connection table on a fixed period.
+ */
+class EventLoop {
+private:
+    /**
+     * @brief What a monitored descriptor is, so events dispatch without lookups
+     */
+    enum FdKind {
+        FD_CLIENT = 0,      // Client connection (default)
+        FD_LISTEN,          // Listening socket
+        FD_FILE_CACHE,      // inotify descriptor of a FileCache
+        FD_WAKEUP           // Read end of the handoff pipe
+    };
+
+    /**
+     * @brief An accepted descriptor waiting to be adopted by the loop
+     */
+    struct Handoff {
+        int fd;
+        struct sockaddr_in address;
+        ServerConfig* config;
+        FileCache* fileCache;
+    };
+
+    Server&                                   _server;           // Owner, accepts on listening sockets
+    const GlobalConfig&                       _globalConfig;     // Process-wide settings
+    size_t                                    _id;               // Position among the server's loops
+
+    IOMultiplexer*                            _multiplexer;      // I/O multiplexer (poll or epoll backend)
+    std::vector<unsigned char>                _fdKinds;          // FdKind indexed by fd
+    ConnectionSlab                            _connections;      // Active connections, pooled and indexed by fd
+    AccessLog*                                _accessLog;        // Given to every connection, NULL if off
+    std::vector<int>                          _pendingFds;       // Connections that stopped on their I/O budget
+    std::vector<int>                          _retryFds;         // Scratch list swapped with _pendingFds
+    short                                     _edgeFlag;         // EVENT_EDGE when edge-triggered mode is active
+
+    // Deadlines, in milliseconds of TimeUtils::monotonicMs()
+    uint64_t                                  _now;              // Clock read once per wakeup
+    TimerWheel                                _timers;           // One timer per connection
+    std::vector<void*>                        _expired;          // Scratch list filled by the wheel
+    uint64_t                                  _timeouts[Connection::TIMEOUT_PHASES]; // Indexed by TimeoutPhase
+    uint64_t                                  _nextReap;         // Next CGIHandler::reapChildren() call
+
+    // Cross-thread handoff, guarded by _handoffMutex
+    pthread_mutex_t                           _handoffMutex;
+    std::vector<Handoff>                      _handoffs;         // Filled by other threads
+    std::vector<Handoff>                      _adopting;         // Scratch list swapped with _handoffs
+    bool                                      _stopRequested;    // Set by stop()
+    int                                       _wakeupPipe[2];    // Written to wake the loop up
+    bool                                      _stopping;         // Loop thread's copy of _stopRequested
+
+    pthread_t                                 _thread;           // Thread running the loop, if started by start()
+    bool                                      _threadStarted;
+
+    void _handleConnection(Connection* connection, short events);
+    void _handleCgiEvent(Connection* connection, int fd, short events);
+    void _handlePendingConnections();
+    void _adoptHandoffs();
+    void _wakeUp();
+    bool _shouldStop() const;
+    void _setFdKind(int fd, FdKind kind);
+    FdKind _getFdKind(int fd) const;
+    void _armTimeout(Connection* connection);
+    void _expireTimeouts();
+    int _waitTimeout() const;
+    void _removeConnection(int fd, Connection* connection);
+
+    // Resolution of the connection deadlines
+    static const uint64_t TIMER_TICK_MS = 100;
+    // Period of the housekeeping that reaps orphaned CGI children
+    static const uint64_t REAP_INTERVAL_MS = 1000;
+
+    static void* _threadMain(void* loop);
+
+public:
+    /**
+     * @brief Construct a new EventLoop object
+     *
+     * @param server Server whose listening sockets this loop may watch
+     * @param globalConfig Settings from the main context (event backend, ...)
+     * @param id Position among the server's loops, for log messages
+     */
+    EventLoop(Server& server, const GlobalConfig& globalConfig, size_t id);
+
+    /**
+     * @brief Destroy the EventLoop object, closing its connections
+     */
+    ~EventLoop();
+
+    /**
+     * @brief Watch a listening socket; its events go to Server::acceptConnection()
+     *
+     * @return true on success, false if the socket could not be watched
+     */
+    bool addListenSocket(Socket* socket);
+
+    /**
+     * @brief Watch the inotify descriptor of a file cache
+     *
+     * @return true on success, false if the descriptor could not be watched
+     */
+    bool addFileCache(FileCache* fileCache);
+
+    /**
+     * @brief Stop watching the inotify descriptor of a file cache
+     */
+    void removeFileCache(FileCache* fileCache);
+
+    /**
+     * @brief Set the access log of the connections adopted from now on
+     *
+     * Called before the loop runs; the log must outlive its connections.
+     */
+    void setAccessLog(AccessLog* accessLog);
+
+    /**
+     * @brief Start serving an accepted client (loop thread only)
+     *
+     * The descriptor is closed if it cannot be watched.
+     *
+     * @param fd Non-blocking client socket
+     * @param address Peer address
+     * @param config Default server of the listening socket
+     * @param fileCache Static file cache of that server, NULL if none
+     */
+    void addConnection(int fd, const struct sockaddr_in& address, ServerConfig* config, FileCache* fileCache);
+
+    /**
+     * @brief Queue an accepted client for this loop (any thread)
+     *
+     * Same parameters as addConnection(); the loop adopts the descriptor
+     * on its next wakeup.
+     */
+    void handOff(int fd, const struct sockaddr_in& address, ServerConfig* config, FileCache* fileCache);
+
+    /**
+     * @brief Run the loop on the calling thread until stop() or a signal
+     */
+    void run();
+
+    /**
+     * @brief Run the loop on a new thread
+     *
+     * @return bool False if the thread could not be created
+     */
+    bool start();
+
+    /**
+     * @brief Ask the loop to return from run() (any thread)
+     */
+    void stop();
+
+    /**
+     * @brief Wait for the thread started by start() to finish
+     */
+    void join();
+
+    /**
+     * @brief Close every connection of the loop (loop stopped)
+     */
+    void closeConnections();
+
+    /**
+     * @brief Get the name of the multiplexer backend
+     */
+    const char* getBackendName() const;
+
+    /**
+     * @brief Check if client sockets are registered edge-triggered
+     */
+    bool isEdgeTriggered() const;
+
+private:
+    // Prevent copying
+    EventLoop(const EventLoop& other);
+    EventLoop& operator=(const EventLoop& other);
+};
@@ -0,0 +1,325 @@
+#include "FileCache.hpp"
+#include "../http/Validators.hpp"
+#include "../utils/FileUtils.hpp"
+#include "../utils/StringUtils.hpp"
+#include "../utils/DebugLogger.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#ifdef __linux__
+# include <sys/inotify.h>
+#endif
+
+#ifdef __linux__
+// Anything that may change what a later read() of the file returns
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+
+// Anything that may change a listing of the directory: reported for its
+// entries as well as for the directory itself
+static const uint32_t DIRECTORY_WATCH_MASK = WATCH_MASK | IN_CREATE | IN_DELETE |
+                                             IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+#endif
+
+FileCache::FileCache(size_t capacity)
+    : _capacity(capacity), _size(0), _notifyFd(-1), _lru(), _index(), _watches()
+{
+    pthread_mutex_init(&_mutex, NULL);
+#ifdef __linux__
+    if (_capacity > 0) {
+        _notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_notifyFd < 0) {
+            std::cerr << "inotify_init1() failed, file cache disabled: " << strerror(errno) << std::endl;
+        }
+    }
+#endif
+}
+
+FileCache::~FileCache() {
+    _clear();
+    if (_notifyFd >= 0) {
+        ::close(_notifyFd);
+        _notifyFd = -1;
+    }
+    pthread_mutex_destroy(&_mutex);
+}
+
+bool FileCache::isEnabled() const {
+    return _notifyFd >= 0;
+}
+
+int FileCache::getNotifyFd() const {
+    return _notifyFd;
+}
+
+size_t FileCache::size() const {
+    return _size;
+}
+
+size_t FileCache::count() const {
+    return _index.size();
+}
+
+const FileCache::Entry* FileCache::get(const std::string& path) {
+    Index::iterator it = _index.find(path);
+    if (it == _index.end()) {
+        return NULL;
+    }
+    // Move to the front of the LRU list (splice keeps the iterator valid)
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return *it->second;
+}
+
+const FileCache::Entry* FileCache::load(const std::string& path, size_t maxEntrySize) {
+#ifdef __linux__
+    if (!isEnabled() || maxEntrySize == 0) {
+        return NULL;
+    }
+    invalidate(path);
+
+    // Watch before reading so a write racing with the read is still reported
+    int wd = inotify_add_watch(_notifyFd, path.c_str(), WATCH_MASK);
+    if (wd < 0) {
+        return NULL;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+        static_cast<size_t>(info.st_size) > maxEntrySize ||
+        static_cast<size_t>(info.st_size) > _capacity) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (_watches.find(wd) == _watches.end()) {
+            inotify_rm_watch(_notifyFd, wd);
+        }
+        return NULL;
+    }
+
+    Entry* entry = new Entry();
+    entry->path = path;
+    entry->info = info;
+    entry->wd = wd;
+    entry->content.resize(info.st_size);
+
+    // Read the whole file
+    size_t total = 0;
+    while (total < entry->content.size()) {
+        ssize_t n = read(fd, &entry->content[total], entry->content.size() - total);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        total += n;
+    }
+    ::close(fd);
+
+    if (total != entry->content.size()) {
+        // Short read: the file changed under us, don't cache it
+        delete entry;
+        if (_watches.find(wd) == _watches.end()) {
+            inotify_rm_watch(_notifyFd, wd);
+        }
+        return NULL;
+    }
+
+    entry->contentType = FileUtils::getMimeType(FileUtils::getFileExtension(path));
+    std::stringstream ss;
+    ss << entry->content.size();
+    entry->contentLength = ss.str();
+    Validators::appendETag(entry->etag, info);
+    Validators::appendLastModified(entry->lastModified, info);
+
+    _insert(entry);
+
+    LOG_DEBUG("File cache: loaded " << path << " (" << entry->contentLength << " bytes)");
+    return entry;
+#else
+    (void)path;
+    (void)maxEntrySize;
+    return NULL;
+#endif
+}
+
+const FileCache::Entry* FileCache::store(const std::string& key, const std::string& dirPath, std::string& content,
+                                         const std::string& contentType, const struct stat& generatedFrom,
+                                         size_t maxEntrySize) {
+#ifdef __linux__
+    if (!isEnabled() || content.size() > maxEntrySize || content.size() > _capacity) {
+        return NULL;
+    }
+    invalidate(key);
+
+    int wd = inotify_add_watch(_notifyFd, dirPath.c_str(), DIRECTORY_WATCH_MASK);
+    if (wd < 0) {
+        return NULL;
+    }
+
+    // The page was generated before the watch existed: a change in between
+    // shows up as a different directory mtime
+    struct stat info;
+    if (stat(dirPath.c_str(), &info) != 0 || info.st_ino != generatedFrom.st_ino ||
+        info.st_dev != generatedFrom.st_dev || info.st_mtim.tv_sec != generatedFrom.st_mtim.tv_sec ||
+        info.st_mtim.tv_nsec != generatedFrom.st_mtim.tv_nsec) {
+        if (_watches.find(wd) == _watches.end()) {
+            inotify_rm_watch(_notifyFd, wd);
+        }
+        return NULL;
+    }
+
+    Entry* entry = new Entry();
+    entry->path = key;
+    entry->info = info;
+    entry->wd = wd;
+    entry->content.swap(content);
+    entry->contentType = contentType;
+    StringUtils::appendUnsigned(entry->contentLength, entry->content.size());
+
+    _insert(entry);
+
+    LOG_DEBUG("File cache: stored " << key << " for " << dirPath << " (" << entry->contentLength << " bytes)");
+    return entry;
+#else
+    (void)key;
+    (void)dirPath;
+    (void)content;
+    (void)contentType;
+    (void)generatedFrom;
+    (void)maxEntrySize;
+    return NULL;
+#endif
+}
+
+bool FileCache::storeGzip(const Entry& entry, int level, std::string& gzipped, const std::string& etag) {
+    Index::iterator it = _index.find(entry.path);
+    if (it == _index.end() || *it->second != &entry || entry.content.size() + gzipped.size() > _capacity) {
+        return false;
+    }
+    Entry* cached = *it->second;
+    _size -= cached->gzipContent.size();
+
+    // Make room, least recently used first, keeping this entry at the front
+    _lru.splice(_lru.begin(), _lru, it->second);
+    while (_lru.back() != cached && _size + gzipped.size() > _capacity) {
+        _remove(_index.find(_lru.back()->path), false);
+    }
+
+    cached->gzipContent.swap(gzipped);
+    cached->gzipEtag = etag;
+    cached->gzipLevel = level;
+    _size += cached->gzipContent.size();
+
+    LOG_DEBUG("File cache: stored gzip level " << level << " of " << cached->path << " ("
+              << cached->gzipContent.size() << " bytes)");
+    return true;
+}
+
+void FileCache::_insert(Entry* entry) {
+    // Register the watch first so evicting a hard link to the same file keeps it
+    _watches.insert(std::make_pair(entry->wd, entry->path));
+
+    // Make room, least recently used first
+    while (!_lru.empty() && _size + entry->content.size() > _capacity) {
+        _remove(_index.find(_lru.back()->path), false);
+    }
+
+    _lru.push_front(entry);
+    _index[entry->path] = _lru.begin();
+    _size += entry->content.size();
+}
+
+void FileCache::invalidate(const std::string& path) {
+    Index::iterator it = _index.find(path);
+    if (it != _index.end()) {
+        _remove(it, false);
+    }
+}
+
+void FileCache::processEvents() {
+#ifdef __linux__
+    // Aligned for struct inotify_event
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;) {
+        ssize_t length = read(_notifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            if (length < 0 && errno == EINTR) {
+                continue;
+            }
+            break;  // EAGAIN: queue drained
+        }
+
+        for (char* ptr = buffer; ptr < buffer + length; ) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost, nothing in the cache can be trusted
+                _clear();
+                continue;
+            }
+            // IN_IGNORED: the kernel already dropped the watch
+            _invalidateWatch(event->wd, (event->mask & IN_IGNORED) != 0);
+        }
+    }
+#endif
+}
+
+void FileCache::_invalidateWatch(int wd, bool watchGone) {
+    std::pair<WatchMap::iterator, WatchMap::iterator> range = _watches.equal_range(wd);
+    if (range.first == range.second) {
+        return;
+    }
+
+    // Copy the paths first, _remove() edits the watch map
+    std::vector<std::string> paths;
+    for (WatchMap::iterator it = range.first; it != range.second; ++it) {
+        paths.push_back(it->second);
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        Index::iterator it = _index.find(paths[i]);
+        if (it != _index.end()) {
+            LOG_DEBUG("File cache: invalidated " << paths[i]);
+            _remove(it, watchGone);
+        }
+    }
+}
+
+void FileCache::_remove(Index::iterator it, bool watchGone) {
+    Entry* entry = *it->second;
+    _removeWatch(entry->wd, entry->path, watchGone);
+    _size -= entry->content.size() + entry->gzipContent.size();
+    _lru.erase(it->second);
+    _index.erase(it);
+    delete entry;
+}
+
+void FileCache::_removeWatch(int wd, const std::string& path, bool watchGone) {
+    std::pair<WatchMap::iterator, WatchMap::iterator> range = _watches.equal_range(wd);
+    for (WatchMap::iterator it = range.first; it != range.second; ++it) {
+        if (it->second == path) {
+            _watches.erase(it);
+            break;
+        }
+    }
+#ifdef __linux__
+    // Other paths (hard links) may still rely on the same watch
+    if (!watchGone && _watches.find(wd) == _watches.end()) {
+        inotify_rm_watch(_notifyFd, wd);
+    }
+#else
+    (void)watchGone;
+#endif
+}
+
+void FileCache::_clear() {
+    while (!_index.empty()) {
+        _remove(_index.begin(), false);
+    }
+}
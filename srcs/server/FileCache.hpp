@@ -0,0 +1,173 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <map>
+#include <cstddef>
+#include <sys/stat.h>
+#include <pthread.h>
+
+/**
+ * @brief Bounded LRU cache of small static files
+ *
+ * Entries are keyed by resolved filesystem path and hold the file bytes,
+ * the preformatted Content-Type, Content-Length, ETag and Last-Modified
+ * header values and the stat metadata taken when the file was read. Each
+ * cached file is watched with inotify; the owner registers getNotifyFd()
+ * with the IOMultiplexer and calls processEvents() when it becomes
+ * readable, which drops every entry whose file was modified, replaced or
+ * removed.
+ *
+ * A body compressed on the fly can be kept next to the file bytes, so
+ * cache hits answered with gzip send stored bytes; it counts towards the
+ * capacity and is dropped with the entry.
+ *
+ * Pages generated from a directory, such as autoindex listings, are kept
+ * the same way under a key of their own and dropped when anything in the
+ * directory changes.
+ *
+ * Without inotify (non-Linux) the cache stays disabled.
+ *
+ * One cache is shared by all event loop threads of a server. Callers hold
+ * a FileCache::Lock around every call and for as long as they use an
+ * Entry returned by get() or load().
+ */
+class FileCache {
+public:
+    /**
+     * @brief A cached file
+     */
+    struct Entry {
+        std::string path;           // Resolved filesystem path, or store() key
+        std::string content;        // File bytes
+        std::string contentType;    // Content-Type header value
+        std::string contentLength;  // Content-Length header value
+        std::string etag;           // ETag header value
+        std::string lastModified;   // Last-Modified header value
+        std::string gzipContent;    // Content compressed at gzipLevel
+        std::string gzipEtag;       // ETag header value of gzipContent
+        int gzipLevel;              // Compression level of gzipContent, 0 if none
+        struct stat info;           // Metadata at load time
+        int wd;                     // inotify watch descriptor
+    };
+
+    /**
+     * @brief Scoped lock on a cache
+     */
+    class Lock {
+    public:
+        explicit Lock(FileCache& cache) : _mutex(cache._mutex) { pthread_mutex_lock(&_mutex); }
+        ~Lock() { pthread_mutex_unlock(&_mutex); }
+    private:
+        pthread_mutex_t& _mutex;
+        Lock(const Lock& other);
+        Lock& operator=(const Lock& other);
+    };
+
+    /**
+     * @brief Construct a new FileCache object
+     *
+     * @param capacity Maximum total size of cached file bytes
+     */
+    explicit FileCache(size_t capacity);
+    ~FileCache();
+
+    /**
+     * @brief Look up a cached file and mark it most recently used
+     *
+     * @param path Resolved filesystem path
+     * @return const Entry* The entry, NULL on a miss. Valid until the next
+     *         load() or processEvents() call.
+     */
+    const Entry* get(const std::string& path);
+
+    /**
+     * @brief Read a file into the cache, evicting least recently used entries
+     *
+     * @param path Resolved filesystem path
+     * @param maxEntrySize Largest file accepted (location limit)
+     * @return const Entry* The new entry, NULL if the file is not cacheable
+     */
+    const Entry* load(const std::string& path, size_t maxEntrySize);
+
+    /**
+     * @brief Cache a page generated from a directory
+     *
+     * The directory is watched instead of a file, so creating, removing,
+     * renaming or modifying anything in it drops the page. The page is
+     * only kept if the directory's mtime still matches the stat taken
+     * before it was generated. Generated pages carry no validators.
+     *
+     * @param key Cache key; must not start with '/' (file keys do)
+     * @param dirPath Directory the page was generated from
+     * @param content Page bytes, swapped into the entry
+     * @param contentType Content-Type header value
+     * @param generatedFrom Directory metadata taken before generating
+     * @param maxEntrySize Largest page accepted (location limit)
+     * @return const Entry* The new entry, NULL if the page is not cacheable
+     */
+    const Entry* store(const std::string& key, const std::string& dirPath, std::string& content,
+                       const std::string& contentType, const struct stat& generatedFrom, size_t maxEntrySize);
+
+    /**
+     * @brief Keep the gzip-compressed content of a cached entry
+     *
+     * One compression level is kept per entry, storing another replaces
+     * it. Other entries are evicted to make room, never this one.
+     *
+     * @param entry Entry returned by get() or load()
+     * @param level Compression level the content was compressed at
+     * @param gzipped Compressed bytes, swapped into the entry
+     * @param etag ETag header value of the compressed bytes
+     * @return true if the entry now holds the compressed bytes
+     */
+    bool storeGzip(const Entry& entry, int level, std::string& gzipped, const std::string& etag);
+
+    /**
+     * @brief Drop the entry for a path, if any
+     */
+    void invalidate(const std::string& path);
+
+    /**
+     * @brief Read pending inotify events and drop the affected entries
+     */
+    void processEvents();
+
+    /**
+     * @brief Get the inotify descriptor to monitor for reading
+     *
+     * @return int The descriptor, -1 if the cache is disabled
+     */
+    int getNotifyFd() const;
+
+    /**
+     * @brief Check if the cache can hold anything
+     */
+    bool isEnabled() const;
+
+    size_t size() const;
+    size_t count() const;
+
+private:
+    typedef std::list<Entry*> LruList;                      // Front is most recently used
+    typedef std::map<std::string, LruList::iterator> Index;
+    typedef std::multimap<int, std::string> WatchMap;       // Hard links share a watch
+
+    size_t _capacity;
+    size_t _size;           // Total bytes of cached content, compressed or not
+    int _notifyFd;
+    LruList _lru;
+    Index _index;
+    WatchMap _watches;
+    pthread_mutex_t _mutex;  // Taken through Lock
+
+    void _insert(Entry* entry);
+    void _remove(Index::iterator it, bool watchGone);
+    void _removeWatch(int wd, const std::string& path, bool watchGone);
+    void _invalidateWatch(int wd, bool watchGone);
+    void _clear();
+
+    // Prevent copying
+    FileCache(const FileCache& other);
+    FileCache& operator=(const FileCache& other);
+};
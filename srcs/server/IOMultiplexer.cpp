@@ -1,127 +1,148 @@
 #include "IOMultiplexer.hpp"
-#include <algorithm>
+#include "PollMultiplexer.hpp"
+#include "EpollMultiplexer.hpp"
 #include <errno.h>
 #include <iostream>
 #include <string.h>
 
-IOMultiplexer::IOMultiplexer() {}
+IOMultiplexer::IOMultiplexer() : _entries(), _ready(), _count(0) {}
 
 IOMultiplexer::~IOMultiplexer() {
     // No need to close file descriptors here; that's the responsibility
     // of the owner of the file descriptors
-    _pollfds.clear();
-    _fdToData.clear();
+    _entries.clear();
+    _ready.clear();
 }
 
-void IOMultiplexer::addFd(int fd, short events, void* data) {
-    // Check if fd already exists
-    for (size_t i = 0; i < _pollfds.size(); ++i) {
-        if (_pollfds[i].fd == fd) {
-            // Update events if already exists
-            _pollfds[i].events = events;
-            _fdToData[fd] = data;
-            return;
+IOMultiplexer* IOMultiplexer::create(GlobalConfig::EventBackend backend) {
+#ifdef __linux__
+    if (backend == GlobalConfig::BACKEND_EPOLL) {
+        try {
+            return new EpollMultiplexer();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << ", falling back to poll()" << std::endl;
         }
     }
-    
+#else
+    (void)backend;
+#endif
+    return new PollMultiplexer();
+}
+
+bool IOMultiplexer::supportsEdgeTriggered() const {
+    return false;
+}
+
+bool IOMultiplexer::_isRegistered(int fd) const {
+    return fd >= 0 && static_cast<size_t>(fd) < _entries.size() && _entries[fd].registered;
+}
+
+bool IOMultiplexer::addFd(int fd, short events, void* data) {
+    if (fd < 0) {
+        return false;
+    }
+
+    // Update events if already exists
+    if (_isRegistered(fd)) {
+        _entries[fd].data = data;
+        modifyFd(fd, events);
+        return true;
+    }
+
+    if (static_cast<size_t>(fd) >= _entries.size()) {
+        FdEntry empty;
+        empty.registered = false;
+        empty.events = 0;
+        empty.data = NULL;
+        empty.slot = 0;
+        empty.ready = 0;
+        _entries.resize(fd + 1, empty);
+    }
+
     // Add new fd
-    struct pollfd pfd;
-    pfd.fd = fd;
-    pfd.events = events;
-    pfd.revents = 0;
-    
-    _pollfds.push_back(pfd);
-    _fdToData[fd] = data;
+    FdEntry& entry = _entries[fd];
+    entry.registered = true;
+    entry.events = events;
+    entry.data = data;
+    if (!_backendAdd(fd, entry)) {
+        entry.registered = false;
+        entry.events = 0;
+        entry.data = NULL;
+        return false;
+    }
+    ++_count;
+    return true;
 }
 
 void IOMultiplexer::modifyFd(int fd, short events) {
-    for (size_t i = 0; i < _pollfds.size(); ++i) {
-        if (_pollfds[i].fd == fd) {
-            _pollfds[i].events = events;
-            return;
-        }
+    if (!_isRegistered(fd) || _entries[fd].events == events) {
+        return;
     }
+    _entries[fd].events = events;
+    _backendModify(fd, _entries[fd]);
 }
 
 void IOMultiplexer::removeFd(int fd) {
-    for (std::vector<struct pollfd>::iterator it = _pollfds.begin(); it != _pollfds.end(); ++it) {
-        if (it->fd == fd) {
-            _pollfds.erase(it);
-            _fdToData.erase(fd);
-            return;
-        }
+    if (!_isRegistered(fd)) {
+        return;
+    }
+    FdEntry& entry = _entries[fd];
+    _backendRemove(fd, entry);
+    entry.registered = false;
+    entry.events = 0;
+    entry.data = NULL;
+    --_count;
+
+    // Neutralize a pending record so the dispatch loop skips it. The index
+    // may be left over from an earlier wait(): the fd check tells.
+    if (entry.ready < _ready.size() && _ready[entry.ready].fd == fd) {
+        _ready[entry.ready].events = 0;
+        _ready[entry.ready].data = NULL;
     }
 }
 
 int IOMultiplexer::wait(int timeout) {
-    if (_pollfds.empty()) {
+    if (_count == 0) {
         return 0;  // No file descriptors to monitor
     }
-    
-    // Reset revents fields
-    for (size_t i = 0; i < _pollfds.size(); ++i) {
-        _pollfds[i].revents = 0;
-    }
-    
-    // Call poll() to wait for events
-    int result = poll(&_pollfds[0], _pollfds.size(), timeout);
-    
+
+    // Reuse the record array; clear() keeps its capacity
+    _ready.clear();
+
+    int result = _waitForEvents(timeout);
+
     if (result < 0) {
         if (errno != EINTR) {
-            std::cerr << "poll() error: " << strerror(errno) << std::endl;
-        }
-    }
-    
-    return result;
-}
-
-bool IOMultiplexer::isReadReady(int fd) const {
-    for (size_t i = 0; i < _pollfds.size(); ++i) {
-        if (_pollfds[i].fd == fd) {
-            return (_pollfds[i].revents & POLLIN) != 0;
+            std::cerr << getName() << "() error: " << strerror(errno) << std::endl;
         }
     }
-    return false;
-}
 
-bool IOMultiplexer::isWriteReady(int fd) const {
-    for (size_t i = 0; i < _pollfds.size(); ++i) {
-        if (_pollfds[i].fd == fd) {
-            return (_pollfds[i].revents & POLLOUT) != 0;
-        }
-    }
-    return false;
+    return result;
 }
 
-bool IOMultiplexer::hasError(int fd) const {
-    for (size_t i = 0; i < _pollfds.size(); ++i) {
-        if (_pollfds[i].fd == fd) {
-            return (_pollfds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
-        }
+void IOMultiplexer::_markReady(int fd, short revents) {
+    if (revents == 0 || !_isRegistered(fd)) {
+        return;
     }
-    return false;
+    Event event;
+    event.fd = fd;
+    event.events = revents;
+    event.data = _entries[fd].data;
+    _entries[fd].ready = _ready.size();
+    _ready.push_back(event);
 }
 
 void* IOMultiplexer::getData(int fd) const {
-    std::map<int, void*>::const_iterator it = _fdToData.find(fd);
-    if (it != _fdToData.end()) {
-        return it->second;
+    if (!_isRegistered(fd)) {
+        return NULL;
     }
-    return NULL;
+    return _entries[fd].data;
 }
 
-std::vector<int> IOMultiplexer::getActiveFds() const {
-    std::vector<int> activeFds;
-    
-    for (size_t i = 0; i < _pollfds.size(); ++i) {
-        if (_pollfds[i].revents != 0) {
-            activeFds.push_back(_pollfds[i].fd);
-        }
-    }
-    
-    return activeFds;
+const std::vector<IOMultiplexer::Event>& IOMultiplexer::getEvents() const {
+    return _ready;
 }
 
 size_t IOMultiplexer::size() const {
-    return _pollfds.size();
-}
\ No newline at end of file
+    return _count;
+}
@@ -1,118 +1,167 @@
 #pragma once
 
 #include <vector>
-#include <map>
 #include <sys/poll.h>
 #include <cstddef>
+#include "../config/parser/GlobalConfig.hpp"
 
 /**
- * @brief Wrapper class for poll() to manage multiple file descriptors
- * 
- * This class encapsulates the poll() functionality and provides a clean API
+ * @brief Common interface for the readiness notification backends
+ *
+ * This class encapsulates the poll()/epoll() functionality and provides a clean API
  * for non-blocking I/O operations. It allows monitoring multiple file descriptors
  * for read and write readiness without blocking the server.
+ *
+ * Bookkeeping is indexed directly by file descriptor, so registration and
+ * readiness lookups cost O(1) regardless of how many descriptors are open.
+ * Concrete backends (PollMultiplexer, EpollMultiplexer) only implement the
+ * kernel-facing part; use create() to obtain one.
  */
 class IOMultiplexer {
-private:
-    std::vector<struct pollfd> _pollfds;
-    std::map<int, void*> _fdToData;
-    
 public:
     // Event types (matching poll() flags)
     static const short EVENT_READ = POLLIN;
     static const short EVENT_WRITE = POLLOUT;
     static const short EVENT_ERROR = POLLERR | POLLHUP | POLLNVAL;
-    
+    // Request edge-triggered notification (only honored when supportsEdgeTriggered())
+    static const short EVENT_EDGE = 0x4000;
+
     /**
-     * @brief Construct a new IOMultiplexer object
+     * @brief A descriptor reported ready by wait()
      */
-    IOMultiplexer();
-    
+    struct Event {
+        int fd;            // The ready file descriptor
+        short events;      // Reported events (EVENT_READ, EVENT_WRITE, EVENT_ERROR bits)
+        void* data;        // Data registered with addFd()
+    };
+
+    /**
+     * @brief Create the multiplexer for the requested backend
+     *
+     * Falls back to poll() when the backend is unavailable on this platform.
+     *
+     * @param backend Backend selected in the configuration
+     * @return IOMultiplexer* Heap-allocated multiplexer, owned by the caller
+     */
+    static IOMultiplexer* create(GlobalConfig::EventBackend backend);
+
     /**
      * @brief Destroy the IOMultiplexer object
      */
-    ~IOMultiplexer();
-    
+    virtual ~IOMultiplexer();
+
     /**
      * @brief Add a file descriptor to monitor
-     * 
+     *
      * @param fd The file descriptor to monitor
      * @param events Event flags (EVENT_READ, EVENT_WRITE, etc.)
      * @param data Pointer to associated data (will be returned by getData())
+     * @return true on success, false if the backend refused the descriptor;
+     *         it is then not monitored and the caller should close it
      */
-    void addFd(int fd, short events, void* data);
-    
+    bool addFd(int fd, short events, void* data);
+
     /**
      * @brief Update the events to monitor for a file descriptor
-     * 
+     *
      * @param fd The file descriptor to update
      * @param events New event flags
      */
     void modifyFd(int fd, short events);
-    
+
     /**
      * @brief Remove a file descriptor from monitoring
-     * 
+     *
      * @param fd The file descriptor to remove
      */
     void removeFd(int fd);
-    
+
     /**
      * @brief Wait for events on monitored file descriptors
-     * 
+     *
      * @param timeout Timeout in milliseconds, -1 for indefinite
      * @return int Number of file descriptors with events, 0 for timeout, -1 for error
      */
     int wait(int timeout = -1);
-    
-    /**
-     * @brief Check if a file descriptor is ready for reading
-     * 
-     * @param fd The file descriptor to check
-     * @return true if ready for reading, false otherwise
-     */
-    bool isReadReady(int fd) const;
-    
-    /**
-     * @brief Check if a file descriptor is ready for writing
-     * 
-     * @param fd The file descriptor to check
-     * @return true if ready for writing, false otherwise
-     */
-    bool isWriteReady(int fd) const;
-    
-    /**
-     * @brief Check if a file descriptor has an error
-     * 
-     * @param fd The file descriptor to check
-     * @return true if error occurred, false otherwise
-     */
-    bool hasError(int fd) const;
-    
+
     /**
      * @brief Get the data associated with a file descriptor
-     * 
+     *
      * @param fd The file descriptor
      * @return void* Pointer to associated data, NULL if not found
      */
     void* getData(int fd) const;
-    
+
     /**
-     * @brief Get all file descriptors with activity
-     * 
-     * @return std::vector<int> List of active file descriptors
+     * @brief Get the ready events reported by the last wait()
+     *
+     * The array is owned by the multiplexer and reused between calls, so it
+     * is only valid until the next wait(). Removing a descriptor while the
+     * array is being iterated clears its pending record (data becomes NULL
+     * and events 0), so callers never see a stale pointer.
+     *
+     * @return const std::vector<Event>& One record per ready descriptor
      */
-    std::vector<int> getActiveFds() const;
-    
+    const std::vector<Event>& getEvents() const;
+
     /**
      * @brief Get the current number of monitored file descriptors
-     * 
+     *
      * @return size_t Number of monitored file descriptors
      */
     size_t size() const;
-    
+
+    /**
+     * @brief Get the backend name, for logging
+     *
+     * @return const char* "poll" or "epoll"
+     */
+    virtual const char* getName() const = 0;
+
+    /**
+     * @brief Whether EVENT_EDGE is honored by this backend
+     *
+     * Edge-triggered descriptors are only reported again once new data
+     * arrives, so their owner must drain them until EAGAIN (or remember
+     * to come back) before waiting again.
+     *
+     * @return true if edge-triggered registration is available
+     */
+    virtual bool supportsEdgeTriggered() const;
+
+protected:
+    /**
+     * @brief Per-descriptor state, stored at index fd
+     */
+    struct FdEntry {
+        bool registered;   // Whether the fd is currently monitored
+        short events;      // Requested events
+        void* data;        // User data returned by getData()
+        size_t slot;       // Backend-specific position (index into pollfd array)
+        size_t ready;      // Index of its record in _ready, valid if that record has this fd
+    };
+
+    std::vector<FdEntry> _entries;     // Indexed by file descriptor
+    std::vector<Event> _ready;         // Records filled by the last wait()
+    size_t _count;                     // Number of registered descriptors
+
+    IOMultiplexer();
+
+    /**
+     * @brief Report events for a descriptor during _waitForEvents()
+     */
+    void _markReady(int fd, short revents);
+
+    bool _isRegistered(int fd) const;
+
+    // Backend hooks, called once the generic bookkeeping is done
+    virtual bool _backendAdd(int fd, FdEntry& entry) = 0;
+    virtual void _backendModify(int fd, FdEntry& entry) = 0;
+    virtual void _backendRemove(int fd, FdEntry& entry) = 0;
+    virtual int _waitForEvents(int timeout) = 0;
+
 private:
     // Prevent copying
     IOMultiplexer(const IOMultiplexer& other);
     IOMultiplexer& operator=(const IOMultiplexer& other);
-};
\ No newline at end of file
+};
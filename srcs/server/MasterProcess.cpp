@@ -0,0 +1,310 @@
+#include "MasterProcess.hpp"
+#include "Server.hpp"
+#include "Socket.hpp"
+#include <set>
+#include <sstream>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/prctl.h>
+#endif
+
+MasterProcess::MasterProcess(const std::vector<ServerConfig*>& configs, const GlobalConfig& globalConfig)
+    : _serverConfigs(configs), _globalConfig(globalConfig), _workers(), _cpus(), _masterPid(getpid())
+{
+    Worker idle;
+    idle.pid = -1;
+    idle.startedAt = 0;
+    idle.restartAt = 0;
+    _workers.assign(_globalConfig.getWorkerProcesses(), idle);
+
+    sigemptyset(&_signals);
+    sigemptyset(&_previousMask);
+}
+
+MasterProcess::~MasterProcess() {}
+
+int MasterProcess::run()
+{
+    if (!_checkAddresses()) {
+        return 1;
+    }
+
+    // The master handles its signals synchronously with sigtimedwait(), so
+    // they stay blocked instead of interrupting it at arbitrary points
+    sigaddset(&_signals, SIGINT);
+    sigaddset(&_signals, SIGTERM);
+    sigaddset(&_signals, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &_signals, &_previousMask) < 0) {
+        std::cerr << "Failed to block signals: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    _masterPid = getpid();
+
+    if (_globalConfig.hasWorkerCpuAffinity()) {
+        _loadCpus();
+    }
+
+    std::cout << "Master process " << _masterPid << " starting "
+              << _workers.size() << " worker processes." << std::endl;
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        _spawnWorker(i);
+    }
+
+    int status = 0;
+    for (;;) {
+        // Wake up at least once a second to fork delayed restarts
+        struct timespec timeout;
+        timeout.tv_sec = 1;
+        timeout.tv_nsec = 0;
+        int signal = sigtimedwait(&_signals, NULL, &timeout);
+
+        if (signal == SIGINT || signal == SIGTERM) {
+            std::cout << "\nReceived signal " << signal << ". Stopping workers..." << std::endl;
+            break;
+        }
+        if (!_reapWorkers()) {
+            status = 1;
+            break;
+        }
+        _restartWorkers();
+    }
+
+    _stopWorkers();
+    sigprocmask(SIG_SETMASK, &_previousMask, NULL);
+    return status;
+}
+
+bool MasterProcess::_checkAddresses()
+{
+    std::set<std::string> checked;
+    for (std::vector<ServerConfig*>::const_iterator it = _serverConfigs.begin(); it != _serverConfigs.end(); ++it) {
+        std::stringstream ss;
+        ss << (*it)->getHost() << ":" << (*it)->getPort();
+        if (!checked.insert(ss.str()).second) {
+            continue;
+        }
+
+        // Bound without SO_REUSEPORT and closed right away
+        Socket probe((*it)->getHost(), (*it)->getPort());
+        try {
+            probe.create();
+            probe.bind();
+        } catch (const std::exception& e) {
+            std::cerr << "Cannot use " << ss.str() << ": " << e.what() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void MasterProcess::_spawnWorker(size_t index)
+{
+    Worker& worker = _workers[index];
+
+    // Anything still buffered would otherwise be written again by the child
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Failed to fork worker " << index << ": " << strerror(errno) << std::endl;
+        worker.pid = -1;
+        worker.restartAt = time(NULL) + MIN_WORKER_UPTIME;
+        return;
+    }
+    if (pid == 0) {
+        _runWorker(index);
+    }
+
+    worker.pid = pid;
+    worker.startedAt = time(NULL);
+    std::cout << "Started worker " << index << " (pid " << pid << ")" << std::endl;
+}
+
+void MasterProcess::_runWorker(size_t index)
+{
+    // Server installs its own handlers; signals are no longer left pending
+    sigprocmask(SIG_SETMASK, &_previousMask, NULL);
+
+#ifdef __linux__
+    // Do not outlive a master that was killed without a chance to stop us
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != _masterPid) {
+        _exit(0);
+    }
+#endif
+
+    _pinWorker(index);
+
+    // Everything the event loop owns (multiplexer, listening sockets,
+    // caches) is created here, after the fork, so nothing is shared
+    int status = 0;
+    Server* server = NULL;
+    try {
+        server = new Server(_serverConfigs, _globalConfig);
+        server->initialize();
+    } catch (const std::exception& e) {
+        std::cerr << "Worker " << index << " failed to initialize: " << e.what() << std::endl;
+        status = EXIT_INIT_FAILURE;
+    }
+
+    if (status == 0) {
+        try {
+            server->run();
+        } catch (const std::exception& e) {
+            std::cerr << "Worker " << index << ": " << e.what() << std::endl;
+            status = 1;
+        }
+    }
+    delete server;
+
+    // Leave without running the master's destructors and atexit handlers
+    std::cout.flush();
+    std::cerr.flush();
+    _exit(status);
+}
+
+void MasterProcess::_pinWorker(size_t index)
+{
+#ifdef __linux__
+    if (_cpus.empty()) {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(_cpus[index % _cpus.size()], &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        std::cerr << "Worker " << index << ": failed to set CPU affinity: "
+                  << strerror(errno) << std::endl;
+    }
+#else
+    (void)index;
+#endif
+}
+
+void MasterProcess::_loadCpus()
+{
+#ifdef __linux__
+    // Only the CPUs we are allowed on (taskset, cgroups), in order
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) < 0) {
+        std::cerr << "worker_cpu_affinity ignored: " << strerror(errno) << std::endl;
+        return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            _cpus.push_back(cpu);
+        }
+    }
+#else
+    std::cerr << "worker_cpu_affinity ignored: not supported on this system" << std::endl;
+#endif
+}
+
+bool MasterProcess::_reapWorkers()
+{
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        size_t index = 0;
+        while (index < _workers.size() && _workers[index].pid != pid) {
+            ++index;
+        }
+        if (index == _workers.size()) {
+            continue;
+        }
+
+        Worker& worker = _workers[index];
+        worker.pid = -1;
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_INIT_FAILURE) {
+            std::cerr << "Worker " << index << " could not initialize, stopping." << std::endl;
+            return false;
+        }
+
+        if (WIFSIGNALED(status)) {
+            std::cerr << "Worker " << index << " (pid " << pid << ") killed by signal "
+                      << WTERMSIG(status) << ", restarting." << std::endl;
+        } else {
+            std::cerr << "Worker " << index << " (pid " << pid << ") exited with status "
+                      << WEXITSTATUS(status) << ", restarting." << std::endl;
+        }
+
+        // A worker that keeps dying right away must not turn into a fork loop
+        time_t now = time(NULL);
+        worker.restartAt = (now - worker.startedAt < MIN_WORKER_UPTIME) ? now + MIN_WORKER_UPTIME : now;
+    }
+    return true;
+}
+
+void MasterProcess::_restartWorkers()
+{
+    time_t now = time(NULL);
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        if (_workers[i].pid < 0 && _workers[i].restartAt <= now) {
+            _spawnWorker(i);
+        }
+    }
+}
+
+void MasterProcess::_stopWorkers()
+{
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        if (_workers[i].pid > 0) {
+            kill(_workers[i].pid, SIGTERM);
+        }
+    }
+
+    time_t deadline = time(NULL) + SHUTDOWN_TIMEOUT;
+    while (_liveWorkers() > 0) {
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            for (size_t i = 0; i < _workers.size(); ++i) {
+                if (_workers[i].pid == pid) {
+                    _workers[i].pid = -1;
+                }
+            }
+        }
+        if (_liveWorkers() == 0) {
+            break;
+        }
+
+        if (time(NULL) >= deadline) {
+            for (size_t i = 0; i < _workers.size(); ++i) {
+                if (_workers[i].pid > 0) {
+                    std::cerr << "Worker " << i << " did not stop, killing it." << std::endl;
+                    kill(_workers[i].pid, SIGKILL);
+                    waitpid(_workers[i].pid, &status, 0);
+                    _workers[i].pid = -1;
+                }
+            }
+            break;
+        }
+
+        struct timespec timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_nsec = 100 * 1000 * 1000;
+        sigtimedwait(&_signals, NULL, &timeout);
+    }
+    std::cout << "All workers stopped." << std::endl;
+}
+
+size_t MasterProcess::_liveWorkers() const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        if (_workers[i].pid > 0) {
+            ++count;
+        }
+    }
+    return count;
+}
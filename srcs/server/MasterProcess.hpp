@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vector>
+#include <ctime>
+#include <signal.h>
+#include <sys/types.h>
+#include "../config/parser/ServerConfig.hpp"
+#include "../config/parser/GlobalConfig.hpp"
+
+/**
+ * @brief Supervisor for the multi-process mode (worker_processes > 1)
+ *
+ * The master forks one worker per configured process. Each worker builds
+ * its own Server after the fork, so it owns its event loop and binds its
+ * own SO_REUSEPORT listening sockets; the kernel spreads new connections
+ * across them and workers share nothing at run time.
+ *
+ * The master only waits for signals: it restarts workers that die, and on
+ * SIGINT/SIGTERM stops them all before exiting. A worker that cannot
+ * initialize (no listening socket could be bound, ...) stops the master,
+ * since its siblings would fail the same way.
+ */
+class MasterProcess {
+private:
+    /**
+     * @brief One worker slot
+     */
+    struct Worker {
+        pid_t pid;              // Running process, -1 while waiting for a restart
+        time_t startedAt;       // When the current process was forked
+        time_t restartAt;       // Earliest time to fork a replacement
+    };
+
+    std::vector<ServerConfig*>  _serverConfigs;     // Server configurations
+    const GlobalConfig&         _globalConfig;      // Process-wide settings
+    std::vector<Worker>         _workers;           // Worker slots, one per process
+    std::vector<int>            _cpus;              // CPUs workers are pinned to, empty if pinning is off
+    sigset_t                    _signals;           // Signals the master waits for
+    sigset_t                    _previousMask;      // Signal mask restored in workers
+    pid_t                       _masterPid;         // Parent of the workers
+
+    // Workers that die sooner than this after being forked are restarted with a delay
+    static const time_t MIN_WORKER_UPTIME = 1;
+    // Seconds a worker gets to finish after SIGTERM before it is killed
+    static const time_t SHUTDOWN_TIMEOUT = 5;
+
+    /**
+     * @brief Make sure no other process listens on the configured addresses
+     *
+     * Workers bind with SO_REUSEPORT, which would let them silently share a
+     * port with another instance started by the same user. A plain bind()
+     * done once here fails instead.
+     *
+     * @return bool False if an address is unavailable
+     */
+    bool _checkAddresses();
+
+    /**
+     * @brief Fork the process of a worker slot
+     *
+     * @param index Worker slot
+     */
+    void _spawnWorker(size_t index);
+
+    /**
+     * @brief Worker process body, never returns
+     *
+     * @param index Worker slot
+     */
+    void _runWorker(size_t index);
+
+    /**
+     * @brief Pin the calling worker to its CPU
+     *
+     * @param index Worker slot
+     */
+    void _pinWorker(size_t index);
+
+    /**
+     * @brief Collect the CPUs the master may run on, for worker_cpu_affinity
+     */
+    void _loadCpus();
+
+    /**
+     * @brief Reap exited workers and schedule their restart
+     *
+     * @return bool False if a worker could not initialize
+     */
+    bool _reapWorkers();
+
+    /**
+     * @brief Fork replacements for dead workers whose restart time has come
+     */
+    void _restartWorkers();
+
+    /**
+     * @brief Send SIGTERM to all workers and wait for them, killing stragglers
+     */
+    void _stopWorkers();
+
+    /**
+     * @brief Number of worker processes still running
+     */
+    size_t _liveWorkers() const;
+
+public:
+    // Exit status of a worker whose Server could not be initialized
+    static const int EXIT_INIT_FAILURE = 2;
+
+    /**
+     * @brief Construct a new MasterProcess object
+     *
+     * @param configs Vector of server configurations
+     * @param globalConfig Settings from the main context (worker_processes, ...)
+     */
+    MasterProcess(const std::vector<ServerConfig*>& configs, const GlobalConfig& globalConfig);
+
+    /**
+     * @brief Destroy the MasterProcess object
+     */
+    ~MasterProcess();
+
+    /**
+     * @brief Fork the workers and supervise them until SIGINT or SIGTERM
+     *
+     * @return int Process exit status
+     */
+    int run();
+
+private:
+    // Prevent copying
+    MasterProcess(const MasterProcess& other);
+    MasterProcess& operator=(const MasterProcess& other);
+};
@@ -0,0 +1,176 @@
+#include "OutputQueue.hpp"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
+
+OutputQueue::OutputQueue() : _segments(), _cursor(0), _size(0) {}
+
+OutputQueue::~OutputQueue() {
+    clear();
+}
+
+void OutputQueue::append(const std::string& data) {
+    if (data.empty()) {
+        return;
+    }
+    // Push an empty segment first so the data is copied only once
+    Segment segment;
+    segment.fd = -1;
+    segment.offset = 0;
+    segment.length = 0;
+    segment.ownsFd = false;
+    _segments.push_back(segment);
+    _segments.back().data = data;
+    _size += data.size();
+}
+
+void OutputQueue::appendFile(int fd, off_t offset, size_t length, bool closeWhenDone) {
+    if (length == 0) {
+        if (closeWhenDone && fd >= 0) {
+            ::close(fd);
+        }
+        return;
+    }
+    Segment segment;
+    segment.fd = fd;
+    segment.offset = offset;
+    segment.length = length;
+    segment.ownsFd = closeWhenDone;
+    _segments.push_back(segment);
+    _size += length;
+}
+
+void OutputQueue::splice(OutputQueue& other) {
+    if (other._segments.empty()) {
+        return;
+    }
+    // Apply the other queue's cursor before its front segment changes owner
+    if (other._cursor > 0) {
+        other._segments.front().data.erase(0, other._cursor);
+        other._cursor = 0;
+    }
+    for (std::deque<Segment>::iterator it = other._segments.begin(); it != other._segments.end(); ++it) {
+        _segments.push_back(Segment());
+        Segment& segment = _segments.back();
+        segment.data.swap(it->data);
+        segment.fd = it->fd;
+        segment.offset = it->offset;
+        segment.length = it->length;
+        segment.ownsFd = it->ownsFd;
+    }
+    _size += other._size;
+    other._segments.clear();
+    other._size = 0;
+}
+
+ssize_t OutputQueue::flush(int sockFd, size_t maxBytes) {
+    if (_segments.empty() || maxBytes == 0) {
+        return 0;
+    }
+    if (_segments.front().fd >= 0) {
+        return _flushFile(sockFd, maxBytes);
+    }
+    return _flushMemory(sockFd, maxBytes);
+}
+
+ssize_t OutputQueue::_flushMemory(int sockFd, size_t maxBytes) {
+    struct iovec iov[MAX_IOV];
+    size_t count = 0;
+    size_t total = 0;
+
+    // Gather consecutive memory segments, stopping at the first file range
+    for (std::deque<Segment>::iterator it = _segments.begin();
+         it != _segments.end() && it->fd < 0 && count < MAX_IOV && total < maxBytes; ++it) {
+        size_t skip = (count == 0) ? _cursor : 0;
+        size_t length = it->data.size() - skip;
+        if (length > maxBytes - total) {
+            length = maxBytes - total;
+        }
+        iov[count].iov_base = const_cast<char*>(it->data.data()) + skip;
+        iov[count].iov_len = length;
+        total += length;
+        ++count;
+    }
+
+    // sendmsg() is writev() plus flags: MSG_NOSIGNAL turns a vanished peer into EPIPE
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    ssize_t bytesWritten = sendmsg(sockFd, &msg, MSG_NOSIGNAL);
+    if (bytesWritten <= 0) {
+        return bytesWritten;
+    }
+
+    // Advance the cursor, releasing fully sent segments
+    size_t remaining = static_cast<size_t>(bytesWritten);
+    _size -= remaining;
+    while (remaining > 0) {
+        size_t left = _segments.front().data.size() - _cursor;
+        if (remaining < left) {
+            _cursor += remaining;
+            break;
+        }
+        remaining -= left;
+        _popFront();
+    }
+    return bytesWritten;
+}
+
+ssize_t OutputQueue::_flushFile(int sockFd, size_t maxBytes) {
+#ifdef __linux__
+    Segment& segment = _segments.front();
+    size_t length = segment.length < maxBytes ? segment.length : maxBytes;
+
+    // The kernel copies straight from the page cache to the socket
+    ssize_t bytesWritten = sendfile(sockFd, segment.fd, &segment.offset, length);
+
+    if (bytesWritten > 0) {
+        segment.length -= bytesWritten;
+        _size -= bytesWritten;
+        if (segment.length == 0) {
+            _popFront();
+        }
+    } else if (bytesWritten == 0) {
+        // The file shrank after its length was announced
+        errno = EIO;
+        return -1;
+    }
+    return bytesWritten;
+#else
+    (void)sockFd;
+    (void)maxBytes;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+void OutputQueue::_popFront() {
+    Segment& segment = _segments.front();
+    if (segment.ownsFd && segment.fd >= 0) {
+        ::close(segment.fd);
+    }
+    _segments.pop_front();
+    _cursor = 0;
+}
+
+bool OutputQueue::empty() const {
+    return _size == 0;
+}
+
+size_t OutputQueue::size() const {
+    return _size;
+}
+
+void OutputQueue::clear() {
+    while (!_segments.empty()) {
+        _popFront();
+    }
+    _size = 0;
+}
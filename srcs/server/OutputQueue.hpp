@@ -0,0 +1,97 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <cstddef>
+#include <sys/types.h>
+
+/**
+ * @brief Ordered list of pending output segments for one socket
+ *
+ * A response is queued as separate segments (header block, body slices,
+ * file ranges) instead of one concatenated string. flush() gathers the
+ * in-memory segments into a single sendmsg() (writev semantics) and sends
+ * file ranges with sendfile(). A cursor tracks how much of the front
+ * segment is already out, so a partial write never moves the remaining data.
+ */
+class OutputQueue {
+public:
+    OutputQueue();
+    ~OutputQueue();
+
+    /**
+     * @brief Queue a copy of an in-memory buffer
+     *
+     * @param data Bytes to send (ignored if empty)
+     */
+    void append(const std::string& data);
+
+    /**
+     * @brief Queue a byte range of an open file
+     *
+     * @param fd Readable file descriptor
+     * @param offset First byte to send
+     * @param length Number of bytes to send
+     * @param closeWhenDone Close fd once this range is sent or the queue is cleared
+     */
+    void appendFile(int fd, off_t offset, size_t length, bool closeWhenDone);
+
+    /**
+     * @brief Move every segment of another queue to the end of this one
+     *
+     * @param other Queue to drain; left empty, its file descriptors now belong to this queue
+     */
+    void splice(OutputQueue& other);
+
+    /**
+     * @brief Send as much as possible without blocking
+     *
+     * @param sockFd Connected socket
+     * @param maxBytes Upper bound for this call
+     * @return ssize_t Bytes sent, or -1 with errno set (EAGAIN when the socket is full,
+     *         EIO when a queued file turned out shorter than announced)
+     */
+    ssize_t flush(int sockFd, size_t maxBytes);
+
+    /**
+     * @brief Check if nothing is left to send
+     */
+    bool empty() const;
+
+    /**
+     * @brief Get the number of bytes left to send
+     */
+    size_t size() const;
+
+    /**
+     * @brief Drop all segments, closing owned file descriptors
+     */
+    void clear();
+
+private:
+    /**
+     * @brief A memory buffer (fd == -1) or a file range
+     */
+    struct Segment {
+        std::string data;   // Memory segment contents
+        int fd;             // File descriptor for file ranges, -1 for memory
+        off_t offset;       // Next file byte to send
+        size_t length;      // File bytes left to send
+        bool ownsFd;        // Close fd when the segment is released
+    };
+
+    // Upper bound on iovec entries per sendmsg() (well below IOV_MAX)
+    static const size_t MAX_IOV = 64;
+
+    std::deque<Segment> _segments;
+    size_t _cursor;         // Bytes of the front memory segment already sent
+    size_t _size;           // Total bytes left to send
+
+    ssize_t _flushMemory(int sockFd, size_t maxBytes);
+    ssize_t _flushFile(int sockFd, size_t maxBytes);
+    void _popFront();
+
+    // Prevent copying
+    OutputQueue(const OutputQueue& other);
+    OutputQueue& operator=(const OutputQueue& other);
+};
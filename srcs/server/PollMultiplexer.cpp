@@ -0,0 +1,55 @@
+#include "PollMultiplexer.hpp"
+
+PollMultiplexer::PollMultiplexer() : IOMultiplexer(), _pollfds() {}
+
+PollMultiplexer::~PollMultiplexer() {
+    _pollfds.clear();
+}
+
+const char* PollMultiplexer::getName() const {
+    return "poll";
+}
+
+bool PollMultiplexer::_backendAdd(int fd, FdEntry& entry) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = entry.events & ~EVENT_EDGE;  // poll() is level-triggered only
+    pfd.revents = 0;
+
+    entry.slot = _pollfds.size();
+    _pollfds.push_back(pfd);
+    return true;
+}
+
+void PollMultiplexer::_backendModify(int fd, FdEntry& entry) {
+    (void)fd;
+    _pollfds[entry.slot].events = entry.events & ~EVENT_EDGE;
+}
+
+void PollMultiplexer::_backendRemove(int fd, FdEntry& entry) {
+    (void)fd;
+    size_t last = _pollfds.size() - 1;
+
+    // Move the last pollfd into the freed slot to keep the array dense
+    if (entry.slot != last) {
+        _pollfds[entry.slot] = _pollfds[last];
+        _entries[_pollfds[entry.slot].fd].slot = entry.slot;
+    }
+    _pollfds.pop_back();
+}
+
+int PollMultiplexer::_waitForEvents(int timeout) {
+    int result = poll(&_pollfds[0], _pollfds.size(), timeout);
+
+    // poll() returns how many entries have revents set, stop once all are found
+    int found = 0;
+    for (size_t i = 0; i < _pollfds.size() && found < result; ++i) {
+        if (_pollfds[i].revents != 0) {
+            _markReady(_pollfds[i].fd, _pollfds[i].revents);
+            _pollfds[i].revents = 0;
+            ++found;
+        }
+    }
+
+    return result;
+}
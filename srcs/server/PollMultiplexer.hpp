@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <sys/poll.h>
+#include "IOMultiplexer.hpp"
+
+/**
+ * @brief poll() backend for IOMultiplexer
+ *
+ * Portable fallback. The pollfd array is kept dense: each FdEntry remembers
+ * its slot so that removal is a swap with the last element instead of a scan.
+ * The kernel still walks the whole array on every wait(), which is why epoll
+ * is preferred on Linux.
+ */
+class PollMultiplexer : public IOMultiplexer {
+private:
+    std::vector<struct pollfd> _pollfds;
+
+public:
+    PollMultiplexer();
+    ~PollMultiplexer();
+
+    const char* getName() const;
+
+protected:
+    bool _backendAdd(int fd, FdEntry& entry);
+    void _backendModify(int fd, FdEntry& entry);
+    void _backendRemove(int fd, FdEntry& entry);
+    int _waitForEvents(int timeout);
+
+private:
+    // Prevent copying
+    PollMultiplexer(const PollMultiplexer& other);
+    PollMultiplexer& operator=(const PollMultiplexer& other);
+};
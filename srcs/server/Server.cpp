@@ -1,4 +1,5 @@
 #include "Server.hpp"
+#include "../utils/DebugLogger.hpp"
 #include <algorithm>
 #include <sstream>
 
@@ -8,13 +9,25 @@ bool Server::_signalReceived = false;
 /**
  * Constructor: Initialize server with configuration
  */
-Server::Server(const std::vector<ServerConfig*>& configs)
-    : _listenSockets(), _serverConfigs(configs), _defaultServers(), 
-      _multiplexer(), _connections(), _running(false)
+Server::Server(const std::vector<ServerConfig*>& configs, const GlobalConfig& globalConfig)
+    : _listenSockets(), _serverConfigs(configs), _defaultServers(), _fileCaches(), _accessLog(NULL), _globalConfig(globalConfig),
+      _loops(), _nextLoop(0), _running(false)
 {
     if (_serverConfigs.empty()) {
         throw std::runtime_error("No server configurations provided");
     }
+    
+    // Each loop has its own multiplexer; the first one runs on the caller's thread
+    try {
+        for (size_t i = 0; i < _globalConfig.getWorkerThreads(); ++i) {
+            _loops.push_back(new EventLoop(*this, _globalConfig, i));
+        }
+    } catch (...) {
+        for (size_t i = 0; i < _loops.size(); ++i) {
+            delete _loops[i];
+        }
+        throw;
+    }
 }
 
 /**
@@ -23,6 +36,9 @@ Server::Server(const std::vector<ServerConfig*>& configs)
 Server::~Server()
 {
     shutdown();
+    for (size_t i = 0; i < _loops.size(); ++i) {
+        delete _loops[i];
+    }
 }
 
 /**
@@ -32,11 +48,18 @@ void Server::initialize()
 {
     _setupListenSockets();
     _setupDefaultServers();
+    _setupFileCaches();
+    _setupAccessLog();
     
     // Set up signal handlers for clean shutdown
     setupSignalHandlers();
     
-    std::cout << "Server initialized successfully." << std::endl;
+    std::cout << "Server initialized successfully (" << _loops[0]->getBackendName() << " backend"
+              << (_loops[0]->isEdgeTriggered() ? ", edge-triggered" : "");
+    if (_loops.size() > 1) {
+        std::cout << ", " << _loops.size() << " event loop threads";
+    }
+    std::cout << ")." << std::endl;
 }
 
 /**
@@ -61,16 +84,22 @@ void Server::_setupListenSockets()
             // Create and initialize a socket for this host:port
             Socket* socket = new Socket((*it)->getHost(), (*it)->getPort());
             socket->create();
+            if (_globalConfig.getWorkerProcesses() > 1) {
+                socket->setReusePort();
+            }
             socket->setNonBlocking();  // Required by subject
             socket->bind();
-            socket->listen();
+            socket->listen(_getBacklog((*it)->getHost(), (*it)->getPort()));
+            
+            // The first loop accepts and hands clients to the others
+            if (!_loops[0]->addListenSocket(socket)) {
+                delete socket;
+                throw std::runtime_error("cannot watch the listening socket");
+            }
             
             _listenSockets.push_back(socket);
             createdSockets[hostPort] = true;
             
-            // Add to multiplexer
-            _multiplexer.addFd(socket->getSocketFd(), IOMultiplexer::EVENT_READ, socket);
-            
             std::cout << "Listening on " << (*it)->getHost() << ":" << (*it)->getPort() << std::endl;
         } catch (const std::exception& e) {
             std::cerr << "Failed to set up socket for " << hostPort << ": " << e.what() << std::endl;
@@ -83,6 +112,20 @@ void Server::_setupListenSockets()
     }
 }
 
+/**
+ * Get the listen() backlog of a host:port: the largest one its server blocks declare
+ */
+int Server::_getBacklog(const std::string& host, int port) const
+{
+    int backlog = 0;
+    for (std::vector<ServerConfig*>::const_iterator it = _serverConfigs.begin(); it != _serverConfigs.end(); ++it) {
+        if ((*it)->getHost() == host && (*it)->getPort() == port && (*it)->getBacklog() > backlog) {
+            backlog = (*it)->getBacklog();
+        }
+    }
+    return backlog;
+}
+
 /**
  * Set up default servers for each host:port combination
  * The first server defined for a host:port is the default
@@ -101,6 +144,45 @@ void Server::_setupDefaultServers()
     }
 }
 
+/**
+ * Create the static file cache of each server block that enables one
+ */
+void Server::_setupFileCaches()
+{
+    for (std::vector<ServerConfig*>::const_iterator it = _serverConfigs.begin(); it != _serverConfigs.end(); ++it) {
+        if ((*it)->getFileCacheSize() == 0) {
+            continue;
+        }
+        
+        FileCache* cache = new FileCache((*it)->getFileCacheSize());
+        if (!cache->isEnabled()) {
+            delete cache;
+            continue;
+        }
+        if (!_loops[0]->addFileCache(cache)) {
+            delete cache;
+            continue;
+        }
+        _fileCaches[*it] = cache;
+    }
+}
+
+/**
+ * Open the access log, if configured, and hand it to every loop
+ */
+void Server::_setupAccessLog()
+{
+    if (_globalConfig.getAccessLog().empty()) {
+        return;
+    }
+    
+    _accessLog = new AccessLog(_globalConfig.getAccessLog(), _globalConfig.getAccessLogFormat(),
+                               _globalConfig.getAccessLogBufferSize(), _globalConfig.getAccessLogFlush());
+    for (size_t i = 0; i < _loops.size(); ++i) {
+        _loops[i]->setAccessLog(_accessLog);
+    }
+}
+
 /**
  * Get the server configuration that should handle this request
  * Implements virtual host routing based on the Host header
@@ -132,7 +214,7 @@ ServerConfig* Server::_getServerConfig(const std::string& host, int port, const
 }
 
 /**
- * Run the main server loop
+ * Run the event loops until shutdown or a signal
  */
 void Server::run()
 {
@@ -142,144 +224,42 @@ void Server::run()
     }
     
     _running = true;
-    std::cout << "Server started. Press Ctrl+C to stop." << std::endl;
     
-    // Main event loop
-    while (_running && !_signalReceived) {
-        // Wait for activity with a timeout of 1 second
-        // This allows us to periodically check timeouts and _signalReceived
-        int activity = _multiplexer.wait(1000);
-        
-        if (activity < 0) {
-            // Poll error (except when interrupted by a signal)
-            if (errno != EINTR) {
-                std::cerr << "poll() failed: " << strerror(errno) << std::endl;
-                break;
-            }
-            continue;
-        }
-        
-        if (activity == 0) {
-            // Timeout - check for connection timeouts
-            _checkTimeouts();
-            continue;
-        }
-        
-        // Get all file descriptors with activity
-        std::vector<int> activeFds = _multiplexer.getActiveFds();
-        
-        for (std::vector<int>::const_iterator it = activeFds.begin(); it != activeFds.end(); ++it) {
-            int fd = *it;
-            
-            // Check for errors
-            if (_multiplexer.hasError(fd)) {
-                if (_isListenSocket(fd)) {
-                    std::cerr << "Error on listening socket: " << fd << std::endl;
-                    // This is serious - we might want to remove this socket
-                } else {
-                    // Client connection error
-                    Connection* connection = static_cast<Connection*>(_multiplexer.getData(fd));
-                    if (connection) {
-                        connection->close();
-                        _multiplexer.removeFd(fd);
-                        delete connection;
-                        _connections.erase(fd);
-                    }
-                }
-                continue;
-            }
-            
-            // Check for read readiness
-            if (_multiplexer.isReadReady(fd)) {
-                if (_isListenSocket(fd)) {
-                    // Accept new connection on listening socket
-                    Socket* socket = static_cast<Socket*>(_multiplexer.getData(fd));
-                    if (socket) {
-                        _acceptNewConnection(socket);
-                    }
-                } else {
-                    // Handle data from existing connection
-                    Connection* connection = static_cast<Connection*>(_multiplexer.getData(fd));
-                    if (connection) {
-                        _handleConnection(connection);
-                    }
-                }
-            }
-            
-            // Check for write readiness
-            if (_multiplexer.isWriteReady(fd)) {
-                // Only for client connections, not listening sockets
-                if (!_isListenSocket(fd)) {
-                    Connection* connection = static_cast<Connection*>(_multiplexer.getData(fd));
-                    if (connection) {
-                        _handleConnection(connection);
-                    }
-                }
+    // The other loops get their own threads; this one serves as the first
+    for (size_t i = 1; i < _loops.size(); ++i) {
+        if (!_loops[i]->start()) {
+            for (size_t j = 1; j < i; ++j) {
+                _loops[j]->stop();
+                _loops[j]->join();
             }
+            _running = false;
+            throw std::runtime_error("Failed to start event loop threads");
         }
-        
-        // Check for connection timeouts
-        _checkTimeouts();
     }
+    std::cout << "Server started. Press Ctrl+C to stop." << std::endl;
     
-    std::cout << "Server event loop terminated." << std::endl;
-}
-
-/**
- * Check if the file descriptor belongs to a listening socket
- */
-bool Server::_isListenSocket(int fd)
-{
-    for (std::vector<Socket*>::const_iterator it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
-        if ((*it)->getSocketFd() == fd) {
-            return true;
-        }
+    _loops[0]->run();
+    
+    for (size_t i = 1; i < _loops.size(); ++i) {
+        _loops[i]->stop();
+    }
+    for (size_t i = 1; i < _loops.size(); ++i) {
+        _loops[i]->join();
     }
-    return false;
+    
+    std::cout << "Server event loop terminated." << std::endl;
 }
 
-/**
- * Get the Socket object for a given file descriptor
- */
-Socket* Server::_getSocketByFd(int fd)
+bool Server::isStopping() const
 {
-    for (std::vector<Socket*>::const_iterator it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
-        if ((*it)->getSocketFd() == fd) {
-            return *it;
-        }
-    }
-    return NULL;
+    return !_running || _signalReceived;
 }
 
 /**
- * Accept a new connection on a listening socket
+ * Accept the pending connections of a listening socket, up to accept_batch
  */
-void Server::_acceptNewConnection(Socket* socket)
+void Server::acceptConnection(Socket* socket, EventLoop& acceptingLoop)
 {
-    int clientFd = socket->accept();
-    
-    if (clientFd < 0) {
-        // EAGAIN/EWOULDBLOCK means no connections ready to be accepted
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            return;
-        }
-        std::cerr << "Error accepting connection: " << strerror(errno) << std::endl;
-        return;
-    }
-    
-    // Set the new socket to non-blocking mode
-    int flags = fcntl(clientFd, F_GETFL, 0);
-    if (flags < 0 || fcntl(clientFd, F_SETFL, flags | O_NONBLOCK) < 0) {
-        std::cerr << "Failed to set client socket to non-blocking mode: " << strerror(errno) << std::endl;
-        ::close(clientFd);
-        return;
-    }
-    
-    // Get client address information
-    struct sockaddr_in clientAddr;
-    socklen_t addrLen = sizeof(clientAddr);
-    getpeername(clientFd, (struct sockaddr*)&clientAddr, &addrLen);
-    
     // TODO: Determine which server config to use based on Host header
     // For now, use the default server for this listening socket
     std::stringstream ss;
@@ -288,77 +268,39 @@ void Server::_acceptNewConnection(Socket* socket)
     
     ServerConfig* config = _defaultServers[hostPort];
     
-    // Create a new Connection object
-    Connection* connection = new Connection(clientFd, clientAddr, config);
-    _connections[clientFd] = connection;
-    
-    // Add to multiplexer - initially only interested in reading
-    _multiplexer.addFd(clientFd, IOMultiplexer::EVENT_READ, connection);
-}
-
-/**
- * Handle activity on a client connection
- */
-void Server::_handleConnection(Connection* connection)
-{
-    int fd = connection->getFd();
-    bool connectionValid = true;
-    
-    // Handle read events
-    if (_multiplexer.isReadReady(fd) && connection->shouldRead()) {
-        connectionValid = connection->readData();
-    }
-    
-    // Handle write events
-    if (connectionValid && _multiplexer.isWriteReady(fd) && connection->shouldWrite()) {
-        connectionValid = connection->writeData();
-    }
-    
-    // If connection is closed, clean up
-    if (!connectionValid || connection->getState() == Connection::CLOSED) {
-        std::cout << "Cleaning up connection " << fd << std::endl;
-        _multiplexer.removeFd(fd);
-        delete connection;
-        _connections.erase(fd);
-        return;
-    }
-    
-    // Update the events we're interested in based on connection state
-    short events = 0;
-    if (connection->shouldRead()) {
-        events |= IOMultiplexer::EVENT_READ;
+    FileCache* fileCache = NULL;
+    std::map<ServerConfig*, FileCache*>::const_iterator cache = _fileCaches.find(config);
+    if (cache != _fileCaches.end()) {
+        fileCache = cache->second;
     }
-    if (connection->shouldWrite()) {
-        events |= IOMultiplexer::EVENT_WRITE;
-    }
-    
-    _multiplexer.modifyFd(fd, events);
-}
-
-/**
- * Check for connection timeouts
- */
-void Server::_checkTimeouts()
-{
-    std::vector<int> timeoutFds;
     
-    // Find all connections that have timed out
-    for (std::map<int, Connection*>::iterator it = _connections.begin(); it != _connections.end(); ++it) {
-        if (it->second->isTimeout()) {
-            std::cout << "Connection timeout: " << it->second->getClientIp() << std::endl;
-            timeoutFds.push_back(it->first);
+    // Drain the queue in one wakeup; whatever is left past the batch keeps
+    // the (level-triggered) socket readable for the next one
+    for (size_t accepted = 0; accepted < _globalConfig.getAcceptBatch(); ++accepted) {
+        struct sockaddr_in clientAddr;
+        int clientFd = socket->accept(clientAddr);
+        
+        if (clientFd < 0) {
+            // EAGAIN/EWOULDBLOCK means no connections ready to be accepted
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            // The client gave up while queued: try the next one
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) {
+                continue;
+            }
+            LOG_ERROR("Error accepting connection: " << strerror(errno));
+            return;
         }
-    }
-    
-    // Close and clean up timed out connections
-    for (std::vector<int>::iterator it = timeoutFds.begin(); it != timeoutFds.end(); ++it) {
-        int fd = *it;
-        Connection* connection = _connections[fd];
         
-        _multiplexer.removeFd(fd);
-        connection->close();
-        delete connection;
-        _connections.erase(fd);
+        // Spread clients over the loops in turn
+        EventLoop* loop = _loops[_nextLoop];
+        _nextLoop = (_nextLoop + 1) % _loops.size();
+        if (loop == &acceptingLoop) {
+            loop->addConnection(clientFd, clientAddr, config, fileCache);
+        } else {
+            loop->handOff(clientFd, clientAddr, config, fileCache);
+        }
     }
 }
 
@@ -369,12 +311,11 @@ void Server::shutdown()
 {
     _running = false;
     
-    // Close all connections
-    for (std::map<int, Connection*>::iterator it = _connections.begin(); it != _connections.end(); ++it) {
-        it->second->close();
-        delete it->second;
+    // Close all connections (loop threads were joined by run())
+    for (size_t i = 0; i < _loops.size(); ++i) {
+        _loops[i]->join();
+        _loops[i]->closeConnections();
     }
-    _connections.clear();
     
     // Close and delete all listen sockets
     for (std::vector<Socket*>::iterator it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
@@ -383,6 +324,17 @@ void Server::shutdown()
     }
     _listenSockets.clear();
     
+    // Release the file caches and their inotify descriptors
+    for (std::map<ServerConfig*, FileCache*>::iterator it = _fileCaches.begin(); it != _fileCaches.end(); ++it) {
+        _loops[0]->removeFileCache(it->second);
+        delete it->second;
+    }
+    _fileCaches.clear();
+    
+    // Connections are closed, so no record is still coming: flush and stop the writer
+    delete _accessLog;
+    _accessLog = NULL;
+    
     std::cout << "Server shut down." << std::endl;
 }
 
@@ -399,6 +351,10 @@ void Server::setupSignalHandlers()
     if (sigaction(SIGINT, &sa, NULL) == -1 || sigaction(SIGTERM, &sa, NULL) == -1) {
         std::cerr << "Failed to set up signal handlers: " << strerror(errno) << std::endl;
     }
+    
+    // Writes to a CGI pipe whose script already exited must fail with EPIPE
+    // instead of killing the server
+    signal(SIGPIPE, SIG_IGN);
 }
 
 /**
@@ -6,9 +6,11 @@
 #include <signal.h>
 #include <iostream>
 #include "Socket.hpp"
-#include "IOMultiplexer.hpp"
-#include "Connection.hpp"
+#include "EventLoop.hpp"
+#include "FileCache.hpp"
+#include "AccessLog.hpp"
 #include "../config/parser/ServerConfig.hpp"
+#include "../config/parser/GlobalConfig.hpp"
 #include "../exceptions/exceptions.hpp"
 
 /**
@@ -16,8 +18,9 @@
  * 
  * This class is responsible for:
  * - Creating and managing server sockets based on configuration
- * - Implementing the main event loop using IOMultiplexer
- * - Accepting new connections and handling data transfer
+ * - Running one EventLoop per worker thread (worker_threads), the first
+ *   one on the calling thread
+ * - Accepting new connections and spreading them over the loops
  * - Managing signal handling for clean shutdown
  */
 class Server {
@@ -25,21 +28,22 @@ private:
     std::vector<Socket*>                      _listenSockets;    // Sockets for each host:port
     std::vector<ServerConfig*>                _serverConfigs;    // Server configurations
     std::map<std::string, ServerConfig*>      _defaultServers;   // Default server for each host:port
+    std::map<ServerConfig*, FileCache*>       _fileCaches;       // Static file cache per server block, shared by the loops
+    AccessLog*                                _accessLog;        // Shared by the loops, NULL if access_log is off
+    const GlobalConfig&                       _globalConfig;     // Process-wide settings
 
-    IOMultiplexer                             _multiplexer;      // I/O multiplexer
-    std::map<int, Connection*>                _connections;      // Active connections
+    std::vector<EventLoop*>                   _loops;            // One per worker thread, _loops[0] runs on the caller
+    size_t                                    _nextLoop;         // Round-robin position for accepted clients
     
     bool                                      _running;          // Server running state
     
     // Helper methods
     void _setupListenSockets();
     void _setupDefaultServers();
+    void _setupFileCaches();
+    void _setupAccessLog();
+    int _getBacklog(const std::string& host, int port) const;
     ServerConfig* _getServerConfig(const std::string& host, int port, const std::string& serverName);
-    void _acceptNewConnection(Socket* socket);
-    void _handleConnection(Connection* connection);
-    bool _isListenSocket(int fd);
-    Socket* _getSocketByFd(int fd);
-    void _checkTimeouts();
     
     // Signal handling
     static bool _signalReceived;
@@ -50,8 +54,9 @@ public:
      * @brief Construct a new Server object
      * 
      * @param configs Vector of server configurations
+     * @param globalConfig Settings from the main context (event backend, ...)
      */
-    Server(const std::vector<ServerConfig*>& configs);
+    Server(const std::vector<ServerConfig*>& configs, const GlobalConfig& globalConfig);
     
     /**
      * @brief Destroy the Server object, clean up resources
@@ -73,6 +78,23 @@ public:
      */
     void shutdown();
     
+    /**
+     * @brief Accept clients on a listening socket and give them to the loops
+     * 
+     * Called by the loop watching the listening sockets. Accepts up to
+     * accept_batch clients per call. Clients go to the loops in turn; the
+     * accepting loop adopts its own directly.
+     * 
+     * @param socket Readable listening socket
+     * @param acceptingLoop Loop that reported the socket readable
+     */
+    void acceptConnection(Socket* socket, EventLoop& acceptingLoop);
+    
+    /**
+     * @brief Check if the loops should return (shutdown() or a signal)
+     */
+    bool isStopping() const;
+    
     /**
      * @brief Set up signal handlers for clean shutdown
      */
@@ -13,8 +13,14 @@ Socket::~Socket()
 
 void Socket::create()
 {
-    // Create a TCP socket
+    // Create a TCP socket, not inherited by CGI scripts
+#ifdef SOCK_CLOEXEC
+    _socketFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+#else
     _socketFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_socketFd >= 0)
+        fcntl(_socketFd, F_SETFD, FD_CLOEXEC);
+#endif
     if (_socketFd < 0)
         throw std::runtime_error("Failed to create socket: " + std::string(strerror(errno)));
     
@@ -27,6 +33,23 @@ void Socket::create()
     }
 }
 
+void Socket::setReusePort()
+{
+    // Each worker process binds its own socket to the same address and the
+    // kernel spreads incoming connections across them
+#ifdef SO_REUSEPORT
+    int opt = 1;
+    if (setsockopt(_socketFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    {
+        close();
+        throw std::runtime_error("Failed to set SO_REUSEPORT: " + std::string(strerror(errno)));
+    }
+#else
+    close();
+    throw std::runtime_error("SO_REUSEPORT is not supported on this system");
+#endif
+}
+
 void Socket::setNonBlocking()
 {
     // Set socket to non-blocking mode using fcntl
@@ -80,17 +103,27 @@ void Socket::listen(int backlog)
     }
 }
 
-int Socket::accept()
+int Socket::accept(struct sockaddr_in& clientAddr)
 {
-    // Accept a new connection
-    struct sockaddr_in clientAddr;
     socklen_t clientAddrLen = sizeof(clientAddr);
     
-    int clientFd = ::accept(_socketFd, (struct sockaddr*)&clientAddr, &clientAddrLen);
-    
     // We don't throw on EAGAIN/EWOULDBLOCK because these aren't errors
     // in non-blocking mode, they just mean "no connection available right now"
+#ifdef __linux__
+    return accept4(_socketFd, (struct sockaddr*)&clientAddr, &clientAddrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    int clientFd = ::accept(_socketFd, (struct sockaddr*)&clientAddr, &clientAddrLen);
+    if (clientFd < 0)
+        return -1;
+    if (fcntl(clientFd, F_SETFL, O_NONBLOCK) < 0 || fcntl(clientFd, F_SETFD, FD_CLOEXEC) < 0)
+    {
+        int error = errno;
+        ::close(clientFd);
+        errno = error;
+        return -1;
+    }
     return clientFd;
+#endif
 }
 
 void Socket::close()
@@ -26,9 +26,19 @@ public:
 
 	void	create();                  // Create the socket
 	void	setNonBlocking();          // Set socket to non-blocking mode
+	void	setReusePort();            // Share the address with other processes' sockets (SO_REUSEPORT)
 	void	bind();                    // Bind socket to address and port
-	void	listen(int backlog = 10);  // Start listening for connections
-	int		accept();                  // Accept a new connection
+	void	listen(int backlog);       // Start listening for connections
+
+	/**
+	 * @brief Accept a pending connection as a non-blocking, close-on-exec socket
+	 *
+	 * One accept4() call on Linux, accept() and fcntl() elsewhere.
+	 *
+	 * @param clientAddr Filled with the peer address
+	 * @return int Client descriptor, -1 with errno set (EAGAIN when none is pending)
+	 */
+	int		accept(struct sockaddr_in& clientAddr);
 	void	close();                   // Close the socket
 
 	// Getters
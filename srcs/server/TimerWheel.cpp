@@ -0,0 +1,176 @@
+#include "TimerWheel.hpp"
+
+TimerWheel::TimerWheel(uint64_t tickMs, uint64_t nowMs)
+    : _tickMs(tickMs > 0 ? tickMs : 1), _current(nowMs / (tickMs > 0 ? tickMs : 1)), _count(0)
+{
+    // Empty lists are heads linked to themselves
+    for (size_t i = 0; i < SLOT_COUNT; ++i) {
+        _slots[i].prev = &_slots[i];
+        _slots[i].next = &_slots[i];
+    }
+}
+
+TimerWheel::~TimerWheel()
+{
+    // Leave no node pointing into the destroyed heads
+    for (size_t i = 0; i < SLOT_COUNT; ++i) {
+        Timer* timer = _slots[i].next;
+        while (timer != &_slots[i]) {
+            Timer* next = timer->next;
+            timer->prev = NULL;
+            timer->next = NULL;
+            timer = next;
+        }
+    }
+}
+
+TimerWheel::Timer& TimerWheel::_slot(unsigned level, uint64_t index)
+{
+    if (level == 0) {
+        return _slots[index & (ROOT_SIZE - 1)];
+    }
+    return _slots[ROOT_SIZE + (level - 1) * LEVEL_SIZE + (index & (LEVEL_SIZE - 1))];
+}
+
+void TimerWheel::_place(Timer& timer)
+{
+    // Never behind the wheel: overdue timers fire on the next tick processed
+    if (timer.expires < _current) {
+        timer.expires = _current;
+    }
+    uint64_t delta = timer.expires - _current;
+
+    // Pick the finest level whose span covers the delay, indexed by the
+    // expiry's own bits so the slot comes up exactly when it is due
+    Timer* head;
+    if (delta < ROOT_SIZE) {
+        head = &_slot(0, timer.expires);
+    } else {
+        unsigned level = 1;
+        unsigned shift = ROOT_BITS;
+        while (level < LEVELS - 1 && delta >= (static_cast<uint64_t>(1) << (shift + LEVEL_BITS))) {
+            ++level;
+            shift += LEVEL_BITS;
+        }
+        // Beyond the wheel's range (weeks at any sane tick): clamp to the farthest slot
+        uint64_t limit = static_cast<uint64_t>(1) << (shift + LEVEL_BITS);
+        if (delta >= limit) {
+            timer.expires = _current + limit - 1;
+        }
+        head = &_slot(level, timer.expires >> shift);
+    }
+
+    timer.prev = head->prev;
+    timer.next = head;
+    head->prev->next = &timer;
+    head->prev = &timer;
+}
+
+void TimerWheel::arm(Timer& timer, uint64_t whenMs)
+{
+    cancel(timer);
+    timer.expires = (whenMs + _tickMs - 1) / _tickMs;
+    if (timer.expires <= _current) {
+        timer.expires = _current + 1;
+    }
+    _place(timer);
+    ++_count;
+}
+
+void TimerWheel::cancel(Timer& timer)
+{
+    if (!timer.isArmed()) {
+        return;
+    }
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = NULL;
+    timer.next = NULL;
+    --_count;
+}
+
+void TimerWheel::_cascade(Timer& head)
+{
+    // Detach the whole list first: re-placing may land in the same slot
+    Timer* timer = head.next;
+    head.prev = &head;
+    head.next = &head;
+
+    while (timer != &head) {
+        Timer* next = timer->next;
+        _place(*timer);
+        timer = next;
+    }
+}
+
+void TimerWheel::advance(uint64_t nowMs, std::vector<void*>& expired)
+{
+    uint64_t target = nowMs / _tickMs;
+
+    // Nothing armed: jump straight to the present
+    if (_count == 0) {
+        if (target > _current) {
+            _current = target;
+        }
+        return;
+    }
+
+    while (_current < target) {
+        ++_current;
+
+        // Entering a new root revolution: bring the next coarser slots
+        // down, highest level first
+        if ((_current & (ROOT_SIZE - 1)) == 0) {
+            unsigned shift = ROOT_BITS;
+            unsigned level = 1;
+            while (level < LEVELS - 1 && ((_current >> shift) & (LEVEL_SIZE - 1)) == 0) {
+                shift += LEVEL_BITS;
+                ++level;
+            }
+            for (; level >= 1; --level, shift -= LEVEL_BITS) {
+                _cascade(_slot(level, _current >> shift));
+            }
+        }
+
+        Timer& head = _slot(0, _current);
+        while (head.next != &head) {
+            Timer* timer = head.next;
+            cancel(*timer);
+            expired.push_back(timer->data);
+        }
+
+        if (_count == 0) {
+            _current = target;
+        }
+    }
+}
+
+int TimerWheel::nextTimeout(uint64_t nowMs) const
+{
+    if (_count == 0) {
+        return -1;
+    }
+
+    // The first non-empty root slot, or the next cascade if it comes
+    // first: coarser timers may move into the root wheel there
+    uint64_t tick = _current + 1;
+    while ((tick & (ROOT_SIZE - 1)) != 0) {
+        const Timer& head = _slots[tick & (ROOT_SIZE - 1)];
+        if (head.next != &head) {
+            break;
+        }
+        ++tick;
+    }
+
+    uint64_t dueMs = tick * _tickMs;
+    if (dueMs <= nowMs) {
+        return 0;
+    }
+    uint64_t wait = dueMs - nowMs;
+    return wait > 0x7fffffff ? 0x7fffffff : static_cast<int>(wait);
+}
+
+size_t TimerWheel::size() const
+{
+    return _count;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * @brief Hierarchical timing wheel for connection deadlines
+ *
+ * Time advances in fixed ticks. Timers due within ROOT_SIZE ticks sit in
+ * the root wheel, one slot per tick; later ones sit in coarser levels and
+ * are moved down ("cascaded") as their time approaches. Arming and
+ * cancelling only link or unlink an intrusive list node, so both are O(1)
+ * however many timers are armed, and advancing touches only the slots
+ * that come due.
+ *
+ * Timers are embedded in their owner (e.g. a Connection); the wheel never
+ * allocates. An owner must cancel its timer before it is destroyed.
+ */
+class TimerWheel {
+public:
+    /**
+     * @brief Intrusive timer node
+     */
+    struct Timer {
+        Timer* prev;            // Slot list links, NULL while not armed
+        Timer* next;
+        uint64_t expires;       // Tick at which the timer fires
+        void* data;             // Owner, returned by advance()
+
+        Timer() : prev(NULL), next(NULL), expires(0), data(NULL) {}
+
+        bool isArmed() const { return next != NULL; }
+    };
+
+    /**
+     * @brief Construct a new TimerWheel object
+     *
+     * @param tickMs Length of a tick in milliseconds
+     * @param nowMs Current time in milliseconds (TimeUtils::monotonicMs())
+     */
+    TimerWheel(uint64_t tickMs, uint64_t nowMs);
+    ~TimerWheel();
+
+    /**
+     * @brief Arm a timer, re-arming it if it is already armed
+     *
+     * @param timer Timer node
+     * @param whenMs Deadline in milliseconds, rounded up to a tick
+     */
+    void arm(Timer& timer, uint64_t whenMs);
+
+    /**
+     * @brief Disarm a timer, no-op if it is not armed
+     */
+    void cancel(Timer& timer);
+
+    /**
+     * @brief Move time forward and collect the timers that fired
+     *
+     * Fired timers are disarmed before being appended.
+     *
+     * @param nowMs Current time in milliseconds
+     * @param expired Receives the data of the fired timers
+     */
+    void advance(uint64_t nowMs, std::vector<void*>& expired);
+
+    /**
+     * @brief Time until advance() may have something to fire
+     *
+     * @param nowMs Current time in milliseconds
+     * @return int Milliseconds to wait, -1 if no timer is armed
+     */
+    int nextTimeout(uint64_t nowMs) const;
+
+    /**
+     * @brief Number of armed timers
+     */
+    size_t size() const;
+
+private:
+    static const unsigned ROOT_BITS = 8;
+    static const unsigned LEVEL_BITS = 6;
+    static const unsigned LEVELS = 4;   // Root and three coarser levels
+    static const uint64_t ROOT_SIZE = 1 << ROOT_BITS;
+    static const uint64_t LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const size_t SLOT_COUNT = ROOT_SIZE + (LEVELS - 1) * LEVEL_SIZE;
+
+    uint64_t _tickMs;
+    uint64_t _current;              // Last tick processed by advance()
+    size_t _count;                  // Armed timers
+    Timer _slots[SLOT_COUNT];       // List heads: root slots, then each level's slots
+
+    /**
+     * @brief Link a timer into the slot matching its expiry
+     */
+    void _place(Timer& timer);
+
+    /**
+     * @brief Re-place every timer of a slot, moving them to finer levels
+     */
+    void _cascade(Timer& head);
+
+    /**
+     * @brief Slot head of a level
+     */
+    Timer& _slot(unsigned level, uint64_t index);
+
+    // Prevent copying (slot heads point to themselves)
+    TimerWheel(const TimerWheel& other);
+    TimerWheel& operator=(const TimerWheel& other);
+};
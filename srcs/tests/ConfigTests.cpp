@@ -64,6 +64,16 @@ void ConfigTests::runAllTests()
     printTestResult("Unknown Directive", testUnknownDirective());
     printTestResult("Multiple Servers With Same HostPort", testMultipleServersWithSameHostPort());
     
+    // Main context tests
+    printTestResult("Global Directives", testGlobalDirectives());
+    printTestResult("Invalid Global Directive", testInvalidGlobalDirective());
+    
+    // File cache tests
+    printTestResult("File Cache Directives", testFileCacheDirectives());
+    
+    // Compression tests
+    printTestResult("Gzip Directives", testGzipDirectives());
+    
     std::cout << "\n====== CONFIG SYSTEM TESTS COMPLETED ======\n" << std::endl;
 }
 
@@ -880,4 +890,200 @@ bool ConfigTests::testMultipleServersWithSameHostPort()
         cleanupTestFile(testFile);
         return false;
     }
-}
\ No newline at end of file
+}
+
+// ===== Main Context Tests =====
+
+bool ConfigTests::testGlobalDirectives()
+{
+    const std::string testFile = "test_global_directives.conf";
+    const std::string content = 
+        "event_backend poll;\n"
+        "edge_triggered on;\n"
+        "read_buffer_size 8K;\n"
+        "io_budget 1M;\n"
+        "worker_processes 4;\n"
+        "worker_cpu_affinity on;\n"
+        "worker_threads 2;\n"
+        "accept_batch 128;\n"
+        "client_header_timeout 10;\n"
+        "client_body_timeout 30s;\n"
+        "send_timeout 500ms;\n"
+        "keepalive_timeout 2m;\n"
+        "access_log logs/access.log buffer=256K flush=5s;\n"
+        "access_log_format '$remote_addr \"$request\" $status $request_time';\n"
+        "\n"
+        "server {\n"
+        "    listen      127.0.0.1:8080 backlog=1024;\n"
+        "    \n"
+        "    location / {\n"
+        "        root        /var/www/html;\n"
+        "        allowed_methods GET;\n"
+        "    }\n"
+        "}\n";
+    
+    if (!createTestConfigFile(testFile, content))
+        return false;
+    
+    try {
+        ConfParser parser(testFile);
+        const GlobalConfig& global = parser.getGlobalConfig();
+        const ServerConfig* server = parser.getServers()[0];
+        bool result = (global.getEventBackend() == GlobalConfig::BACKEND_POLL &&
+                       global.isEdgeTriggered() &&
+                       global.getReadBufferSize() == 8 * 1024 &&
+                       global.getIoBudget() == 1024 * 1024 &&
+                       global.getWorkerProcesses() == 4 &&
+                       global.hasWorkerCpuAffinity() &&
+                       global.getWorkerThreads() == 2 &&
+                       global.getAcceptBatch() == 128 &&
+                       server->getPort() == 8080 &&
+                       server->getBacklog() == 1024 &&
+                       global.getClientHeaderTimeout() == 10 * 1000 &&
+                       global.getClientBodyTimeout() == 30 * 1000 &&
+                       global.getSendTimeout() == 500 &&
+                       global.getKeepaliveTimeout() == 2 * 60 * 1000 &&
+                       global.getAccessLog() == "logs/access.log" &&
+                       global.getAccessLogBufferSize() == 256 * 1024 &&
+                       global.getAccessLogFlush() == 5 * 1000 &&
+                       global.getAccessLogFormat() == "$remote_addr \"$request\" $status $request_time");
+        
+        cleanupTestFile(testFile);
+        return result;
+    } catch (const std::exception& e) {
+        std::cerr << "Error in testGlobalDirectives: " << e.what() << std::endl;
+        cleanupTestFile(testFile);
+        return false;
+    }
+}
+
+bool ConfigTests::testInvalidGlobalDirective()
+{
+    const std::string testFile = "test_invalid_global_directive.conf";
+    const std::string content = 
+        "io_budget 0;\n" // Budget must be positive
+        "\n"
+        "server {\n"
+        "    listen      127.0.0.1:8080;\n"
+        "    \n"
+        "    location / {\n"
+        "        root        /var/www/html;\n"
+        "        allowed_methods GET;\n"
+        "    }\n"
+        "}\n";
+    
+    if (!createTestConfigFile(testFile, content))
+        return false;
+    
+    try {
+        ConfParser parser(testFile);
+        // Should not reach here
+        cleanupTestFile(testFile);
+        return false;
+    } catch (const ConfigException& e) {
+        // Expected to throw a ConfigException
+        cleanupTestFile(testFile);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Unexpected error in testInvalidGlobalDirective: " << e.what() << std::endl;
+        cleanupTestFile(testFile);
+        return false;
+    }
+}
+
+// ===== File Cache Tests =====
+
+bool ConfigTests::testFileCacheDirectives()
+{
+    const std::string testFile = "test_file_cache_directives.conf";
+    const std::string content = 
+        "server {\n"
+        "    listen      127.0.0.1:8080;\n"
+        "    file_cache_size 4M;\n"
+        "    \n"
+        "    location / {\n"
+        "        root        /var/www/html;\n"
+        "        allowed_methods GET;\n"
+        "        file_cache_max_entry 64K;\n"
+        "    }\n"
+        "    location /images {\n"
+        "        root        /var/www/images;\n"
+        "        allowed_methods GET;\n"
+        "    }\n"
+        "}\n";
+    
+    if (!createTestConfigFile(testFile, content))
+        return false;
+    
+    try {
+        ConfParser parser(testFile);
+        ServerConfig* server = parser.getServers()[0];
+        const std::vector<LocationConfig*>& locations = server->getLocations();
+        
+        // The second location keeps the default per-entry limit
+        bool result = (server->getFileCacheSize() == 4 * 1024 * 1024 &&
+                       locations.size() == 2 &&
+                       locations[0]->getFileCacheMaxEntry() == 64 * 1024 &&
+                       locations[1]->getFileCacheMaxEntry() == 1024 * 1024);
+        
+        cleanupTestFile(testFile);
+        return result;
+    } catch (const std::exception& e) {
+        std::cerr << "Error in testFileCacheDirectives: " << e.what() << std::endl;
+        cleanupTestFile(testFile);
+        return false;
+    }
+}
+
+// ===== Compression Tests =====
+
+bool ConfigTests::testGzipDirectives()
+{
+    const std::string testFile = "test_gzip_directives.conf";
+    const std::string content = 
+        "server {\n"
+        "    listen      127.0.0.1:8080;\n"
+        "    \n"
+        "    location / {\n"
+        "        root        /var/www/html;\n"
+        "        allowed_methods GET;\n"
+        "        gzip on;\n"
+        "        gzip_static on;\n"
+        "        gzip_types text/html application/json;\n"
+        "        gzip_min_length 2K;\n"
+        "        gzip_comp_level 6;\n"
+        "    }\n"
+        "    location /images {\n"
+        "        root        /var/www/images;\n"
+        "        allowed_methods GET;\n"
+        "    }\n"
+        "}\n";
+    
+    if (!createTestConfigFile(testFile, content))
+        return false;
+    
+    try {
+        ConfParser parser(testFile);
+        const std::vector<LocationConfig*>& locations = parser.getServers()[0]->getLocations();
+        
+        // Parameters are ignored when matching types, the second location keeps the defaults
+        bool result = (locations.size() == 2 &&
+                       locations[0]->getGzip() && locations[0]->getGzipStatic() &&
+                       locations[0]->getGzipTypes().size() == 2 &&
+                       locations[0]->isGzipType("application/json; charset=utf-8") &&
+                       !locations[0]->isGzipType("text/css") &&
+                       locations[0]->getGzipMinLength() == 2 * 1024 &&
+                       locations[0]->getGzipCompLevel() == 6 &&
+                       !locations[1]->getGzip() && !locations[1]->getGzipStatic() &&
+                       locations[1]->isGzipType("text/css") &&
+                       locations[1]->getGzipMinLength() == 1024 &&
+                       locations[1]->getGzipCompLevel() == 1);
+        
+        cleanupTestFile(testFile);
+        return result;
+    } catch (const std::exception& e) {
+        std::cerr << "Error in testGzipDirectives: " << e.what() << std::endl;
+        cleanupTestFile(testFile);
+        return false;
+    }
+}
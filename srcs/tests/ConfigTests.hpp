@@ -49,4 +49,14 @@ private:
     static bool testMissingClosingBrace();
     static bool testUnknownDirective();
     static bool testMultipleServersWithSameHostPort();
+
+    // Main context tests
+    static bool testGlobalDirectives();
+    static bool testInvalidGlobalDirective();
+
+    // File cache tests
+    static bool testFileCacheDirectives();
+
+    // Compression tests
+    static bool testGzipDirectives();
 };
\ No newline at end of file
@@ -43,7 +43,16 @@ private:
     static bool testFileServing();
     static bool testDirectoryListing();
     static bool testFileUpload();
+    static bool testMultipartStreaming();
     static bool testCgiExecution();
+    static bool testRequestFraming();
+    static bool testRequestParser();
+    static bool testByteRanges();
+    static bool testValidators();
+    static bool testTimerWheel();
+    static bool testAccessLog();
+    static bool testContentCoding();
+    static bool testMultiplexer();
     
     // Helper for HTTP request simulation
     static bool simulateRequest(
@@ -1,4 +1,80 @@
 #include "DebugLogger.hpp"
 
 // Initialize static member
-bool DebugLogger::_enabled = false;
\ No newline at end of file
+int DebugLogger::_level = WEBSERV_LOG_WARN;
+
+int DebugLogger::parseLevel(const std::string& name)
+{
+    if (name == "error")
+        return WEBSERV_LOG_ERROR;
+    if (name == "warn")
+        return WEBSERV_LOG_WARN;
+    if (name == "info")
+        return WEBSERV_LOG_INFO;
+    if (name == "debug")
+        return WEBSERV_LOG_DEBUG;
+    return -1;
+}
+
+void DebugLogger::write(int level, const std::string& message)
+{
+    switch (level) {
+        case WEBSERV_LOG_ERROR:
+            std::cerr << "[ERROR] " << message << '\n';
+            break;
+        case WEBSERV_LOG_WARN:
+            std::cerr << "[WARN] " << message << '\n';
+            break;
+        case WEBSERV_LOG_INFO:
+            std::cout << "[INFO] " << message << '\n';
+            break;
+        default:
+            std::cout << "[DEBUG] " << message << '\n';
+            break;
+    }
+}
+
+void DebugLogger::logRequest(const std::string& clientIp, const std::string& method,
+                             const std::string& path, const std::string& headers)
+{
+    std::cout << "\n[REQUEST] " << clientIp << " - " << method << " " << path << '\n'
+              << "------- Headers -------\n"
+              << headers << '\n'
+              << "----------------------\n";
+}
+
+void DebugLogger::logResponse(int statusCode, const std::string& headers)
+{
+    std::cout << "\n[RESPONSE] Status: " << statusCode << '\n'
+              << "------- Headers -------\n"
+              << headers << '\n'
+              << "----------------------\n";
+}
+
+void DebugLogger::hexDump(const std::string& label, const char* data, size_t size, size_t maxBytes)
+{
+    if (size == 0)
+        return;
+
+    std::cout << "[HEXDUMP] " << label << " (" << size << " bytes):\n";
+
+    static const char digits[] = "0123456789abcdef";
+    size_t bytes = size > maxBytes ? maxBytes : size;
+    std::string line;
+
+    for (size_t i = 0; i < bytes; ++i) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        line += digits[c >> 4];
+        line += digits[c & 0x0f];
+        line += ' ';
+
+        if ((i + 1) % 16 == 0 || i == bytes - 1) {
+            std::cout << line << '\n';
+            line.clear();
+        }
+    }
+
+    if (size > maxBytes) {
+        std::cout << "... " << (size - maxBytes) << " more bytes\n";
+    }
+}
@@ -4,84 +4,115 @@
 #include <string>
 #include <sstream>
 
+// Log levels, from most to least severe
+#define WEBSERV_LOG_ERROR 0     // Server-side failures (CGI, file system, sockets)
+#define WEBSERV_LOG_WARN  1     // Degraded but handled (client I/O errors, killed scripts)
+#define WEBSERV_LOG_INFO  2     // Connection and request lifecycle, client mistakes
+#define WEBSERV_LOG_DEBUG 3     // Parser and I/O tracing
+
+// Most verbose level compiled in. Statements above it sit in a dead branch
+// the compiler drops, arguments included; release builds lower it
+// (make LOG_LEVEL=1).
+#ifndef WEBSERV_LOG_LEVEL
+# define WEBSERV_LOG_LEVEL WEBSERV_LOG_DEBUG
+#endif
+
+/**
+ * @brief Log a message if its level is enabled at run time
+ *
+ * The message is a stream expression (LOG_DEBUG("Read " << n << " bytes")),
+ * only evaluated when the level is on, so disabled statements cost a single
+ * comparison.
+ */
+#define WEBSERV_LOG(level, message)                                     \
+    do {                                                                \
+        if (DebugLogger::isEnabled(level)) {                            \
+            std::ostringstream webservLogStream_;                       \
+            webservLogStream_ << message;                               \
+            DebugLogger::write(level, webservLogStream_.str());         \
+        }                                                               \
+    } while (0)
+
+// Type-checks the message, then compiles to nothing
+#define WEBSERV_LOG_DISABLED(message)                                   \
+    do {                                                                \
+        if (false) {                                                    \
+            std::ostringstream webservLogStream_;                       \
+            webservLogStream_ << message;                               \
+        }                                                               \
+    } while (0)
+
+#if WEBSERV_LOG_LEVEL >= WEBSERV_LOG_ERROR
+# define LOG_ERROR(message) WEBSERV_LOG(WEBSERV_LOG_ERROR, message)
+#else
+# define LOG_ERROR(message) WEBSERV_LOG_DISABLED(message)
+#endif
+
+#if WEBSERV_LOG_LEVEL >= WEBSERV_LOG_WARN
+# define LOG_WARN(message) WEBSERV_LOG(WEBSERV_LOG_WARN, message)
+#else
+# define LOG_WARN(message) WEBSERV_LOG_DISABLED(message)
+#endif
+
+#if WEBSERV_LOG_LEVEL >= WEBSERV_LOG_INFO
+# define LOG_INFO(message) WEBSERV_LOG(WEBSERV_LOG_INFO, message)
+#else
+# define LOG_INFO(message) WEBSERV_LOG_DISABLED(message)
+#endif
+
+#if WEBSERV_LOG_LEVEL >= WEBSERV_LOG_DEBUG
+# define LOG_DEBUG(message) WEBSERV_LOG(WEBSERV_LOG_DEBUG, message)
+# define LOG_DEBUG_ENABLED() DebugLogger::isEnabled(WEBSERV_LOG_DEBUG)
+#else
+# define LOG_DEBUG(message) WEBSERV_LOG_DISABLED(message)
+# define LOG_DEBUG_ENABLED() false
+#endif
+
+/**
+ * @brief Leveled logger behind the LOG_* macros
+ *
+ * Errors and warnings go to stderr, the rest to stdout. Nothing is flushed
+ * explicitly: stdout stays buffered when redirected, so tracing does not
+ * cost a write() per line on the I/O path.
+ */
 class DebugLogger {
 private:
-    static bool _enabled;
+    static int _level;
 
 public:
-    static void enable() { _enabled = true; }
-    static void disable() { _enabled = false; }
-    static bool isEnabled() { return _enabled; }
-    
-    // C++98 compatible toString template
-    template<typename T>
-    static std::string toString(const T& value) {
-        std::stringstream ss;
-        ss << value;
-        return ss.str();
-    }
-    
-    static void log(const std::string& message) {
-        if (_enabled) {
-            std::cout << "[DEBUG] " << message << std::endl;
-        }
-    }
-    
-    template<typename T>
-    static void log(const std::string& prefix, const T& value) {
-        if (_enabled) {
-            std::cout << "[DEBUG] " << prefix << ": " << value << std::endl;
-        }
-    }
-    
-    static void logRequest(const std::string& clientIp, const std::string& method, 
-                        const std::string& path, const std::string& headers) {
-        if (_enabled) {
-            std::cout << "\n[REQUEST] " << clientIp << " - " << method << " " << path << std::endl;
-            std::cout << "------- Headers -------" << std::endl;
-            std::cout << headers << std::endl;
-            std::cout << "----------------------" << std::endl;
-        }
-    }
-    
-    static void logResponse(int statusCode, const std::string& headers) {
-        if (_enabled) {
-            std::stringstream ss;
-            ss << statusCode;
-            std::cout << "\n[RESPONSE] Status: " << ss.str() << std::endl;
-            std::cout << "------- Headers -------" << std::endl;
-            std::cout << headers << std::endl;
-            std::cout << "----------------------" << std::endl;
-        }
-    }
-    
-    static void logError(const std::string& message) {
-        if (_enabled) {
-            std::cerr << "[ERROR] " << message << std::endl;
-        }
-    }
-    
-    static void hexDump(const std::string& label, const std::string& data, size_t maxBytes = 100) {
-        if (!_enabled || data.empty())
-            return;
-            
-        std::cout << "[HEXDUMP] " << label << " (" << data.size() << " bytes):" << std::endl;
-        
-        std::stringstream ss;
-        size_t bytes = data.size() > maxBytes ? maxBytes : data.size();
-        
-        for (size_t i = 0; i < bytes; ++i) {
-            unsigned char c = static_cast<unsigned char>(data[i]);
-            ss << std::hex << (c < 16 ? "0" : "") << (int)c << " ";
-            
-            if ((i + 1) % 16 == 0 || i == bytes - 1) {
-                std::cout << ss.str() << std::endl;
-                ss.str("");
-            }
-        }
-        
-        if (data.size() > maxBytes) {
-            std::cout << "... " << (data.size() - maxBytes) << " more bytes" << std::endl;
-        }
-    }
-};
\ No newline at end of file
+    // --debug: everything
+    static void enable() { _level = WEBSERV_LOG_DEBUG; }
+    // Back to the default level
+    static void disable() { _level = WEBSERV_LOG_WARN; }
+    static void setLevel(int level) { _level = level; }
+    static int getLevel() { return _level; }
+    static bool isEnabled(int level) { return level <= _level; }
+
+    /**
+     * @brief Convert a level name ("error", "warn", "info", "debug")
+     *
+     * @return int Level, -1 if the name is unknown
+     */
+    static int parseLevel(const std::string& name);
+
+    /**
+     * @brief Write one line with its level prefix (use the LOG_* macros)
+     */
+    static void write(int level, const std::string& message);
+
+    /**
+     * @brief Dump request headers (call under LOG_DEBUG_ENABLED())
+     */
+    static void logRequest(const std::string& clientIp, const std::string& method,
+                           const std::string& path, const std::string& headers);
+
+    /**
+     * @brief Dump response headers (call under LOG_DEBUG_ENABLED())
+     */
+    static void logResponse(int statusCode, const std::string& headers);
+
+    /**
+     * @brief Hex dump of the first bytes of a buffer (call under LOG_DEBUG_ENABLED())
+     */
+    static void hexDump(const std::string& label, const char* data, size_t size, size_t maxBytes = 100);
+};
@@ -0,0 +1,392 @@
+#include "DirectoryListing.hpp"
+#include "StringUtils.hpp"
+#include "TimeUtils.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Work charged for an entry skipped by the offset, so a large offset is
+// also walked through a slice at a time
+static const size_t SKIP_COST = 64;
+
+static void appendHtmlEscaped(std::string& out, const std::string& text)
+{
+    for (size_t i = 0; i < text.size(); ++i) {
+        switch (text[i]) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default: out += text[i]; break;
+        }
+    }
+}
+
+static void appendJsonString(std::string& out, const std::string& text)
+{
+    static const char HEX[] = "0123456789abcdef";
+    out += '"';
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = text[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            out += "\\u00";
+            out += HEX[c >> 4];
+            out += HEX[c & 0x0F];
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+// Percent-encode a file name for use as a relative URL path segment
+static void appendPathEscaped(std::string& out, const std::string& name)
+{
+    static const char HEX[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < name.size(); ++i) {
+        unsigned char c = name[i];
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += HEX[c >> 4];
+            out += HEX[c & 0x0F];
+        }
+    }
+}
+
+DirectoryListing::DirectoryListing(const std::string& requestPath, Format format, size_t offset, size_t limit)
+    : _requestPath(requestPath), _format(format), _offset(offset), _limit(limit), _dir(NULL),
+      _entries(), _next(0), _skip(offset), _remaining(limit), _shown(0), _started(false),
+      _buffered(false), _eof(false), _done(false), _failed(false)
+{
+}
+
+DirectoryListing::~DirectoryListing()
+{
+    _close();
+}
+
+const char* DirectoryListing::contentType(Format format)
+{
+    return format == FORMAT_JSON ? "application/json" : "text/html";
+}
+
+bool DirectoryListing::isBuffered() const
+{
+    return _buffered;
+}
+
+bool DirectoryListing::hasFailed() const
+{
+    return _failed;
+}
+
+bool DirectoryListing::open(const std::string& dirPath)
+{
+    int dirFd = ::open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return false;
+    }
+    _dir = fdopendir(dirFd);
+    if (!_dir) {
+        ::close(dirFd);
+        return false;
+    }
+
+    // A directory that fits is read whole and sorted
+    Entry entry;
+    while (_entries.size() <= SORT_LIMIT && _readEntry(entry)) {
+        _entries.push_back(entry);
+    }
+    if (_failed) {
+        return false;
+    }
+    if (_eof) {
+        std::sort(_entries.begin(), _entries.end(), _listingOrder);
+        _buffered = true;
+    }
+    return true;
+}
+
+bool DirectoryListing::read(std::string& out, size_t maxBytes)
+{
+    if (_done) {
+        return false;
+    }
+
+    size_t start = out.size();
+    size_t work = 0;
+    if (!_started) {
+        _appendPrologue(out);
+        _started = true;
+    }
+
+    Entry entry;
+    while (out.size() - start + work < maxBytes) {
+        if (_skip > 0) {
+            if (!_nextEntry(entry)) {
+                break;
+            }
+            --_skip;
+            work += SKIP_COST;
+            continue;
+        }
+        if (_remaining == 0) {
+            // Only look for one more entry, to offer the next page
+            _appendEpilogue(out, _nextEntry(entry));
+            _close();
+            _done = true;
+            return false;
+        }
+        if (!_nextEntry(entry)) {
+            break;
+        }
+        _stat(entry);
+        _appendEntry(out, entry);
+        ++_shown;
+        if (_remaining != NO_LIMIT) {
+            --_remaining;
+        }
+    }
+
+    if (!_eof || _next < _entries.size()) {
+        return true;  // Slice full
+    }
+    _close();
+    _done = true;
+    if (!_failed) {
+        _appendEpilogue(out, false);
+    }
+    return false;
+}
+
+bool DirectoryListing::_nextEntry(Entry& entry)
+{
+    if (_next < _entries.size()) {
+        entry = _entries[_next++];
+        if (_next == _entries.size() && !_eof) {
+            // Read-ahead of a large directory used up, the rest is streamed
+            std::vector<Entry>().swap(_entries);
+            _next = 0;
+        }
+        return true;
+    }
+    return !_eof && _readEntry(entry);
+}
+
+bool DirectoryListing::_readEntry(Entry& entry)
+{
+    for (;;) {
+        errno = 0;
+        struct dirent* dirent = readdir(_dir);
+        if (!dirent) {
+            _failed = (errno != 0);
+            _eof = true;
+            return false;
+        }
+
+        // Skip hidden files, which includes "." and ".."
+        if (dirent->d_name[0] == '.') {
+            continue;
+        }
+
+        entry.name = dirent->d_name;
+        entry.isDirectory = (dirent->d_type == DT_DIR);
+        entry.statted = false;
+        entry.hasInfo = false;
+        entry.size = 0;
+        entry.modTime = 0;
+
+        // Symlinks and filesystems without d_type are classified by their target
+        if (dirent->d_type == DT_LNK || dirent->d_type == DT_UNKNOWN) {
+            _stat(entry);
+        }
+        return true;
+    }
+}
+
+void DirectoryListing::_stat(Entry& entry)
+{
+    if (entry.statted) {
+        return;
+    }
+    entry.statted = true;
+
+    // Relative to the directory: no path is built or resolved again
+    struct stat info;
+    if (fstatat(dirfd(_dir), entry.name.c_str(), &info, 0) == 0) {
+        entry.hasInfo = true;
+        entry.isDirectory = S_ISDIR(info.st_mode);
+        entry.size = info.st_size;
+        entry.modTime = info.st_mtime;
+    }
+}
+
+void DirectoryListing::_close()
+{
+    if (_dir) {
+        closedir(_dir);  // Also closes the descriptor
+        _dir = NULL;
+    }
+}
+
+// Directories first, then by name
+bool DirectoryListing::_listingOrder(const Entry& a, const Entry& b)
+{
+    if (a.isDirectory != b.isDirectory) {
+        return a.isDirectory;
+    }
+    return a.name < b.name;
+}
+
+void DirectoryListing::_appendPrologue(std::string& out) const
+{
+    if (_format == FORMAT_JSON) {
+        out += "{\"path\":";
+        appendJsonString(out, _requestPath);
+        out += ",\"offset\":";
+        StringUtils::appendUnsigned(out, _offset);
+        out += ",\"entries\":[";
+        return;
+    }
+
+    out += "<!DOCTYPE html>\r\n"
+           "<html>\r\n"
+           "<head>\r\n"
+           "    <title>Index of ";
+    appendHtmlEscaped(out, _requestPath);
+    out += "</title>\r\n"
+           "    <style>\r\n"
+           "        body { font-family: Arial, sans-serif; margin: 20px; }\r\n"
+           "        h1 { border-bottom: 1px solid #ccc; padding-bottom: 10px; }\r\n"
+           "        table { border-collapse: collapse; width: 100%; }\r\n"
+           "        th, td { text-align: left; padding: 8px; }\r\n"
+           "        tr:nth-child(even) { background-color: #f2f2f2; }\r\n"
+           "        th { background-color: #4CAF50; color: white; }\r\n"
+           "        a { text-decoration: none; color: #0066cc; }\r\n"
+           "        a:hover { text-decoration: underline; }\r\n"
+           "    </style>\r\n"
+           "</head>\r\n"
+           "<body>\r\n"
+           "    <h1>Index of ";
+    appendHtmlEscaped(out, _requestPath);
+    out += "</h1>\r\n"
+           "    <table>\r\n"
+           "        <tr>\r\n"
+           "            <th>Name</th>\r\n"
+           "            <th>Last Modified (UTC)</th>\r\n"
+           "            <th>Size</th>\r\n"
+           "        </tr>\r\n";
+
+    // Add parent directory link (except for root)
+    if (_requestPath != "/") {
+        out += "        <tr>\r\n"
+               "            <td><a href=\"../\">Parent Directory</a></td>\r\n"
+               "            <td>-</td>\r\n"
+               "            <td>-</td>\r\n"
+               "        </tr>\r\n";
+    }
+}
+
+void DirectoryListing::_appendEntry(std::string& out, const Entry& entry) const
+{
+    char date[TimeUtils::DATE_TIME_LENGTH + 1];
+    if (entry.hasInfo) {
+        TimeUtils::formatDateTime(date, entry.modTime);
+    }
+
+    if (_format == FORMAT_JSON) {
+        if (_shown > 0) {
+            out += ',';
+        }
+        out += "\r\n{\"name\":";
+        appendJsonString(out, entry.name);
+        out += entry.isDirectory ? ",\"type\":\"directory\"" : ",\"type\":\"file\"";
+        if (entry.hasInfo) {
+            if (!entry.isDirectory) {
+                out += ",\"size\":";
+                StringUtils::appendUnsigned(out, entry.size);
+            }
+            // ISO 8601
+            date[10] = 'T';
+            out += ",\"modified\":\"";
+            out.append(date, TimeUtils::DATE_TIME_LENGTH);
+            out += "Z\"";
+        }
+        out += '}';
+        return;
+    }
+
+    out += "        <tr>\r\n"
+           "            <td><a href=\"";
+    appendPathEscaped(out, entry.name);
+    if (entry.isDirectory) {
+        out += '/';
+    }
+    out += "\">";
+    appendHtmlEscaped(out, entry.name);
+    if (entry.isDirectory) {
+        out += '/';
+    }
+    out += "</a></td>\r\n"
+           "            <td>";
+    if (entry.hasInfo) {
+        out.append(date, TimeUtils::DATE_TIME_LENGTH);
+    } else {
+        out += '-';
+    }
+    out += "</td>\r\n"
+           "            <td>";
+    if (entry.isDirectory || !entry.hasInfo) {
+        out += '-';
+    } else if (entry.size < 1024) {
+        StringUtils::appendUnsigned(out, entry.size);
+        out += " B";
+    } else if (entry.size < 1024 * 1024) {
+        StringUtils::appendUnsigned(out, entry.size / 1024);
+        out += " KB";
+    } else {
+        StringUtils::appendUnsigned(out, entry.size / (1024 * 1024));
+        out += " MB";
+    }
+    out += "</td>\r\n"
+           "        </tr>\r\n";
+}
+
+void DirectoryListing::_appendEpilogue(std::string& out, bool more) const
+{
+    if (_format == FORMAT_JSON) {
+        out += more ? "\r\n],\"more\":true}\r\n" : "\r\n],\"more\":false}\r\n";
+        return;
+    }
+
+    out += "    </table>\r\n";
+    if (_offset > 0 && _limit != NO_LIMIT) {
+        _appendPageLink(out, _offset > _limit ? _offset - _limit : 0, "Previous page");
+    }
+    if (more) {
+        _appendPageLink(out, _offset + _shown, "Next page");
+    }
+    out += "    <hr>\r\n"
+           "    <p>WebServer</p>\r\n"
+           "</body>\r\n"
+           "</html>\r\n";
+}
+
+void DirectoryListing::_appendPageLink(std::string& out, size_t offset, const char* label) const
+{
+    out += "    <p><a href=\"?offset=";
+    StringUtils::appendUnsigned(out, offset);
+    out += "&amp;limit=";
+    StringUtils::appendUnsigned(out, _limit);
+    out += "\">";
+    out += label;
+    out += "</a></p>\r\n";
+}
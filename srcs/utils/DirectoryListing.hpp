@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ctime>
+#include <sys/types.h>
+#include <dirent.h>
+
+/**
+ * @brief Class to render an autoindex page a slice at a time
+ *
+ * Entries are read relative to the open directory: d_type classifies
+ * them and a single fstatat() each supplies size and modification time
+ * (shown in UTC), only for the entries actually shown. Hidden files are
+ * left out.
+ *
+ * A directory of up to SORT_LIMIT entries is read at once and listed
+ * sorted, directories first. A larger one is listed in directory order
+ * as it is read, so memory and the time to the first byte do not grow
+ * with its size. Either way the page can be cut into pages with an
+ * offset and a limit, and rendered as HTML or JSON.
+ */
+class DirectoryListing {
+public:
+    enum Format {
+        FORMAT_HTML,
+        FORMAT_JSON
+    };
+
+    // Largest directory listed sorted
+    static const size_t SORT_LIMIT = 1024;
+
+    // No limit on the number of entries shown
+    static const size_t NO_LIMIT = static_cast<size_t>(-1);
+
+    /**
+     * @brief Construct a new DirectoryListing object
+     *
+     * @param requestPath Request path of the directory (title and links)
+     * @param format Output format
+     * @param offset Number of entries skipped
+     * @param limit Maximum number of entries shown, NO_LIMIT for all
+     */
+    DirectoryListing(const std::string& requestPath, Format format, size_t offset, size_t limit);
+    ~DirectoryListing();
+
+    /**
+     * @brief Open the directory and read ahead up to SORT_LIMIT entries
+     *
+     * @param dirPath Directory path
+     * @return false if the directory cannot be read
+     */
+    bool open(const std::string& dirPath);
+
+    /**
+     * @brief Check if the whole directory was read by open()
+     *
+     * The listing is then sorted and read() needs no more system calls
+     * than one fstatat() per entry shown.
+     */
+    bool isBuffered() const;
+
+    /**
+     * @brief Render the next slice of the page
+     *
+     * @param out Receives the rendered bytes, appended
+     * @param maxBytes Stop once about this much was rendered
+     * @return true while more follows, false once the page ended (or failed)
+     */
+    bool read(std::string& out, size_t maxBytes);
+
+    /**
+     * @brief Check if reading the directory failed part way
+     */
+    bool hasFailed() const;
+
+    /**
+     * @brief Get the Content-Type header value for a format
+     */
+    static const char* contentType(Format format);
+
+private:
+    // A directory entry, with the metadata shown in a listing
+    struct Entry {
+        std::string name;
+        bool isDirectory;
+        bool statted;      // fstatat() was called
+        bool hasInfo;      // fstatat() succeeded (false for dangling symlinks)
+        off_t size;
+        time_t modTime;
+    };
+
+    std::string _requestPath;
+    Format _format;
+    size_t _offset;
+    size_t _limit;
+    DIR* _dir;                      // Open until the page ends
+    std::vector<Entry> _entries;    // Read ahead by open()
+    size_t _next;                   // Next entry of _entries to show
+    size_t _skip;                   // Entries still to skip
+    size_t _remaining;              // Entries still to show
+    size_t _shown;
+    bool _started;
+    bool _buffered;                 // open() read the whole directory
+    bool _eof;                      // readdir() reached the end
+    bool _done;
+    bool _failed;
+
+    bool _nextEntry(Entry& entry);
+    bool _readEntry(Entry& entry);
+    void _stat(Entry& entry);
+    void _close();
+    void _appendPrologue(std::string& out) const;
+    void _appendEntry(std::string& out, const Entry& entry) const;
+    void _appendEpilogue(std::string& out, bool more) const;
+    void _appendPageLink(std::string& out, size_t offset, const char* label) const;
+
+    static bool _listingOrder(const Entry& a, const Entry& b);
+
+    // Prevent copying
+    DirectoryListing(const DirectoryListing& other);
+    DirectoryListing& operator=(const DirectoryListing& other);
+};
@@ -1,4 +1,5 @@
 #include "FileUtils.hpp"
+#include "DirectoryListing.hpp"
 #include <fstream>
 #include <sstream>
 #include <sys/stat.h>
@@ -8,6 +9,8 @@
 #include <cstring>
 #include <algorithm> // Add this for std::sort
 #include <cstdlib>   // Add this for realpath
+#include <fcntl.h>
+#include <pthread.h>
 
 bool FileUtils::fileExists(const std::string& path)
 {
@@ -27,7 +30,7 @@ bool FileUtils::isDirectory(const std::string& path)
     // If path doesn't end with slash, try with slash
     if (!path.empty() && path[path.length() - 1] != '/') {
         if (stat((path + "/").c_str(), &buffer) == 0 && S_ISDIR(buffer.st_mode)) {
-            std::cout << "url request is a directory with no / at the end\n";
+            LOG_DEBUG("url request is a directory with no / at the end");
             return true;
         }
     }
@@ -36,7 +39,7 @@ bool FileUtils::isDirectory(const std::string& path)
     if (!path.empty() && path[path.length() - 1] == '/') {
         std::string withoutSlash = path.substr(0, path.length() - 1);
         if (stat(withoutSlash.c_str(), &buffer) == 0 && S_ISDIR(buffer.st_mode)) {
-            std::cout << "url request is a directory with added / at the end\n";
+            LOG_DEBUG("url request is a directory with added / at the end");
             return true;
         }
     }
@@ -120,195 +123,84 @@ std::string FileUtils::getMimeType(const std::string& extension)
     return "application/octet-stream";
 }
 
-const std::map<std::string, std::string>& FileUtils::getMimeTypes()
+static std::map<std::string, std::string> buildMimeTypes()
 {
-    static std::map<std::string, std::string> mimeTypes;
-    
-    // Initialize on first call
-    if (mimeTypes.empty()) {
-        // Text
-        mimeTypes["html"] = "text/html";
-        mimeTypes["htm"] = "text/html";
-        mimeTypes["css"] = "text/css";
-        mimeTypes["js"] = "text/javascript";
-        mimeTypes["txt"] = "text/plain";
-        mimeTypes["md"] = "text/markdown";
-        mimeTypes["csv"] = "text/csv";
-        
-        // Images
-        mimeTypes["gif"] = "image/gif";
-        mimeTypes["jpg"] = "image/jpeg";
-        mimeTypes["jpeg"] = "image/jpeg";
-        mimeTypes["png"] = "image/png";
-        mimeTypes["svg"] = "image/svg+xml";
-        mimeTypes["ico"] = "image/x-icon";
-        mimeTypes["webp"] = "image/webp";
-        
-        // Audio
-        mimeTypes["mp3"] = "audio/mpeg";
-        mimeTypes["wav"] = "audio/wav";
-        mimeTypes["ogg"] = "audio/ogg";
-        
-        // Video
-        mimeTypes["mp4"] = "video/mp4";
-        mimeTypes["webm"] = "video/webm";
-        
-        // Applications
-        mimeTypes["json"] = "application/json";
-        mimeTypes["xml"] = "application/xml";
-        mimeTypes["pdf"] = "application/pdf";
-        mimeTypes["zip"] = "application/zip";
-        mimeTypes["gz"] = "application/gzip";
-        mimeTypes["tar"] = "application/x-tar";
-        
-        // Fonts
-        mimeTypes["ttf"] = "font/ttf";
-        mimeTypes["woff"] = "font/woff";
-        mimeTypes["woff2"] = "font/woff2";
-    }
+    std::map<std::string, std::string> mimeTypes;
+    
+    // Text
+    mimeTypes["html"] = "text/html";
+    mimeTypes["htm"] = "text/html";
+    mimeTypes["css"] = "text/css";
+    mimeTypes["js"] = "text/javascript";
+    mimeTypes["txt"] = "text/plain";
+    mimeTypes["md"] = "text/markdown";
+    mimeTypes["csv"] = "text/csv";
+    
+    // Images
+    mimeTypes["gif"] = "image/gif";
+    mimeTypes["jpg"] = "image/jpeg";
+    mimeTypes["jpeg"] = "image/jpeg";
+    mimeTypes["png"] = "image/png";
+    mimeTypes["svg"] = "image/svg+xml";
+    mimeTypes["ico"] = "image/x-icon";
+    mimeTypes["webp"] = "image/webp";
+    
+    // Audio
+    mimeTypes["mp3"] = "audio/mpeg";
+    mimeTypes["wav"] = "audio/wav";
+    mimeTypes["ogg"] = "audio/ogg";
+    
+    // Video
+    mimeTypes["mp4"] = "video/mp4";
+    mimeTypes["webm"] = "video/webm";
+    
+    // Applications
+    mimeTypes["json"] = "application/json";
+    mimeTypes["xml"] = "application/xml";
+    mimeTypes["pdf"] = "application/pdf";
+    mimeTypes["zip"] = "application/zip";
+    mimeTypes["gz"] = "application/gzip";
+    mimeTypes["tar"] = "application/x-tar";
+    
+    // Fonts
+    mimeTypes["ttf"] = "font/ttf";
+    mimeTypes["woff"] = "font/woff";
+    mimeTypes["woff2"] = "font/woff2";
     
     return mimeTypes;
 }
 
+static pthread_once_t mimeTypesOnce = PTHREAD_ONCE_INIT;
+static const std::map<std::string, std::string>* mimeTypesMap = NULL;
+
+static void buildMimeTypesOnce()
+{
+    mimeTypesMap = new std::map<std::string, std::string>(buildMimeTypes());
+}
+
+const std::map<std::string, std::string>& FileUtils::getMimeTypes()
+{
+    // Built once, by whichever event loop thread gets here first
+    pthread_once(&mimeTypesOnce, buildMimeTypesOnce);
+    return *mimeTypesMap;
+}
+
 std::string FileUtils::generateDirectoryListing(const std::string& dirPath, const std::string& requestPath)
 {
-    DIR* dir = opendir(dirPath.c_str());
-    if (!dir) {
+    DirectoryListing listing(requestPath, DirectoryListing::FORMAT_HTML, 0, DirectoryListing::NO_LIMIT);
+    if (!listing.open(dirPath)) {
         return "";
     }
     
-    std::stringstream html;
-    html << "<!DOCTYPE html>\r\n"
-         << "<html>\r\n"
-         << "<head>\r\n"
-         << "    <title>Index of " << requestPath << "</title>\r\n"
-         << "    <style>\r\n"
-         << "        body { font-family: Arial, sans-serif; margin: 20px; }\r\n"
-         << "        h1 { border-bottom: 1px solid #ccc; padding-bottom: 10px; }\r\n"
-         << "        table { border-collapse: collapse; width: 100%; }\r\n"
-         << "        th, td { text-align: left; padding: 8px; }\r\n"
-         << "        tr:nth-child(even) { background-color: #f2f2f2; }\r\n"
-         << "        th { background-color: #4CAF50; color: white; }\r\n"
-         << "        a { text-decoration: none; color: #0066cc; }\r\n"
-         << "        a:hover { text-decoration: underline; }\r\n"
-         << "    </style>\r\n"
-         << "</head>\r\n"
-         << "<body>\r\n"
-         << "    <h1>Index of " << requestPath << "</h1>\r\n"
-         << "    <table>\r\n"
-         << "        <tr>\r\n"
-         << "            <th>Name</th>\r\n"
-         << "            <th>Last Modified</th>\r\n"
-         << "            <th>Size</th>\r\n"
-         << "        </tr>\r\n";
-    
-    // Add parent directory link (except for root)
-    if (requestPath != "/") {
-        html << "        <tr>\r\n"
-             << "            <td><a href=\"../\">Parent Directory</a></td>\r\n"
-             << "            <td>-</td>\r\n"
-             << "            <td>-</td>\r\n"
-             << "        </tr>\r\n";
+    std::string html;
+    while (listing.read(html, std::string::npos)) {
     }
-    
-    // Read all directory entries
-    std::vector<std::string> files;
-    std::vector<std::string> directories;
-    
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        std::string name = entry->d_name;
-        
-        // Skip hidden files and the current/parent directory entries
-        if (name[0] == '.' && (name.length() == 1 || (name.length() == 2 && name[1] == '.'))) {
-            continue;
-        }
-        
-        // Skip other hidden files
-        if (name[0] == '.') {
-            continue;
-        }
-        
-        // Check if it's a directory
-        std::string fullPath = dirPath + "/" + name;
-        if (isDirectory(fullPath)) {
-            directories.push_back(name);
-        } else {
-            files.push_back(name);
-        }
-    }
-    
-    closedir(dir);
-    
-    // Sort directories and files
-    std::sort(directories.begin(), directories.end());
-    std::sort(files.begin(), files.end());
-    
-    // Add directories first
-    for (std::vector<std::string>::const_iterator it = directories.begin(); it != directories.end(); ++it) {
-        std::string fullPath = dirPath + "/" + *it;
-        struct stat buffer;
-        stat(fullPath.c_str(), &buffer);
-        
-        // Format modification time (C++98 compatible)
-        std::stringstream modTime;
-        struct tm* timeinfo = localtime(&buffer.st_mtime);
-        char timeBuf[64];
-        strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%d %H:%M:%S", timeinfo);
-        modTime << timeBuf;
-        
-        html << "        <tr>\r\n"
-             << "            <td><a href=\"" << *it << "/\">" << *it << "/</a></td>\r\n"
-             << "            <td>" << modTime.str() << "</td>\r\n"
-             << "            <td>-</td>\r\n"
-             << "        </tr>\r\n";
-    }
-    
-    // Add files
-    for (std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it) {
-        std::string fullPath = dirPath + "/" + *it;
-        struct stat buffer;
-        stat(fullPath.c_str(), &buffer);
-        
-        // Format modification time (C++98 compatible)
-        std::stringstream modTime;
-        struct tm* timeinfo = localtime(&buffer.st_mtime);
-        char timeBuf[64];
-        strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%d %H:%M:%S", timeinfo);
-        modTime << timeBuf;
-        
-        // Format size (C++98 compatible)
-        std::stringstream sizeStream;
-        if (buffer.st_size < 1024) {
-            sizeStream << buffer.st_size << " B";
-        } else if (buffer.st_size < 1024 * 1024) {
-            sizeStream << (buffer.st_size / 1024) << " KB";
-        } else {
-            sizeStream << (buffer.st_size / (1024 * 1024)) << " MB";
-        }
-        std::string sizeStr = sizeStream.str();
-        
-        html << "        <tr>\r\n"
-             << "            <td><a href=\"" << *it << "\">" << *it << "</a></td>\r\n"
-             << "            <td>" << modTime.str() << "</td>\r\n"
-             << "            <td>" << sizeStr << "</td>\r\n"
-             << "        </tr>\r\n";
-    }
-    
-    html << "    </table>\r\n"
-         << "    <hr>\r\n"
-         << "    <p>WebServer</p>\r\n"
-         << "</body>\r\n"
-         << "</html>\r\n";
-    
-    return html.str();
+    return listing.hasFailed() ? "" : html;
 }
 
 std::string FileUtils::resolvePath(const std::string& uriPath, const LocationConfig& location)
 {
-    DebugLogger::log("Resolving URI path: " + uriPath + 
-                  " for location path: " + location.getPath() + 
-                  " with root: " + location.getRoot());
+    LOG_DEBUG("Resolving URI path: " << uriPath << " for location path: " << location.getPath() << " with root: " << location.getRoot());
     
     std::string locationPath = location.getPath();
     std::string root = location.getRoot();
@@ -317,31 +209,31 @@ std::string FileUtils::resolvePath(const std::string& uriPath, const LocationCon
         char cwd[PATH_MAX];
         if (getcwd(cwd, sizeof(cwd)) != NULL) {
             root = std::string(cwd) + "/" + root;
-            DebugLogger::log("Converted relative root to absolute: " + root);
+            LOG_DEBUG("Converted relative root to absolute: " << root);
         }
     }
     
     // Ensure location path ends with a slash if it's not "/"
     if (locationPath != "/" && locationPath[locationPath.length() - 1] != '/') {
         locationPath += '/';
-        DebugLogger::log("Added trailing slash to location path: " + locationPath);
+        LOG_DEBUG("Added trailing slash to location path: " << locationPath);
     }
     
     // Ensure root ends with a slash
     if (!root.empty() && root[root.length() - 1] != '/') {
         root += '/';
-        DebugLogger::log("Added trailing slash to root path: " + root);
+        LOG_DEBUG("Added trailing slash to root path: " << root);
     }
     
     // Handle special case for root path
     if (uriPath == "/" || uriPath.empty()) {
-        DebugLogger::log("URI is root path, returning root directory: " + root);
+        LOG_DEBUG("URI is root path, returning root directory: " << root);
         return root;
     }
     
     // If the URI exactly matches the location path
     if (uriPath == location.getPath()) {
-        DebugLogger::log("URI exactly matches location path, returning root: " + root);
+        LOG_DEBUG("URI exactly matches location path, returning root: " << root);
         return root;
     }
     
@@ -353,19 +245,19 @@ std::string FileUtils::resolvePath(const std::string& uriPath, const LocationCon
         // If relativePath is empty but we're not dealing with root location,
         // we should return the root directory
         if (relativePath.empty() && locationPath != "/") {
-            DebugLogger::log("Empty relative path for non-root location, returning root: " + root);
+            LOG_DEBUG("Empty relative path for non-root location, returning root: " << root);
             return root;
         }
         
         // Ensure relativePath doesn't start with a slash
         if (!relativePath.empty() && relativePath[0] == '/') {
             relativePath = relativePath.substr(1);
-            DebugLogger::log("Removed leading slash from relative path: " + relativePath);
+            LOG_DEBUG("Removed leading slash from relative path: " << relativePath);
         }
         
         // Concatenate with root
         std::string result = root + relativePath;
-        DebugLogger::log("Resolved path: " + result);
+        LOG_DEBUG("Resolved path: " << result);
         return result;
     }
     
@@ -376,18 +268,18 @@ std::string FileUtils::resolvePath(const std::string& uriPath, const LocationCon
         // Ensure relativePath doesn't start with a slash
         if (!relativePath.empty() && relativePath[0] == '/') {
             relativePath = relativePath.substr(1);
-            DebugLogger::log("Removed leading slash from relative path: " + relativePath);
+            LOG_DEBUG("Removed leading slash from relative path: " << relativePath);
         }
         
         std::string result = root + relativePath;
-        DebugLogger::log("Resolved path for root location: " + result);
+        LOG_DEBUG("Resolved path for root location: " << result);
         return result;
     }
     
     // Default case: Just append the URI to the root
     // This is a fallback and should not normally be reached
     std::string result = root + uriPath;
-    DebugLogger::logError("Using fallback path resolution: " + result);
+    LOG_DEBUG("Using fallback path resolution: " << result);
     return result;
 }
 
@@ -487,4 +379,21 @@ std::string FileUtils::formatFileSize(size_t size)
     }
     
     return ss.str();
-}
\ No newline at end of file
+}
+bool FileUtils::createPipe(int fds[2], bool nonBlocking)
+{
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC | (nonBlocking ? O_NONBLOCK : 0)) == 0;
+#else
+    if (pipe(fds) < 0) {
+        return false;
+    }
+    for (int i = 0; i < 2; ++i) {
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        if (nonBlocking) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+        }
+    }
+    return true;
+#endif
+}
@@ -201,6 +201,8 @@ public:
     /**
      * @brief Generate an HTML directory listing for a directory
      * 
+     * The whole page at once, see DirectoryListing to render it in slices.
+     * 
      * @param dirPath Directory path
      * @param requestPath Request path (for URLs)
      * @return std::string HTML listing, empty string if error
@@ -274,6 +276,18 @@ public:
      */
     static bool deleteFile(const std::string& path);
     
+    /**
+     * @brief Create a pipe whose ends are closed on exec
+     * 
+     * The flag is set atomically where possible, so a fork() on another
+     * thread cannot leak the ends into its child.
+     * 
+     * @param fds Receives the read and write ends
+     * @param nonBlocking Also make both ends non-blocking
+     * @return bool True on success, errno is set otherwise
+     */
+    static bool createPipe(int fds[2], bool nonBlocking);
+    
 private:
     // Private constructor to prevent instantiation
     FileUtils();
@@ -191,4 +191,22 @@ std::string StringUtils::replace(const std::string& str, const std::string& from
     }
     
     return result;
-}
\ No newline at end of file
+}
+
+size_t StringUtils::formatUnsigned(char* buffer, unsigned long value)
+{
+    // Write the digits backwards, then reverse them in place
+    size_t length = 0;
+    do {
+        buffer[length++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    std::reverse(buffer, buffer + length);
+    return length;
+}
+
+void StringUtils::appendUnsigned(std::string& out, unsigned long value)
+{
+    char buffer[20];
+    out.append(buffer, formatUnsigned(buffer, value));
+}
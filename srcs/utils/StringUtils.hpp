@@ -116,6 +116,23 @@ public:
      */
     static std::string replace(const std::string& str, const std::string& from, const std::string& to);
 
+    /**
+     * @brief Format an unsigned number in decimal
+     * 
+     * @param buffer Output buffer, at least 20 characters
+     * @param value Number to format
+     * @return size_t Number of characters written (not NUL terminated)
+     */
+    static size_t formatUnsigned(char* buffer, unsigned long value);
+
+    /**
+     * @brief Append an unsigned number in decimal, without a temporary string
+     * 
+     * @param out String to append to
+     * @param value Number to append
+     */
+    static void appendUnsigned(std::string& out, unsigned long value);
+
 private:
     // Private constructor to prevent instantiation
     StringUtils();
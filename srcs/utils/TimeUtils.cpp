@@ -0,0 +1,183 @@
+#include "TimeUtils.hpp"
+#include <cstring>
+
+static const char* const DAY_NAMES[7] = {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+};
+
+static const char* const MONTH_NAMES[12] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+// Private constructor to prevent instantiation
+TimeUtils::TimeUtils() {}
+
+// Private destructor
+TimeUtils::~TimeUtils() {}
+
+static void putTwoDigits(char* out, int value)
+{
+    out[0] = static_cast<char>('0' + value / 10);
+    out[1] = static_cast<char>('0' + value % 10);
+}
+
+size_t TimeUtils::formatHttpDate(char* buffer, time_t when)
+{
+    struct tm tm;
+    gmtime_r(&when, &tm);
+
+    // Fixed layout, so no strftime() (and no locale) is needed
+    const char* day = DAY_NAMES[tm.tm_wday];
+    const char* month = MONTH_NAMES[tm.tm_mon];
+    int year = tm.tm_year + 1900;
+
+    buffer[0] = day[0];
+    buffer[1] = day[1];
+    buffer[2] = day[2];
+    buffer[3] = ',';
+    buffer[4] = ' ';
+    putTwoDigits(buffer + 5, tm.tm_mday);
+    buffer[7] = ' ';
+    buffer[8] = month[0];
+    buffer[9] = month[1];
+    buffer[10] = month[2];
+    buffer[11] = ' ';
+    putTwoDigits(buffer + 12, year / 100);
+    putTwoDigits(buffer + 14, year % 100);
+    buffer[16] = ' ';
+    putTwoDigits(buffer + 17, tm.tm_hour);
+    buffer[19] = ':';
+    putTwoDigits(buffer + 20, tm.tm_min);
+    buffer[22] = ':';
+    putTwoDigits(buffer + 23, tm.tm_sec);
+    buffer[25] = ' ';
+    buffer[26] = 'G';
+    buffer[27] = 'M';
+    buffer[28] = 'T';
+    buffer[29] = '\0';
+    return HTTP_DATE_LENGTH;
+}
+
+size_t TimeUtils::formatDateTime(char* buffer, time_t when)
+{
+    struct tm tm;
+    gmtime_r(&when, &tm);
+
+    int year = tm.tm_year + 1900;
+    putTwoDigits(buffer, year / 100);
+    putTwoDigits(buffer + 2, year % 100);
+    buffer[4] = '-';
+    putTwoDigits(buffer + 5, tm.tm_mon + 1);
+    buffer[7] = '-';
+    putTwoDigits(buffer + 8, tm.tm_mday);
+    buffer[10] = ' ';
+    putTwoDigits(buffer + 11, tm.tm_hour);
+    buffer[13] = ':';
+    putTwoDigits(buffer + 14, tm.tm_min);
+    buffer[16] = ':';
+    putTwoDigits(buffer + 17, tm.tm_sec);
+    buffer[19] = '\0';
+    return DATE_TIME_LENGTH;
+}
+
+static int parseTwoDigits(const char* in)
+{
+    if (in[0] < '0' || in[0] > '9' || in[1] < '0' || in[1] > '9') {
+        return -1;
+    }
+    return (in[0] - '0') * 10 + (in[1] - '0');
+}
+
+static int findMonth(const char* in)
+{
+    for (int i = 0; i < 12; ++i) {
+        if (in[0] == MONTH_NAMES[i][0] && in[1] == MONTH_NAMES[i][1] && in[2] == MONTH_NAMES[i][2]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool TimeUtils::parseHttpDate(const std::string& text, time_t& when)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+
+    // IMF-fixdate, what every current client sends: "Sun, 06 Nov 1994 08:49:37 GMT"
+    const char* in = text.c_str();
+    if (text.size() == HTTP_DATE_LENGTH) {
+        int century = parseTwoDigits(in + 12);
+        int year = parseTwoDigits(in + 14);
+        tm.tm_mday = parseTwoDigits(in + 5);
+        tm.tm_mon = findMonth(in + 8);
+        tm.tm_hour = parseTwoDigits(in + 17);
+        tm.tm_min = parseTwoDigits(in + 20);
+        tm.tm_sec = parseTwoDigits(in + 23);
+        if (in[3] != ',' || in[4] != ' ' || in[7] != ' ' || in[11] != ' ' || in[16] != ' ' ||
+            in[19] != ':' || in[22] != ':' || text.compare(25, 4, " GMT") != 0 ||
+            century < 0 || year < 0 || tm.tm_mday < 1 || tm.tm_mon < 0 ||
+            tm.tm_hour < 0 || tm.tm_min < 0 || tm.tm_sec < 0) {
+            return false;
+        }
+        tm.tm_year = century * 100 + year - 1900;
+    } else {
+        // Obsolete formats are rare enough for strptime()
+        const char* end = strptime(in, "%A, %d-%b-%y %H:%M:%S GMT", &tm);
+        if (!end || *end) {
+            memset(&tm, 0, sizeof(tm));
+            end = strptime(in, "%a %b %e %H:%M:%S %Y", &tm);
+        }
+        if (!end || *end) {
+            return false;
+        }
+    }
+
+    if (tm.tm_mday > 31 || tm.tm_hour > 23 || tm.tm_min > 59 || tm.tm_sec > 60) {
+        return false;
+    }
+    when = timegm(&tm);
+    return when != static_cast<time_t>(-1);
+}
+
+// The per-thread caches use __thread, a GCC/Clang extension: C++98 has no thread_local
+
+const char* TimeUtils::currentHttpDate()
+{
+    static __thread char cached[HTTP_DATE_LENGTH + 1];
+    static __thread time_t cachedAt = -1;
+
+    time_t now = time(NULL);
+    if (now != cachedAt) {
+        formatHttpDate(cached, now);
+        cachedAt = now;
+    }
+    return cached;
+}
+
+const char* TimeUtils::currentLogTime()
+{
+    static __thread char cached[64];
+    static __thread time_t cachedAt = -1;
+
+    time_t now = time(NULL);
+    if (now != cachedAt) {
+        struct tm tm;
+        localtime_r(&now, &tm);
+        if (strftime(cached, sizeof(cached), "%d/%b/%Y:%H:%M:%S %z", &tm) == 0) {
+            cached[0] = '\0';
+        }
+        cachedAt = now;
+    }
+    return cached;
+}
+
+uint64_t TimeUtils::monotonicMs()
+{
+    struct timespec now;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+    return static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <ctime>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * @brief Class containing HTTP date formatting utilities
+ */
+class TimeUtils
+{
+public:
+    // Length of an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+    static const size_t HTTP_DATE_LENGTH = 29;
+
+    // Length of a listing timestamp, e.g. "1994-11-06 08:49:37"
+    static const size_t DATE_TIME_LENGTH = 19;
+
+    /**
+     * @brief Format a time as an HTTP date (IMF-fixdate, RFC 9110 section 5.6.7)
+     * 
+     * @param buffer Output buffer, at least HTTP_DATE_LENGTH + 1 characters
+     * @param when Time to format
+     * @return size_t Number of characters written, excluding the NUL
+     */
+    static size_t formatHttpDate(char* buffer, time_t when);
+
+    /**
+     * @brief Format a time as "YYYY-MM-DD HH:MM:SS" in UTC, for listings
+     * 
+     * @param buffer Output buffer, at least DATE_TIME_LENGTH + 1 characters
+     * @param when Time to format
+     * @return size_t Number of characters written, excluding the NUL
+     */
+    static size_t formatDateTime(char* buffer, time_t when);
+
+    /**
+     * @brief Parse an HTTP date, as found in If-Modified-Since
+     * 
+     * Accepts the IMF-fixdate format we send as well as the obsolete
+     * RFC 850 and asctime() formats recipients must still understand.
+     * 
+     * @param text Header value
+     * @param when Receives the parsed time
+     * @return true if the value is a valid HTTP date
+     */
+    static bool parseHttpDate(const std::string& text, time_t& when);
+
+    /**
+     * @brief Get the current time as an HTTP date
+     * 
+     * The string is formatted at most once per second and reused. Each
+     * thread keeps its own copy, so event loop threads need no locking.
+     * 
+     * @return const char* Current date for the Date header, HTTP_DATE_LENGTH characters
+     */
+    static const char* currentHttpDate();
+
+    /**
+     * @brief Get the current local time in common log format
+     * 
+     * Same per-thread, once per second caching as currentHttpDate().
+     * 
+     * @return const char* Current time, e.g. "16/Oct/2026:14:03:27 +0200"
+     */
+    static const char* currentLogTime();
+
+    /**
+     * @brief Get a monotonic clock reading, for deadlines
+     * 
+     * Uses the coarse clock where available: it costs no more than a
+     * memory read and ticks every few milliseconds, which is all a
+     * timeout needs. Callers on a hot path read it once per wakeup.
+     * 
+     * @return uint64_t Milliseconds since an arbitrary starting point
+     */
+    static uint64_t monotonicMs();
+
+private:
+    // Private constructor to prevent instantiation
+    TimeUtils();
+    // Private destructor
+    ~TimeUtils();
+    // Private copy constructor and assignment operator to prevent copying
+    TimeUtils(const TimeUtils& other);
+    TimeUtils& operator=(const TimeUtils& other);
+};